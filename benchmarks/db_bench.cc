@@ -13,6 +13,9 @@
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/memtablerep.h"
+#include "leveldb/persistent_cache.h"
+#include "leveldb/slice_transform.h"
 #include "leveldb/write_batch.h"
 #include "port/port.h"
 #include "util/crc32c.h"
@@ -43,6 +46,7 @@
 //      compact     -- Compact the entire DB
 //      stats       -- Print DB stats
 //      sstables    -- Print sstable info
+//      cachestats  -- Print block cache stats per shard
 //      heapprofile -- Dump a heap profile (if supported by this port)
 static const char* FLAGS_benchmarks =
     "fillseq,"
@@ -100,6 +104,38 @@ static int FLAGS_block_size = 0;
 // Negative means use default settings.
 static int FLAGS_cache_size = -1;
 
+// Number of bytes to use as a cache of compressed blocks.
+// Negative means no compressed block cache.
+static int FLAGS_compressed_cache_size = -1;
+
+// Number of bytes to use as a cache of the entries point lookups find.
+// Negative means no row cache.
+static int FLAGS_row_cache_size = -1;
+
+// Directory of a persistent block cache, e.g. on a faster device than
+// the database.  Null means no persistent cache.
+static const char* FLAGS_persistent_cache_path = nullptr;
+
+// Number of bytes the persistent block cache may use.
+static int64_t FLAGS_persistent_cache_size = int64_t{1} << 30;
+
+// Block cache implementation: "lru" or "clock".
+static const char* FLAGS_cache_type = "lru";
+
+// Number of shards of the cache is 2^cache_shard_bits.  Negative means
+// pick it from the cache size (LRU cache only).
+static int FLAGS_cache_shard_bits = 4;
+
+// If true, the LRU cache does not cache entries that exceed its capacity.
+static bool FLAGS_cache_strict_capacity_limit = false;
+
+// Part of the cache reserved for entries inserted with high priority.
+static double FLAGS_cache_high_pri_pool_ratio = 0;
+
+// If true, store the index blocks and filters in the cache instead of
+// holding them in memory with the open tables.
+static bool FLAGS_cache_index_and_filter_blocks = false;
+
 // Maximum number of files to keep open at the same time (use default if == 0)
 static int FLAGS_open_files = 0;
 
@@ -107,9 +143,27 @@ static int FLAGS_open_files = 0;
 // Negative means use default settings.
 static int FLAGS_bloom_bits = -1;
 
+// Filter used if bloom_bits is not negative: "bloom", "blocked_bloom" or
+// "ribbon".  For ribbon, bloom_bits sets the false positive rate of a bloom
+// filter with that many bits per key.
+static const char* FLAGS_filter_type = "bloom";
+
+// If true, build one filter per table instead of one per 2KB of data.
+static bool FLAGS_full_filter = false;
+
+// If true, partition the index and filters of each table and read the
+// partitions through the block cache.
+static bool FLAGS_partition_index_and_filters = false;
+
+// If true, give data blocks a hash index for point lookups.
+static bool FLAGS_data_block_hash_index = false;
+
 // Common key prefix length.
 static int FLAGS_key_prefix = 0;
 
+// Maximum readahead of the iterator of readseq, in bytes.  0 disables it.
+static int FLAGS_readahead_size = 0;
+
 // If true, do not destroy the existing database.  If you set this
 // flag and also specify a benchmark that wants a fresh database, that
 // benchmark will fail.
@@ -121,6 +175,27 @@ static bool FLAGS_reuse_logs = false;
 // If true, use compression.
 static bool FLAGS_compression = true;
 
+// Algorithm used if compression is enabled: "snappy", "zstd" or "lz4".
+static const char* FLAGS_compression_type = "snappy";
+
+// Compression level for zstd.
+static int FLAGS_zstd_compression_level = 1;
+
+// If non-zero, train a zstd dictionary of this many bytes per table.
+static int FLAGS_zstd_max_dict_bytes = 0;
+
+// If true, overlap log writes with memtable inserts of earlier writes.
+static bool FLAGS_enable_pipelined_write = false;
+
+// If true, writers of a group insert their own batches into the memtable.
+static bool FLAGS_allow_concurrent_memtable_write = false;
+
+// Memtable representation: "skip_list", "prefix_hash" or "vector".
+static const char* FLAGS_memtablerep = "skip_list";
+
+// Length of the key prefix that "prefix_hash" buckets keys by.
+static int FLAGS_prefix_size = 8;
+
 // Use the db with the following name.
 static const char* FLAGS_db = nullptr;
 
@@ -372,7 +447,12 @@ struct ThreadState {
 class Benchmark {
  private:
   Cache* cache_;
+  Cache* compressed_cache_;
+  PersistentCache* persistent_cache_;
+  Cache* row_cache_;
   const FilterPolicy* filter_policy_;
+  const SliceTransform* prefix_extractor_;
+  MemTableRepFactory* memtable_factory_;
   DB* db_;
   int num_;
   int value_size_;
@@ -415,14 +495,70 @@ class Benchmark {
         "WARNING: Assertions are enabled; benchmarks unnecessarily slow\n");
 #endif
 
-    // See if snappy is working by attempting to compress a compressible string
+    // See if compression is working by attempting to compress a
+    // compressible string
     const char text[] = "yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy";
     std::string compressed;
-    if (!port::Snappy_Compress(text, sizeof(text), &compressed)) {
-      std::fprintf(stdout, "WARNING: Snappy compression is not enabled\n");
+    bool compressed_ok = false;
+    switch (CompressionTypeFlag()) {
+      case kSnappyCompression:
+        compressed_ok =
+            port::Snappy_Compress(text, sizeof(text), &compressed);
+        break;
+      case kZstdCompression:
+        compressed_ok = port::Zstd_Compress(FLAGS_zstd_compression_level,
+                                            text, sizeof(text), &compressed);
+        break;
+      case kLZ4Compression:
+        compressed_ok = port::Lz4_Compress(text, sizeof(text), &compressed);
+        break;
+      default:
+        break;
+    }
+    if (!compressed_ok) {
+      std::fprintf(stdout, "WARNING: %s compression is not enabled\n",
+                   FLAGS_compression_type);
     } else if (compressed.size() >= sizeof(text)) {
-      std::fprintf(stdout, "WARNING: Snappy compression is not effective\n");
+      std::fprintf(stdout, "WARNING: %s compression is not effective\n",
+                   FLAGS_compression_type);
+    }
+  }
+
+  static CompressionType CompressionTypeFlag() {
+    if (strcmp(FLAGS_compression_type, "zstd") == 0) {
+      return kZstdCompression;
+    } else if (strcmp(FLAGS_compression_type, "lz4") == 0) {
+      return kLZ4Compression;
+    } else if (strcmp(FLAGS_compression_type, "snappy") == 0) {
+      return kSnappyCompression;
     }
+    std::fprintf(stderr, "unknown compression_type %s\n",
+                 FLAGS_compression_type);
+    std::exit(1);
+  }
+
+  static const FilterPolicy* NewFilterPolicyFlag() {
+    if (strcmp(FLAGS_filter_type, "bloom") == 0) {
+      return NewBloomFilterPolicy(FLAGS_bloom_bits);
+    } else if (strcmp(FLAGS_filter_type, "blocked_bloom") == 0) {
+      return NewBlockedBloomFilterPolicy(FLAGS_bloom_bits);
+    } else if (strcmp(FLAGS_filter_type, "ribbon") == 0) {
+      return NewRibbonFilterPolicy(FLAGS_bloom_bits);
+    }
+    std::fprintf(stderr, "unknown filter_type %s\n", FLAGS_filter_type);
+    std::exit(1);
+  }
+
+  static Cache* NewCacheFlag() {
+    if (strcmp(FLAGS_cache_type, "lru") == 0) {
+      return NewLRUCache(FLAGS_cache_size, FLAGS_cache_shard_bits,
+                         FLAGS_cache_strict_capacity_limit,
+                         FLAGS_cache_high_pri_pool_ratio);
+    } else if (strcmp(FLAGS_cache_type, "clock") == 0) {
+      return NewClockCache(FLAGS_cache_size, FLAGS_cache_shard_bits);
+    }
+    std::fprintf(stderr, "unknown cache_type %s\n", FLAGS_cache_type);
+    std::exit(1);
   }
 
   void PrintEnvironment() {
@@ -463,10 +599,18 @@ class Benchmark {
 
  public:
   Benchmark()
-      : cache_(FLAGS_cache_size >= 0 ? NewLRUCache(FLAGS_cache_size) : nullptr),
-        filter_policy_(FLAGS_bloom_bits >= 0
-                           ? NewBloomFilterPolicy(FLAGS_bloom_bits)
-                           : nullptr),
+      : cache_(FLAGS_cache_size >= 0 ? NewCacheFlag() : nullptr),
+        compressed_cache_(FLAGS_compressed_cache_size >= 0
+                              ? NewLRUCache(FLAGS_compressed_cache_size)
+                              : nullptr),
+        persistent_cache_(nullptr),
+        row_cache_(FLAGS_row_cache_size >= 0
+                       ? NewLRUCache(FLAGS_row_cache_size)
+                       : nullptr),
+        filter_policy_(FLAGS_bloom_bits >= 0 ? NewFilterPolicyFlag()
+                                             : nullptr),
+        prefix_extractor_(NewFixedPrefixTransform(FLAGS_prefix_size)),
+        memtable_factory_(nullptr),
         db_(nullptr),
         num_(FLAGS_num),
         value_size_(FLAGS_value_size),
@@ -482,15 +626,46 @@ class Benchmark {
         g_env->RemoveFile(std::string(FLAGS_db) + "/" + files[i]);
       }
     }
+    if (strcmp(FLAGS_memtablerep, "prefix_hash") == 0) {
+      memtable_factory_ = NewHashSkipListRepFactory(prefix_extractor_);
+    } else if (strcmp(FLAGS_memtablerep, "vector") == 0) {
+      memtable_factory_ = NewVectorRepFactory();
+    } else if (strcmp(FLAGS_memtablerep, "skip_list") != 0) {
+      std::fprintf(stderr, "unknown memtablerep %s\n", FLAGS_memtablerep);
+      std::exit(1);
+    }
     if (!FLAGS_use_existing_db) {
       DestroyDB(FLAGS_db, Options());
     }
+    if (FLAGS_persistent_cache_path != nullptr) {
+      // The blocks of a destroyed database must not be found again.
+      if (!FLAGS_use_existing_db) {
+        g_env->GetChildren(FLAGS_persistent_cache_path, &files);
+        for (const std::string& file : files) {
+          g_env->RemoveFile(std::string(FLAGS_persistent_cache_path) + "/" +
+                            file);
+        }
+      }
+      Status s = NewPersistentCache(g_env, FLAGS_persistent_cache_path,
+                                    FLAGS_persistent_cache_size,
+                                    &persistent_cache_);
+      if (!s.ok()) {
+        std::fprintf(stderr, "open persistent cache error: %s\n",
+                     s.ToString().c_str());
+        std::exit(1);
+      }
+    }
   }
 
   ~Benchmark() {
     delete db_;
     delete cache_;
+    delete compressed_cache_;
+    delete persistent_cache_;
+    delete row_cache_;
     delete filter_policy_;
+    delete memtable_factory_;
+    delete prefix_extractor_;
   }
 
   void Run() {
@@ -585,6 +760,8 @@ class Benchmark {
         PrintStats("leveldb.stats");
       } else if (name == Slice("sstables")) {
         PrintStats("leveldb.sstables");
+      } else if (name == Slice("cachestats")) {
+        PrintStats("leveldb.block-cache-stats");
       } else {
         if (!name.empty()) {  // No error message for empty name
           std::fprintf(stderr, "unknown benchmark '%s'\n",
@@ -765,6 +942,9 @@ class Benchmark {
     options.env = g_env;
     options.create_if_missing = !FLAGS_use_existing_db;
     options.block_cache = cache_;
+    options.compressed_block_cache = compressed_cache_;
+    options.persistent_cache = persistent_cache_;
+    options.row_cache = row_cache_;
     options.write_buffer_size = FLAGS_write_buffer_size;
     options.max_file_size = FLAGS_max_file_size;
     options.block_size = FLAGS_block_size;
@@ -773,9 +953,19 @@ class Benchmark {
     }
     options.max_open_files = FLAGS_open_files;
     options.filter_policy = filter_policy_;
+    options.full_filter = FLAGS_full_filter;
+    options.partition_index_and_filters = FLAGS_partition_index_and_filters;
+    options.cache_index_and_filter_blocks = FLAGS_cache_index_and_filter_blocks;
+    options.data_block_hash_index = FLAGS_data_block_hash_index;
     options.reuse_logs = FLAGS_reuse_logs;
     options.compression =
-        FLAGS_compression ? kSnappyCompression : kNoCompression;
+        FLAGS_compression ? CompressionTypeFlag() : kNoCompression;
+    options.zstd_compression_level = FLAGS_zstd_compression_level;
+    options.zstd_max_dict_bytes = FLAGS_zstd_max_dict_bytes;
+    options.enable_pipelined_write = FLAGS_enable_pipelined_write;
+    options.allow_concurrent_memtable_write =
+        FLAGS_allow_concurrent_memtable_write;
+    options.memtable_factory = memtable_factory_;
     Status s = DB::Open(options, FLAGS_db, &db_);
     if (!s.ok()) {
       std::fprintf(stderr, "open error: %s\n", s.ToString().c_str());
@@ -826,7 +1016,9 @@ class Benchmark {
   }
 
   void ReadSequential(ThreadState* thread) {
-    Iterator* iter = db_->NewIterator(ReadOptions());
+    ReadOptions options;
+    options.readahead_size = FLAGS_readahead_size;
+    Iterator* iter = db_->NewIterator(options);
     int i = 0;
     int64_t bytes = 0;
     for (iter->SeekToFirst(); i < reads_ && iter->Valid(); iter->Next()) {
@@ -1033,6 +1225,7 @@ int main(int argc, char** argv) {
   for (int i = 1; i < argc; i++) {
     double d;
     int n;
+    long long ll;
     char junk;
     if (leveldb::Slice(argv[i]).starts_with("--benchmarks=")) {
       FLAGS_benchmarks = argv[i] + strlen("--benchmarks=");
@@ -1053,6 +1246,28 @@ int main(int argc, char** argv) {
     } else if (sscanf(argv[i], "--compression=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_compression = n;
+    } else if (strncmp(argv[i], "--compression_type=", 19) == 0) {
+      FLAGS_compression_type = argv[i] + 19;
+    } else if (sscanf(argv[i], "--zstd_compression_level=%d%c", &n, &junk) ==
+               1) {
+      FLAGS_zstd_compression_level = n;
+    } else if (sscanf(argv[i], "--zstd_max_dict_bytes=%d%c", &n, &junk) ==
+               1) {
+      FLAGS_zstd_max_dict_bytes = n;
+    } else if (sscanf(argv[i], "--enable_pipelined_write=%d%c", &n, &junk) ==
+                   1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_enable_pipelined_write = n;
+    } else if (sscanf(argv[i], "--allow_concurrent_memtable_write=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_allow_concurrent_memtable_write = n;
+    } else if (strncmp(argv[i], "--memtablerep=", 14) == 0) {
+      FLAGS_memtablerep = argv[i] + 14;
+    } else if (sscanf(argv[i], "--prefix_size=%d%c", &n, &junk) == 1) {
+      FLAGS_prefix_size = n;
+    } else if (sscanf(argv[i], "--readahead_size=%d%c", &n, &junk) == 1) {
+      FLAGS_readahead_size = n;
     } else if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
       FLAGS_num = n;
     } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
@@ -1071,8 +1286,46 @@ int main(int argc, char** argv) {
       FLAGS_key_prefix = n;
     } else if (sscanf(argv[i], "--cache_size=%d%c", &n, &junk) == 1) {
       FLAGS_cache_size = n;
+    } else if (sscanf(argv[i], "--compressed_cache_size=%d%c", &n, &junk) ==
+               1) {
+      FLAGS_compressed_cache_size = n;
+    } else if (sscanf(argv[i], "--row_cache_size=%d%c", &n, &junk) == 1) {
+      FLAGS_row_cache_size = n;
+    } else if (strncmp(argv[i], "--persistent_cache_path=", 24) == 0) {
+      FLAGS_persistent_cache_path = argv[i] + 24;
+    } else if (sscanf(argv[i], "--persistent_cache_size=%lld%c", &ll,
+                      &junk) == 1) {
+      FLAGS_persistent_cache_size = ll;
+    } else if (strncmp(argv[i], "--cache_type=", 13) == 0) {
+      FLAGS_cache_type = argv[i] + 13;
+    } else if (sscanf(argv[i], "--cache_shard_bits=%d%c", &n, &junk) == 1) {
+      FLAGS_cache_shard_bits = n;
+    } else if (sscanf(argv[i], "--cache_strict_capacity_limit=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_cache_strict_capacity_limit = n;
+    } else if (sscanf(argv[i], "--cache_high_pri_pool_ratio=%lf%c", &d,
+                      &junk) == 1) {
+      FLAGS_cache_high_pri_pool_ratio = d;
+    } else if (sscanf(argv[i], "--cache_index_and_filter_blocks=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_cache_index_and_filter_blocks = n;
     } else if (sscanf(argv[i], "--bloom_bits=%d%c", &n, &junk) == 1) {
       FLAGS_bloom_bits = n;
+    } else if (strncmp(argv[i], "--filter_type=", 14) == 0) {
+      FLAGS_filter_type = argv[i] + 14;
+    } else if (sscanf(argv[i], "--full_filter=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_full_filter = n;
+    } else if (sscanf(argv[i], "--partition_index_and_filters=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_partition_index_and_filters = n;
+    } else if (sscanf(argv[i], "--data_block_hash_index=%d%c", &n, &junk) ==
+                   1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_data_block_hash_index = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
       FLAGS_open_files = n;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
@@ -0,0 +1,156 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+namespace {
+
+constexpr int kBitsPerKey = 10;
+
+// Number of distinct keys probed per benchmark.  Enough that the probes
+// of large filters keep missing the CPU caches.
+constexpr int kProbeKeys = 1 << 16;
+
+const FilterPolicy* NewPolicy(int policy) {
+  switch (policy) {
+    case 0:
+      return NewBloomFilterPolicy(kBitsPerKey);
+    case 1:
+      return NewBlockedBloomFilterPolicy(kBitsPerKey);
+    default:
+      return NewRibbonFilterPolicy(kBitsPerKey);
+  }
+}
+
+// Fills *keys with keys [0, num_keys), which *key_slices point into.
+void MakeKeys(int num_keys, std::string* keys, std::vector<Slice>* key_slices) {
+  keys->clear();
+  for (int i = 0; i < num_keys; i++) {
+    PutFixed32(keys, i);
+  }
+  key_slices->resize(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    (*key_slices)[i] =
+        Slice(keys->data() + i * sizeof(uint32_t), sizeof(uint32_t));
+  }
+}
+
+std::string Key(int i) {
+  char buf[sizeof(uint32_t)];
+  EncodeFixed32(buf, i);
+  return std::string(buf, sizeof(buf));
+}
+
+// A filter over keys [0, num_keys), plus keys to probe it with: those
+// added to it if "present", or keys that were not added otherwise.
+class FilterFixture {
+ public:
+  FilterFixture(int policy, int num_keys, bool present)
+      : policy_(NewPolicy(policy)) {
+    std::string keys;
+    std::vector<Slice> key_slices;
+    MakeKeys(num_keys, &keys, &key_slices);
+    policy_->CreateFilter(key_slices.data(), num_keys, &filter_);
+
+    for (int i = 0; i < kProbeKeys; i++) {
+      // Spread present probes over the whole filter.
+      probes_.push_back(present ? Key(static_cast<int>(
+                                      (static_cast<int64_t>(i) * 7919) %
+                                      num_keys))
+                                : Key(i + 1000000000));
+    }
+  }
+
+  ~FilterFixture() { delete policy_; }
+
+  const FilterPolicy* policy() const { return policy_; }
+  const std::string& filter() const { return filter_; }
+  const std::vector<std::string>& probes() const { return probes_; }
+
+ private:
+  const FilterPolicy* const policy_;
+  std::string filter_;
+  std::vector<std::string> probes_;
+};
+
+void RunProbes(benchmark::State& state, bool present) {
+  FilterFixture fixture(state.range(0), state.range(1), present);
+  const FilterPolicy* policy = fixture.policy();
+  const Slice filter(fixture.filter());
+  const std::vector<std::string>& probes = fixture.probes();
+
+  int64_t matches = 0;
+  int64_t probes_done = 0;
+  for (auto st : state) {
+    for (const std::string& key : probes) {
+      matches += policy->KeyMayMatch(key, filter);
+    }
+    probes_done += probes.size();
+  }
+  state.SetItemsProcessed(probes_done);
+  state.SetLabel(policy->Name());
+  state.counters["bytes_per_key"] =
+      static_cast<double>(filter.size()) / state.range(1);
+  if (!present) {
+    state.counters["fp_rate"] =
+        static_cast<double>(matches) / std::max<int64_t>(probes_done, 1);
+  }
+}
+
+void BM_FilterProbeMissing(benchmark::State& state) {
+  RunProbes(state, /*present=*/false);
+}
+
+void BM_FilterProbePresent(benchmark::State& state) {
+  RunProbes(state, /*present=*/true);
+}
+
+void BM_FilterCreate(benchmark::State& state) {
+  const FilterPolicy* policy = NewPolicy(state.range(0));
+  const int num_keys = state.range(1);
+  std::string keys;
+  std::vector<Slice> key_slices;
+  MakeKeys(num_keys, &keys, &key_slices);
+
+  std::string filter;
+  for (auto st : state) {
+    filter.clear();
+    policy->CreateFilter(key_slices.data(), num_keys, &filter);
+  }
+  state.SetItemsProcessed(state.iterations() * num_keys);
+  state.SetLabel(policy->Name());
+  state.counters["bytes_per_key"] =
+      static_cast<double>(filter.size()) / num_keys;
+  delete policy;
+}
+
+// Args: {policy (0 = bloom, 1 = blocked bloom, 2 = ribbon), number of
+// keys}.  The largest filters are several MB, well past the CPU caches.
+void FilterArgs(benchmark::internal::Benchmark* b) {
+  for (int policy : {0, 1, 2}) {
+    for (int num_keys : {10000, 1000000, 4000000}) {
+      b->Args({policy, num_keys});
+    }
+  }
+}
+
+BENCHMARK(BM_FilterProbeMissing)->Apply(FilterArgs);
+BENCHMARK(BM_FilterProbePresent)->Apply(FilterArgs);
+BENCHMARK(BM_FilterCreate)->Apply(FilterArgs);
+
+}  // namespace
+
+}  // namespace leveldb
+
+BENCHMARK_MAIN();
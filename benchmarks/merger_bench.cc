@@ -0,0 +1,111 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+#include "table/merger.h"
+
+namespace leveldb {
+
+namespace {
+
+constexpr int kKeysPerChild = 10000;
+
+std::string MakeKey(unsigned int num) {
+  char buf[30];
+  std::snprintf(buf, sizeof(buf), "%016u", num);
+  return std::string(buf);
+}
+
+// Builds "num_children" blocks whose keys interleave, like the level-0
+// files and levels of a DB scan do.
+class Children {
+ public:
+  explicit Children(int num_children) {
+    Options options;
+    for (int i = 0; i < num_children; i++) {
+      BlockBuilder builder(&options);
+      for (int k = 0; k < kKeysPerChild; k++) {
+        builder.Add(MakeKey(k * num_children + i), "value");
+      }
+      Slice raw = builder.Finish();
+      char* buf = new char[raw.size()];
+      std::memcpy(buf, raw.data(), raw.size());
+      BlockContents contents;
+      contents.data = Slice(buf, raw.size());
+      contents.cachable = false;
+      contents.heap_allocated = true;  // Owned by the Block
+      blocks_.push_back(new Block(contents));
+    }
+  }
+
+  ~Children() {
+    for (Block* block : blocks_) {
+      delete block;
+    }
+  }
+
+  Iterator* NewMergingIterator() {
+    std::vector<Iterator*> list;
+    for (Block* block : blocks_) {
+      list.push_back(block->NewIterator(BytewiseComparator()));
+    }
+    return leveldb::NewMergingIterator(BytewiseComparator(), list.data(),
+                                       list.size());
+  }
+
+ private:
+  std::vector<Block*> blocks_;
+};
+
+void BM_MergingIteratorScan(benchmark::State& state) {
+  const int num_children = state.range(0);
+  Children children(num_children);
+  Iterator* iter = children.NewMergingIterator();
+
+  int64_t keys = 0;
+  for (auto st : state) {
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      benchmark::DoNotOptimize(iter->key());
+      keys++;
+    }
+  }
+  delete iter;
+  state.SetItemsProcessed(keys);
+}
+
+void BM_MergingIteratorReverseScan(benchmark::State& state) {
+  const int num_children = state.range(0);
+  Children children(num_children);
+  Iterator* iter = children.NewMergingIterator();
+
+  int64_t keys = 0;
+  for (auto st : state) {
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      benchmark::DoNotOptimize(iter->key());
+      keys++;
+    }
+  }
+  delete iter;
+  state.SetItemsProcessed(keys);
+}
+
+BENCHMARK(BM_MergingIteratorScan)->RangeMultiplier(2)->Range(2, 64);
+BENCHMARK(BM_MergingIteratorReverseScan)->RangeMultiplier(2)->Range(2, 64);
+
+}  // namespace
+
+}  // namespace leveldb
+
+BENCHMARK_MAIN();
@@ -4,6 +4,8 @@
 
 #include "db/builder.h"
 
+#include <algorithm>
+
 #include "db/dbformat.h"
 #include "db/filename.h"
 #include "db/table_cache.h"
@@ -14,6 +16,16 @@
 
 namespace leveldb {
 
+Options TableOptionsForLevel(const Options& options, int level) {
+  Options result = options;
+  const std::vector<CompressionType>& per_level = options.compression_per_level;
+  if (!per_level.empty()) {
+    const size_t index = static_cast<size_t>(level);
+    result.compression = per_level[std::min(index, per_level.size() - 1)];
+  }
+  return result;
+}
+
 /**
  * iter就是memtable的迭代器。
  * meta保存新sstable的元信息。
@@ -36,7 +48,8 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
 
     //将根据file创建一个TableBuilder类，用来构造sstable。
     //简单理解：将文件和TableBuilder类绑定。
-    TableBuilder* builder = new TableBuilder(options, file);
+    TableBuilder* builder =
+        new TableBuilder(TableOptionsForLevel(options, 0), file);
     //sstable的最小key
     meta->smallest.DecodeFrom(iter->key());
     Slice key;
@@ -72,8 +85,10 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
     if (s.ok()) {
       // Verify that the table is usable
       // 验证表是否可用
+      // New tables are written to level 0, even if a memtable flush may
+      // then place its table higher.
       Iterator* it = table_cache->NewIterator(ReadOptions(), meta->number,
-                                              meta->file_size);
+                                              meta->file_size, nullptr, 0);
       s = it->status();
       delete it;
     }
@@ -5,11 +5,11 @@
 #ifndef STORAGE_LEVELDB_DB_BUILDER_H_
 #define STORAGE_LEVELDB_DB_BUILDER_H_
 
+#include "leveldb/options.h"
 #include "leveldb/status.h"
 
 namespace leveldb {
 
-struct Options;
 struct FileMetaData;
 
 class Env;
@@ -17,11 +17,16 @@ class Iterator;
 class TableCache;
 class VersionEdit;
 
+// Return a copy of "options" for building a table that is written to
+// "level": its compression is the one configured for that level.
+Options TableOptionsForLevel(const Options& options, int level);
+
 // Build a Table file from the contents of *iter.  The generated file
 // will be named according to meta->number.  On success, the rest of
 // *meta will be filled with metadata about the generated table.
 // If no data is present in *iter, meta->file_size will be set to
-// zero, and no Table file will be produced.
+// zero, and no Table file will be produced.  The table is compressed as
+// configured for level 0.
 Status BuildTable(const std::string& dbname, Env* env, const Options& options,
                   TableCache* table_cache, Iterator* iter, FileMetaData* meta);
 
@@ -244,6 +244,25 @@ int main(int argc, char** argv) {
     leveldb_writebatch_destroy(wb);
   }
 
+  StartPhase("multiget");
+  {
+    const char* keys[3] = {"box", "foo", "bar"};
+    size_t keys_sizes[3] = {3, 3, 3};
+    char* vals[3];
+    size_t vals_sizes[3];
+    char* errs[3];
+    leveldb_multi_get(db, roptions, 3, keys, keys_sizes, vals, vals_sizes,
+                      errs);
+    CheckNoError(errs[0]);
+    CheckNoError(errs[1]);
+    CheckNoError(errs[2]);
+    CheckEqual("c", vals[0], vals_sizes[0]);
+    CheckEqual("hello", vals[1], vals_sizes[1]);
+    CheckEqual(NULL, vals[2], vals_sizes[2]);
+    Free(&vals[0]);
+    Free(&vals[1]);
+  }
+
   StartPhase("iter");
   {
     leveldb_iterator_t* iter = leveldb_create_iterator(db, roptions);
@@ -34,23 +34,43 @@
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/thread_local.h"
 
 namespace leveldb {
 
 const int kNumNonTableCacheFiles = 10;
 
+// Stored in a thread's SuperVersion slot while that thread is using the
+// SuperVersion it took out of the slot.
+static char super_version_in_use_marker;
+static void* const kSuperVersionInUse = &super_version_in_use_marker;
+
 // Information kept for every waiting writer
 /**
  * 记录写操作WriteBatch、是否同步、是否完成、状态，以及用于通信的条件变量port::CondVar
  */
 struct DBImpl::Writer {
   explicit Writer(port::Mutex* mu)
-      : batch(nullptr), sync(false), done(false), cv(mu) {}
+      : batch(nullptr),
+        sync(false),
+        done(false),
+        last_sequence(0),
+        insert_leader(nullptr),
+        pending_inserts(0),
+        cv(mu) {}
 
   Status status;
   WriteBatch* batch;
   bool sync;
   bool done;
+  SequenceNumber last_sequence;  // Of the group led by this writer
+
+  // Concurrent memtable writes: a follower inserts its own batch once its
+  // leader sets insert_leader, and the leader waits until pending_inserts
+  // (the number of followers still inserting) drops to zero.
+  Writer* insert_leader;
+  int pending_inserts;
+
   port::CondVar cv;
 };
 
@@ -97,14 +117,23 @@ static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
 Options SanitizeOptions(const std::string& dbname,
                         const InternalKeyComparator* icmp,
                         const InternalFilterPolicy* ipolicy,
+                        const InternalKeySliceTransform* iprefix,
                         const Options& src) {
   Options result = src;
   result.comparator = icmp;
   result.filter_policy = (src.filter_policy != nullptr) ? ipolicy : nullptr;
+  result.prefix_extractor =
+      (src.prefix_extractor != nullptr) ? iprefix : nullptr;
   ClipToRange(&result.max_open_files, 64 + kNumNonTableCacheFiles, 50000);
   ClipToRange(&result.write_buffer_size, 64 << 10, 1 << 30);
   ClipToRange(&result.max_file_size, 1 << 20, 1 << 30);
   ClipToRange(&result.block_size, 1 << 10, 4 << 20);
+  ClipToRange(&result.max_background_compactions, 1, 64);
+  ClipToRange(&result.max_subcompactions, 1, 64);
+  if (result.memtable_factory != nullptr &&
+      !result.memtable_factory->IsInsertConcurrentlySupported()) {
+    result.allow_concurrent_memtable_write = false;
+  }
   if (result.info_log == nullptr) {
     // Open a log file in the same directory as the db
     src.env->CreateDir(dbname);  // In case it does not exist
@@ -116,7 +145,9 @@ Options SanitizeOptions(const std::string& dbname,
     }
   }
   if (result.block_cache == nullptr) {
-    result.block_cache = NewLRUCache(8 << 20);
+    // Half of it protects the index blocks and filters inserted with high
+    // priority from being evicted by data blocks.
+    result.block_cache = NewLRUCache(8 << 20, 0.5);
   }
   return result;
 }
@@ -136,8 +167,10 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
     : env_(raw_options.env),
       internal_comparator_(raw_options.comparator),
       internal_filter_policy_(raw_options.filter_policy),
+      internal_prefix_extractor_(raw_options.prefix_extractor),
       options_(SanitizeOptions(dbname, &internal_comparator_,
-                               &internal_filter_policy_, raw_options)),
+                               &internal_filter_policy_,
+                               &internal_prefix_extractor_, raw_options)),
       owns_info_log_(options_.info_log != raw_options.info_log),
       owns_cache_(options_.block_cache != raw_options.block_cache),
       dbname_(dbname),
@@ -153,19 +186,35 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       log_(nullptr),
       seed_(0),
       tmp_batch_(new WriteBatch),
-      background_compaction_scheduled_(false),
+      background_flush_scheduled_(false),
+      flushing_memtable_(false),
+      background_compactions_scheduled_(0),
+      running_compactions_(0),
+      writing_manifest_(false),
+      manifest_write_finished_signal_(&mutex_),
       manual_compaction_(nullptr),
       versions_(new VersionSet(dbname_, &options_, table_cache_,
-                               &internal_comparator_)) {}
+                               &internal_comparator_)),
+      super_version_(nullptr),
+      super_version_number_(0),
+      local_super_version_(
+          new ThreadLocalPtr(&DBImpl::CleanupThreadLocalSuperVersion)) {}
 
 DBImpl::~DBImpl() {
   // Wait for background work to finish.
   mutex_.Lock();
   shutting_down_.store(true, std::memory_order_release);
-  while (background_compaction_scheduled_) {
+  while (background_flush_scheduled_ || background_compactions_scheduled_ > 0) {
     background_work_finished_signal_.Wait();
   }
+  // Drop all SuperVersions while versions_ is still alive.
+  if (super_version_ != nullptr) {
+    ResetLocalSuperVersions();
+    UnrefSuperVersionLocked(super_version_);
+    super_version_ = nullptr;
+  }
   mutex_.Unlock();
+  delete local_super_version_;
 
   if (db_lock_ != nullptr) {
     env_->UnlockFile(db_lock_);
@@ -231,6 +280,104 @@ void DBImpl::MaybeIgnoreError(Status* s) const {
   }
 }
 
+void DBImpl::InstallSuperVersion() {
+  mutex_.AssertHeld();
+  SuperVersion* sv = new SuperVersion;
+  sv->mem = mem_;
+  sv->mem->Ref();
+  sv->imm = imm_;
+  if (sv->imm != nullptr) sv->imm->Ref();
+  sv->current = versions_->current();
+  sv->current->Ref();
+  sv->number = super_version_number_.load(std::memory_order_relaxed) + 1;
+  sv->refs.store(1, std::memory_order_relaxed);
+  sv->mu = &mutex_;
+
+  SuperVersion* old = super_version_;
+  super_version_ = sv;
+  super_version_number_.store(sv->number, std::memory_order_release);
+  ResetLocalSuperVersions();
+  if (old != nullptr) {
+    UnrefSuperVersionLocked(old);
+  }
+}
+
+void DBImpl::ResetLocalSuperVersions() {
+  mutex_.AssertHeld();
+  std::vector<void*> cached;
+  local_super_version_->Scrape(&cached, nullptr);
+  for (void* ptr : cached) {
+    // A thread that is using its copy will notice the reset when it tries
+    // to put the copy back, and drops the reference itself.
+    if (ptr != kSuperVersionInUse) {
+      UnrefSuperVersionLocked(static_cast<SuperVersion*>(ptr));
+    }
+  }
+}
+
+DBImpl::SuperVersion* DBImpl::AcquireSuperVersion() {
+  SuperVersion* sv =
+      static_cast<SuperVersion*>(local_super_version_->Swap(kSuperVersionInUse));
+  assert(sv != kSuperVersionInUse);
+  if (sv != nullptr &&
+      sv->number == super_version_number_.load(std::memory_order_acquire)) {
+    return sv;
+  }
+
+  // Slow path: this thread has no usable copy yet.
+  MutexLock l(&mutex_);
+  if (sv != nullptr) {
+    UnrefSuperVersionLocked(sv);
+  }
+  sv = super_version_;
+  sv->refs.fetch_add(1, std::memory_order_relaxed);
+  return sv;
+}
+
+void DBImpl::ReleaseSuperVersion(SuperVersion* sv) {
+  void* expected = kSuperVersionInUse;
+  if (!local_super_version_->CompareAndSwap(sv, &expected)) {
+    // A newer SuperVersion was installed while we were using this one.
+    assert(expected == nullptr);
+    UnrefSuperVersion(sv);
+  }
+}
+
+void DBImpl::UnrefSuperVersion(SuperVersion* sv) {
+  if (sv->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    port::Mutex* mu = sv->mu;
+    mu->Lock();
+    DeleteSuperVersion(sv);
+    mu->Unlock();
+  }
+}
+
+void DBImpl::UnrefSuperVersionLocked(SuperVersion* sv) {
+  mutex_.AssertHeld();
+  if (sv->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    DeleteSuperVersion(sv);
+  }
+}
+
+void DBImpl::DeleteSuperVersion(SuperVersion* sv) {
+  sv->mu->AssertHeld();
+  assert(sv->refs.load(std::memory_order_relaxed) == 0);
+  sv->mem->Unref();
+  if (sv->imm != nullptr) sv->imm->Unref();
+  sv->current->Unref();
+  delete sv;
+}
+
+void DBImpl::CleanupThreadLocalSuperVersion(void* ptr) {
+  if (ptr != kSuperVersionInUse) {
+    UnrefSuperVersion(static_cast<SuperVersion*>(ptr));
+  }
+}
+
+SequenceNumber DBImpl::LastSequenceNoLock() const {
+  return versions_->LastSequence();
+}
+
 void DBImpl::RemoveObsoleteFiles() {
   mutex_.AssertHeld();
 
@@ -447,7 +594,7 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     WriteBatchInternal::SetContents(&batch, record);
 
     if (mem == nullptr) {
-      mem = new MemTable(internal_comparator_);
+      mem = new MemTable(internal_comparator_, options_.memtable_factory);
       mem->Ref();
     }
     status = WriteBatchInternal::InsertInto(&batch, mem);
@@ -464,7 +611,9 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     if (mem->ApproximateMemoryUsage() > options_.write_buffer_size) {
       compactions++;
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, nullptr);
+      uint64_t file_number;
+      status = WriteLevel0Table(mem, edit, nullptr, &file_number);
+      pending_outputs_.erase(file_number);
       mem->Unref();
       mem = nullptr;
       if (!status.ok()) {
@@ -493,7 +642,7 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
         mem = nullptr;
       } else {
         // mem can be nullptr if lognum exists but was empty.
-        mem_ = new MemTable(internal_comparator_);
+        mem_ = new MemTable(internal_comparator_, options_.memtable_factory);
         mem_->Ref();
       }
     }
@@ -503,7 +652,9 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     // mem did not get reused; compact it.
     if (status.ok()) {
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, nullptr);
+      uint64_t file_number;
+      status = WriteLevel0Table(mem, edit, nullptr, &file_number);
+      pending_outputs_.erase(file_number);
     }
     mem->Unref();
   }
@@ -515,15 +666,14 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
  * 将memtable变成sstable。
  */
 Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
-                                Version* base) {
+                                Version* base, uint64_t* file_number) {
   mutex_.AssertHeld();
   const uint64_t start_micros = env_->NowMicros();
   FileMetaData meta;
   //首先顺序生成 sstable 的编号，用于文件名
   meta.number = versions_->NewFileNumber();
   pending_outputs_.insert(meta.number);
-  //跳表的迭代器
-  Iterator* iter = mem->NewIterator();
+  *file_number = meta.number;
   Log(options_.info_log, "Level-0 table #%llu: started",
       (unsigned long long)meta.number);
 
@@ -534,15 +684,18 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
     //更新memtable中全部数据到xxx.ldb文件。
     //meta记录key range, file_size等sst信息。
     mutex_.Unlock();
+    // "mem" is immutable by now; let its rep prepare for the scan (e.g.
+    // sort itself) without holding the lock.
+    mem->MarkReadOnly();
+    Iterator* iter = mem->NewIterator();
     s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    delete iter;
     mutex_.Lock();
   }
 
   Log(options_.info_log, "Level-0 table #%llu: %lld bytes %s",
       (unsigned long long)meta.number, (unsigned long long)meta.file_size,
       s.ToString().c_str());
-  delete iter;
-  pending_outputs_.erase(meta.number);
 
   // Note that if file_size is zero, the file has been deleted and
   // should not be added to the manifest.
@@ -557,8 +710,19 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
     const Slice min_user_key = meta.smallest.user_key();
     const Slice max_user_key = meta.largest.user_key();
     if (base != nullptr) {
-      //为新生成sstable选择合适的level(不一定总是0)
-      level = base->PickLevelForMemTableOutput(min_user_key, max_user_key);
+      // Choose the level against the latest Version.  The caller installs
+      // *edit without releasing mutex_ in between, so no compaction can be
+      // picked from a Version that lacks this file.  A compaction that is
+      // already running may still write files overlapping this one into
+      // any level but 0, so stay in level 0 while one is running.
+      while (writing_manifest_) {
+        manifest_write_finished_signal_.Wait();
+      }
+      if (running_compactions_ == 0) {
+        //为新生成sstable选择合适的level(不一定总是0)
+        level = versions_->current()->PickLevelForMemTableOutput(
+            min_user_key, max_user_key);
+      }
     }
     // edit记录变化：新增文件。
     edit->AddFile(level, meta.number, meta.file_size, meta.smallest,
@@ -583,13 +747,16 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
 void DBImpl::CompactMemTable() {
   mutex_.AssertHeld();
   assert(imm_ != nullptr);
+  assert(!flushing_memtable_);
+  flushing_memtable_ = true;
 
   // Save the contents of the memtable as a new Table
   //第一部分
   VersionEdit edit;
   Version* base = versions_->current();
   base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
+  uint64_t file_number;
+  Status s = WriteLevel0Table(imm_, &edit, base, &file_number);
   base->Unref();
 
   if (s.ok() && shutting_down_.load(std::memory_order_acquire)) {
@@ -603,8 +770,10 @@ void DBImpl::CompactMemTable() {
     edit.SetPrevLogNumber(0);
     edit.SetLogNumber(logfile_number_);  // Earlier logs no longer needed
     //应用edit
-    s = versions_->LogAndApply(&edit, &mutex_);
+    s = LogAndApply(&edit);
   }
+  pending_outputs_.erase(file_number);
+  flushing_memtable_ = false;
 
   //第三部分
   //新的版本信息生成后，做一个文件的清理，通过RemoveObsoleteFiles选出并且删除。
@@ -613,6 +782,7 @@ void DBImpl::CompactMemTable() {
     imm_->Unref();
     imm_ = nullptr;
     has_imm_.store(false, std::memory_order_release);
+    InstallSuperVersion();
     //todo
     RemoveObsoleteFiles();
   } else {
@@ -692,6 +862,18 @@ Status DBImpl::TEST_CompactMemTable() {
   return s;
 }
 
+Status DBImpl::LogAndApply(VersionEdit* edit) {
+  mutex_.AssertHeld();
+  while (writing_manifest_) {
+    manifest_write_finished_signal_.Wait();
+  }
+  writing_manifest_ = true;
+  Status s = versions_->LogAndApply(edit, &mutex_);
+  writing_manifest_ = false;
+  manifest_write_finished_signal_.SignalAll();
+  return s;
+}
+
 void DBImpl::RecordBackgroundError(const Status& s) {
   mutex_.AssertHeld();
   if (bg_error_.ok()) {
@@ -702,55 +884,84 @@ void DBImpl::RecordBackgroundError(const Status& s) {
 
 void DBImpl::MaybeScheduleCompaction() {
   mutex_.AssertHeld();
-  if (background_compaction_scheduled_) {
-    // Already scheduled
-  } else if (shutting_down_.load(std::memory_order_acquire)) {
+  if (shutting_down_.load(std::memory_order_acquire)) {
     // DB is being deleted; no more background compactions
   } else if (!bg_error_.ok()) {
     // Already got an error; no more changes
-  } else if (imm_ == nullptr && manual_compaction_ == nullptr &&
-             !versions_->NeedsCompaction()) {
-    // No work to be done
   } else {
-    background_compaction_scheduled_ = true;
-    env_->Schedule(&DBImpl::BGWork, this);
+    if (imm_ != nullptr && !background_flush_scheduled_) {
+      background_flush_scheduled_ = true;
+      env_->Schedule(&DBImpl::BGFlushWork, this, Env::kHighPriority);
+    }
+    if (background_compactions_scheduled_ <
+            options_.max_background_compactions &&
+        (manual_compaction_ != nullptr || versions_->NeedsCompaction())) {
+      background_compactions_scheduled_++;
+      env_->Schedule(&DBImpl::BGCompactionWork, this, Env::kLowPriority);
+    }
   }
 }
 
-void DBImpl::BGWork(void* db) {
-  reinterpret_cast<DBImpl*>(db)->BackgroundCall();
+void DBImpl::BGFlushWork(void* db) {
+  reinterpret_cast<DBImpl*>(db)->BackgroundFlushCall();
+}
+
+void DBImpl::BGCompactionWork(void* db) {
+  reinterpret_cast<DBImpl*>(db)->BackgroundCompactionCall();
 }
 
-void DBImpl::BackgroundCall() {
+void DBImpl::BackgroundFlushCall() {
   MutexLock l(&mutex_);
-  assert(background_compaction_scheduled_);
+  assert(background_flush_scheduled_);
+  if (shutting_down_.load(std::memory_order_acquire)) {
+    // No more background work when shutting down.
+  } else if (!bg_error_.ok()) {
+    // No more background work after a background error.
+  } else if (imm_ != nullptr && !flushing_memtable_) {
+    // A compaction may already have flushed imm_ (or be flushing it).
+    CompactMemTable();
+  }
+
+  background_flush_scheduled_ = false;
+
+  // The new level-0 file may call for a compaction.
+  MaybeScheduleCompaction();
+  background_work_finished_signal_.SignalAll();
+}
+
+void DBImpl::BackgroundCompactionCall() {
+  MutexLock l(&mutex_);
+  assert(background_compactions_scheduled_ > 0);
+  bool did_work = false;
   if (shutting_down_.load(std::memory_order_acquire)) {
     // No more background work when shutting down.
   } else if (!bg_error_.ok()) {
     // No more background work after a background error.
   } else {
-    BackgroundCompaction();
+    did_work = BackgroundCompaction();
   }
 
-  background_compaction_scheduled_ = false;
+  background_compactions_scheduled_--;
 
   // Previous compaction may have produced too many files in a level,
-  // so reschedule another compaction if needed.
-  MaybeScheduleCompaction();
+  // so reschedule another compaction if needed.  A job that found
+  // nothing to do does not, so that jobs blocked by running compactions
+  // do not spin; those compactions reschedule when they finish.
+  if (did_work) {
+    MaybeScheduleCompaction();
+  }
   background_work_finished_signal_.SignalAll();
 }
 
 /**
  * 整个压缩过程的入口函数。
- * minor compaction 是高优于 major 的
  */
-void DBImpl::BackgroundCompaction() {
+bool DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
 
-  //如果immutable memtable存在，则本次先compact，即Minor Compaction
-  if (imm_ != nullptr) {
-    CompactMemTable();
-    return;
+  // Pick from the latest Version; see WriteLevel0Table().
+  while (writing_manifest_) {
+    manifest_write_finished_signal_.Wait();
   }
 
   // major compaction
@@ -758,6 +969,11 @@ void DBImpl::BackgroundCompaction() {
   bool is_manual = (manual_compaction_ != nullptr);
   InternalKey manual_end;
   if (is_manual) {
+    if (running_compactions_ > 0) {
+      // Manual compactions do not run alongside other compactions.  The
+      // last of those to finish will schedule this one again.
+      return false;
+    }
     ManualCompaction* m = manual_compaction_;
     c = versions_->CompactRange(m->level, m->begin, m->end);
     m->done = (c == nullptr);
@@ -771,6 +987,9 @@ void DBImpl::BackgroundCompaction() {
         (m->done ? "(end)" : manual_end.DebugString().c_str()));
   } else {
     c = versions_->PickCompaction();
+    if (c == nullptr) {
+      return false;
+    }
   }
 
   Status status;
@@ -780,11 +999,15 @@ void DBImpl::BackgroundCompaction() {
     // Move file to next level
     assert(c->num_input_files(0) == 1);
     FileMetaData* f = c->input(0, 0);
+    c->MarkInputsBeingCompacted(true);
     c->edit()->RemoveFile(c->level(), f->number);
     c->edit()->AddFile(c->level() + 1, f->number, f->file_size, f->smallest,
                        f->largest);
-    status = versions_->LogAndApply(c->edit(), &mutex_);
-    if (!status.ok()) {
+    status = LogAndApply(c->edit());
+    c->MarkInputsBeingCompacted(false);
+    if (status.ok()) {
+      InstallSuperVersion();
+    } else {
       RecordBackgroundError(status);
     }
     VersionSet::LevelSummaryStorage tmp;
@@ -793,12 +1016,20 @@ void DBImpl::BackgroundCompaction() {
         static_cast<unsigned long long>(f->file_size),
         status.ToString().c_str(), versions_->LevelSummary(&tmp));
   } else {
+    c->MarkInputsBeingCompacted(true);
+    running_compactions_++;
+    if (!is_manual) {
+      // Let another compaction start on different files while this one runs.
+      MaybeScheduleCompaction();
+    }
     CompactionState* compact = new CompactionState(c);
     status = DoCompactionWork(compact);
     if (!status.ok()) {
       RecordBackgroundError(status);
     }
     CleanupCompaction(compact);
+    c->MarkInputsBeingCompacted(false);
+    running_compactions_--;
     c->ReleaseInputs();
     RemoveObsoleteFiles();
   }
@@ -825,6 +1056,7 @@ void DBImpl::BackgroundCompaction() {
     }
     manual_compaction_ = nullptr;
   }
+  return true;
 }
 
 void DBImpl::CleanupCompaction(CompactionState* compact) {
@@ -864,7 +1096,9 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
   std::string fname = TableFileName(dbname_, file_number);
   Status s = env_->NewWritableFile(fname, &compact->outfile);
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    compact->builder = new TableBuilder(
+        TableOptionsForLevel(options_, compact->compaction->level() + 1),
+        compact->outfile);
   }
   return s;
 }
@@ -933,12 +1167,39 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
     compact->compaction->edit()->AddFile(level + 1, out.number, out.file_size,
                                          out.smallest, out.largest);
   }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  Status s = LogAndApply(compact->compaction->edit());
+  if (s.ok()) {
+    InstallSuperVersion();
+  }
+  return s;
 }
 
+// One key range of a compaction, merged by DoSubcompactionWork().
+struct DBImpl::Subcompaction {
+  Subcompaction()
+      : db(nullptr),
+        state(nullptr),
+        input(nullptr),
+        begin(nullptr),
+        end(nullptr),
+        imm_micros(0),
+        done(false) {}
+
+  DBImpl* db;
+  CompactionState* state;  // Receives the output files
+  Iterator* input;         // Deleted by DoSubcompactionWork()
+
+  // User key range [*begin, *end) to merge; nullptr means unbounded.
+  const std::string* begin;
+  const std::string* end;
+
+  int64_t imm_micros;  // Micros spent doing imm_ compactions
+  Status status;
+  bool done;  // Guarded by db->mutex_ for subcompaction threads
+};
+
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
   const uint64_t start_micros = env_->NowMicros();
-  int64_t imm_micros = 0;  // Micros spent doing imm_ compactions
 
   Log(options_.info_log, "Compacting %d@%d + %d@%d files",
       compact->compaction->num_input_files(0), compact->compaction->level(),
@@ -954,12 +1215,110 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     compact->smallest_snapshot = snapshots_.oldest()->sequence_number();
   }
 
-  Iterator* input = versions_->MakeInputIterator(compact->compaction);
+  // Split a large compaction into key ranges that are merged in parallel.
+  // Every range after the first writes its files to a CompactionState
+  // of its own; they are all moved to *compact and installed together.
+  std::vector<std::string> boundaries;
+  compact->compaction->GetSubcompactionBoundaries(options_.max_subcompactions,
+                                                  &boundaries);
+  const size_t num_subcompactions = boundaries.size() + 1;
+  std::vector<Subcompaction> subs(num_subcompactions);
+  for (size_t i = 0; i < num_subcompactions; i++) {
+    Subcompaction* sub = &subs[i];
+    sub->db = this;
+    if (i == 0) {
+      sub->state = compact;
+    } else {
+      sub->state = new CompactionState(compact->compaction);
+      sub->state->smallest_snapshot = compact->smallest_snapshot;
+      sub->begin = &boundaries[i - 1];
+    }
+    if (i + 1 < num_subcompactions) {
+      sub->end = &boundaries[i];
+    }
+    sub->input = versions_->MakeInputIterator(compact->compaction);
+  }
+  if (num_subcompactions > 1) {
+    Log(options_.info_log, "Compaction split into %d key ranges",
+        static_cast<int>(num_subcompactions));
+  }
 
   // Release mutex while we're actually doing the compaction work
   mutex_.Unlock();
 
-  input->SeekToFirst();
+  for (size_t i = 1; i < num_subcompactions; i++) {
+    env_->StartThread(&DBImpl::SubcompactionThread, &subs[i]);
+  }
+  subs[0].status = DoSubcompactionWork(&subs[0]);
+
+  mutex_.Lock();
+  subs[0].done = true;
+  for (size_t i = 1; i < num_subcompactions; i++) {
+    while (!subs[i].done) {
+      background_work_finished_signal_.Wait();
+    }
+  }
+
+  Status status;
+  int64_t imm_micros = 0;
+  for (size_t i = 0; i < num_subcompactions; i++) {
+    Subcompaction* sub = &subs[i];
+    if (status.ok()) {
+      status = sub->status;
+    }
+    imm_micros += sub->imm_micros;
+    if (sub->state != compact) {
+      compact->outputs.insert(compact->outputs.end(),
+                              sub->state->outputs.begin(),
+                              sub->state->outputs.end());
+      compact->total_bytes += sub->state->total_bytes;
+      sub->state->outputs.clear();
+      CleanupCompaction(sub->state);
+    }
+  }
+
+  CompactionStats stats;
+  stats.micros = env_->NowMicros() - start_micros - imm_micros;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+    }
+  }
+  for (size_t i = 0; i < compact->outputs.size(); i++) {
+    stats.bytes_written += compact->outputs[i].file_size;
+  }
+  stats_[compact->compaction->level() + 1].Add(stats);
+
+  if (status.ok()) {
+    status = InstallCompactionResults(compact);
+  }
+  if (!status.ok()) {
+    RecordBackgroundError(status);
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log, "compacted to: %s", versions_->LevelSummary(&tmp));
+  return status;
+}
+
+void DBImpl::SubcompactionThread(void* arg) {
+  Subcompaction* sub = reinterpret_cast<Subcompaction*>(arg);
+  DBImpl* db = sub->db;
+  sub->status = db->DoSubcompactionWork(sub);
+  MutexLock l(&db->mutex_);
+  sub->done = true;
+  db->background_work_finished_signal_.SignalAll();
+}
+
+Status DBImpl::DoSubcompactionWork(Subcompaction* sub) {
+  CompactionState* compact = sub->state;
+  Iterator* input = sub->input;
+  if (sub->begin != nullptr) {
+    InternalKey begin(*sub->begin, kMaxSequenceNumber, kValueTypeForSeek);
+    input->Seek(begin.Encode());
+  } else {
+    input->SeekToFirst();
+  }
+  Compaction::Progress progress;
   Status status;
   ParsedInternalKey ikey;
   std::string current_user_key;
@@ -970,17 +1329,22 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     if (has_imm_.load(std::memory_order_relaxed)) {
       const uint64_t imm_start = env_->NowMicros();
       mutex_.Lock();
-      if (imm_ != nullptr) {
+      if (imm_ != nullptr && !flushing_memtable_) {
         CompactMemTable();
         // Wake up MakeRoomForWrite() if necessary.
         background_work_finished_signal_.SignalAll();
       }
       mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
+      sub->imm_micros += (env_->NowMicros() - imm_start);
     }
 
     Slice key = input->key();
-    if (compact->compaction->ShouldStopBefore(key) &&
+    if (sub->end != nullptr && ParseInternalKey(key, &ikey) &&
+        user_comparator()->Compare(ikey.user_key, *sub->end) >= 0) {
+      // Past the key range of this subcompaction
+      break;
+    }
+    if (compact->compaction->ShouldStopBefore(key, &progress) &&
         compact->builder != nullptr) {
       status = FinishCompactionOutputFile(compact, input);
       if (!status.ok()) {
@@ -1010,7 +1374,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         drop = true;  // (A)
       } else if (ikey.type == kTypeDeletion &&
                  ikey.sequence <= compact->smallest_snapshot &&
-                 compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
+                 compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                                        &progress)) {
         // For this user key:
         // (1) there is no data in higher levels
         // (2) data in lower levels will have larger sequence numbers
@@ -1029,7 +1394,7 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         "%d smallest_snapshot: %d",
         ikey.user_key.ToString().c_str(),
         (int)ikey.sequence, ikey.type, kTypeValue, drop,
-        compact->compaction->IsBaseLevelForKey(ikey.user_key),
+        compact->compaction->IsBaseLevelForKey(ikey.user_key, &progress),
         (int)last_sequence_for_key, (int)compact->smallest_snapshot);
 #endif
 
@@ -1070,30 +1435,7 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     status = input->status();
   }
   delete input;
-  input = nullptr;
-
-  CompactionStats stats;
-  stats.micros = env_->NowMicros() - start_micros - imm_micros;
-  for (int which = 0; which < 2; which++) {
-    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
-      stats.bytes_read += compact->compaction->input(which, i)->file_size;
-    }
-  }
-  for (size_t i = 0; i < compact->outputs.size(); i++) {
-    stats.bytes_written += compact->outputs[i].file_size;
-  }
-
-  mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
-
-  if (status.ok()) {
-    status = InstallCompactionResults(compact);
-  }
-  if (!status.ok()) {
-    RecordBackgroundError(status);
-  }
-  VersionSet::LevelSummaryStorage tmp;
-  Log(options_.info_log, "compacted to: %s", versions_->LevelSummary(&tmp));
+  sub->input = nullptr;
   return status;
 }
 
@@ -1159,51 +1501,151 @@ int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
   return versions_->MaxNextLevelOverlappingBytes();
 }
 
+void DBImpl::UnpinSuperVersion(void* arg1, void* arg2) {
+  UnrefSuperVersion(reinterpret_cast<SuperVersion*>(arg1));
+}
+
 Status DBImpl::Get(const ReadOptions& options, const Slice& key,
                    std::string* value) {
+  return GetImpl(options, key, value, nullptr);
+}
+
+Status DBImpl::Get(const ReadOptions& options, const Slice& key,
+                   PinnableSlice* value) {
+  value->Reset();
+  return GetImpl(options, key, nullptr, value);
+}
+
+Status DBImpl::GetImpl(const ReadOptions& options, const Slice& key,
+                       std::string* value, PinnableSlice* pinnable) {
   Status s;
-  MutexLock l(&mutex_);
+  // Pick the sequence number before the SuperVersion: every write visible
+  // at "snapshot" was applied to a memtable that the SuperVersion still
+  // references, either directly or through the table it was flushed to.
   SequenceNumber snapshot;
   if (options.snapshot != nullptr) {
     snapshot =
         static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
   } else {
-    snapshot = versions_->LastSequence();
+    snapshot = LastSequenceNoLock();
   }
 
-  MemTable* mem = mem_;
-  MemTable* imm = imm_;
-  Version* current = versions_->current();
-  mem->Ref();
-  if (imm != nullptr) imm->Ref();
-  current->Ref();
+  SuperVersion* sv = AcquireSuperVersion();
 
   bool have_stat_update = false;
   Version::GetStats stats;
 
-  // Unlock while reading from files and memtables
-  {
-    mutex_.Unlock();
-    // First look in the memtable, then in the immutable memtable (if any).
-    LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, &s)) {
+  // First look in the memtable, then in the immutable memtable (if any).
+  LookupKey lkey(key, snapshot);
+  Slice mem_value;
+  if (sv->mem->Get(lkey, &mem_value, &s) ||
+      (sv->imm != nullptr && sv->imm->Get(lkey, &mem_value, &s))) {
+    if (s.ok() && pinnable != nullptr) {
+      // The SuperVersion keeps the memtables alive.
+      sv->refs.fetch_add(1, std::memory_order_relaxed);
+      pinnable->PinSlice(mem_value, &DBImpl::UnpinSuperVersion, sv, nullptr);
+    } else if (s.ok()) {
+      value->assign(mem_value.data(), mem_value.size());
+    }
+  } else if (pinnable != nullptr) {
+    s = sv->current->Get(options, lkey, pinnable, &stats);
+    have_stat_update = true;
+  } else {
+    s = sv->current->Get(options, lkey, value, &stats);
+    have_stat_update = true;
+  }
+
+  // Charging a seek to a file mutates shared file metadata, so only this
+  // (comparatively rare) case needs mutex_.
+  if (have_stat_update && stats.seek_file != nullptr) {
+    MutexLock l(&mutex_);
+    if (sv->current->UpdateStats(stats)) {
+      MaybeScheduleCompaction();
+    }
+  }
+  ReleaseSuperVersion(sv);
+  return s;
+}
+
+std::vector<Status> DBImpl::MultiGet(const ReadOptions& options,
+                                     const std::vector<Slice>& keys,
+                                     std::vector<std::string>* values) {
+  const size_t n = keys.size();
+  std::vector<Status> statuses(n);
+  values->clear();
+  values->resize(n);
+
+  // See Get() for why the sequence number is picked first.
+  SequenceNumber snapshot;
+  if (options.snapshot != nullptr) {
+    snapshot =
+        static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
+  } else {
+    snapshot = LastSequenceNoLock();
+  }
+
+  SuperVersion* sv = AcquireSuperVersion();
+
+  // Sort the keys so that each level and table is walked only once.
+  std::vector<size_t> order(n);
+  for (size_t i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  const Comparator* ucmp = user_comparator();
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return ucmp->Compare(keys[a], keys[b]) < 0;
+  });
+
+  // First look in the memtable, then in the immutable memtable (if any).
+  std::vector<LookupKey*> lkeys;
+  std::vector<Version::GetRequest> requests;
+  lkeys.reserve(n);
+  for (size_t i : order) {
+    LookupKey* lkey = new LookupKey(keys[i], snapshot);
+    lkeys.push_back(lkey);
+    std::string* value = &(*values)[i];
+    Status* s = &statuses[i];
+    if (sv->mem->Get(*lkey, value, s)) {
       // Done
-    } else if (imm != nullptr && imm->Get(lkey, value, &s)) {
+    } else if (sv->imm != nullptr && sv->imm->Get(*lkey, value, s)) {
       // Done
     } else {
-      s = current->Get(options, lkey, value, &stats);
-      have_stat_update = true;
+      Version::GetRequest request;
+      request.key = lkey;
+      request.value = value;
+      request.status = s;
+      requests.push_back(request);
     }
-    mutex_.Lock();
+  }
+  if (!requests.empty()) {
+    sv->current->MultiGet(options, &requests);
   }
 
-  if (have_stat_update && current->UpdateStats(stats)) {
-    MaybeScheduleCompaction();
+  bool have_seek_charge = false;
+  for (const Version::GetRequest& request : requests) {
+    if (request.stats.seek_file != nullptr) {
+      have_seek_charge = true;
+      break;
+    }
   }
-  mem->Unref();
-  if (imm != nullptr) imm->Unref();
-  current->Unref();
-  return s;
+  if (have_seek_charge) {
+    MutexLock l(&mutex_);
+    bool need_compaction = false;
+    for (const Version::GetRequest& request : requests) {
+      if (sv->current->UpdateStats(request.stats)) {
+        need_compaction = true;
+      }
+    }
+    if (need_compaction) {
+      MaybeScheduleCompaction();
+    }
+  }
+  ReleaseSuperVersion(sv);
+
+  for (LookupKey* lkey : lkeys) {
+    delete lkey;
+  }
+  return statuses;
 }
 
 Iterator* DBImpl::NewIterator(const ReadOptions& options) {
@@ -1215,7 +1657,10 @@ Iterator* DBImpl::NewIterator(const ReadOptions& options) {
                             ? static_cast<const SnapshotImpl*>(options.snapshot)
                                   ->sequence_number()
                             : latest_snapshot),
-                       seed);
+                       seed,
+                       options.prefix_same_as_start
+                           ? internal_prefix_extractor_.user_transform()
+                           : nullptr);
 }
 
 void DBImpl::RecordReadSample(Slice key) {
@@ -1249,6 +1694,10 @@ Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
  * 每次的写操作并不是立即执行，而是生成一个Writer对象，然后加入双端操作队列writers_中等待被调度。
  */
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
+  if (options_.enable_pipelined_write) {
+    return PipelinedWrite(options, updates);
+  }
+
   Writer w(&mutex_);
   w.batch = updates;
   w.sync = options.sync;
@@ -1257,7 +1706,11 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
   MutexLock l(&mutex_);
   writers_.push_back(&w);
   while (!w.done && &w != writers_.front()) {
-    w.cv.Wait();
+    if (w.insert_leader != nullptr) {
+      InsertFollowerBatch(&w);
+    } else {
+      w.cv.Wait();
+    }
   }
   if (w.done) {
     return w.status;
@@ -1268,7 +1721,7 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
   uint64_t last_sequence = versions_->LastSequence();
   Writer* last_writer = &w;
   if (status.ok() && updates != nullptr) {  // nullptr batch is for compactions
-    WriteBatch* write_batch = BuildBatchGroup(&last_writer);
+    WriteBatch* write_batch = BuildBatchGroup(&last_writer, tmp_batch_);
     WriteBatchInternal::SetSequence(write_batch, last_sequence + 1);
     last_sequence += WriteBatchInternal::Count(write_batch);
 
@@ -1288,7 +1741,9 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
           sync_error = true;
         }
       }
-      if (status.ok()) {
+      const bool concurrent_insert =
+          options_.allow_concurrent_memtable_write && write_batch != updates;
+      if (status.ok() && !concurrent_insert) {
         status = WriteBatchInternal::InsertInto(write_batch, mem_);
       }
       mutex_.Lock();
@@ -1298,6 +1753,14 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
         // So we force the DB into a mode where all future writes fail.
         RecordBackgroundError(status);
       }
+      if (status.ok() && concurrent_insert) {
+        std::vector<Writer*> group;
+        for (Writer* writer : writers_) {
+          group.push_back(writer);
+          if (writer == last_writer) break;
+        }
+        status = InsertBatchGroupConcurrently(group, write_batch);
+      }
     }
     if (write_batch == tmp_batch_) tmp_batch_->Clear();
 
@@ -1334,9 +1797,170 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
   return status;
 }
 
+Status DBImpl::PipelinedWrite(const WriteOptions& options,
+                              WriteBatch* updates) {
+  Writer w(&mutex_);
+  w.batch = updates;
+  w.sync = options.sync;
+  w.done = false;
+
+  MutexLock l(&mutex_);
+  writers_.push_back(&w);
+  // Writers of a group that is past the log stage are no longer queued,
+  // so writers_ may be empty while they wait.
+  while (!w.done && (writers_.empty() || &w != writers_.front())) {
+    if (w.insert_leader != nullptr) {
+      InsertFollowerBatch(&w);
+    } else {
+      w.cv.Wait();
+    }
+  }
+  if (w.done) {
+    return w.status;
+  }
+
+  // Log stage.  May temporarily unlock and wait.
+  Status status = MakeRoomForWrite(updates == nullptr);
+  Writer* last_writer = &w;
+  WriteBatch group_batch;
+  WriteBatch* write_batch = nullptr;
+  if (status.ok() && updates != nullptr) {  // nullptr batch is for compactions
+    write_batch = BuildBatchGroup(&last_writer, &group_batch);
+
+    // Earlier groups may not have published their sequence numbers yet.
+    SequenceNumber last_sequence = versions_->LastSequence();
+    if (!memtable_writers_.empty()) {
+      last_sequence = memtable_writers_.back()->last_sequence;
+    }
+    WriteBatchInternal::SetSequence(write_batch, last_sequence + 1);
+    w.last_sequence = last_sequence + WriteBatchInternal::Count(write_batch);
+
+    // Only the writer at the front of writers_ touches log_.
+    mutex_.Unlock();
+    status = log_->AddRecord(WriteBatchInternal::Contents(write_batch));
+    bool sync_error = false;
+    if (status.ok() && options.sync) {
+      status = logfile_->Sync();
+      if (!status.ok()) {
+        sync_error = true;
+      }
+    }
+    mutex_.Lock();
+    if (sync_error) {
+      // The state of the log file is indeterminate: the log record we
+      // just added may or may not show up when the DB is re-opened.
+      // So we force the DB into a mode where all future writes fail.
+      RecordBackgroundError(status);
+    }
+  }
+
+  // Take the group off writers_ so that the next group can be logged
+  // while this one is inserted into the memtable.
+  std::vector<Writer*> group;
+  while (true) {
+    Writer* ready = writers_.front();
+    writers_.pop_front();
+    group.push_back(ready);
+    if (ready == last_writer) break;
+  }
+  if (status.ok() && write_batch != nullptr) {
+    memtable_writers_.push_back(&w);
+  }
+  if (!writers_.empty()) {
+    writers_.front()->cv.Signal();
+  }
+
+  // Memtable stage.  Groups are inserted one at a time in sequence order,
+  // so each can publish its last sequence number as soon as it is done.
+  if (status.ok() && write_batch != nullptr) {
+    while (&w != memtable_writers_.front()) {
+      w.cv.Wait();
+    }
+    if (options_.allow_concurrent_memtable_write && write_batch != updates) {
+      status = InsertBatchGroupConcurrently(group, write_batch);
+    } else {
+      MemTable* mem = mem_;
+      mutex_.Unlock();
+      status = WriteBatchInternal::InsertInto(write_batch, mem);
+      mutex_.Lock();
+    }
+    versions_->SetLastSequence(w.last_sequence);
+    memtable_writers_.pop_front();
+    if (!memtable_writers_.empty()) {
+      memtable_writers_.front()->cv.Signal();
+    } else if (!writers_.empty()) {
+      // The next log stage may be waiting to switch memtables.
+      writers_.front()->cv.Signal();
+    }
+  }
+
+  for (Writer* ready : group) {
+    if (ready != &w) {
+      ready->status = status;
+      ready->done = true;
+      ready->cv.Signal();
+    }
+  }
+  return status;
+}
+
+Status DBImpl::InsertBatchGroupConcurrently(const std::vector<Writer*>& group,
+                                            WriteBatch* write_batch) {
+  mutex_.AssertHeld();
+  Writer* leader = group[0];
+
+  // Give every batch the sequence numbers its entries have in write_batch
+  // and hand the followers' batches back to their own threads.
+  SequenceNumber sequence = WriteBatchInternal::Sequence(write_batch);
+  leader->status = Status::OK();
+  leader->pending_inserts = 0;
+  for (Writer* writer : group) {
+    if (writer->batch == nullptr) {
+      continue;
+    }
+    WriteBatchInternal::SetSequence(writer->batch, sequence);
+    sequence += WriteBatchInternal::Count(writer->batch);
+    if (writer != leader) {
+      writer->insert_leader = leader;
+      leader->pending_inserts++;
+      writer->cv.Signal();
+    }
+  }
+
+  MemTable* mem = mem_;
+  mutex_.Unlock();
+  Status status =
+      WriteBatchInternal::InsertIntoConcurrently(leader->batch, mem);
+  mutex_.Lock();
+  while (leader->pending_inserts > 0) {
+    leader->cv.Wait();
+  }
+  if (status.ok()) {
+    status = leader->status;
+  }
+  return status;
+}
+
+void DBImpl::InsertFollowerBatch(Writer* w) {
+  mutex_.AssertHeld();
+  Writer* leader = w->insert_leader;
+  w->insert_leader = nullptr;
+  MemTable* mem = mem_;
+  mutex_.Unlock();
+  Status status = WriteBatchInternal::InsertIntoConcurrently(w->batch, mem);
+  mutex_.Lock();
+  if (!status.ok()) {
+    leader->status = status;
+  }
+  if (--leader->pending_inserts == 0) {
+    leader->cv.Signal();
+  }
+}
+
 // REQUIRES: Writer list must be non-empty
 // REQUIRES: First writer must have a non-null batch
-WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
+WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer,
+                                    WriteBatch* tmp_batch) {
   mutex_.AssertHeld();
   assert(!writers_.empty());
   Writer* first = writers_.front();
@@ -1373,7 +1997,7 @@ WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
       // Append to *result
       if (result == first->batch) {
         // Switch to temporary batch instead of disturbing caller's batch
-        result = tmp_batch_;
+        result = tmp_batch;
         assert(WriteBatchInternal::Count(result) == 0);
         WriteBatchInternal::Append(result, first->batch);
       }
@@ -1441,6 +2065,10 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       // There are too many level-0 files.
       Log(options_.info_log, "Too many L0 files; waiting...\n");
       background_work_finished_signal_.Wait();
+    } else if (!memtable_writers_.empty()) {
+      // Pipelined writes are still inserting into mem_; the last of them
+      // signals the front of writers_ (this thread) once done.
+      writers_.front()->cv.Wait();
     } else {
       // Attempt to switch to a new memtable and trigger compaction of old
       assert(versions_->PrevLogNumber() == 0);
@@ -1461,8 +2089,9 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       imm_ = mem_;
       has_imm_.store(true, std::memory_order_release);
       //重新new一个新的mem_供更新
-      mem_ = new MemTable(internal_comparator_);
+      mem_ = new MemTable(internal_comparator_, options_.memtable_factory);
       mem_->Ref();
+      InstallSuperVersion();
       force = false;  // Do not force another compaction if have room
       MaybeScheduleCompaction();
     }
@@ -1514,6 +2143,8 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
   } else if (in == "sstables") {
     *value = versions_->current()->DebugString();
     return true;
+  } else if (in == "block-cache-stats") {
+    return options_.block_cache->GetStats(value);
   } else if (in == "approximate-memory-usage") {
     size_t total_usage = options_.block_cache->TotalCharge();
     if (mem_) {
@@ -1565,12 +2196,45 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
   return Write(opt, &batch);
 }
 
+std::vector<Status> DB::MultiGet(const ReadOptions& options,
+                                 const std::vector<Slice>& keys,
+                                 std::vector<std::string>* values) {
+  std::vector<Status> statuses(keys.size());
+  values->clear();
+  values->resize(keys.size());
+  ReadOptions read_options = options;
+  if (options.snapshot == nullptr) {
+    read_options.snapshot = GetSnapshot();
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    statuses[i] = Get(read_options, keys[i], &(*values)[i]);
+  }
+  if (options.snapshot == nullptr) {
+    ReleaseSnapshot(read_options.snapshot);
+  }
+  return statuses;
+}
+
+Status DB::Get(const ReadOptions& options, const Slice& key,
+               PinnableSlice* value) {
+  std::string result;
+  Status s = Get(options, key, &result);
+  if (s.ok()) {
+    value->PinSelf(result);
+  } else {
+    value->Reset();
+  }
+  return s;
+}
+
 DB::~DB() = default;
 
 Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
   *dbptr = nullptr;
 
   DBImpl* impl = new DBImpl(options, dbname);
+  impl->env_->SetBackgroundThreads(impl->options_.max_background_compactions,
+                                   Env::kLowPriority);
   impl->mutex_.Lock();
   VersionEdit edit;
   // Recover handles create_if_missing, error_if_exists
@@ -1587,16 +2251,18 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
       impl->logfile_ = lfile;
       impl->logfile_number_ = new_log_number;
       impl->log_ = new log::Writer(lfile);
-      impl->mem_ = new MemTable(impl->internal_comparator_);
+      impl->mem_ = new MemTable(impl->internal_comparator_,
+                                impl->options_.memtable_factory);
       impl->mem_->Ref();
     }
   }
   if (s.ok() && save_manifest) {
     edit.SetPrevLogNumber(0);  // No older logs needed after recovery.
     edit.SetLogNumber(impl->logfile_number_);
-    s = impl->versions_->LogAndApply(&edit, &impl->mutex_);
+    s = impl->LogAndApply(&edit);
   }
   if (s.ok()) {
+    impl->InstallSuperVersion();
     impl->RemoveObsoleteFiles();
     impl->MaybeScheduleCompaction();
   }
@@ -22,6 +22,7 @@ namespace leveldb {
 
 class MemTable;
 class TableCache;
+class ThreadLocalPtr;
 class Version;
 class VersionEdit;
 class VersionSet;
@@ -42,6 +43,11 @@ class DBImpl : public DB {
   Status Write(const WriteOptions& options, WriteBatch* updates) override;
   Status Get(const ReadOptions& options, const Slice& key,
              std::string* value) override;
+  Status Get(const ReadOptions& options, const Slice& key,
+             PinnableSlice* value) override;
+  std::vector<Status> MultiGet(const ReadOptions& options,
+                               const std::vector<Slice>& keys,
+                               std::vector<std::string>* values) override;
   Iterator* NewIterator(const ReadOptions&) override;
   const Snapshot* GetSnapshot() override;
   void ReleaseSnapshot(const Snapshot* snapshot) override;
@@ -74,8 +80,23 @@ class DBImpl : public DB {
  private:
   friend class DB;
   struct CompactionState;
+  struct Subcompaction;
   struct Writer;
 
+  // A referenced bundle of the memtables and the current Version.  Readers
+  // obtain one through AcquireSuperVersion(), which normally hands out a
+  // copy cached in the calling thread without touching mutex_.  A new
+  // SuperVersion is installed whenever mem_, imm_ or versions_->current()
+  // changes, and installing it invalidates every thread-local copy.
+  struct SuperVersion {
+    MemTable* mem;
+    MemTable* imm;  // May be nullptr
+    Version* current;
+    uint64_t number;  // Value of super_version_number_ when installed
+    std::atomic<int> refs;
+    port::Mutex* mu;  // Protects the Unref() calls made during cleanup
+  };
+
   // Information for a manual compaction
   struct ManualCompaction {
     int level;
@@ -115,6 +136,44 @@ class DBImpl : public DB {
 
   void MaybeIgnoreError(Status* s) const;
 
+  // Build a SuperVersion for the current mem_, imm_ and Version, make it
+  // the one handed to readers, and drop every thread-local cached copy.
+  void InstallSuperVersion() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Return a referenced SuperVersion.  Does not acquire mutex_ unless the
+  // calling thread's cached copy is missing or out of date.
+  SuperVersion* AcquireSuperVersion() LOCKS_EXCLUDED(mutex_);
+
+  // Return a SuperVersion obtained from AcquireSuperVersion(), caching it
+  // in the calling thread if it is still current.
+  void ReleaseSuperVersion(SuperVersion* sv) LOCKS_EXCLUDED(mutex_);
+
+  // Implements both Get()s: exactly one of "value" and "pinnable" is set.
+  Status GetImpl(const ReadOptions& options, const Slice& key,
+                 std::string* value, PinnableSlice* pinnable)
+      LOCKS_EXCLUDED(mutex_);
+
+  // Drop every SuperVersion cached by other threads.
+  void ResetLocalSuperVersions() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Drop one reference to *sv and delete it if that was the last one.
+  // UnrefSuperVersion() acquires sv->mu when deletion is needed.
+  static void UnrefSuperVersion(SuperVersion* sv);
+  // Cleanup function of a PinnableSlice holding a reference to arg1.
+  static void UnpinSuperVersion(void* arg1, void* arg2);
+  void UnrefSuperVersionLocked(SuperVersion* sv)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // REQUIRES: sv->mu is held and no references to *sv remain.
+  static void DeleteSuperVersion(SuperVersion* sv);
+
+  // ThreadLocalPtr handler for SuperVersions cached by exiting threads.
+  static void CleanupThreadLocalSuperVersion(void* ptr);
+
+  // The last sequence number is published atomically by VersionSet, so
+  // readers may fetch it without holding mutex_.
+  SequenceNumber LastSequenceNoLock() const NO_THREAD_SAFETY_ANALYSIS;
+
   // Delete any unneeded files and stale in-memory entries.
   void RemoveObsoleteFiles() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
@@ -127,24 +186,56 @@ class DBImpl : public DB {
                         VersionEdit* edit, SequenceNumber* max_sequence)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base)
+  // Write "mem" to a new table and record it in *edit.  The table's number
+  // is stored in *file_number and left in pending_outputs_; the caller
+  // erases it once *edit has been installed (or abandoned).
+  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base,
+                          uint64_t* file_number)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
-  WriteBatch* BuildBatchGroup(Writer** last_writer)
+  WriteBatch* BuildBatchGroup(Writer** last_writer, WriteBatch* tmp_batch)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Insert the batches of "group", which were logged together as
+  // "write_batch", into mem_ with every writer of the group inserting its
+  // own batch in parallel.  REQUIRES: group[0] is the calling leader.
+  Status InsertBatchGroupConcurrently(const std::vector<Writer*>& group,
+                                      WriteBatch* write_batch)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Called by a follower once its leader has asked it to insert its own
+  // batch (see InsertBatchGroupConcurrently()).
+  void InsertFollowerBatch(Writer* w) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Write() for options_.enable_pipelined_write: the log append of one
+  // batch group overlaps with the memtable insertion of the previous one.
+  Status PipelinedWrite(const WriteOptions& options, WriteBatch* updates)
+      LOCKS_EXCLUDED(mutex_);
+
   void RecordBackgroundError(const Status& s);
 
+  // Apply *edit through versions_->LogAndApply().  Flushes and concurrent
+  // compactions may all install edits, so calls are serialized here.
+  Status LogAndApply(VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Schedule a memtable flush on the high priority pool and/or one more
+  // compaction on the low priority pool if there is work for them.
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
-  static void BGWork(void* db);
-  void BackgroundCall();
-  void BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  static void BGFlushWork(void* db);
+  static void BGCompactionWork(void* db);
+  void BackgroundFlushCall();
+  void BackgroundCompactionCall();
+  // Returns true iff a compaction was picked and run.
+  bool BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void CleanupCompaction(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Merge the part of a compaction's input selected by *sub.
+  Status DoSubcompactionWork(Subcompaction* sub) LOCKS_EXCLUDED(mutex_);
+  static void SubcompactionThread(void* arg);
 
   Status OpenCompactionOutputFile(CompactionState* compact);
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
@@ -159,6 +250,7 @@ class DBImpl : public DB {
   Env* const env_;
   const InternalKeyComparator internal_comparator_;
   const InternalFilterPolicy internal_filter_policy_;
+  const InternalKeySliceTransform internal_prefix_extractor_;
   const Options options_;  // options_.comparator == &internal_comparator_
   const bool owns_info_log_;
   const bool owns_cache_;
@@ -191,6 +283,11 @@ class DBImpl : public DB {
   std::deque<Writer*> writers_ GUARDED_BY(mutex_);
   WriteBatch* tmp_batch_ GUARDED_BY(mutex_);
 
+  // Leaders of pipelined batch groups that have been logged and are
+  // waiting for (or doing) their memtable insertion, in sequence order.
+  // mem_ is not switched while this is non-empty.
+  std::deque<Writer*> memtable_writers_ GUARDED_BY(mutex_);
+
   SnapshotList snapshots_ GUARDED_BY(mutex_);
 
   // Set of table files to protect from deletion because they are
@@ -198,13 +295,32 @@ class DBImpl : public DB {
   //正在compactions的文件
   std::set<uint64_t> pending_outputs_ GUARDED_BY(mutex_);
 
-  // Has a background compaction been scheduled or is running?
-  bool background_compaction_scheduled_ GUARDED_BY(mutex_);
+  // Has a memtable flush been scheduled or is one running?
+  bool background_flush_scheduled_ GUARDED_BY(mutex_);
+  // Is imm_ being written out by CompactMemTable() right now?
+  bool flushing_memtable_ GUARDED_BY(mutex_);
+
+  // Number of compaction jobs that are scheduled or running.
+  int background_compactions_scheduled_ GUARDED_BY(mutex_);
+  // Number of compactions whose inputs are currently marked as being
+  // compacted.  Manual compactions only run when this is zero.
+  int running_compactions_ GUARDED_BY(mutex_);
+
+  // Is some thread inside versions_->LogAndApply()?
+  bool writing_manifest_ GUARDED_BY(mutex_);
+  port::CondVar manifest_write_finished_signal_ GUARDED_BY(mutex_);
 
   ManualCompaction* manual_compaction_ GUARDED_BY(mutex_);
 
   VersionSet* const versions_ GUARDED_BY(mutex_);
 
+  // Latest SuperVersion; holds one reference of its own.
+  SuperVersion* super_version_ GUARDED_BY(mutex_);
+  // Incremented (under mutex_) each time a SuperVersion is installed.
+  std::atomic<uint64_t> super_version_number_;
+  // Per-thread cached SuperVersion (see AcquireSuperVersion()).
+  ThreadLocalPtr* const local_super_version_;
+
   // Have we encountered a background error in paranoid mode?
   Status bg_error_ GUARDED_BY(mutex_);
 
@@ -216,6 +332,7 @@ class DBImpl : public DB {
 Options SanitizeOptions(const std::string& db,
                         const InternalKeyComparator* icmp,
                         const InternalFilterPolicy* ipolicy,
+                        const InternalKeySliceTransform* iprefix,
                         const Options& src);
 
 }  // namespace leveldb
@@ -46,13 +46,15 @@ class DBIter : public Iterator {
   enum Direction { kForward, kReverse };
 
   DBIter(DBImpl* db, const Comparator* cmp, Iterator* iter, SequenceNumber s,
-         uint32_t seed)
+         uint32_t seed, const SliceTransform* prefix_extractor)
       : db_(db),
         user_comparator_(cmp),
+        prefix_extractor_(prefix_extractor),
         iter_(iter),
         sequence_(s),
         direction_(kForward),
         valid_(false),
+        prefix_bounded_(false),
         rnd_(seed),
         bytes_until_read_sampling_(RandomCompactionPeriod()) {}
 
@@ -87,6 +89,13 @@ class DBIter : public Iterator {
   void FindNextUserEntry(bool skipping, std::string* skip);
   void FindPrevUserEntry();
   bool ParseKey(ParsedInternalKey* key);
+  // True if "user_key" is outside of the prefix the last Seek() bounded
+  // the iteration to.
+  bool OutOfPrefix(const Slice& user_key) const {
+    return prefix_bounded_ && (!prefix_extractor_->InDomain(user_key) ||
+                               prefix_extractor_->Transform(user_key) !=
+                                   Slice(prefix_));
+  }
 
   inline void SaveKey(const Slice& k, std::string* dst) {
     dst->assign(k.data(), k.size());
@@ -108,6 +117,7 @@ class DBIter : public Iterator {
 
   DBImpl* db_;
   const Comparator* const user_comparator_;
+  const SliceTransform* const prefix_extractor_;
   Iterator* const iter_;
   SequenceNumber const sequence_;
   Status status_;
@@ -115,6 +125,8 @@ class DBIter : public Iterator {
   std::string saved_value_;  // == current raw value when direction_==kReverse
   Direction direction_;
   bool valid_;
+  bool prefix_bounded_;  // Only keys with prefix_ are yielded
+  std::string prefix_;
   Random rnd_;
   size_t bytes_until_read_sampling_;
 };
@@ -180,7 +192,11 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
   assert(direction_ == kForward);
   do {
     ParsedInternalKey ikey;
-    if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
+    const bool parsed = ParseKey(&ikey);
+    if (parsed && OutOfPrefix(ikey.user_key)) {
+      break;
+    }
+    if (parsed && ikey.sequence <= sequence_) {
       switch (ikey.type) {
         case kTypeDeletion:
           // Arrange to skip all upcoming entries for this key since
@@ -240,7 +256,13 @@ void DBIter::FindPrevUserEntry() {
   if (iter_->Valid()) {
     do {
       ParsedInternalKey ikey;
-      if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
+      const bool parsed = ParseKey(&ikey);
+      if (parsed && OutOfPrefix(ikey.user_key)) {
+        // Keys before the prefix are not yielded, so the entries found so
+        // far decide the result.
+        break;
+      }
+      if (parsed && ikey.sequence <= sequence_) {
         if ((value_type != kTypeDeletion) &&
             user_comparator_->Compare(ikey.user_key, saved_key_) < 0) {
           // We encountered a non-deleted value in entries for previous keys,
@@ -278,6 +300,12 @@ void DBIter::FindPrevUserEntry() {
 void DBIter::Seek(const Slice& target) {
   direction_ = kForward;
   ClearSavedValue();
+  prefix_bounded_ =
+      prefix_extractor_ != nullptr && prefix_extractor_->InDomain(target);
+  if (prefix_bounded_) {
+    Slice prefix = prefix_extractor_->Transform(target);
+    prefix_.assign(prefix.data(), prefix.size());
+  }
   saved_key_.clear();
   AppendInternalKey(&saved_key_,
                     ParsedInternalKey(target, sequence_, kValueTypeForSeek));
@@ -292,6 +320,7 @@ void DBIter::Seek(const Slice& target) {
 void DBIter::SeekToFirst() {
   direction_ = kForward;
   ClearSavedValue();
+  prefix_bounded_ = false;
   iter_->SeekToFirst();
   if (iter_->Valid()) {
     FindNextUserEntry(false, &saved_key_ /* temporary storage */);
@@ -303,6 +332,7 @@ void DBIter::SeekToFirst() {
 void DBIter::SeekToLast() {
   direction_ = kReverse;
   ClearSavedValue();
+  prefix_bounded_ = false;
   iter_->SeekToLast();
   FindPrevUserEntry();
 }
@@ -311,8 +341,10 @@ void DBIter::SeekToLast() {
 
 Iterator* NewDBIterator(DBImpl* db, const Comparator* user_key_comparator,
                         Iterator* internal_iter, SequenceNumber sequence,
-                        uint32_t seed) {
-  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed);
+                        uint32_t seed,
+                        const SliceTransform* prefix_extractor) {
+  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed,
+                    prefix_extractor);
 }
 
 }  // namespace leveldb
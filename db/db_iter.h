@@ -16,10 +16,13 @@ class DBImpl;
 
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// into appropriate user keys.  If "prefix_extractor" is non-null, the
+// iterator stops at the first key whose prefix differs from that of the
+// target of the last Seek().
 Iterator* NewDBIterator(DBImpl* db, const Comparator* user_key_comparator,
                         Iterator* internal_iter, SequenceNumber sequence,
-                        uint32_t seed);
+                        uint32_t seed,
+                        const SliceTransform* prefix_extractor = nullptr);
 
 }  // namespace leveldb
 
@@ -6,7 +6,10 @@
 
 #include <atomic>
 #include <cinttypes>
+#include <map>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "db/db_impl.h"
@@ -16,6 +19,9 @@
 #include "leveldb/cache.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/memtablerep.h"
+#include "leveldb/persistent_cache.h"
+#include "leveldb/slice_transform.h"
 #include "leveldb/table.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
@@ -237,6 +243,12 @@ class DBTest : public testing::Test {
 
   DBTest() : env_(new SpecialEnv(Env::Default())), option_config_(kDefault) {
     filter_policy_ = NewBloomFilterPolicy(10);
+    prefix_extractor_ = NewFixedPrefixTransform(1);
+    hash_skiplist_factory_ = NewHashSkipListRepFactory(prefix_extractor_);
+    vector_factory_ = NewVectorRepFactory();
+    empty_cache_ = NewLRUCache(0);
+    compressed_block_cache_ = NewLRUCache(1 << 20);
+    row_cache_ = NewLRUCache(1 << 20);
     dbname_ = testing::TempDir() + "db_test";
     DestroyDB(dbname_, Options());
     db_ = nullptr;
@@ -248,6 +260,12 @@ class DBTest : public testing::Test {
     DestroyDB(dbname_, Options());
     delete env_;
     delete filter_policy_;
+    delete hash_skiplist_factory_;
+    delete vector_factory_;
+    delete prefix_extractor_;
+    delete empty_cache_;
+    delete compressed_block_cache_;
+    delete row_cache_;
   }
 
   // Switch to a fresh database with the next option configuration to
@@ -273,9 +291,49 @@ class DBTest : public testing::Test {
       case kFilter:
         options.filter_policy = filter_policy_;
         break;
+      case kFullFilter:
+        options.filter_policy = filter_policy_;
+        options.full_filter = true;
+        break;
+      case kPartitionedIndexAndFilter:
+        options.filter_policy = filter_policy_;
+        options.partition_index_and_filters = true;
+        options.metadata_block_size = 256;
+        break;
+      case kCachedIndexAndFilter:
+        options.filter_policy = filter_policy_;
+        options.cache_index_and_filter_blocks = true;
+        options.pin_l0_filter_and_index_blocks_in_cache = true;
+        break;
+      case kDataBlockHashIndex:
+        options.data_block_hash_index = true;
+        break;
+      case kCompressedBlockCache:
+        // Every block read goes to the compressed block cache.
+        options.block_cache = empty_cache_;
+        options.compressed_block_cache = compressed_block_cache_;
+        break;
+      case kRowCache:
+        options.row_cache = row_cache_;
+        break;
       case kUncompressed:
         options.compression = kNoCompression;
         break;
+      case kParallelCompactions:
+        options.max_background_compactions = 4;
+        break;
+      case kPipelinedWrite:
+        options.enable_pipelined_write = true;
+        break;
+      case kConcurrentMemtableWrite:
+        options.allow_concurrent_memtable_write = true;
+        break;
+      case kHashSkipListRep:
+        options.memtable_factory = hash_skiplist_factory_;
+        break;
+      case kVectorRep:
+        options.memtable_factory = vector_factory_;
+        break;
       default:
         break;
     }
@@ -532,9 +590,32 @@ class DBTest : public testing::Test {
 
  private:
   // Sequence of option configurations to try
-  enum OptionConfig { kDefault, kReuse, kFilter, kUncompressed, kEnd };
+  enum OptionConfig {
+    kDefault,
+    kReuse,
+    kFilter,
+    kFullFilter,
+    kPartitionedIndexAndFilter,
+    kCachedIndexAndFilter,
+    kDataBlockHashIndex,
+    kCompressedBlockCache,
+    kRowCache,
+    kUncompressed,
+    kParallelCompactions,
+    kPipelinedWrite,
+    kConcurrentMemtableWrite,
+    kHashSkipListRep,
+    kVectorRep,
+    kEnd
+  };
 
   const FilterPolicy* filter_policy_;
+  const SliceTransform* prefix_extractor_;
+  MemTableRepFactory* hash_skiplist_factory_;
+  MemTableRepFactory* vector_factory_;
+  Cache* empty_cache_;
+  Cache* compressed_block_cache_;
+  Cache* row_cache_;
   int option_config_;
 };
 
@@ -615,6 +696,62 @@ TEST_F(DBTest, GetFromVersions) {
   } while (ChangeOptions());
 }
 
+TEST_F(DBTest, GetPinned) {
+  do {
+    ASSERT_LEVELDB_OK(Put("foo", "v1"));
+    ASSERT_LEVELDB_OK(Put("bar", "v2"));
+    {
+      PinnableSlice value;
+      ASSERT_LEVELDB_OK(db_->Get(ReadOptions(), "foo", &value));
+      ASSERT_TRUE(value.IsPinned());
+      // The memtable stays while pinned.
+      dbfull()->TEST_CompactMemTable();
+      ASSERT_EQ("v1", value.ToString());
+    }
+
+    PinnableSlice value;
+    ASSERT_LEVELDB_OK(db_->Get(ReadOptions(), "bar", &value));
+    ASSERT_TRUE(value.IsPinned());
+    ASSERT_EQ("v2", value.ToString());
+    // So does the table, after compactions replace it.
+    ASSERT_LEVELDB_OK(Put("bar", "v3"));
+    dbfull()->TEST_CompactMemTable();
+    Compact("a", "z");
+    ASSERT_EQ("v2", value.ToString());
+    ASSERT_LEVELDB_OK(db_->Get(ReadOptions(), "bar", &value));
+    ASSERT_EQ("v3", value.ToString());
+
+    ASSERT_TRUE(db_->Get(ReadOptions(), "missing", &value).IsNotFound());
+    ASSERT_TRUE(!value.IsPinned());
+    ASSERT_TRUE(value.empty());
+  } while (ChangeOptions());
+}
+
+TEST_F(DBTest, CloseWhileReaderThreadsExit) {
+  for (int round = 0; round < 20; round++) {
+    Reopen();
+    ASSERT_LEVELDB_OK(Put("foo", "v1"));
+    // The readers return as soon as their Get()s are done, so the DB is
+    // closed while their cached SuperVersions are being released.
+    const int kNumThreads = 8;
+    std::atomic<int> done(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kNumThreads; i++) {
+      threads.emplace_back([this, &done]() {
+        ASSERT_EQ("v1", Get("foo"));
+        done.fetch_add(1);
+      });
+    }
+    while (done.load() < kNumThreads) {
+      std::this_thread::yield();
+    }
+    Close();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+}
+
 TEST_F(DBTest, GetMemUsage) {
   do {
     ASSERT_LEVELDB_OK(Put("foo", "v1"));
@@ -626,6 +763,44 @@ TEST_F(DBTest, GetMemUsage) {
   } while (ChangeOptions());
 }
 
+TEST_F(DBTest, GetBlockCacheStats) {
+  Options options = CurrentOptions();
+  options.block_cache = NewLRUCache(1 << 20, 2, false);
+  Reopen(&options);
+  ASSERT_LEVELDB_OK(Put("foo", "v1"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ("v1", Get("foo"));
+
+  std::string stats;
+  ASSERT_TRUE(db_->GetProperty("leveldb.block-cache-stats", &stats));
+  // A header, a separator, then one row per shard.
+  std::vector<std::string> rows;
+  size_t start = 0;
+  for (size_t end; (end = stats.find('\n', start)) != std::string::npos;
+       start = end + 1) {
+    rows.push_back(stats.substr(start, end - start));
+  }
+  ASSERT_EQ(2 + 4, rows.size());
+  unsigned long long hits = 0, misses = 0;
+  for (size_t i = 2; i < rows.size(); i++) {
+    int shard;
+    unsigned long long capacity, usage, pinned, shard_hits, shard_misses;
+    ASSERT_EQ(6, std::sscanf(rows[i].c_str(), "%d %llu %llu %llu %llu %llu",
+                             &shard, &capacity, &usage, &pinned, &shard_hits,
+                             &shard_misses));
+    ASSERT_EQ(i - 2, shard);
+    ASSERT_EQ((1 << 20) / 4, capacity);
+    hits += shard_hits;
+    misses += shard_misses;
+  }
+  // Blocks of mmapped files are not cached, so reads may only miss.
+  ASSERT_GE(hits + misses, 2);
+
+  Close();
+  delete options.block_cache;
+}
+
 TEST_F(DBTest, GetSnapshot) {
   do {
     // Try with both a short key and a long key
@@ -1124,6 +1299,134 @@ TEST_F(DBTest, CompactionsGenerateMultipleFiles) {
   }
 }
 
+TEST_F(DBTest, MultiGet) {
+  do {
+    // Spread versions of the keys over the memtable, level-0 files and
+    // the other levels, with some keys deleted along the way.
+    Random rnd(301);
+    for (int round = 0; round < 4; round++) {
+      for (int i = 0; i < 200; i++) {
+        const int k = rnd.Uniform(300);
+        if (rnd.OneIn(5)) {
+          ASSERT_LEVELDB_OK(Delete(Key(k)));
+        } else {
+          ASSERT_LEVELDB_OK(Put(Key(k), Key(k) + "." + std::to_string(round)));
+        }
+      }
+      if (round == 0) {
+        Compact(Key(0), Key(300));
+      } else if (round < 3) {
+        dbfull()->TEST_CompactMemTable();
+      }
+    }
+    const Snapshot* snapshot = db_->GetSnapshot();
+    ASSERT_LEVELDB_OK(Put(Key(7), "after snapshot"));
+
+    // Unsorted keys with duplicates; some were never written.
+    std::vector<std::string> key_storage;
+    for (int i = 0; i < 400; i++) {
+      key_storage.push_back(Key(rnd.Uniform(350)));
+    }
+    key_storage.push_back(Key(7));
+    std::vector<Slice> keys(key_storage.begin(), key_storage.end());
+
+    const Snapshot* snapshots[] = {nullptr, snapshot};
+    for (const Snapshot* s : snapshots) {
+      ReadOptions options;
+      options.snapshot = s;
+      std::vector<std::string> values;
+      std::vector<Status> statuses = db_->MultiGet(options, keys, &values);
+      ASSERT_EQ(keys.size(), statuses.size());
+      ASSERT_EQ(keys.size(), values.size());
+      for (size_t i = 0; i < keys.size(); i++) {
+        const std::string expected = Get(key_storage[i], s);
+        if (expected == "NOT_FOUND") {
+          ASSERT_TRUE(statuses[i].IsNotFound());
+        } else {
+          ASSERT_LEVELDB_OK(statuses[i]);
+          ASSERT_EQ(expected, values[i]);
+        }
+      }
+    }
+    db_->ReleaseSnapshot(snapshot);
+  } while (ChangeOptions());
+}
+
+TEST_F(DBTest, Subcompactions) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000000;  // Large write buffer
+  options.max_subcompactions = 4;
+  Reopen(&options);
+
+  Random rnd(301);
+
+  // Write 8MB as four level-0 files covering disjoint key ranges, then
+  // overwrite every third key across the whole range.
+  std::vector<std::string> values(80);
+  for (int i = 0; i < 80; i++) {
+    values[i] = RandomString(&rnd, 100000);
+    ASSERT_LEVELDB_OK(Put(Key(i), values[i]));
+    if (i % 20 == 19) {
+      Reopen(&options);
+    }
+  }
+  for (int i = 0; i < 80; i += 3) {
+    values[i] = RandomString(&rnd, 1000);
+    ASSERT_LEVELDB_OK(Put(Key(i), values[i]));
+  }
+  ASSERT_LEVELDB_OK(Delete(Key(1)));
+  values[1] = "NOT_FOUND";
+  Reopen(&options);
+
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+  ASSERT_GT(NumTableFilesAtLevel(1), 1);
+  for (int i = 0; i < 80; i++) {
+    ASSERT_EQ(Get(Key(i)), values[i]);
+  }
+
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(iter->key().ToString(), Key(count == 0 ? 0 : count + 1));
+    count++;
+  }
+  ASSERT_EQ(count, 79);
+  delete iter;
+}
+
+TEST_F(DBTest, CompressionPerLevel) {
+  Options options = CurrentOptions();
+  options.compression_per_level = {kNoCompression, kLZ4Compression,
+                                   kZstdCompression};
+  Reopen(&options);
+
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 200; i++) {
+    std::string value;
+    test::CompressibleString(&rnd, 0.25, 1000, &value);
+    values.push_back(value);
+    ASSERT_LEVELDB_OK(Put(Key(i), value));
+  }
+
+  // Push the data down to level 3, rewriting it with each level's
+  // compression on the way.
+  dbfull()->TEST_CompactMemTable();
+  for (int level = 0; level < 3; level++) {
+    dbfull()->TEST_CompactRange(level, nullptr, nullptr);
+    for (int i = 0; i < 200; i++) {
+      ASSERT_EQ(values[i], Get(Key(i)));
+    }
+  }
+  ASSERT_EQ("0,0,0,1", FilesPerLevel());
+
+  Reopen(&options);
+  for (int i = 0; i < 200; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+}
+
 TEST_F(DBTest, RepeatedWritesToSameKey) {
   Options options = CurrentOptions();
   options.env = env_;
@@ -1941,6 +2244,339 @@ TEST_F(DBTest, BloomFilter) {
   delete options.filter_policy;
 }
 
+TEST_F(DBTest, FullBloomFilter) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.full_filter = true;
+  Reopen(&options);
+
+  // Populate multiple layers
+  const int N = 10000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  Compact("a", "z");
+  for (int i = 0; i < N; i += 100) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  dbfull()->TEST_CompactMemTable();
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+
+  // Lookup present keys.  Should rarely read from small sstable.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+  }
+  int reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d present => %d reads\n", N, reads);
+  ASSERT_GE(reads, N);
+  ASSERT_LE(reads, N + 2 * N / 100);
+
+  // Lookup present keys.  Should rarely read from either sstable.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d missing => %d reads\n", N, reads);
+  ASSERT_LE(reads, 3 * N / 100);
+
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+}
+
+TEST_F(DBTest, PersistentCache) {
+  // The cache goes through the default Env so that its reads are not
+  // counted.
+  Env* const cache_env = Env::Default();
+  const std::string cache_path = dbname_ + "_persistent_cache";
+  PersistentCache* persistent_cache;
+  ASSERT_LEVELDB_OK(
+      NewPersistentCache(cache_env, cache_path, 1 << 30, &persistent_cache));
+
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.persistent_cache = persistent_cache;
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+  const int N = 1000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  Compact("a", "z");
+
+  // Reading back the new tables to check them filled the cache, which
+  // serves their blocks from now on, also after a restart.
+  for (int reopen_cache = 0; reopen_cache < 2; reopen_cache++) {
+    Close();
+    if (reopen_cache) {
+      delete persistent_cache;
+      ASSERT_LEVELDB_OK(NewPersistentCache(cache_env, cache_path, 1 << 30,
+                                           &persistent_cache));
+      options.persistent_cache = persistent_cache;
+    }
+    Reopen(&options);
+    env_->random_read_counter_.Reset();
+    for (int i = 0; i < N; i++) {
+      ASSERT_EQ(Key(i), Get(Key(i)));
+    }
+    // Opening a table reads its footer and index.
+    ASSERT_LE(env_->random_read_counter_.Read(), 10 * TotalTableFiles());
+  }
+
+  // A database recreated under the same name is not served the old
+  // blocks, even though its table files have the same numbers and sizes.
+  DestroyAndReopen(&options);
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(N - 1 - i)));
+  }
+  Compact("a", "z");
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(N - 1 - i), Get(Key(i)));
+  }
+
+  Close();
+  delete options.block_cache;
+  delete persistent_cache;
+  std::vector<std::string> filenames;
+  ASSERT_LEVELDB_OK(cache_env->GetChildren(cache_path, &filenames));
+  for (const std::string& filename : filenames) {
+    cache_env->RemoveFile(cache_path + "/" + filename);
+  }
+  cache_env->RemoveDir(cache_path);
+}
+
+// A PersistentCache in memory whose blocks get corrupted.
+class CorruptingPersistentCache : public PersistentCache {
+ public:
+  void Insert(const Slice& key, const Slice& data) override {
+    std::string corrupted = data.ToString();
+    corrupted[0] ^= 0x80;
+    blocks_.emplace(key.ToString(), corrupted);
+  }
+
+  bool Lookup(const Slice& key, std::string* data) override {
+    auto it = blocks_.find(key.ToString());
+    if (it == blocks_.end()) {
+      return false;
+    }
+    lookups_++;
+    *data = it->second;
+    return true;
+  }
+
+  int lookups() const { return lookups_; }
+
+ private:
+  std::map<std::string, std::string> blocks_;
+  int lookups_ = 0;
+};
+
+TEST_F(DBTest, PersistentCacheChecksums) {
+  CorruptingPersistentCache persistent_cache;
+  Options options = CurrentOptions();
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.persistent_cache = &persistent_cache;
+  options.compression = kNoCompression;
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+  const int N = 100;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  Compact("a", "z");
+
+  // The corrupted blocks are read from the table file instead.
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < N; i++) {
+      ASSERT_EQ(Key(i), Get(Key(i)));
+    }
+  }
+  ASSERT_GT(persistent_cache.lookups(), 0);
+
+  Close();
+  delete options.block_cache;
+}
+
+TEST_F(DBTest, RowCache) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.row_cache = NewLRUCache(1 << 20);
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+
+  ASSERT_LEVELDB_OK(Put("foo", "v1"));
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_LEVELDB_OK(Put("foo", "v2"));
+  ASSERT_LEVELDB_OK(Put("bar", "v3"));
+  ASSERT_LEVELDB_OK(Delete("bar"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(1, TotalTableFiles());
+
+  // The first lookup reads the table, the next ones only the row cache.
+  for (int i = 0; i < 3; i++) {
+    env_->random_read_counter_.Reset();
+    ASSERT_EQ("v2", Get("foo"));
+    ASSERT_EQ("NOT_FOUND", Get("bar"));
+    if (i > 0) {
+      ASSERT_EQ(0, env_->random_read_counter_.Read());
+    }
+  }
+  // Keys missing from the file are not cached.
+  ASSERT_EQ("NOT_FOUND", Get("baz"));
+
+  // The cached entry is too new for the snapshot.
+  ASSERT_EQ("v1", Get("foo", snapshot));
+  ASSERT_EQ("NOT_FOUND", Get("bar", snapshot));
+  db_->ReleaseSnapshot(snapshot);
+
+  Close();
+  delete options.block_cache;
+  delete options.row_cache;
+}
+
+TEST_F(DBTest, CacheIndexAndFilterBlocks) {
+  for (bool pin : {false, true}) {
+    env_->count_random_reads_ = true;
+    Options options = CurrentOptions();
+    options.env = env_;
+    options.block_cache = NewLRUCache(0);  // Nothing stays unless pinned
+    options.filter_policy = NewBloomFilterPolicy(10);
+    options.cache_index_and_filter_blocks = true;
+    options.pin_l0_filter_and_index_blocks_in_cache = pin;
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+
+    // Overlapping flushes land in levels 2, 1 and 0.
+    for (int i = 0; i < 3; i++) {
+      ASSERT_LEVELDB_OK(Put("a", "va"));
+      ASSERT_LEVELDB_OK(Put("z", "vz"));
+      dbfull()->TEST_CompactMemTable();
+    }
+    ASSERT_EQ("1,1,1", FilesPerLevel());
+
+    // Reopen the tables knowing their levels.
+    Reopen(&options);
+    ASSERT_EQ("va", Get("a"));
+
+    // Each lookup reads the index block and filter of each table, but
+    // the pinned one.
+    const int N = 100;
+    env_->random_read_counter_.Reset();
+    for (int i = 0; i < N; i++) {
+      ASSERT_EQ("NOT_FOUND", Get(Key(i)));
+    }
+    int reads = env_->random_read_counter_.Read();
+    std::fprintf(stderr, "pin %d: %d missing => %d reads\n", pin, N, reads);
+    if (pin) {
+      ASSERT_GE(reads, 4 * N);
+      ASSERT_LE(reads, 4 * N + N / 4);
+    } else {
+      ASSERT_GE(reads, 6 * N);
+    }
+
+    Close();
+    delete options.block_cache;
+    delete options.filter_policy;
+  }
+}
+
+TEST_F(DBTest, PrefixSameAsStart) {
+  for (bool full_filter : {false, true}) {
+    env_->count_random_reads_ = true;
+    Options options = CurrentOptions();
+    options.env = env_;
+    options.block_cache = NewLRUCache(0);  // Prevent cache hits
+    options.filter_policy = NewBloomFilterPolicy(10);
+    options.full_filter = full_filter;
+    options.prefix_extractor = NewFixedPrefixTransform(8);  // "key%05d"
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+
+    // Groups of ten keys share a prefix.  Only the even groups are present.
+    const int N = 10000;
+    for (int i = 0; i < N; i++) {
+      if ((i / 10) % 2 == 0) {
+        ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+      }
+    }
+    Compact("a", "z");
+    for (int i = 0; i < N; i += 40) {
+      ASSERT_LEVELDB_OK(Put(Key(i), "v2"));
+    }
+    ASSERT_LEVELDB_OK(Delete(Key(N / 2 + 1)));
+    dbfull()->TEST_CompactMemTable();
+
+    // Prevent auto compactions triggered by seeks
+    env_->delay_data_sync_.store(true, std::memory_order_release);
+
+    ReadOptions ropts;
+    ropts.prefix_same_as_start = true;
+    Iterator* iter = db_->NewIterator(ropts);
+
+    // Present prefixes yield their own keys only.
+    for (int i = 0; i < N; i += 20) {
+      int count = 0;
+      for (iter->Seek(Key(i)); iter->Valid(); iter->Next()) {
+        ASSERT_TRUE(iter->key().starts_with(Key(i).substr(0, 8)));
+        count++;
+      }
+      ASSERT_EQ((i == N / 2) ? 9 : 10, count);
+    }
+    iter->Seek(Key(45));
+    ASSERT_EQ(Key(45), iter->key().ToString());
+    int count = 0;
+    for (; iter->Valid(); iter->Prev()) {
+      count++;
+    }
+    ASSERT_EQ(6, count);
+
+    // Missing prefixes should rarely read a data block, though a seek may
+    // probe the filters of two blocks in each of the two tables.
+    env_->random_read_counter_.Reset();
+    for (int i = 10; i < N; i += 20) {
+      iter->Seek(Key(i));
+      ASSERT_TRUE(!iter->Valid());
+    }
+    int reads = env_->random_read_counter_.Read();
+    std::fprintf(stderr, "%d missing prefixes => %d reads\n", N / 20, reads);
+    ASSERT_LE(reads, 6 * (N / 20) / 100);
+    ASSERT_LEVELDB_OK(iter->status());
+
+    // Without a seek target, the iterator is not bounded.
+    iter->SeekToFirst();
+    count = 0;
+    for (; iter->Valid(); iter->Next()) {
+      count++;
+    }
+    ASSERT_EQ(N / 2 - 1, count);
+    delete iter;
+
+    // The prefix is ignored unless requested.
+    iter = db_->NewIterator(ReadOptions());
+    iter->Seek(Key(10));
+    ASSERT_EQ(Key(20), iter->key().ToString());
+    delete iter;
+
+    env_->delay_data_sync_.store(false, std::memory_order_release);
+    Close();
+    delete options.block_cache;
+    delete options.filter_policy;
+    delete options.prefix_extractor;
+  }
+}
+
 // Multi-threaded test:
 namespace {
 
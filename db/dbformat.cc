@@ -103,6 +103,11 @@ void InternalKeyComparator::FindShortSuccessor(std::string* key) const {
   }
 }
 
+bool InternalKeyComparator::ExtractHashKey(const Slice& key,
+                                           Slice* hash_key) const {
+  return user_comparator_->ExtractHashKey(ExtractUserKey(key), hash_key);
+}
+
 const char* InternalFilterPolicy::Name() const { return user_policy_->Name(); }
 
 void InternalFilterPolicy::CreateFilter(const Slice* keys, int n,
@@ -110,17 +115,37 @@ void InternalFilterPolicy::CreateFilter(const Slice* keys, int n,
   // We rely on the fact that the code in table.cc does not mind us
   // adjusting keys[].
   Slice* mkey = const_cast<Slice*>(keys);
+  int num_keys = 0;
   for (int i = 0; i < n; i++) {
-    mkey[i] = ExtractUserKey(keys[i]);
-    // TODO(sanjay): Suppress dups?
+    Slice user_key = ExtractUserKey(keys[i]);
+    // Keys arrive sorted, so the versions of a user key (or the repeats of
+    // a prefix) are adjacent.
+    if (num_keys > 0 && mkey[num_keys - 1] == user_key) {
+      continue;
+    }
+    mkey[num_keys++] = user_key;
   }
-  user_policy_->CreateFilter(keys, n, dst);
+  user_policy_->CreateFilter(keys, num_keys, dst);
 }
 
 bool InternalFilterPolicy::KeyMayMatch(const Slice& key, const Slice& f) const {
   return user_policy_->KeyMayMatch(ExtractUserKey(key), f);
 }
 
+const char* InternalKeySliceTransform::Name() const {
+  return user_transform_->Name();
+}
+
+Slice InternalKeySliceTransform::Transform(const Slice& key) const {
+  Slice prefix = user_transform_->Transform(ExtractUserKey(key));
+  assert(prefix.data() == key.data());  // Only prefixes are supported
+  return Slice(key.data(), prefix.size() + 8);
+}
+
+bool InternalKeySliceTransform::InDomain(const Slice& key) const {
+  return user_transform_->InDomain(ExtractUserKey(key));
+}
+
 /**
  * LookupKey = [klength] [User key] [Sequence] [Type]
  *
@@ -13,6 +13,7 @@
 #include "leveldb/db.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/slice.h"
+#include "leveldb/slice_transform.h"
 #include "leveldb/table_builder.h"
 #include "util/coding.h"
 #include "util/logging.h"
@@ -111,6 +112,8 @@ class InternalKeyComparator : public Comparator {
   void FindShortestSeparator(std::string* start,
                              const Slice& limit) const override;
   void FindShortSuccessor(std::string* key) const override;
+  // Point lookups are after the entries of one user key.
+  bool ExtractHashKey(const Slice& key, Slice* hash_key) const override;
 
   const Comparator* user_comparator() const { return user_comparator_; }
 
@@ -129,6 +132,25 @@ class InternalFilterPolicy : public FilterPolicy {
   bool KeyMayMatch(const Slice& key, const Slice& filter) const override;
 };
 
+// Prefix extractor wrapper that applies a user key transform to internal
+// keys.  Its results are meant for InternalFilterPolicy, which drops the
+// last 8 bytes of what it is given: the result is the user key's prefix
+// followed by the next 8 bytes of the internal key, so that the filter
+// sees the prefix itself.
+class InternalKeySliceTransform : public SliceTransform {
+ private:
+  const SliceTransform* const user_transform_;
+
+ public:
+  explicit InternalKeySliceTransform(const SliceTransform* t)
+      : user_transform_(t) {}
+  const char* Name() const override;
+  Slice Transform(const Slice& key) const override;
+  bool InDomain(const Slice& key) const override;
+
+  const SliceTransform* user_transform() const { return user_transform_; }
+};
+
 // Modules in this directory should keep internal keys wrapped inside
 // the following class instead of plain strings so that we do not
 // incorrectly use string comparisons instead of an InternalKeyComparator.
@@ -22,12 +22,28 @@ static Slice GetLengthPrefixedSlice(const char* data) {
   return Slice(p, len);
 }
 
-MemTable::MemTable(const InternalKeyComparator& comparator)
-    : comparator_(comparator), refs_(0), table_(comparator_, &arena_) {}
+static MemTableRepFactory* DefaultRepFactory() {
+  static MemTableRepFactory* factory = NewSkipListRepFactory();
+  return factory;
+}
+
+MemTable::MemTable(const InternalKeyComparator& comparator,
+                   MemTableRepFactory* factory)
+    : comparator_(comparator),
+      refs_(0),
+      table_((factory != nullptr ? factory : DefaultRepFactory())
+                 ->CreateMemTableRep(comparator_, &arena_)) {}
+
+MemTable::~MemTable() {
+  assert(refs_ == 0);
+  delete table_;
+}
 
-MemTable::~MemTable() { assert(refs_ == 0); }
+size_t MemTable::ApproximateMemoryUsage() {
+  return arena_.MemoryUsage() + table_->ApproximateMemoryUsage();
+}
 
-size_t MemTable::ApproximateMemoryUsage() { return arena_.MemoryUsage(); }
+void MemTable::MarkReadOnly() { table_->MarkReadOnly(); }
 
 /**
  * operator()负责解析出 internal key，交给 comparator
@@ -52,39 +68,51 @@ static const char* EncodeKey(std::string* scratch, const Slice& target) {
 
 class MemTableIterator : public Iterator {
  public:
-  explicit MemTableIterator(MemTable::Table* table) : iter_(table) {}
+  explicit MemTableIterator(MemTableRep::Iterator* iter) : iter_(iter) {}
 
   MemTableIterator(const MemTableIterator&) = delete;
   MemTableIterator& operator=(const MemTableIterator&) = delete;
 
-  ~MemTableIterator() override = default;
+  ~MemTableIterator() override { delete iter_; }
 
-  bool Valid() const override { return iter_.Valid(); }
-  void Seek(const Slice& k) override { iter_.Seek(EncodeKey(&tmp_, k)); }
-  void SeekToFirst() override { iter_.SeekToFirst(); }
-  void SeekToLast() override { iter_.SeekToLast(); }
-  void Next() override { iter_.Next(); }
-  void Prev() override { iter_.Prev(); }
-  Slice key() const override { return GetLengthPrefixedSlice(iter_.key()); }
+  bool Valid() const override { return iter_->Valid(); }
+  void Seek(const Slice& k) override { iter_->Seek(EncodeKey(&tmp_, k)); }
+  void SeekToFirst() override { iter_->SeekToFirst(); }
+  void SeekToLast() override { iter_->SeekToLast(); }
+  void Next() override { iter_->Next(); }
+  void Prev() override { iter_->Prev(); }
+  Slice key() const override { return GetLengthPrefixedSlice(iter_->key()); }
   Slice value() const override {
-    Slice key_slice = GetLengthPrefixedSlice(iter_.key());
+    Slice key_slice = GetLengthPrefixedSlice(iter_->key());
     return GetLengthPrefixedSlice(key_slice.data() + key_slice.size());
   }
 
   Status status() const override { return Status::OK(); }
 
  private:
-  MemTable::Table::Iterator iter_;
+  MemTableRep::Iterator* const iter_;
   std::string tmp_;  // For passing to EncodeKey
 };
 
-Iterator* MemTable::NewIterator() { return new MemTableIterator(&table_); }
+Iterator* MemTable::NewIterator() {
+  return new MemTableIterator(table_->GetIterator());
+}
 
 /**
  * Add过程的代码就是组装memtable key，然后调用SkipList接口写入。
  */
 void MemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
                    const Slice& value) {
+  AddEntry(s, type, key, value, false);
+}
+
+void MemTable::AddConcurrently(SequenceNumber s, ValueType type,
+                               const Slice& key, const Slice& value) {
+  AddEntry(s, type, key, value, true);
+}
+
+void MemTable::AddEntry(SequenceNumber s, ValueType type, const Slice& key,
+                        const Slice& value, bool concurrently) {
   // Format of an entry is concatenation of:
   //  key_size     : varint32 of internal_key.size()
   //  key bytes    : char[internal_key.size()]
@@ -102,7 +130,8 @@ void MemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
   const size_t encoded_len = VarintLength(internal_key_size) +
                              internal_key_size + VarintLength(val_size) +
                              val_size;
-  char* buf = arena_.Allocate(encoded_len);
+  char* buf = concurrently ? arena_.AllocateConcurrently(encoded_len)
+                           : arena_.Allocate(encoded_len);
   char* p = EncodeVarint32(buf, internal_key_size);
   std::memcpy(p, key.data(), key_size);
   p += key_size;
@@ -116,7 +145,11 @@ void MemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
   std::memcpy(p, value.data(), val_size);
   assert(p + val_size == buf + encoded_len);
   //写入table_的buffer包含了key/value及附属信息
-  table_.Insert(buf);
+  if (concurrently) {
+    table_->InsertConcurrently(buf);
+  } else {
+    table_->Insert(buf);
+  }
 }
 
 /**
@@ -128,10 +161,22 @@ void MemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
  *     2.如果 userkey 不存在，返回第一个 > userkey 的 Node.
  */
 bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
+  Slice v;
+  if (!Get(key, &v, s)) {
+    return false;
+  }
+  if (s->ok()) {
+    value->assign(v.data(), v.size());
+  }
+  return true;
+}
+
+bool MemTable::Get(const LookupKey& key, Slice* value, Status* s) {
   Slice memkey = key.memtable_key();
-  Table::Iterator iter(&table_);
-  iter.Seek(memkey.data());
-  if (iter.Valid()) {
+  MemTableRep::Iterator* iter = table_->GetPointLookupIterator(key.user_key());
+  iter->Seek(memkey.data());
+  bool found = false;
+  if (iter->Valid()) {
     // entry format is:
     //    klength  varint32
     //    userkey  char[klength]
@@ -141,7 +186,7 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
     // Check that it belongs to same user key.  We do not check the
     // sequence number since the Seek() call above should have skipped
     // all entries with overly large sequence numbers.
-    const char* entry = iter.key();
+    const char* entry = iter->key();
     uint32_t key_length;
     //解析出internal_key的长度存储到key_length
     //key_ptr指向internal_key
@@ -162,17 +207,19 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
         //        key是写入状态：正常返回
         //        key是删除状态：返回空
         case kTypeValue: {
-          Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
-          value->assign(v.data(), v.size());
-          return true;
+          *value = GetLengthPrefixedSlice(key_ptr + key_length);
+          found = true;
+          break;
         }
         case kTypeDeletion:
           *s = Status::NotFound(Slice());
-          return true;
+          found = true;
+          break;
       }
     }
   }
-  return false;
+  delete iter;
+  return found;
 }
 
 }  // namespace leveldb
@@ -8,8 +8,8 @@
 #include <string>
 
 #include "db/dbformat.h"
-#include "db/skiplist.h"
 #include "leveldb/db.h"
+#include "leveldb/memtablerep.h"
 #include "util/arena.h"
 
 namespace leveldb {
@@ -21,7 +21,11 @@ class MemTable {
  public:
   // MemTables are reference counted.  The initial reference count
   // is zero and the caller must call Ref() at least once.
-  explicit MemTable(const InternalKeyComparator& comparator);
+  //
+  // Entries are held in a rep made by "factory", which must outlive the
+  // memtable; nullptr means the default skiplist.
+  explicit MemTable(const InternalKeyComparator& comparator,
+                    MemTableRepFactory* factory = nullptr);
 
   MemTable(const MemTable&) = delete;
   MemTable& operator=(const MemTable&) = delete;
@@ -56,32 +60,43 @@ class MemTable {
   void Add(SequenceNumber seq, ValueType type, const Slice& key,
            const Slice& value);
 
+  // Same as Add(), but may be called from several threads at once.
+  // REQUIRES: no concurrent call to Add().
+  void AddConcurrently(SequenceNumber seq, ValueType type, const Slice& key,
+                       const Slice& value);
+
   // If memtable contains a value for key, store it in *value and return true.
   // If memtable contains a deletion for key, store a NotFound() error
   // in *status and return true.
   // Else, return false.
   bool Get(const LookupKey& key, std::string* value, Status* s);
 
- private:
-  friend class MemTableIterator;
-  friend class MemTableBackwardIterator;
+  // Same as above, but points *value at the value in the memtable, which
+  // stays valid for as long as the memtable is referenced.
+  bool Get(const LookupKey& key, Slice* value, Status* s);
+
+  // Called once no more entries will be added, when the memtable becomes
+  // immutable.  Lets the rep reorganize itself for reads.
+  void MarkReadOnly();
 
+ private:
   //operator()负责解析出 internal key，交给 comparator 比较:
   //[C++ 中的嵌套类和局部类](https://blog.csdn.net/liyuanbhu/article/details/43897979)
-  struct KeyComparator {
+  struct KeyComparator : public MemTableRep::KeyComparator {
     const InternalKeyComparator comparator;
     explicit KeyComparator(const InternalKeyComparator& c) : comparator(c) {}
-    int operator()(const char* a, const char* b) const;
+    int operator()(const char* a, const char* b) const override;
   };
 
-  typedef SkipList<const char*, KeyComparator> Table;
-
   ~MemTable();  // Private since only Unref() should be used to delete it
 
+  void AddEntry(SequenceNumber seq, ValueType type, const Slice& key,
+                const Slice& value, bool concurrently);
+
   KeyComparator comparator_;
   int refs_;
   Arena arena_;
-  Table table_;
+  MemTableRep* const table_;
 };
 
 }  // namespace leveldb
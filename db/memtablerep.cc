@@ -0,0 +1,411 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/memtablerep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/skiplist.h"
+#include "leveldb/slice_transform.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/arena.h"
+#include "util/coding.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+MemTableRep::KeyComparator::~KeyComparator() = default;
+
+MemTableRep::Iterator::~Iterator() = default;
+
+MemTableRep::~MemTableRep() = default;
+
+void MemTableRep::InsertConcurrently(const char* entry) {
+  // Only reps whose factory claims support may be used concurrently.
+  assert(false);
+  Insert(entry);
+}
+
+void MemTableRep::MarkReadOnly() {}
+
+MemTableRep::Iterator* MemTableRep::GetPointLookupIterator(
+    const Slice& user_key) {
+  return GetIterator();
+}
+
+MemTableRepFactory::~MemTableRepFactory() = default;
+
+bool MemTableRepFactory::IsInsertConcurrentlySupported() const {
+  return false;
+}
+
+namespace {
+
+// SkipList takes its comparator by value.
+struct SkipListComparator {
+  explicit SkipListComparator(const MemTableRep::KeyComparator* cmp)
+      : cmp(cmp) {}
+
+  int operator()(const char* a, const char* b) const { return (*cmp)(a, b); }
+
+  const MemTableRep::KeyComparator* cmp;
+};
+
+typedef SkipList<const char*, SkipListComparator> EntryList;
+
+class SkipListIterator : public MemTableRep::Iterator {
+ public:
+  explicit SkipListIterator(const EntryList* list) : iter_(list) {}
+
+  bool Valid() const override { return iter_.Valid(); }
+  const char* key() const override { return iter_.key(); }
+  void Next() override { iter_.Next(); }
+  void Prev() override { iter_.Prev(); }
+  void Seek(const char* target) override { iter_.Seek(target); }
+  void SeekToFirst() override { iter_.SeekToFirst(); }
+  void SeekToLast() override { iter_.SeekToLast(); }
+
+ private:
+  EntryList::Iterator iter_;
+};
+
+class EmptyIterator : public MemTableRep::Iterator {
+ public:
+  bool Valid() const override { return false; }
+  const char* key() const override {
+    assert(false);
+    return nullptr;
+  }
+  void Next() override { assert(false); }
+  void Prev() override { assert(false); }
+  void Seek(const char* target) override {}
+  void SeekToFirst() override {}
+  void SeekToLast() override {}
+};
+
+// Iterates over a vector of entries sorted by "cmp".
+class SortedVectorIterator : public MemTableRep::Iterator {
+ public:
+  // Deletes "entries" when done iff "owned".
+  SortedVectorIterator(const MemTableRep::KeyComparator* cmp,
+                       const std::vector<const char*>* entries, bool owned)
+      : cmp_(cmp), entries_(entries), owned_(owned), pos_(entries->size()) {}
+
+  ~SortedVectorIterator() override {
+    if (owned_) {
+      delete entries_;
+    }
+  }
+
+  bool Valid() const override { return pos_ < entries_->size(); }
+  const char* key() const override {
+    assert(Valid());
+    return (*entries_)[pos_];
+  }
+  void Next() override {
+    assert(Valid());
+    pos_++;
+  }
+  void Prev() override {
+    assert(Valid());
+    pos_ = (pos_ == 0) ? entries_->size() : pos_ - 1;
+  }
+  void Seek(const char* target) override {
+    const MemTableRep::KeyComparator* cmp = cmp_;
+    pos_ = std::lower_bound(entries_->begin(), entries_->end(), target,
+                            [cmp](const char* a, const char* b) {
+                              return (*cmp)(a, b) < 0;
+                            }) -
+           entries_->begin();
+  }
+  void SeekToFirst() override { pos_ = 0; }
+  void SeekToLast() override {
+    pos_ = entries_->empty() ? 0 : entries_->size() - 1;
+  }
+
+ private:
+  const MemTableRep::KeyComparator* const cmp_;
+  const std::vector<const char*>* const entries_;
+  const bool owned_;
+  size_t pos_;
+};
+
+void SortEntries(const MemTableRep::KeyComparator* cmp,
+                 std::vector<const char*>* entries) {
+  std::sort(entries->begin(), entries->end(),
+            [cmp](const char* a, const char* b) { return (*cmp)(a, b) < 0; });
+}
+
+// The default representation: a single skiplist.
+class SkipListRep : public MemTableRep {
+ public:
+  SkipListRep(const KeyComparator& cmp, Arena* arena)
+      : list_(SkipListComparator(&cmp), arena) {}
+
+  void Insert(const char* entry) override { list_.Insert(entry); }
+  void InsertConcurrently(const char* entry) override {
+    list_.InsertConcurrently(entry);
+  }
+  size_t ApproximateMemoryUsage() override { return 0; }
+  Iterator* GetIterator() override { return new SkipListIterator(&list_); }
+
+ private:
+  EntryList list_;
+};
+
+class SkipListRepFactory : public MemTableRepFactory {
+ public:
+  const char* Name() const override { return "leveldb.SkipListRepFactory"; }
+  MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& cmp,
+                                 Arena* arena) override {
+    return new SkipListRep(cmp, arena);
+  }
+  bool IsInsertConcurrentlySupported() const override { return true; }
+};
+
+// A fixed array of buckets, each a skiplist of the entries whose user keys
+// share a prefix (or rather, the hash of one).  Buckets are created on
+// first insert, in the arena.
+class HashSkipListRep : public MemTableRep {
+ public:
+  HashSkipListRep(const KeyComparator& cmp, Arena* arena,
+                  const SliceTransform* prefix_extractor, size_t bucket_count)
+      : cmp_(&cmp),
+        arena_(arena),
+        prefix_extractor_(prefix_extractor),
+        bucket_count_(bucket_count),
+        buckets_(new std::atomic<EntryList*>[bucket_count]) {
+    for (size_t i = 0; i < bucket_count_; i++) {
+      buckets_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~HashSkipListRep() override { delete[] buckets_; }
+
+  void Insert(const char* entry) override {
+    std::atomic<EntryList*>* slot = Bucket(UserKey(entry));
+    EntryList* list = slot->load(std::memory_order_relaxed);
+    if (list == nullptr) {
+      char* mem = arena_->AllocateAligned(sizeof(EntryList));
+      list = new (mem) EntryList(SkipListComparator(cmp_), arena_);
+      // Publish only the fully constructed list to readers.
+      slot->store(list, std::memory_order_release);
+    }
+    list->Insert(entry);
+  }
+
+  // The bucket array is a fixed cost, not charged against the write buffer:
+  // it may well exceed a small write_buffer_size on its own.
+  size_t ApproximateMemoryUsage() override { return 0; }
+
+  // Collects and sorts the entries of every bucket.
+  Iterator* GetIterator() override {
+    std::vector<const char*>* entries = new std::vector<const char*>;
+    for (size_t i = 0; i < bucket_count_; i++) {
+      EntryList* list = buckets_[i].load(std::memory_order_acquire);
+      if (list != nullptr) {
+        EntryList::Iterator iter(list);
+        for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+          entries->push_back(iter.key());
+        }
+      }
+    }
+    SortEntries(cmp_, entries);
+    return new SortedVectorIterator(cmp_, entries, true);
+  }
+
+  Iterator* GetPointLookupIterator(const Slice& user_key) override {
+    EntryList* list = Bucket(user_key)->load(std::memory_order_acquire);
+    if (list == nullptr) {
+      return new EmptyIterator;
+    }
+    return new SkipListIterator(list);
+  }
+
+ private:
+  static Slice UserKey(const char* entry) {
+    uint32_t key_length;
+    const char* key_ptr = GetVarint32Ptr(entry, entry + 5, &key_length);
+    return ExtractUserKey(Slice(key_ptr, key_length));
+  }
+
+  std::atomic<EntryList*>* Bucket(const Slice& user_key) const {
+    Slice prefix = prefix_extractor_->InDomain(user_key)
+                       ? prefix_extractor_->Transform(user_key)
+                       : user_key;
+    return &buckets_[Hash(prefix.data(), prefix.size(), 0) % bucket_count_];
+  }
+
+  const KeyComparator* const cmp_;
+  Arena* const arena_;
+  const SliceTransform* const prefix_extractor_;
+  const size_t bucket_count_;
+  std::atomic<EntryList*>* const buckets_;
+};
+
+class HashSkipListRepFactory : public MemTableRepFactory {
+ public:
+  HashSkipListRepFactory(const SliceTransform* prefix_extractor,
+                         size_t bucket_count)
+      : prefix_extractor_(prefix_extractor), bucket_count_(bucket_count) {
+    assert(bucket_count_ > 0);
+  }
+
+  const char* Name() const override {
+    return "leveldb.HashSkipListRepFactory";
+  }
+  MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& cmp,
+                                 Arena* arena) override {
+    return new HashSkipListRep(cmp, arena, prefix_extractor_, bucket_count_);
+  }
+
+ private:
+  const SliceTransform* const prefix_extractor_;
+  const size_t bucket_count_;
+};
+
+// Entries are appended to an unsorted vector and sorted once, when the
+// memtable becomes read-only.  Until then every iterator sorts a copy.
+class VectorRep : public MemTableRep {
+ public:
+  explicit VectorRep(const KeyComparator& cmp) : cmp_(&cmp), sorted_(false) {}
+
+  void Insert(const char* entry) override {
+    MutexLock l(&mu_);
+    assert(!sorted_);
+    entries_.push_back(entry);
+  }
+
+  void MarkReadOnly() override {
+    MutexLock l(&mu_);
+    if (!sorted_) {
+      SortEntries(cmp_, &entries_);
+      sorted_ = true;
+    }
+  }
+
+  size_t ApproximateMemoryUsage() override {
+    MutexLock l(&mu_);
+    return entries_.capacity() * sizeof(const char*);
+  }
+
+  Iterator* GetIterator() override {
+    std::vector<const char*>* entries;
+    {
+      MutexLock l(&mu_);
+      if (sorted_) {
+        // entries_ never changes again.
+        return new SortedVectorIterator(cmp_, &entries_, false);
+      }
+      entries = new std::vector<const char*>(entries_);
+    }
+    SortEntries(cmp_, entries);
+    return new SortedVectorIterator(cmp_, entries, true);
+  }
+
+  // A point lookup only seeks once, which a linear scan of the unsorted
+  // vector answers far cheaper than sorting a copy of it.
+  Iterator* GetPointLookupIterator(const Slice& user_key) override {
+    {
+      MutexLock l(&mu_);
+      if (sorted_) {
+        return new SortedVectorIterator(cmp_, &entries_, false);
+      }
+    }
+    return new ScanIterator(this);
+  }
+
+ private:
+  enum Direction { kAtOrAfter, kAfter, kBefore };
+
+  // Answers every positioning call with a scan of the whole vector.
+  class ScanIterator : public Iterator {
+   public:
+    explicit ScanIterator(VectorRep* rep) : rep_(rep), current_(nullptr) {}
+
+    bool Valid() const override { return current_ != nullptr; }
+    const char* key() const override {
+      assert(Valid());
+      return current_;
+    }
+    void Next() override {
+      assert(Valid());
+      current_ = rep_->Find(current_, kAfter);
+    }
+    void Prev() override {
+      assert(Valid());
+      current_ = rep_->Find(current_, kBefore);
+    }
+    void Seek(const char* target) override {
+      current_ = rep_->Find(target, kAtOrAfter);
+    }
+    void SeekToFirst() override { current_ = rep_->Find(nullptr, kAfter); }
+    void SeekToLast() override { current_ = rep_->Find(nullptr, kBefore); }
+
+   private:
+    VectorRep* const rep_;
+    const char* current_;
+  };
+
+  // Return the smallest entry >= "bound" (kAtOrAfter) or > "bound" (kAfter),
+  // or the largest entry < "bound" (kBefore).  A null "bound" is unbounded.
+  // Returns nullptr if there is no such entry.
+  const char* Find(const char* bound, Direction direction) {
+    MutexLock l(&mu_);
+    const char* best = nullptr;
+    for (const char* entry : entries_) {
+      if (bound != nullptr) {
+        const int r = (*cmp_)(entry, bound);
+        if ((direction == kAtOrAfter && r < 0) ||
+            (direction == kAfter && r <= 0) ||
+            (direction == kBefore && r >= 0)) {
+          continue;
+        }
+      }
+      if (best == nullptr) {
+        best = entry;
+      } else {
+        const int r = (*cmp_)(entry, best);
+        if (direction == kBefore ? r > 0 : r < 0) {
+          best = entry;
+        }
+      }
+    }
+    return best;
+  }
+
+  const KeyComparator* const cmp_;
+
+  port::Mutex mu_;
+  std::vector<const char*> entries_ GUARDED_BY(mu_);
+  bool sorted_ GUARDED_BY(mu_);
+};
+
+class VectorRepFactory : public MemTableRepFactory {
+ public:
+  const char* Name() const override { return "leveldb.VectorRepFactory"; }
+  MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& cmp,
+                                 Arena* arena) override {
+    return new VectorRep(cmp);
+  }
+};
+
+}  // namespace
+
+MemTableRepFactory* NewSkipListRepFactory() { return new SkipListRepFactory; }
+
+MemTableRepFactory* NewHashSkipListRepFactory(
+    const SliceTransform* prefix_extractor, size_t bucket_count) {
+  return new HashSkipListRepFactory(prefix_extractor, bucket_count);
+}
+
+MemTableRepFactory* NewVectorRepFactory() { return new VectorRepFactory; }
+
+}  // namespace leveldb
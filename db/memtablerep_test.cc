@@ -0,0 +1,207 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/memtablerep.h"
+
+#include <map>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "leveldb/slice_transform.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+enum RepType { kSkipList, kHashSkipList, kVector };
+
+const RepType kRepTypes[] = {kSkipList, kHashSkipList, kVector};
+
+// Orders encoded internal keys for the model.
+struct InternalKeyLess {
+  bool operator()(const std::string& a, const std::string& b) const {
+    return icmp->Compare(a, b) < 0;
+  }
+  const InternalKeyComparator* icmp;
+};
+
+class MemTableRepTest : public testing::Test {
+ public:
+  MemTableRepTest()
+      : icmp_(BytewiseComparator()),
+        prefix_extractor_(NewFixedPrefixTransform(2)),
+        factory_(nullptr),
+        mem_(nullptr),
+        model_(InternalKeyLess{&icmp_}) {}
+
+  ~MemTableRepTest() {
+    Close();
+    delete prefix_extractor_;
+  }
+
+  void Close() {
+    if (mem_ != nullptr) {
+      mem_->Unref();
+      mem_ = nullptr;
+    }
+    delete factory_;
+    factory_ = nullptr;
+    model_.clear();
+    last_sequence_ = 0;
+  }
+
+  // Starts over with an empty memtable of the given representation.
+  void Open(RepType type) {
+    Close();
+    switch (type) {
+      case kSkipList:
+        factory_ = NewSkipListRepFactory();
+        break;
+      case kHashSkipList:
+        // Few buckets, so that different prefixes share some.
+        factory_ = NewHashSkipListRepFactory(prefix_extractor_, 7);
+        break;
+      case kVector:
+        factory_ = NewVectorRepFactory();
+        break;
+    }
+    mem_ = new MemTable(icmp_, factory_);
+    mem_->Ref();
+  }
+
+  // Adds "n" random entries to mem_ and to model_, which maps each
+  // internal key to its value ("" for deletions).
+  void AddRandomEntries(Random* rnd, int n) {
+    for (int i = 0; i < n; i++) {
+      std::string user_key;
+      // Include keys shorter than the prefix.
+      test::RandomString(rnd, 1 + rnd->Uniform(4), &user_key);
+      ValueType type = rnd->OneIn(4) ? kTypeDeletion : kTypeValue;
+      std::string value;
+      if (type == kTypeValue) {
+        test::RandomString(rnd, rnd->Uniform(10), &value);
+      }
+      SequenceNumber seq = ++last_sequence_;
+      mem_->Add(seq, type, user_key, value);
+      InternalKey ikey(user_key, seq, type);
+      model_[ikey.Encode().ToString()] = value;
+    }
+  }
+
+  void CheckIteration() {
+    Iterator* iter = mem_->NewIterator();
+    auto it = model_.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+      ASSERT_TRUE(it != model_.end());
+      ASSERT_EQ(it->first, iter->key().ToString());
+      ASSERT_EQ(it->second, iter->value().ToString());
+    }
+    ASSERT_TRUE(it == model_.end());
+
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      --it;
+      ASSERT_EQ(it->first, iter->key().ToString());
+    }
+    ASSERT_TRUE(it == model_.begin());
+
+    for (const auto& kv : model_) {
+      iter->Seek(kv.first);
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(kv.first, iter->key().ToString());
+    }
+    delete iter;
+  }
+
+  // Looks up "user_key" as of every sequence number and checks the result
+  // against the newest model entry at or below that sequence number.
+  void CheckGet(const std::string& user_key) {
+    for (SequenceNumber seq = 1; seq <= last_sequence_; seq++) {
+      std::string expected_value;
+      bool expected_found = false;
+      bool expected_deleted = false;
+      auto it = model_.lower_bound(
+          InternalKey(user_key, seq, kValueTypeForSeek).Encode().ToString());
+      if (it != model_.end()) {
+        ParsedInternalKey parsed;
+        ASSERT_TRUE(ParseInternalKey(it->first, &parsed));
+        if (parsed.user_key == user_key) {
+          expected_found = true;
+          expected_deleted = (parsed.type == kTypeDeletion);
+          expected_value = it->second;
+        }
+      }
+
+      std::string value;
+      Status s;
+      ASSERT_EQ(expected_found,
+                mem_->Get(LookupKey(user_key, seq), &value, &s));
+      if (expected_found) {
+        ASSERT_EQ(expected_deleted, s.IsNotFound());
+        if (!expected_deleted) {
+          ASSERT_EQ(expected_value, value);
+        }
+      }
+    }
+  }
+
+  const InternalKeyComparator icmp_;
+  const SliceTransform* const prefix_extractor_;
+  MemTableRepFactory* factory_;
+  MemTable* mem_;
+  SequenceNumber last_sequence_ = 0;
+  std::map<std::string, std::string, InternalKeyLess> model_;
+};
+
+TEST_F(MemTableRepTest, Empty) {
+  for (RepType type : kRepTypes) {
+    Open(type);
+    Iterator* iter = mem_->NewIterator();
+    iter->SeekToFirst();
+    ASSERT_TRUE(!iter->Valid());
+    iter->SeekToLast();
+    ASSERT_TRUE(!iter->Valid());
+    delete iter;
+
+    std::string value;
+    Status s;
+    ASSERT_TRUE(!mem_->Get(LookupKey("foo", 100), &value, &s));
+  }
+}
+
+TEST_F(MemTableRepTest, Random) {
+  Random rnd(test::RandomSeed());
+  for (RepType type : kRepTypes) {
+    Open(type);
+    AddRandomEntries(&rnd, 300);
+    CheckIteration();
+    for (const char* key : {"a", "ab", "abc", "zzzz"}) {
+      CheckGet(key);
+    }
+
+    // Reads must keep working once the memtable is immutable.
+    AddRandomEntries(&rnd, 300);
+    mem_->MarkReadOnly();
+    CheckIteration();
+    for (int i = 0; i < 20; i++) {
+      std::string user_key;
+      test::RandomString(&rnd, 1 + rnd.Uniform(4), &user_key);
+      CheckGet(user_key);
+    }
+  }
+}
+
+TEST(SliceTransformTest, FixedPrefix) {
+  const SliceTransform* transform = NewFixedPrefixTransform(3);
+  ASSERT_TRUE(!transform->InDomain("ab"));
+  ASSERT_TRUE(transform->InDomain("abc"));
+  ASSERT_EQ("abc", transform->Transform("abc").ToString());
+  ASSERT_EQ("abc", transform->Transform("abcdef").ToString());
+  delete transform;
+}
+
+}  // namespace leveldb
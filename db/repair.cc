@@ -49,7 +49,9 @@ class Repairer {
         env_(options.env),
         icmp_(options.comparator),
         ipolicy_(options.filter_policy),
-        options_(SanitizeOptions(dbname, &icmp_, &ipolicy_, options)),
+        iprefix_(options.prefix_extractor),
+        options_(SanitizeOptions(dbname, &icmp_, &ipolicy_, &iprefix_,
+                                 options)),
         owns_info_log_(options_.info_log != options.info_log),
         owns_cache_(options_.block_cache != options.block_cache),
         next_file_number_(1) {
@@ -177,7 +179,7 @@ class Repairer {
     std::string scratch;
     Slice record;
     WriteBatch batch;
-    MemTable* mem = new MemTable(icmp_);
+    MemTable* mem = new MemTable(icmp_, options_.memtable_factory);
     mem->Ref();
     int counter = 0;
     while (reader.ReadRecord(&record, &scratch)) {
@@ -302,7 +304,8 @@ class Repairer {
     if (!s.ok()) {
       return;
     }
-    TableBuilder* builder = new TableBuilder(options_, file);
+    TableBuilder* builder =
+        new TableBuilder(TableOptionsForLevel(options_, 0), file);
 
     // Copy data.
     Iterator* iter = NewTableIterator(t.meta);
@@ -429,6 +432,7 @@ class Repairer {
   Env* const env_;
   InternalKeyComparator const icmp_;
   InternalFilterPolicy const ipolicy_;
+  InternalKeySliceTransform const iprefix_;
   const Options options_;
   bool owns_info_log_;
   bool owns_cache_;
@@ -8,7 +8,9 @@
 // Thread safety
 // -------------
 //
-// Writes require external synchronization, most likely a mutex.
+// Writes require external synchronization, most likely a mutex.  The one
+// exception is InsertConcurrently(), which may be called from several
+// threads at once as long as no Insert() runs at the same time.
 // Reads require a guarantee that the SkipList will not be destroyed
 // while the read is in progress.  Apart from that, reads progress
 // without any internal locking or synchronization.
@@ -30,6 +32,8 @@
 #include <atomic>
 #include <cassert>
 #include <cstdlib>
+#include <functional>
+#include <thread>
 
 #include "util/arena.h"
 #include "util/random.h"
@@ -54,6 +58,13 @@ class SkipList {
   // REQUIRES: nothing that compares equal to key is currently in the list.
   void Insert(const Key& key);
 
+  // Same as Insert(), but safe to call from several threads at once.
+  // Links are published with compare-and-swap, so inserters never block
+  // each other.  Nodes are allocated with Arena::AllocateAlignedConcurrently().
+  // REQUIRES: nothing that compares equal to key is currently in the list,
+  // or being inserted.
+  void InsertConcurrently(const Key& key);
+
   // Returns true iff an entry that compares equal to key is in the list.
   bool Contains(const Key& key) const;
 
@@ -103,8 +114,8 @@ class SkipList {
     return max_height_.load(std::memory_order_relaxed);
   }
 
-  Node* NewNode(const Key& key, int height);
-  int RandomHeight();
+  Node* NewNode(const Key& key, int height, bool concurrently = false);
+  int RandomHeight(Random* rnd);
   bool Equal(const Key& a, const Key& b) const { return (compare_(a, b) == 0); }
 
   // Return true if key is greater than the data stored in "n"
@@ -117,6 +128,11 @@ class SkipList {
   // node at "level" for every level in [0..max_height_-1].
   Node* FindGreaterOrEqual(const Key& key, Node** prev) const;
 
+  // Starting at "before", which must sort before key, find the adjacent
+  // nodes at "level" between which key belongs.
+  void FindSpliceForLevel(const Key& key, Node* before, int level,
+                          Node** out_prev, Node** out_next) const;
+
   // Return the latest node with a key < key.
   // Return head_ if there is no such node.
   Node* FindLessThan(const Key& key) const;
@@ -131,11 +147,12 @@ class SkipList {
 
   Node* const head_;
 
-  // Modified only by Insert().  Read racily by readers, but stale
-  // values are ok.
+  // Modified only by Insert() and InsertConcurrently().  Read racily by
+  // readers, but stale values are ok.
   std::atomic<int> max_height_;  // Height of the entire list
 
-  // Read/written only by Insert().
+  // Read/written only by Insert().  InsertConcurrently() uses a
+  // per-thread generator instead.
   Random rnd_;
 };
 
@@ -171,6 +188,13 @@ struct SkipList<Key, Comparator>::Node {
     next_[n].store(x, std::memory_order_relaxed);
   }
 
+  // Set the link to x only if it still equals "expected".  Like SetNext(),
+  // this publishes a fully initialized x.
+  bool CASNext(int n, Node* expected, Node* x) {
+    assert(n >= 0);
+    return next_[n].compare_exchange_strong(expected, x);
+  }
+
  private:
   // Array of length equal to the node height.  next_[0] is lowest level link.
   std::atomic<Node*> next_[1];
@@ -178,9 +202,11 @@ struct SkipList<Key, Comparator>::Node {
 
 template <typename Key, class Comparator>
 typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::NewNode(
-    const Key& key, int height) {
-  char* const node_memory = arena_->AllocateAligned(
-      sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1));
+    const Key& key, int height, bool concurrently) {
+  const size_t bytes = sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1);
+  char* const node_memory = concurrently
+                                ? arena_->AllocateAlignedConcurrently(bytes)
+                                : arena_->AllocateAligned(bytes);
   return new (node_memory) Node(key);
 }
 
@@ -237,11 +263,11 @@ inline void SkipList<Key, Comparator>::Iterator::SeekToLast() {
 }
 
 template <typename Key, class Comparator>
-int SkipList<Key, Comparator>::RandomHeight() {
+int SkipList<Key, Comparator>::RandomHeight(Random* rnd) {
   // Increase height with probability 1 in kBranching
   static const unsigned int kBranching = 4;
   int height = 1;
-  while (height < kMaxHeight && rnd_.OneIn(kBranching)) {
+  while (height < kMaxHeight && rnd->OneIn(kBranching)) {
     height++;
   }
   assert(height > 0);
@@ -278,6 +304,22 @@ SkipList<Key, Comparator>::FindGreaterOrEqual(const Key& key,
   }
 }
 
+template <typename Key, class Comparator>
+void SkipList<Key, Comparator>::FindSpliceForLevel(const Key& key, Node* before,
+                                                   int level, Node** out_prev,
+                                                   Node** out_next) const {
+  while (true) {
+    Node* next = before->Next(level);
+    if (KeyIsAfterNode(key, next)) {
+      before = next;
+    } else {
+      *out_prev = before;
+      *out_next = next;
+      return;
+    }
+  }
+}
+
 template <typename Key, class Comparator>
 typename SkipList<Key, Comparator>::Node*
 SkipList<Key, Comparator>::FindLessThan(const Key& key) const {
@@ -341,7 +383,7 @@ void SkipList<Key, Comparator>::Insert(const Key& key) {
   // Our data structure does not allow duplicate insertion
   assert(x == nullptr || !Equal(key, x->key));
 
-  int height = RandomHeight();
+  int height = RandomHeight(&rnd_);
   if (height > GetMaxHeight()) {
     for (int i = GetMaxHeight(); i < height; i++) {
       prev[i] = head_;
@@ -365,6 +407,50 @@ void SkipList<Key, Comparator>::Insert(const Key& key) {
   }
 }
 
+template <typename Key, class Comparator>
+void SkipList<Key, Comparator>::InsertConcurrently(const Key& key) {
+  static thread_local Random rnd(static_cast<uint32_t>(
+      std::hash<std::thread::id>()(std::this_thread::get_id())));
+  const int height = RandomHeight(&rnd);
+
+  // Raise max_height_ first, so that readers and other inserters start
+  // their searches high enough to see the new node's upper links.
+  int max_height = GetMaxHeight();
+  while (height > max_height) {
+    if (max_height_.compare_exchange_weak(max_height, height,
+                                          std::memory_order_relaxed)) {
+      max_height = height;
+      break;
+    }
+  }
+
+  // prev[max_height] is a sentinel for the top-down search.
+  Node* prev[kMaxHeight + 1];
+  Node* next[kMaxHeight + 1];
+  prev[max_height] = head_;
+  for (int i = max_height - 1; i >= 0; i--) {
+    FindSpliceForLevel(key, prev[i + 1], i, &prev[i], &next[i]);
+  }
+
+  // Our data structure does not allow duplicate insertion
+  assert(next[0] == nullptr || !Equal(key, next[0]->key));
+
+  // Link bottom-up, so that the node is in the level 0 list (which
+  // defines membership) before it can be reached from above.
+  Node* x = NewNode(key, height, true);
+  for (int i = 0; i < height; i++) {
+    while (true) {
+      x->NoBarrier_SetNext(i, next[i]);
+      if (prev[i]->CASNext(i, next[i], x)) {
+        break;
+      }
+      // Another node was linked after prev[i] in the meantime.  prev[i]
+      // still sorts before key, so search on from there.
+      FindSpliceForLevel(key, prev[i], i, &prev[i], &next[i]);
+    }
+  }
+}
+
 template <typename Key, class Comparator>
 bool SkipList<Key, Comparator>::Contains(const Key& key) const {
   Node* x = FindGreaterOrEqual(key, nullptr);
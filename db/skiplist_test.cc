@@ -6,6 +6,8 @@
 
 #include <atomic>
 #include <set>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "leveldb/env.h"
@@ -359,6 +361,48 @@ static void RunConcurrent(int run) {
   }
 }
 
+TEST(SkipTest, InsertConcurrently) {
+  const int kNumThreads = 4;
+  const int kKeysPerThread = 20000;
+  Arena arena;
+  Comparator cmp;
+  SkipList<Key, Comparator> list(cmp, &arena);
+
+  // Each thread inserts a disjoint, randomly ordered set of keys.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&list, t]() {
+      Random rnd(1000 + t);
+      std::vector<Key> keys;
+      for (int i = 0; i < kKeysPerThread; i++) {
+        keys.push_back(static_cast<Key>(i) * kNumThreads + t);
+      }
+      for (int i = kKeysPerThread - 1; i > 0; i--) {
+        std::swap(keys[i], keys[rnd.Uniform(i + 1)]);
+      }
+      for (Key key : keys) {
+        list.InsertConcurrently(key);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  SkipList<Key, Comparator>::Iterator iter(&list);
+  iter.SeekToFirst();
+  for (Key expected = 0; expected < kNumThreads * kKeysPerThread; expected++) {
+    ASSERT_TRUE(iter.Valid());
+    ASSERT_EQ(expected, iter.key());
+    iter.Next();
+  }
+  ASSERT_TRUE(!iter.Valid());
+
+  for (Key key = 0; key < kNumThreads * kKeysPerThread; key += 97) {
+    ASSERT_TRUE(list.Contains(key));
+  }
+}
+
 TEST(SkipTest, Concurrent1) { RunConcurrent(1); }
 TEST(SkipTest, Concurrent2) { RunConcurrent(2); }
 TEST(SkipTest, Concurrent3) { RunConcurrent(3); }
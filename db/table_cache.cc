@@ -26,6 +26,45 @@ static void DeleteEntry(const Slice& key, void* value) {
   delete tf;
 }
 
+// A row cache entry holds the newest entry of a user key in a table file:
+// its length prefixed internal key followed by its value.
+static void DeleteRow(const Slice& key, void* value) {
+  delete reinterpret_cast<std::string*>(value);
+}
+
+static void DeleteUncachedRow(void* arg1, void* arg2) {
+  delete reinterpret_cast<std::string*>(arg1);
+}
+
+namespace {
+// Collects the entry found by a seek for the newest entry of "user_key".
+struct RowSaver {
+  const Comparator* ucmp;
+  Slice user_key;
+  bool found_entry;  // Whether the seek found any entry
+  bool found_row;    // Whether that entry is for "user_key"
+  std::string* row;
+};
+}  // namespace
+
+static void SaveRow(void* arg, const Slice& k, const Slice& v) {
+  RowSaver* saver = reinterpret_cast<RowSaver*>(arg);
+  saver->found_entry = true;
+  saver->found_row = k.size() >= 8 &&
+                     saver->ucmp->Compare(ExtractUserKey(k),
+                                          saver->user_key) == 0;
+  saver->row->clear();
+  PutLengthPrefixedSlice(saver->row, k);
+  saver->row->append(v.data(), v.size());
+}
+
+// The newest entry of a user key in a file is the one a seek for the key
+// as of "sequence" finds, unless it was written after "sequence".
+static bool IsVisible(const Slice& newest_key, SequenceNumber sequence) {
+  return (DecodeFixed64(newest_key.data() + newest_key.size() - 8) >> 8) <=
+         sequence;
+}
+
 static void UnrefEntry(void* arg1, void* arg2) {
   Cache* cache = reinterpret_cast<Cache*>(arg1);
   Cache::Handle* h = reinterpret_cast<Cache::Handle*>(arg2);
@@ -37,12 +76,13 @@ TableCache::TableCache(const std::string& dbname, const Options& options,
     : env_(options.env),
       dbname_(dbname),
       options_(options),
-      cache_(NewLRUCache(entries)) {}
+      cache_(NewLRUCache(entries)),
+      row_cache_id_(options.row_cache ? options.row_cache->NewId() : 0) {}
 
 TableCache::~TableCache() { delete cache_; }
 
 Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
-                             Cache::Handle** handle) {
+                             int level, Cache::Handle** handle) {
   Status s;
   //缓存的 key 就是文件的 file_number
   char buf[sizeof(file_number)];
@@ -64,7 +104,11 @@ Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
       }
     }
     if (s.ok()) {
-      s = Table::Open(options_, file, file_size, &table);
+      // A file keeps its level 0 pinning for as long as it stays in the
+      // cache, even if it is moved to a higher level meanwhile.
+      const bool pin =
+          level == 0 && options_.pin_l0_filter_and_index_blocks_in_cache;
+      s = Table::Open(options_, file, file_size, pin, &table);
     }
 
     if (!s.ok()) {
@@ -86,13 +130,13 @@ Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
 
 Iterator* TableCache::NewIterator(const ReadOptions& options,
                                   uint64_t file_number, uint64_t file_size,
-                                  Table** tableptr) {
+                                  Table** tableptr, int level) {
   if (tableptr != nullptr) {
     *tableptr = nullptr;
   }
 
   Cache::Handle* handle = nullptr;
-  Status s = FindTable(file_number, file_size, &handle);
+  Status s = FindTable(file_number, file_size, level, &handle);
   if (!s.ok()) {
     return NewErrorIterator(s);
   }
@@ -107,14 +151,141 @@ Iterator* TableCache::NewIterator(const ReadOptions& options,
 }
 
 Status TableCache::Get(const ReadOptions& options, uint64_t file_number,
-                       uint64_t file_size, const Slice& k, void* arg,
+                       uint64_t file_size, int level, const Slice& k, void* arg,
                        void (*handle_result)(void*, const Slice&,
-                                             const Slice&)) {
+                                             const Slice&),
+                       Iterator** pin) {
+  if (pin != nullptr) {
+    *pin = nullptr;
+  }
+  Cache* row_cache = options_.row_cache;
+  ParsedInternalKey target;
+  if (row_cache == nullptr || !ParseInternalKey(k, &target)) {
+    return GetFromTable(options, file_number, file_size, level, k, arg,
+                        handle_result, pin);
+  }
+
+  // 行缓存的 key = row_cache_id_ + file_number + user_key
+  std::string row_key;
+  PutFixed64(&row_key, row_cache_id_);
+  PutFixed64(&row_key, file_number);
+  row_key.append(target.user_key.data(), target.user_key.size());
+  Cache::Handle* row_handle = row_cache->Lookup(row_key);
+  if (row_handle != nullptr) {
+    Slice row(*reinterpret_cast<std::string*>(row_cache->Value(row_handle)));
+    Slice found_key;
+    GetLengthPrefixedSlice(&row, &found_key);
+    if (IsVisible(found_key, target.sequence)) {
+      (*handle_result)(arg, found_key, row);
+      if (pin != nullptr) {
+        *pin = NewEmptyIterator();
+        (*pin)->RegisterCleanup(&UnrefEntry, row_cache, row_handle);
+      } else {
+        row_cache->Release(row_handle);
+      }
+      return Status::OK();
+    }
+    row_cache->Release(row_handle);
+    return GetFromTable(options, file_number, file_size, level, k, arg,
+                        handle_result, pin);
+  }
+
+  // Look up the newest entry of the user key, which is cached.
+  std::string newest_key;
+  AppendInternalKey(&newest_key, ParsedInternalKey(target.user_key,
+                                                   kMaxSequenceNumber,
+                                                   kValueTypeForSeek));
+  std::string* row = new std::string;
+  RowSaver saver;
+  saver.ucmp =
+      reinterpret_cast<const InternalKeyComparator*>(options_.comparator)
+          ->user_comparator();
+  saver.user_key = target.user_key;
+  saver.found_entry = false;
+  saver.found_row = false;
+  saver.row = row;
+  Status s = GetFromTable(options, file_number, file_size, level, newest_key,
+                          &saver, SaveRow, nullptr);
+  if (!s.ok() || !saver.found_entry) {
+    delete row;
+    return s;
+  }
+  Slice entry(*row);
+  Slice found_key;
+  GetLengthPrefixedSlice(&entry, &found_key);
+  // If the file has no entry for the user key, a seek to "k" finds the
+  // same entry.
+  const bool visible =
+      !saver.found_row || IsVisible(found_key, target.sequence);
+  row_handle = nullptr;
+  if (saver.found_row && options.fill_cache) {
+    row_handle = row_cache->Insert(row_key, row, row->size(), &DeleteRow);
+  }
+  if (visible) {
+    (*handle_result)(arg, found_key, entry);
+  }
+  if (visible && pin != nullptr) {
+    *pin = NewEmptyIterator();
+    if (row_handle != nullptr) {
+      (*pin)->RegisterCleanup(&UnrefEntry, row_cache, row_handle);
+    } else {
+      (*pin)->RegisterCleanup(&DeleteUncachedRow, row, nullptr);
+    }
+  } else if (row_handle != nullptr) {
+    row_cache->Release(row_handle);
+  } else {
+    delete row;
+  }
+  if (visible) {
+    return s;
+  }
+  return GetFromTable(options, file_number, file_size, level, k, arg,
+                      handle_result, pin);
+}
+
+Status TableCache::GetFromTable(const ReadOptions& options,
+                                uint64_t file_number, uint64_t file_size,
+                                int level, const Slice& k, void* arg,
+                                void (*handle_result)(void*, const Slice&,
+                                                      const Slice&),
+                                Iterator** pin) {
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(file_number, file_size, level, &handle);
+  if (s.ok()) {
+    Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+    s = t->InternalGet(options, k, arg, handle_result, pin);
+    if (pin != nullptr && *pin != nullptr) {
+      // The block may be read through the table's file.
+      (*pin)->RegisterCleanup(&UnrefEntry, cache_, handle);
+    } else {
+      cache_->Release(handle);
+    }
+  }
+  return s;
+}
+
+bool TableCache::PrefixMayMatch(uint64_t file_number, uint64_t file_size,
+                                const Slice& target) {
+  Cache::Handle* handle = nullptr;
+  if (!FindTable(file_number, file_size, -1, &handle).ok()) {
+    return true;
+  }
+  Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+  bool result = t->PrefixMayMatch(target);
+  cache_->Release(handle);
+  return result;
+}
+
+Status TableCache::MultiGet(const ReadOptions& options, uint64_t file_number,
+                            uint64_t file_size, int level, const Slice* keys,
+                            void* const* args, int n,
+                            void (*handle_result)(void*, const Slice&,
+                                                  const Slice&)) {
   Cache::Handle* handle = nullptr;
-  Status s = FindTable(file_number, file_size, &handle);
+  Status s = FindTable(file_number, file_size, level, &handle);
   if (s.ok()) {
     Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
-    s = t->InternalGet(options, k, arg, handle_result);
+    s = t->InternalMultiGet(options, keys, args, n, handle_result);
     cache_->Release(handle);
   }
   return s;
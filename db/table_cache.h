@@ -35,25 +35,61 @@ class TableCache {
   // underlies the returned iterator.  The returned "*tableptr" object is owned
   // by the cache and should not be deleted, and is valid for as long as the
   // returned iterator is live.
+  //
+  // "level" is the level of the file, or -1 if unknown.  The index and
+  // filter of level-0 files are pinned in the block cache if
+  // Options::pin_l0_filter_and_index_blocks_in_cache is set.  The same
+  // goes for the methods below.
   Iterator* NewIterator(const ReadOptions& options, uint64_t file_number,
-                        uint64_t file_size, Table** tableptr = nullptr);
+                        uint64_t file_size, Table** tableptr = nullptr,
+                        int level = -1);
 
   // If a seek to internal key "k" in specified file finds an entry,
-  // call (*handle_result)(arg, found_key, found_value).
+  // call (*handle_result)(arg, found_key, found_value).  Looks up the
+  // entry in Options::row_cache first.
+  //
+  // If "pin" is non-null, sets "*pin" to an iterator that keeps found_key
+  // and found_value valid until the caller deletes it, or to nullptr if no
+  // entry was found.
   Status Get(const ReadOptions& options, uint64_t file_number,
-             uint64_t file_size, const Slice& k, void* arg,
-             void (*handle_result)(void*, const Slice&, const Slice&));
+             uint64_t file_size, int level, const Slice& k, void* arg,
+             void (*handle_result)(void*, const Slice&, const Slice&),
+             Iterator** pin = nullptr);
+
+  // Same as calling Get(options, file_number, file_size, keys[i], args[i],
+  // handle_result) for every i in [0, n), but the table is looked up
+  // once and each data block is read at most once.
+  // REQUIRES: keys are sorted.
+  Status MultiGet(const ReadOptions& options, uint64_t file_number,
+                  uint64_t file_size, int level, const Slice* keys,
+                  void* const* args, int n,
+                  void (*handle_result)(void*, const Slice&, const Slice&));
+
+  // Returns false if the specified file holds no key with the prefix of
+  // internal key "target", according to its full filter.  Errors are
+  // treated as potential matches.
+  bool PrefixMayMatch(uint64_t file_number, uint64_t file_size,
+                      const Slice& target);
 
   // Evict any entry for the specified file number
   void Evict(uint64_t file_number);
 
  private:
-  Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**);
+  Status FindTable(uint64_t file_number, uint64_t file_size, int level,
+                   Cache::Handle**);
+
+  // Same as Get(), without the row cache.
+  Status GetFromTable(const ReadOptions& options, uint64_t file_number,
+                      uint64_t file_size, int level, const Slice& k, void* arg,
+                      void (*handle_result)(void*, const Slice&,
+                                            const Slice&),
+                      Iterator** pin);
 
   Env* const env_;
   const std::string dbname_;
   const Options& options_;
   Cache* cache_;
+  const uint64_t row_cache_id_;  // Id of this DB's entries in row_cache
 };
 
 }  // namespace leveldb
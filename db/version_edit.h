@@ -26,7 +26,8 @@ class VersionSet;
  * 只要判断这个key是否在这个[smallest, largest]区间，就可以很快判定。
  */
 struct FileMetaData {
-  FileMetaData() : refs(0), allowed_seeks(1 << 30), file_size(0) {}
+  FileMetaData()
+      : refs(0), allowed_seeks(1 << 30), file_size(0), being_compacted(false) {}
 
   int refs;
   int allowed_seeks;  // Seeks allowed until compaction
@@ -34,6 +35,7 @@ struct FileMetaData {
   uint64_t file_size;    // File size in bytes
   InternalKey smallest;  // Smallest internal key served by table
   InternalKey largest;   // Largest internal key served by table
+  bool being_compacted;  // Input of a running compaction (not persisted)
 };
 
 /**
@@ -13,6 +13,7 @@
 #include "db/memtable.h"
 #include "db/table_cache.h"
 #include "leveldb/env.h"
+#include "leveldb/pinnable_slice.h"
 #include "leveldb/table_builder.h"
 #include "table/merger.h"
 #include "table/two_level_iterator.h"
@@ -219,11 +220,27 @@ static Iterator* GetFileIterator(void* arg, const ReadOptions& options,
   }
 }
 
+static bool FileMayMatchPrefix(void* arg, const Slice& target,
+                               const Slice& largest_key,
+                               const Slice& file_value) {
+  TableCache* cache = reinterpret_cast<TableCache*>(arg);
+  if (file_value.size() != 16) {
+    return true;  // Let GetFileIterator() report the corruption
+  }
+  return cache->PrefixMayMatch(DecodeFixed64(file_value.data()),
+                               DecodeFixed64(file_value.data() + 8), target);
+}
+
 Iterator* Version::NewConcatenatingIterator(const ReadOptions& options,
                                             int level) const {
+  // With prefix seeks, a file whose filter rules out the prefix is skipped
+  // without opening an iterator on it, and ends the seek if it lies past
+  // the files that hold the prefix.
   return NewTwoLevelIterator(
       new LevelFileNumIterator(vset_->icmp_, &files_[level]), &GetFileIterator,
-      vset_->table_cache_, options);
+      vset_->table_cache_, options,
+      vset_->options_->prefix_extractor != nullptr ? &FileMayMatchPrefix
+                                                   : nullptr);
 }
 
 void Version::AddIterators(const ReadOptions& options,
@@ -231,7 +248,7 @@ void Version::AddIterators(const ReadOptions& options,
   // Merge all level zero files together since they may overlap
   for (size_t i = 0; i < files_[0].size(); i++) {
     iters->push_back(vset_->table_cache_->NewIterator(
-        options, files_[0][i]->number, files_[0][i]->file_size));
+        options, files_[0][i]->number, files_[0][i]->file_size, nullptr, 0));
   }
 
   // For levels > 0, we can use a concatenating iterator that sequentially
@@ -256,7 +273,8 @@ struct Saver {
   SaverState state;
   const Comparator* ucmp;
   Slice user_key;
-  std::string* value;
+  std::string* value;  // If null, found_value refers to the value
+  Slice found_value;
 };
 }  // namespace
 static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
@@ -268,7 +286,11 @@ static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
     if (s->ucmp->Compare(parsed_key.user_key, s->user_key) == 0) {
       s->state = (parsed_key.type == kTypeValue) ? kFound : kDeleted;
       if (s->state == kFound) {
-        s->value->assign(v.data(), v.size());
+        if (s->value != nullptr) {
+          s->value->assign(v.data(), v.size());
+        } else {
+          s->found_value = v;
+        }
       }
     }
   }
@@ -321,13 +343,29 @@ void Version::ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
   }
 }
 
+static void DeletePin(void* arg1, void* arg2) {
+  delete reinterpret_cast<Iterator*>(arg1);
+}
+
 Status Version::Get(const ReadOptions& options, const LookupKey& k,
                     std::string* value, GetStats* stats) {
+  return GetImpl(options, k, value, nullptr, stats);
+}
+
+Status Version::Get(const ReadOptions& options, const LookupKey& k,
+                    PinnableSlice* value, GetStats* stats) {
+  return GetImpl(options, k, nullptr, value, stats);
+}
+
+Status Version::GetImpl(const ReadOptions& options, const LookupKey& k,
+                        std::string* value, PinnableSlice* pinnable,
+                        GetStats* stats) {
   stats->seek_file = nullptr;
   stats->seek_file_level = -1;
 
   struct State {
     Saver saver;
+    PinnableSlice* pinnable;
     GetStats* stats;
     const ReadOptions* options;
     Slice ikey;
@@ -351,9 +389,18 @@ Status Version::Get(const ReadOptions& options, const LookupKey& k,
       state->last_file_read = f;
       state->last_file_read_level = level;
 
-      state->s = state->vset->table_cache_->Get(*state->options, f->number,
-                                                f->file_size, state->ikey,
-                                                &state->saver, SaveValue);
+      Iterator* pin = nullptr;
+      state->s = state->vset->table_cache_->Get(
+          *state->options, f->number, f->file_size, level, state->ikey,
+          &state->saver, SaveValue,
+          state->pinnable != nullptr ? &pin : nullptr);
+      if (state->s.ok() && state->saver.state == kFound &&
+          state->pinnable != nullptr) {
+        state->pinnable->PinSlice(state->saver.found_value, &DeletePin, pin,
+                                  nullptr);
+      } else {
+        delete pin;
+      }
       if (!state->s.ok()) {
         state->found = true;
         return false;
@@ -393,12 +440,145 @@ Status Version::Get(const ReadOptions& options, const LookupKey& k,
   state.saver.ucmp = vset_->icmp_.user_comparator();
   state.saver.user_key = k.user_key();
   state.saver.value = value;
+  state.pinnable = pinnable;
 
   ForEachOverlapping(state.saver.user_key, state.ikey, &state, &State::Match);
 
   return state.found ? state.s : Status::NotFound(Slice());
 }
 
+namespace {
+struct MultiGetState {
+  Version::GetRequest* request;
+  Saver saver;
+  FileMetaData* last_file_read;
+  int last_file_read_level;
+  bool done;
+};
+}  // namespace
+
+void Version::MultiGet(const ReadOptions& options,
+                       std::vector<GetRequest>* requests) {
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  const size_t n = requests->size();
+  std::vector<MultiGetState> states(n);
+  for (size_t i = 0; i < n; i++) {
+    GetRequest* r = &(*requests)[i];
+    r->stats.seek_file = nullptr;
+    r->stats.seek_file_level = -1;
+    MultiGetState* state = &states[i];
+    state->request = r;
+    state->saver.state = kNotFound;
+    state->saver.ucmp = ucmp;
+    state->saver.user_key = r->key->user_key();
+    state->saver.value = r->value;
+    state->last_file_read = nullptr;
+    state->last_file_read_level = -1;
+    state->done = false;
+  }
+
+  // Look up the keys of "batch" in "f" and settle the ones it decides.
+  std::vector<MultiGetState*> batch;
+  std::vector<Slice> keys;
+  std::vector<void*> args;
+  auto search_file = [&](int level, FileMetaData* f) {
+    keys.clear();
+    args.clear();
+    for (MultiGetState* state : batch) {
+      if (state->request->stats.seek_file == nullptr &&
+          state->last_file_read != nullptr) {
+        // We have had more than one seek for this read.  Charge the 1st file.
+        state->request->stats.seek_file = state->last_file_read;
+        state->request->stats.seek_file_level = state->last_file_read_level;
+      }
+      state->last_file_read = f;
+      state->last_file_read_level = level;
+      keys.push_back(state->request->key->internal_key());
+      args.push_back(&state->saver);
+    }
+    Status s = vset_->table_cache_->MultiGet(
+        options, f->number, f->file_size, level, keys.data(), args.data(),
+        static_cast<int>(batch.size()), SaveValue);
+    for (MultiGetState* state : batch) {
+      if (!s.ok()) {
+        *state->request->status = s;
+        state->done = true;
+        continue;
+      }
+      switch (state->saver.state) {
+        case kNotFound:
+          break;  // Keep searching in other files
+        case kFound:
+          *state->request->status = Status::OK();
+          state->done = true;
+          break;
+        case kDeleted:
+          *state->request->status = Status::NotFound(Slice());
+          state->done = true;
+          break;
+        case kCorrupt:
+          *state->request->status =
+              Status::Corruption("corrupted key for ", state->saver.user_key);
+          state->done = true;
+          break;
+      }
+    }
+    batch.clear();
+  };
+
+  // Search level-0 in order from newest to oldest.
+  std::vector<FileMetaData*> tmp(files_[0]);
+  std::sort(tmp.begin(), tmp.end(), NewestFirst);
+  for (FileMetaData* f : tmp) {
+    for (MultiGetState& state : states) {
+      if (!state.done &&
+          ucmp->Compare(state.saver.user_key, f->smallest.user_key()) >= 0 &&
+          ucmp->Compare(state.saver.user_key, f->largest.user_key()) <= 0) {
+        batch.push_back(&state);
+      }
+    }
+    if (!batch.empty()) {
+      search_file(0, f);
+    }
+  }
+
+  // Search other levels.  Files and keys are both sorted, so a single
+  // pass over each level finds the file for every key.
+  for (int level = 1; level < config::kNumLevels; level++) {
+    const std::vector<FileMetaData*>& files = files_[level];
+    size_t index = 0;
+    for (MultiGetState& state : states) {
+      if (state.done) continue;
+      const Slice ikey = state.request->key->internal_key();
+      while (index < files.size() &&
+             vset_->icmp_.Compare(files[index]->largest.Encode(), ikey) < 0) {
+        if (!batch.empty()) {
+          search_file(level, files[index]);
+        }
+        index++;
+      }
+      if (index == files.size()) {
+        break;
+      }
+      if (ucmp->Compare(state.saver.user_key,
+                        files[index]->smallest.user_key()) < 0) {
+        // All of files[index] is past any data for this key
+      } else {
+        batch.push_back(&state);
+      }
+    }
+    if (!batch.empty()) {
+      search_file(level, files[index]);
+    }
+  }
+
+  for (MultiGetState& state : states) {
+    if (!state.done) {
+      *state.request->status = Status::NotFound(Slice());
+    }
+  }
+}
+
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
   if (f != nullptr) {
@@ -1133,6 +1313,7 @@ void VersionSet::Finalize(Version* v) {
           static_cast<double>(level_bytes) / MaxBytesForLevel(options_, level);
     }
 
+    v->compaction_scores_[level] = score;
     if (score > best_score) {
       best_level = level;
       best_score = score;
@@ -1212,7 +1393,8 @@ uint64_t VersionSet::ApproximateOffsetOf(Version* v, const InternalKey& ikey) {
         // approximate offset of "ikey" within the table.
         Table* tableptr;
         Iterator* iter = table_cache_->NewIterator(
-            ReadOptions(), files[i]->number, files[i]->file_size, &tableptr);
+            ReadOptions(), files[i]->number, files[i]->file_size, &tableptr,
+            level);
         if (tableptr != nullptr) {
           result += tableptr->ApproximateOffsetOf(ikey.Encode());
         }
@@ -1309,8 +1491,8 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
       if (c->level() + which == 0) {
         const std::vector<FileMetaData*>& files = c->inputs_[which];
         for (size_t i = 0; i < files.size(); i++) {
-          list[num++] = table_cache_->NewIterator(options, files[i]->number,
-                                                  files[i]->file_size);
+          list[num++] = table_cache_->NewIterator(
+              options, files[i]->number, files[i]->file_size, nullptr, 0);
         }
       } else {
         // Create concatenating iterator for the files from this level
@@ -1326,60 +1508,120 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   return result;
 }
 
-Compaction* VersionSet::PickCompaction() {
-  Compaction* c;
-  int level;
+static bool AnyBeingCompacted(const std::vector<FileMetaData*>& files) {
+  for (size_t i = 0; i < files.size(); i++) {
+    if (files[i]->being_compacted) {
+      return true;
+    }
+  }
+  return false;
+}
 
+Compaction* VersionSet::PickCompaction() {
   // We prefer compactions triggered by too much data in a level over
-  // the compactions triggered by seeks.
-  // 文件数过多
-  const bool size_compaction = (current_->compaction_score_ >= 1);
-  // seek了多次文件但是没有查到，记录到的file_to_compact_
-  const bool seek_compaction = (current_->file_to_compact_ != nullptr);
-  if (size_compaction) {
-    level = current_->compaction_level_;
-    assert(level >= 0);
-    assert(level + 1 < config::kNumLevels);
-    c = new Compaction(options_, level);
-
-    // Pick the first file that comes after compact_pointer_[level]
-    for (size_t i = 0; i < current_->files_[level].size(); i++) {
-      FileMetaData* f = current_->files_[level][i];
-      if (compact_pointer_[level].empty() ||
-          icmp_.Compare(f->largest.Encode(), compact_pointer_[level]) > 0) {
-        c->inputs_[0].push_back(f);
-        break;
+  // the compactions triggered by seeks.  Levels are tried from the
+  // highest score down so that a level whose files are all busy with
+  // other compactions does not hold up the rest.
+  int levels[config::kNumLevels - 1];
+  int num_levels = 0;
+  for (int level = 0; level < config::kNumLevels - 1; level++) {
+    if (current_->compaction_scores_[level] >= 1) {
+      int i = num_levels++;
+      while (i > 0 && current_->compaction_scores_[levels[i - 1]] <
+                          current_->compaction_scores_[level]) {
+        levels[i] = levels[i - 1];
+        i--;
       }
+      levels[i] = level;
     }
-    if (c->inputs_[0].empty()) {
-      // Wrap-around to the beginning of the key space
-      c->inputs_[0].push_back(current_->files_[level][0]);
+  }
+  for (int i = 0; i < num_levels; i++) {
+    Compaction* c = PickCompactionAtLevel(levels[i]);
+    if (c != nullptr) {
+      return c;
     }
-  } else if (seek_compaction) {
-    level = current_->file_to_compact_level_;
-    c = new Compaction(options_, level);
-    c->inputs_[0].push_back(current_->file_to_compact_);
-  } else {
-    return nullptr;
   }
 
+  // seek了多次文件但是没有查到，记录到的file_to_compact_
+  FileMetaData* f = current_->file_to_compact_;
+  if (f == nullptr || f->being_compacted) {
+    return nullptr;
+  }
+  const int level = current_->file_to_compact_level_;
+  if (level == 0 && AnyBeingCompacted(current_->files_[0])) {
+    return nullptr;
+  }
+  Compaction* c = new Compaction(options_, level);
+  c->inputs_[0].push_back(f);
   c->input_version_ = current_;
   c->input_version_->Ref();
-
-  // Files in level 0 may overlap each other, so pick up all overlapping ones
   if (level == 0) {
     InternalKey smallest, largest;
     GetRange(c->inputs_[0], &smallest, &largest);
-    // Note that the next call will discard the file we placed in
-    // c->inputs_[0] earlier and replace it with an overlapping set
-    // which will include the picked file.
     current_->GetOverlappingInputs(0, &smallest, &largest, &c->inputs_[0]);
-    assert(!c->inputs_[0].empty());
   }
+  if (!SetupOtherInputs(c)) {
+    delete c;
+    return nullptr;
+  }
+  return c;
+}
 
-  SetupOtherInputs(c);
+Compaction* VersionSet::PickCompactionAtLevel(int level) {
+  assert(level >= 0);
+  assert(level + 1 < config::kNumLevels);
+  const std::vector<FileMetaData*>& files = current_->files_[level];
+  if (files.empty()) {
+    return nullptr;
+  }
 
-  return c;
+  // Level-0 files may overlap each other, so level-0 compactions are
+  // not run concurrently with one another.
+  if (level == 0 && AnyBeingCompacted(files)) {
+    return nullptr;
+  }
+
+  // Start with the first file that comes after compact_pointer_[level],
+  // wrapping around to the beginning of the key space.
+  size_t start = 0;
+  if (!compact_pointer_[level].empty()) {
+    while (start < files.size() &&
+           icmp_.Compare(files[start]->largest.Encode(),
+                         compact_pointer_[level]) <= 0) {
+      start++;
+    }
+    if (start == files.size()) {
+      start = 0;
+    }
+  }
+
+  for (size_t n = 0; n < files.size(); n++) {
+    FileMetaData* f = files[(start + n) % files.size()];
+    if (f->being_compacted) {
+      continue;
+    }
+    Compaction* c = new Compaction(options_, level);
+    c->inputs_[0].push_back(f);
+    c->input_version_ = current_;
+    c->input_version_->Ref();
+
+    // Files in level 0 may overlap each other, so pick up all overlapping ones
+    if (level == 0) {
+      InternalKey smallest, largest;
+      GetRange(c->inputs_[0], &smallest, &largest);
+      // Note that the next call will discard the file we placed in
+      // c->inputs_[0] earlier and replace it with an overlapping set
+      // which will include the picked file.
+      current_->GetOverlappingInputs(0, &smallest, &largest, &c->inputs_[0]);
+      assert(!c->inputs_[0].empty());
+    }
+
+    if (SetupOtherInputs(c)) {
+      return c;
+    }
+    delete c;
+  }
+  return nullptr;
 }
 
 // Finds the largest key in a vector of files. Returns true if files is not
@@ -1461,7 +1703,7 @@ void AddBoundaryInputs(const InternalKeyComparator& icmp,
   }
 }
 
-void VersionSet::SetupOtherInputs(Compaction* c) {
+bool VersionSet::SetupOtherInputs(Compaction* c) {
   const int level = c->level();
   InternalKey smallest, largest;
 
@@ -1472,6 +1714,10 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
                                  &c->inputs_[1]);
   AddBoundaryInputs(icmp_, current_->files_[level + 1], &c->inputs_[1]);
 
+  if (AnyBeingCompacted(c->inputs_[0]) || AnyBeingCompacted(c->inputs_[1])) {
+    return false;
+  }
+
   // Get entire range covered by compaction
   InternalKey all_start, all_limit;
   GetRange2(c->inputs_[0], c->inputs_[1], &all_start, &all_limit);
@@ -1487,14 +1733,16 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
     const int64_t expanded0_size = TotalFileSize(expanded0);
     if (expanded0.size() > c->inputs_[0].size() &&
         inputs1_size + expanded0_size <
-            ExpandedCompactionByteSizeLimit(options_)) {
+            ExpandedCompactionByteSizeLimit(options_) &&
+        !AnyBeingCompacted(expanded0)) {
       InternalKey new_start, new_limit;
       GetRange(expanded0, &new_start, &new_limit);
       std::vector<FileMetaData*> expanded1;
       current_->GetOverlappingInputs(level + 1, &new_start, &new_limit,
                                      &expanded1);
       AddBoundaryInputs(icmp_, current_->files_[level + 1], &expanded1);
-      if (expanded1.size() == c->inputs_[1].size()) {
+      if (expanded1.size() == c->inputs_[1].size() &&
+          !AnyBeingCompacted(expanded1)) {
         Log(options_->info_log,
             "Expanding@%d %d+%d (%ld+%ld bytes) to %d+%d (%ld+%ld bytes)\n",
             level, int(c->inputs_[0].size()), int(c->inputs_[1].size()),
@@ -1522,6 +1770,7 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
   // key range next time.
   compact_pointer_[level] = largest.Encode().ToString();
   c->edit_.SetCompactPointer(level, largest);
+  return true;
 }
 
 Compaction* VersionSet::CompactRange(int level, const InternalKey* begin,
@@ -1553,19 +1802,24 @@ Compaction* VersionSet::CompactRange(int level, const InternalKey* begin,
   c->input_version_ = current_;
   c->input_version_->Ref();
   c->inputs_[0] = inputs;
-  SetupOtherInputs(c);
+  if (!SetupOtherInputs(c)) {
+    // The caller must not run a manual compaction concurrently with
+    // other compactions.
+    delete c;
+    return nullptr;
+  }
   return c;
 }
 
 Compaction::Compaction(const Options* options, int level)
     : level_(level),
       max_output_file_size_(MaxFileSizeForLevel(options, level)),
-      input_version_(nullptr),
-      grandparent_index_(0),
-      seen_key_(false),
-      overlapped_bytes_(0) {
+      input_version_(nullptr) {}
+
+Compaction::Progress::Progress()
+    : grandparent_index(0), seen_key(false), overlapped_bytes(0) {
   for (int i = 0; i < config::kNumLevels; i++) {
-    level_ptrs_[i] = 0;
+    level_ptrs[i] = 0;
   }
 }
 
@@ -1593,13 +1847,15 @@ void Compaction::AddInputDeletions(VersionEdit* edit) {
   }
 }
 
-bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
+bool Compaction::IsBaseLevelForKey(const Slice& user_key,
+                                   Progress* progress) const {
   // Maybe use binary search to find right entry instead of linear search?
   const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
+  size_t* level_ptrs = progress->level_ptrs;
   for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
     const std::vector<FileMetaData*>& files = input_version_->files_[lvl];
-    while (level_ptrs_[lvl] < files.size()) {
-      FileMetaData* f = files[level_ptrs_[lvl]];
+    while (level_ptrs[lvl] < files.size()) {
+      FileMetaData* f = files[level_ptrs[lvl]];
       if (user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
         // We've advanced far enough
         if (user_cmp->Compare(user_key, f->smallest.user_key()) >= 0) {
@@ -1608,36 +1864,80 @@ bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
         }
         break;
       }
-      level_ptrs_[lvl]++;
+      level_ptrs[lvl]++;
     }
   }
   return true;
 }
 
-bool Compaction::ShouldStopBefore(const Slice& internal_key) {
+bool Compaction::ShouldStopBefore(const Slice& internal_key,
+                                  Progress* progress) const {
   const VersionSet* vset = input_version_->vset_;
   // Scan to find earliest grandparent file that contains key.
   const InternalKeyComparator* icmp = &vset->icmp_;
-  while (grandparent_index_ < grandparents_.size() &&
-         icmp->Compare(internal_key,
-                       grandparents_[grandparent_index_]->largest.Encode()) >
+  while (progress->grandparent_index < grandparents_.size() &&
+         icmp->Compare(
+             internal_key,
+             grandparents_[progress->grandparent_index]->largest.Encode()) >
              0) {
-    if (seen_key_) {
-      overlapped_bytes_ += grandparents_[grandparent_index_]->file_size;
+    if (progress->seen_key) {
+      progress->overlapped_bytes +=
+          grandparents_[progress->grandparent_index]->file_size;
     }
-    grandparent_index_++;
+    progress->grandparent_index++;
   }
-  seen_key_ = true;
+  progress->seen_key = true;
 
-  if (overlapped_bytes_ > MaxGrandParentOverlapBytes(vset->options_)) {
+  if (progress->overlapped_bytes > MaxGrandParentOverlapBytes(vset->options_)) {
     // Too much overlap for current output; start new output
-    overlapped_bytes_ = 0;
+    progress->overlapped_bytes = 0;
     return true;
   } else {
     return false;
   }
 }
 
+void Compaction::GetSubcompactionBoundaries(
+    int max_subcompactions, std::vector<std::string>* boundaries) const {
+  boundaries->clear();
+  std::vector<FileMetaData*> files(inputs_[0]);
+  files.insert(files.end(), inputs_[1].begin(), inputs_[1].end());
+  const uint64_t total_bytes = TotalFileSize(files);
+
+  // Give every piece at least one output file's worth of input.
+  uint64_t pieces = total_bytes / max_output_file_size_;
+  if (pieces > static_cast<uint64_t>(max_subcompactions)) {
+    pieces = max_subcompactions;
+  }
+  if (pieces <= 1) {
+    return;
+  }
+
+  const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
+  std::sort(files.begin(), files.end(),
+            [user_cmp](FileMetaData* a, FileMetaData* b) {
+              return user_cmp->Compare(a->smallest.user_key(),
+                                       b->smallest.user_key()) < 0;
+            });
+
+  // Start a new piece at the first file that begins after the previous
+  // pieces have covered their share of the input bytes.
+  uint64_t bytes_before = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    const Slice key = files[i]->smallest.user_key();
+    const Slice last =
+        boundaries->empty() ? files[0]->smallest.user_key() : boundaries->back();
+    if (bytes_before >= total_bytes * (boundaries->size() + 1) / pieces &&
+        user_cmp->Compare(key, last) > 0) {
+      boundaries->push_back(key.ToString());
+      if (boundaries->size() + 1 == pieces) {
+        break;
+      }
+    }
+    bytes_before += files[i]->file_size;
+  }
+}
+
 void Compaction::ReleaseInputs() {
   if (input_version_ != nullptr) {
     input_version_->Unref();
@@ -1645,4 +1945,13 @@ void Compaction::ReleaseInputs() {
   }
 }
 
+void Compaction::MarkInputsBeingCompacted(bool value) {
+  for (int which = 0; which < 2; which++) {
+    for (size_t i = 0; i < inputs_[which].size(); i++) {
+      assert(inputs_[which][i]->being_compacted != value);
+      inputs_[which][i]->being_compacted = value;
+    }
+  }
+}
+
 }  // namespace leveldb
@@ -15,6 +15,7 @@
 #ifndef STORAGE_LEVELDB_DB_VERSION_SET_H_
 #define STORAGE_LEVELDB_DB_VERSION_SET_H_
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <vector>
@@ -33,6 +34,7 @@ class Writer;
 class Compaction;
 class Iterator;
 class MemTable;
+class PinnableSlice;
 class TableBuilder;
 class TableCache;
 class Version;
@@ -75,6 +77,26 @@ class Version {
   Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
              GetStats* stats);
 
+  // Same as above, but points *val at the value where it is cached (in
+  // the block cache or the row cache) and pins it there.
+  Status Get(const ReadOptions&, const LookupKey& key, PinnableSlice* val,
+             GetStats* stats);
+
+  // One lookup of a MultiGet() batch.
+  struct GetRequest {
+    const LookupKey* key;
+    std::string* value;
+    Status* status;
+    GetStats stats;
+  };
+
+  // Perform Get(options, *r.key, r.value, &r.stats) for every request r
+  // and store the result in *r.status.  Each level is walked once for the
+  // whole batch and each table is probed once for all of its keys.
+  // REQUIRES: requests are sorted by key
+  // REQUIRES: lock is not held
+  void MultiGet(const ReadOptions&, std::vector<GetRequest>* requests);
+
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
   // REQUIRES: lock is held
@@ -128,7 +150,11 @@ class Version {
         file_to_compact_(nullptr),
         file_to_compact_level_(-1),
         compaction_score_(-1),
-        compaction_level_(-1) {}
+        compaction_level_(-1) {
+    for (int level = 0; level < config::kNumLevels; level++) {
+      compaction_scores_[level] = -1;
+    }
+  }
 
   Version(const Version&) = delete;
   Version& operator=(const Version&) = delete;
@@ -137,6 +163,10 @@ class Version {
 
   Iterator* NewConcatenatingIterator(const ReadOptions&, int level) const;
 
+  // Implements both Get()s: exactly one of "value" and "pinnable" is set.
+  Status GetImpl(const ReadOptions&, const LookupKey& key, std::string* value,
+                 PinnableSlice* pinnable, GetStats* stats);
+
   // Call func(arg, level, f) for every file that overlaps user_key in
   // order from newest to oldest.  If an invocation of func returns
   // false, makes no more calls.
@@ -177,6 +207,8 @@ class Version {
   // are initialized by Finalize().
   double compaction_score_;
   int compaction_level_;
+  // Compaction score of every level; compaction_score_ is the largest.
+  double compaction_scores_[config::kNumLevels];
 };
 
 /**
@@ -227,13 +259,16 @@ class VersionSet {
   // Return the combined file size of all files at the specified level.
   int64_t NumLevelBytes(int level) const;
 
-  // Return the last sequence number.
-  uint64_t LastSequence() const { return last_sequence_; }
+  // Return the last sequence number.  Unlike the rest of VersionSet,
+  // this may be called without external synchronization.
+  uint64_t LastSequence() const {
+    return last_sequence_.load(std::memory_order_acquire);
+  }
 
   // Set the last sequence number to s.
   void SetLastSequence(uint64_t s) {
-    assert(s >= last_sequence_);
-    last_sequence_ = s;
+    assert(s >= last_sequence_.load(std::memory_order_relaxed));
+    last_sequence_.store(s, std::memory_order_release);
   }
 
   // Mark the specified file number as used.
@@ -246,7 +281,10 @@ class VersionSet {
   // being compacted, or zero if there is no such log file.
   uint64_t PrevLogNumber() const { return prev_log_number_; }
 
-  // Pick level and inputs for a new compaction.
+  // Pick level and inputs for a new compaction.  Files that are inputs
+  // of a compaction that is still running (see
+  // Compaction::MarkInputsBeingCompacted) are never picked, so the result
+  // may run concurrently with those compactions.
   // Returns nullptr if there is no compaction to be done.
   // Otherwise returns a pointer to a heap-allocated object that
   // describes the compaction.  Caller should delete the result.
@@ -305,7 +343,14 @@ class VersionSet {
                  const std::vector<FileMetaData*>& inputs2,
                  InternalKey* smallest, InternalKey* largest);
 
-  void SetupOtherInputs(Compaction* c);
+  // Pick a size-triggered compaction of "level" whose inputs are not
+  // being compacted, or return nullptr if there is none.
+  Compaction* PickCompactionAtLevel(int level);
+
+  // Complete the inputs of "c", whose inputs_[0] holds its seed file(s).
+  // Returns false, leaving compact_pointer_ untouched, if the completed
+  // inputs include a file that is already being compacted.
+  bool SetupOtherInputs(Compaction* c);
 
   // Save current contents to *log
   Status WriteSnapshot(log::Writer* log);
@@ -330,7 +375,7 @@ class VersionSet {
   uint64_t manifest_file_number_;
   //sequence号，用于snapshot，每次写入操作都会递增
   // 上一个使用的SequenceNumber
-  uint64_t last_sequence_;
+  std::atomic<uint64_t> last_sequence_;
   //WAL日志文件编号
   uint64_t log_number_;
   uint64_t prev_log_number_;  // 0 or backing store for memtable being compacted
@@ -382,19 +427,56 @@ class Compaction {
   // Add all inputs to this compaction as delete operations to *edit.
   void AddInputDeletions(VersionEdit* edit);
 
+  // State kept while walking (part of) the compaction's input in key
+  // order.  Each thread working on the compaction needs its own.
+  struct Progress {
+    Progress();
+
+    // State used to check for number of overlapping grandparent files
+    // (parent == level_ + 1, grandparent == level_ + 2)
+    size_t grandparent_index;  // Index in grandparents_
+    bool seen_key;             // Some output key has been seen
+    int64_t overlapped_bytes;  // Bytes of overlap between current output
+                               // and grandparent files
+
+    // State for implementing IsBaseLevelForKey
+
+    // level_ptrs holds indices into input_version_->levels_: our state
+    // is that we are positioned at one of the file ranges for each
+    // higher level than the ones involved in this compaction (i.e. for
+    // all L >= level_ + 2).
+    size_t level_ptrs[config::kNumLevels];
+  };
+
   // Returns true if the information we have available guarantees that
   // the compaction is producing data in "level+1" for which no data exists
   // in levels greater than "level+1".
-  bool IsBaseLevelForKey(const Slice& user_key);
+  // REQUIRES: successive calls with the same *progress pass increasing keys
+  bool IsBaseLevelForKey(const Slice& user_key, Progress* progress) const;
 
   // Returns true iff we should stop building the current output
   // before processing "internal_key".
-  bool ShouldStopBefore(const Slice& internal_key);
+  // REQUIRES: successive calls with the same *progress pass increasing keys
+  bool ShouldStopBefore(const Slice& internal_key, Progress* progress) const;
+
+  // Store in *boundaries up to max_subcompactions-1 increasing user keys
+  // that split the input key range into pieces of roughly equal size,
+  // each large enough to fill at least one output file.  The pieces can
+  // be compacted independently.  Boundaries are taken from the starting
+  // keys of input files.
+  void GetSubcompactionBoundaries(int max_subcompactions,
+                                  std::vector<std::string>* boundaries) const;
 
   // Release the input version for the compaction, once the compaction
   // is successful.
   void ReleaseInputs();
 
+  // Set FileMetaData::being_compacted to "value" for every input file.
+  // Inputs must be marked for as long as the compaction runs so that
+  // concurrent compactions do not pick them.
+  // REQUIRES: lock is held
+  void MarkInputsBeingCompacted(bool value);
+
  private:
   friend class Version;
   friend class VersionSet;
@@ -409,21 +491,8 @@ class Compaction {
   // Each compaction reads inputs from "level_" and "level_+1"
   std::vector<FileMetaData*> inputs_[2];  // The two sets of inputs
 
-  // State used to check for number of overlapping grandparent files
-  // (parent == level_ + 1, grandparent == level_ + 2)
+  // Files in level_ + 2 overlapping the inputs; see ShouldStopBefore()
   std::vector<FileMetaData*> grandparents_;
-  size_t grandparent_index_;  // Index in grandparent_starts_
-  bool seen_key_;             // Some output key has been seen
-  int64_t overlapped_bytes_;  // Bytes of overlap between current output
-                              // and grandparent files
-
-  // State for implementing IsBaseLevelForKey
-
-  // level_ptrs_ holds indices into input_version_->levels_: our state
-  // is that we are positioned at one of the file ranges for each
-  // higher level than the ones involved in this compaction (i.e. for
-  // all L >= level_ + 2).
-  size_t level_ptrs_[config::kNumLevels];
 };
 
 }  // namespace leveldb
@@ -97,6 +97,18 @@ LEVELDB_EXPORT char* leveldb_get(leveldb_t* db,
                                  const char* key, size_t keylen, size_t* vallen,
                                  char** errptr);
 
+/* Looks up num_keys keys at once.  For each key i, values_list[i] is set
+   to NULL if the key is not found or to a malloc()ed array otherwise, and
+   values_list_sizes[i] to the length of that array.  errs[i] is set to
+   NULL, or to a malloc()ed error message if the lookup failed. */
+LEVELDB_EXPORT void leveldb_multi_get(leveldb_t* db,
+                                      const leveldb_readoptions_t* options,
+                                      size_t num_keys,
+                                      const char* const* keys_list,
+                                      const size_t* keys_list_sizes,
+                                      char** values_list,
+                                      size_t* values_list_sizes, char** errs);
+
 LEVELDB_EXPORT leveldb_iterator_t* leveldb_create_iterator(
     leveldb_t* db, const leveldb_readoptions_t* options);
 
@@ -190,7 +202,12 @@ LEVELDB_EXPORT void leveldb_options_set_block_restart_interval(
 LEVELDB_EXPORT void leveldb_options_set_max_file_size(leveldb_options_t*,
                                                       size_t);
 
-enum { leveldb_no_compression = 0, leveldb_snappy_compression = 1 };
+enum {
+  leveldb_no_compression = 0,
+  leveldb_snappy_compression = 1,
+  leveldb_zstd_compression = 2,
+  leveldb_lz4_compression = 3
+};
 LEVELDB_EXPORT void leveldb_options_set_compression(leveldb_options_t*, int);
 
 /* Comparator */
@@ -10,8 +10,8 @@
 // length strings, may use the length of the string as the charge for
 // the string.
 //
-// A builtin cache implementation with a least-recently-used eviction
-// policy is provided.  Clients may use their own implementations if
+// Builtin cache implementations with a least-recently-used and a CLOCK
+// eviction policy are provided.  Clients may use their own implementations if
 // they want something more sophisticated (like scan-resistance, a
 // custom eviction policy, variable cache sizing, etc.)
 
@@ -19,6 +19,7 @@
 #define STORAGE_LEVELDB_INCLUDE_CACHE_H_
 
 #include <cstdint>
+#include <string>
 
 #include "leveldb/export.h"
 #include "leveldb/slice.h"
@@ -31,6 +32,35 @@ class LEVELDB_EXPORT Cache;
 // of Cache uses a least-recently-used eviction policy.
 LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity);
 
+// Like NewLRUCache(capacity), but up to high_pri_pool_ratio of the
+// capacity is reserved for entries inserted with kHighPriority: those are
+// only evicted once there are no low priority entries left to evict, or
+// when they overflow the reserved part.  Low priority entries may still
+// use the whole capacity.
+LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity, double high_pri_pool_ratio);
+
+// Like NewLRUCache(capacity, high_pri_pool_ratio), split into
+// 2^num_shard_bits shards instead of 16.  A negative num_shard_bits picks
+// a number of shards from the capacity.  With strict_capacity_limit, an
+// entry that does not fit once all unused entries are evicted is not
+// cached: Insert() returns a handle that is only valid until released.
+LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity, int num_shard_bits,
+                                  bool strict_capacity_limit,
+                                  double high_pri_pool_ratio = 0);
+
+// Create a new cache with a fixed size capacity, split into
+// 2^num_shard_bits shards.  This implementation of Cache uses the CLOCK
+// eviction policy: Lookup() and Release() never block, only Insert(),
+// Erase() and Prune() lock the shard.  High priority entries survive more
+// turns of the clock hand.
+//
+// Each shard keeps its entries in a table sized for entries of about
+// estimated_entry_charge (the default block size if not given): a cache
+// holding much smaller entries evicts them before reaching its capacity.
+LEVELDB_EXPORT Cache* NewClockCache(size_t capacity, int num_shard_bits);
+LEVELDB_EXPORT Cache* NewClockCache(size_t capacity, int num_shard_bits,
+                                    size_t estimated_entry_charge);
+
 class LEVELDB_EXPORT Cache {
  public:
   Cache() = default;
@@ -45,6 +75,9 @@ class LEVELDB_EXPORT Cache {
   // Opaque handle to an entry stored in the cache.
   struct Handle {};
 
+  // Entries are evicted in order of priority first, then of recency.
+  enum Priority { kLowPriority = 0, kHighPriority = 1 };
+
   // Insert a mapping from key->value into the cache and assign it
   // the specified charge against the total cache capacity.
   //
@@ -58,6 +91,12 @@ class LEVELDB_EXPORT Cache {
   virtual Handle* Insert(const Slice& key, void* value, size_t charge,
                          void (*deleter)(const Slice& key, void* value)) = 0;
 
+  // Same as above, with the given eviction priority.  The default
+  // implementation ignores the priority.
+  virtual Handle* Insert(const Slice& key, void* value, size_t charge,
+                         void (*deleter)(const Slice& key, void* value),
+                         Priority priority);
+
   // If the cache has no mapping for "key", returns nullptr.
   //
   // Else return a handle that corresponds to the mapping.  The caller
@@ -99,6 +138,11 @@ class LEVELDB_EXPORT Cache {
   // Return an estimate of the combined charges of all elements stored in the
   // cache.
   virtual size_t TotalCharge() const = 0;
+
+  // Append a human readable table of per-shard statistics (capacity, usage,
+  // hits and misses) to *stats and return true.  Default implementation
+  // returns false, for caches that do not keep statistics.
+  virtual bool GetStats(std::string* stats) const { return false; }
 };
 
 }  // namespace leveldb
@@ -52,6 +52,14 @@ class LEVELDB_EXPORT Comparator {
   // Simple comparator implementations may return with *key unchanged,
   // i.e., an implementation of this method that does nothing is correct.
   virtual void FindShortSuccessor(std::string* key) const = 0;
+
+  // If keys that compare equal always have the same bytes, sets
+  // "*hash_key" to the part of "key" that is shared by all the keys a
+  // point lookup for "key" is after, and returns true.  For most
+  // comparators that part is "key" itself.  The hash indexes of data
+  // blocks (see Options::data_block_hash_index) are keyed by it.  The
+  // default implementation returns false, which disables them.
+  virtual bool ExtractHashKey(const Slice& key, Slice* hash_key) const;
 };
 
 // Return a builtin comparator that uses lexicographic byte-wise
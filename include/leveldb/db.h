@@ -7,10 +7,13 @@
 
 #include <cstdint>
 #include <cstdio>
+#include <string>
+#include <vector>
 
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
 #include "leveldb/options.h"
+#include "leveldb/pinnable_slice.h"
 
 namespace leveldb {
 
@@ -87,6 +90,23 @@ class LEVELDB_EXPORT DB {
   virtual Status Get(const ReadOptions& options, const Slice& key,
                      std::string* value) = 0;
 
+  // Same as Get() above, but instead of copying the value, may point
+  // *value at it in a memtable or the block cache and pin it there until
+  // *value is reset or destroyed.  *value must be released before the
+  // database is deleted.
+  virtual Status Get(const ReadOptions& options, const Slice& key,
+                     PinnableSlice* value);
+
+  // Look up all of "keys" as Get() would, all at the same snapshot.
+  // Resizes *values to keys.size() and returns one status per key; for
+  // keys that are not found (*values)[i] is empty.
+  //
+  // Faster than calling Get() for every key when there are many keys:
+  // the keys are sorted and each table is searched once per batch.
+  virtual std::vector<Status> MultiGet(const ReadOptions& options,
+                                       const std::vector<Slice>& keys,
+                                       std::vector<std::string>* values);
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -121,6 +141,9 @@ class LEVELDB_EXPORT DB {
   //     of the sstables that make up the db contents.
   //  "leveldb.approximate-memory-usage" - returns the approximate number of
   //     bytes of memory in use by the DB.
+  //  "leveldb.block-cache-stats" - returns a multi-line string with the
+  //     capacity, usage, hits and misses of each shard of the block cache,
+  //     if the cache keeps statistics.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
   // For each i in [0,n-1], store in "sizes[i]", the approximate
@@ -19,6 +19,7 @@
 #include <vector>
 
 #include "leveldb/export.h"
+#include "leveldb/slice.h"
 #include "leveldb/status.h"
 
 // This workaround can be removed when leveldb::Env::DeleteFile is removed.
@@ -202,6 +203,19 @@ class LEVELDB_EXPORT Env {
   // serialized.
   virtual void Schedule(void (*function)(void* arg), void* arg) = 0;
 
+  // Background work is split into pools by priority so that short,
+  // latency-sensitive work (memtable flushes) is not queued behind long
+  // running work (compactions).
+  enum Priority { kLowPriority = 0, kHighPriority = 1 };
+
+  // Like Schedule(function, arg) but runs "(*function)(arg)" on the pool
+  // for "pri".  The default implementation ignores "pri".
+  virtual void Schedule(void (*function)(void* arg), void* arg, Priority pri);
+
+  // Make sure the pool for "pri" has at least "number" threads.  Pools
+  // never shrink.  The default implementation does nothing.
+  virtual void SetBackgroundThreads(int number, Priority pri);
+
   // Start a new thread, invoking "function(arg)" within the new thread.
   // When "function(arg)" returns, the thread will be destroyed.
   virtual void StartThread(void (*function)(void* arg), void* arg) = 0;
@@ -274,6 +288,34 @@ class LEVELDB_EXPORT RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
+
+  // One read of a MultiRead() batch.  The caller fills in "offset", "n"
+  // and "scratch"; MultiRead() sets "result" and "status" exactly as
+  // Read(offset, n, &result, scratch) would.
+  struct ReadRequest {
+    uint64_t offset;
+    size_t n;
+    char* scratch;
+    Slice result;
+    Status status;
+  };
+
+  // Perform the "num" reads described by "reqs[0..num-1]" and return once
+  // all of them have completed.  Implementations may keep all of the reads
+  // in flight at once, so a batch of reads costs roughly one device
+  // round-trip instead of "num".  The default implementation calls Read()
+  // for each request in turn.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void MultiRead(ReadRequest* reqs, size_t num) const;
+
+  // Hint that the "n" bytes starting at "offset" will be read soon, so
+  // that the implementation can start fetching them in the background.
+  // Returns without waiting for the data.  The default implementation
+  // does nothing.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void Prefetch(uint64_t offset, size_t n) const;
 };
 
 // A file abstraction for sequential writing.  The implementation
@@ -389,6 +431,12 @@ class LEVELDB_EXPORT EnvWrapper : public Env {
   void Schedule(void (*f)(void*), void* a) override {
     return target_->Schedule(f, a);
   }
+  void Schedule(void (*f)(void*), void* a, Priority pri) override {
+    return target_->Schedule(f, a, pri);
+  }
+  void SetBackgroundThreads(int number, Priority pri) override {
+    return target_->SetBackgroundThreads(number, pri);
+  }
   void StartThread(void (*f)(void*), void* a) override {
     return target_->StartThread(f, a);
   }
@@ -67,6 +67,35 @@ class LEVELDB_EXPORT FilterPolicy {
 // trailing spaces in keys.
 LEVELDB_EXPORT const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
 
+// Return a new filter policy that, like NewBloomFilterPolicy(), uses a
+// bloom filter with approximately the specified number of bits per key,
+// but keeps all of a key's bits in one 64-byte cache line.  A probe then
+// costs at most one cache miss instead of one per bit, and is evaluated
+// with AVX2 instructions on CPUs that have them.  Every key sets eight
+// bits, which suits 8 to 12 bits per key; at 10 bits per key the false
+// positive rate is ~0.9%, and filters are rounded up to a whole number of
+// 64-byte lines.
+//
+// The same caveats as for NewBloomFilterPolicy() apply.  The two policies
+// have different names, so filters written by one are ignored by the
+// other.
+LEVELDB_EXPORT const FilterPolicy* NewBlockedBloomFilterPolicy(
+    int bits_per_key);
+
+// Return a new filter policy that uses a Ribbon filter with about the same
+// false positive rate as NewBloomFilterPolicy(bloom_equivalent_bits_per_key)
+// but roughly 25% less space: at 10, the rate is ~0.8% for ~7.4 bits per
+// key.  In exchange, filters take several times longer to build than bloom
+// filters, and probes are ~1.5x slower.
+//
+// Every filter takes at least 112 bytes at 10 bloom-equivalent bits,
+// however few keys it holds, so this policy is best combined with
+// Options::full_filter, whose filters cover whole tables.
+//
+// The same caveats as for NewBloomFilterPolicy() apply.
+LEVELDB_EXPORT const FilterPolicy* NewRibbonFilterPolicy(
+    int bloom_equivalent_bits_per_key);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_INCLUDE_FILTER_POLICY_H_
@@ -0,0 +1,147 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A MemTableRep is the data structure that holds the entries of a
+// memtable.  A database picks its representation through the
+// MemTableRepFactory in Options::memtable_factory.  Builtin factories:
+//
+//   NewSkipListRepFactory()      - a sorted skiplist.  The default; good
+//                                  all round and supports concurrent inserts.
+//   NewHashSkipListRepFactory()  - a hash table of skiplists, bucketed by a
+//                                  key prefix.  Point lookups only search
+//                                  the bucket of their key's prefix; full
+//                                  scans pay for merging all buckets.
+//   NewVectorRepFactory()        - an unsorted vector that is sorted once,
+//                                  when the memtable becomes immutable.
+//                                  Cheapest inserts for bulk loads, but
+//                                  point lookups in the active memtable
+//                                  scan it and iterators copy and sort it.
+//
+// Memtable entries are opaque "const char*" buffers owned by the memtable.
+// Each starts with the entry's internal key, encoded as a varint32 length
+// followed by that many bytes; only KeyComparator needs to interpret them.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_MEMTABLEREP_H_
+#define STORAGE_LEVELDB_INCLUDE_MEMTABLEREP_H_
+
+#include <cstddef>
+
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class Arena;
+class SliceTransform;
+
+class LEVELDB_EXPORT MemTableRep {
+ public:
+  // Orders memtable entries.
+  class KeyComparator {
+   public:
+    virtual ~KeyComparator();
+
+    // Three-way comparison of two entries, or of an entry and a lookup key
+    // encoded the same way.
+    virtual int operator()(const char* a, const char* b) const = 0;
+  };
+
+  // Iteration over the entries of a MemTableRep, in KeyComparator order.
+  class Iterator {
+   public:
+    Iterator() = default;
+
+    Iterator(const Iterator&) = delete;
+    Iterator& operator=(const Iterator&) = delete;
+
+    virtual ~Iterator();
+
+    virtual bool Valid() const = 0;
+
+    // REQUIRES: Valid()
+    virtual const char* key() const = 0;
+
+    // REQUIRES: Valid()
+    virtual void Next() = 0;
+
+    // REQUIRES: Valid()
+    virtual void Prev() = 0;
+
+    // Position at the first entry >= target, which is encoded like the
+    // start of an entry.
+    virtual void Seek(const char* target) = 0;
+
+    virtual void SeekToFirst() = 0;
+    virtual void SeekToLast() = 0;
+  };
+
+  MemTableRep() = default;
+
+  MemTableRep(const MemTableRep&) = delete;
+  MemTableRep& operator=(const MemTableRep&) = delete;
+
+  virtual ~MemTableRep();
+
+  // Insert "entry", which stays live for the lifetime of the rep.
+  // REQUIRES: external synchronization with other inserts; nothing that
+  // compares equal to "entry" is in the rep.  Concurrent reads through
+  // iterators must be supported.
+  virtual void Insert(const char* entry) = 0;
+
+  // Same as Insert(), but may be called from several threads at once.
+  // Only called if the factory's IsInsertConcurrentlySupported() is true.
+  virtual void InsertConcurrently(const char* entry);
+
+  // Called once no more entries will be inserted.
+  virtual void MarkReadOnly();
+
+  // Return the number of bytes the rep has allocated for its entries outside
+  // of its arena.  This is charged against Options::write_buffer_size.
+  virtual size_t ApproximateMemoryUsage() = 0;
+
+  // Return a new iterator over all entries.  The caller must delete it.
+  virtual Iterator* GetIterator() = 0;
+
+  // Return a new iterator that is only required to be correct for entries
+  // whose user key equals "user_key".  Point lookups use this so that a
+  // rep may search a subset of its entries.  The default implementation
+  // returns GetIterator().
+  virtual Iterator* GetPointLookupIterator(const Slice& user_key);
+};
+
+class LEVELDB_EXPORT MemTableRepFactory {
+ public:
+  virtual ~MemTableRepFactory();
+
+  // The name of this factory, for logging.
+  virtual const char* Name() const = 0;
+
+  // Return a new, empty rep that orders entries with "cmp".  "cmp" and
+  // "arena" outlive the rep, and the rep may allocate from "arena".
+  virtual MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& cmp,
+                                         Arena* arena) = 0;
+
+  // Return true if the reps created by this factory implement
+  // InsertConcurrently().
+  virtual bool IsInsertConcurrentlySupported() const;
+};
+
+// Each factory below returns a new object that the caller must delete
+// once no database opened with it remains open.
+
+// The default representation.
+LEVELDB_EXPORT MemTableRepFactory* NewSkipListRepFactory();
+
+// Hash "bucket_count" buckets of skiplists, keyed by the prefix that
+// "prefix_extractor" gives each user key.  User keys outside the
+// extractor's domain are bucketed by the whole key.  "prefix_extractor"
+// must outlive the factory.
+LEVELDB_EXPORT MemTableRepFactory* NewHashSkipListRepFactory(
+    const SliceTransform* prefix_extractor, size_t bucket_count = 50000);
+
+LEVELDB_EXPORT MemTableRepFactory* NewVectorRepFactory();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_MEMTABLEREP_H_
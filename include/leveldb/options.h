@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
 
 #include <cstddef>
+#include <vector>
 
 #include "leveldb/export.h"
 
@@ -16,6 +17,9 @@ class Comparator;
 class Env;
 class FilterPolicy;
 class Logger;
+class MemTableRepFactory;
+class PersistentCache;
+class SliceTransform;
 class Snapshot;
 
 // DB contents are stored in a set of blocks, each of which holds a
@@ -26,7 +30,9 @@ enum CompressionType {
   // NOTE: do not change the values of existing entries, as these are
   // part of the persistent format on disk.
   kNoCompression = 0x0,
-  kSnappyCompression = 0x1
+  kSnappyCompression = 0x1,
+  kZstdCompression = 0x2,
+  kLZ4Compression = 0x3
 };
 
 // Options to control the behavior of a database (passed to DB::Open)
@@ -93,6 +99,28 @@ struct LEVELDB_EXPORT Options {
   // If null, leveldb will automatically create and use an 8MB internal cache.
   Cache* block_cache = nullptr;
 
+  // If non-null, compressed blocks read from disk are also kept in this
+  // cache, in their compressed on-disk form.  A block missing from
+  // block_cache is then decompressed from memory instead of read from the
+  // file.  Compressed blocks take less memory, so this cache holds more
+  // blocks than block_cache could in the same space.
+  Cache* compressed_block_cache = nullptr;
+
+  // If non-null, blocks read from the table files are also kept in this
+  // cache, which stores them in files of its own (see NewPersistentCache()).
+  // Meant for a database on a slow device, such as a spinning disk, with
+  // the cache on a faster one.  Blocks are keyed by a random id that each
+  // table file is given when it is written with this option set, so
+  // databases may share a cache, and checksummed whenever they are read
+  // back from it.  Tables written without it are not cached here.
+  PersistentCache* persistent_cache = nullptr;
+
+  // If non-null, the entries point lookups find in table files are cached
+  // here, keyed by file and user key, so that lookups of hot keys skip the
+  // index and data blocks altogether.  Only the newest entry of a key in
+  // each file is cached; reads from older snapshots go to the table.
+  Cache* row_cache = nullptr;
+
   // Approximate size of user data packed per block.  Note that the
   // block size specified here corresponds to uncompressed data.  The
   // actual size of the unit read from disk may be smaller if
@@ -104,6 +132,22 @@ struct LEVELDB_EXPORT Options {
   // leave this parameter alone.
   int block_restart_interval = 16;
 
+  // If true, each data block of new tables ends with a hash index mapping
+  // the hash of every key (as given by Comparator::ExtractHashKey()) to
+  // the restart point before it.  Point lookups then jump to that restart
+  // point instead of binary searching the restart points, and skip the
+  // block without any key comparison if the key is missing from it.  The
+  // index takes about one byte per key divided by
+  // data_block_hash_table_util_ratio.  It is left out of blocks with more
+  // than 253 restart points, and for comparators without hash keys.
+  // Tables with hash indexes cannot be read by older versions of leveldb.
+  bool data_block_hash_index = false;
+
+  // Number of keys per bucket of the hash index of data blocks.  Lower
+  // ratios make fewer collisions, which fall back to a binary search.
+  // Values outside of [0.1, 1] are clipped to that range.
+  double data_block_hash_table_util_ratio = 0.75;
+
   // Leveldb will write up to this amount of bytes to a file before
   // switching to a new one.
   // Most clients should leave this parameter alone.  However if your
@@ -128,8 +172,36 @@ struct LEVELDB_EXPORT Options {
   // worth switching to kNoCompression.  Even if the input data is
   // incompressible, the kSnappyCompression implementation will
   // efficiently detect that and will switch to uncompressed mode.
+  //
+  // kLZ4Compression decompresses faster than snappy at a similar ratio;
+  // kZstdCompression compresses considerably better but costs more CPU.
+  // Both need leveldb to be built with the library; otherwise blocks are
+  // stored uncompressed.
   CompressionType compression = kSnappyCompression;
 
+  // If non-empty, the compression of the tables written to level L is
+  // compression_per_level[L], or the last entry for levels past the end,
+  // and "compression" is ignored.  Typically a fast algorithm is chosen
+  // for the frequently rewritten upper levels and a denser one for the
+  // bottom levels, which hold most of the data.  Memtable flushes use
+  // the entry for level 0.
+  std::vector<CompressionType> compression_per_level;
+
+  // Compression level used by kZstdCompression.  Higher values compress
+  // better and slower; negative values are faster still.
+  int zstd_compression_level = 1;
+
+  // If non-zero, each table compressed with kZstdCompression gets its own
+  // zstd dictionary of at most this many bytes, trained on samples of the
+  // table's data blocks and stored in the table.  Dictionaries make small
+  // blocks compress much better, since each block no longer has to
+  // rediscover the patterns it shares with its neighbours.
+  size_t zstd_max_dict_bytes = 0;
+
+  // Amount of a table's data buffered in memory and sampled to train its
+  // dictionary.  Zero means 100 times zstd_max_dict_bytes.
+  size_t zstd_max_train_bytes = 0;
+
   // EXPERIMENTAL: If true, append to existing MANIFEST and log files
   // when a database is opened.  This can significantly speed up open.
   //
@@ -140,6 +212,92 @@ struct LEVELDB_EXPORT Options {
   // Many applications will benefit from passing the result of
   // NewBloomFilterPolicy() here.
   const FilterPolicy* filter_policy = nullptr;
+
+  // If true, new tables get a single filter over all of their keys instead
+  // of one filter per 2KB of data blocks.  A lookup then probes the filter
+  // before searching the index block, so a table that cannot hold the key
+  // is skipped after one probe.  The filter of a table is held in memory
+  // as a whole either way.  Tables of both kinds can be read regardless of
+  // this setting.
+  bool full_filter = false;
+
+  // If true, the index block of new tables is cut into partitions of about
+  // metadata_block_size bytes, and so is the filter: one filter over the
+  // keys of each index partition, as with full_filter.  Only the small
+  // top-level index of the partitions stays in memory with the open table;
+  // the partitions are read through block_cache like data blocks, and are
+  // evicted like them.  This bounds the memory used by many large tables,
+  // at the cost of a block cache lookup (or a read) per lookup.
+  // Overrides full_filter.
+  bool partition_index_and_filters = false;
+
+  // Approximate size of the index partitions of partition_index_and_filters.
+  size_t metadata_block_size = 4 * 1024;
+
+  // If true, the index block and filter of each open table are stored in
+  // block_cache, charged against its capacity and evicted like data
+  // blocks, instead of being held by the table for as long as it is open.
+  // This bounds the memory used for reads as a whole, at the cost of
+  // reading them again after they have been evicted.  They are inserted
+  // into the cache when the table is opened, and whatever the fill_cache
+  // setting of a read.  Ignored if block_cache is null.
+  bool cache_index_and_filter_blocks = false;
+
+  // If true, the index blocks and filters stored in block_cache, including
+  // the partitions of partition_index_and_filters, are inserted with
+  // Cache::kHighPriority, so that a cache created with a high priority
+  // pool evicts them after the data blocks.
+  bool cache_index_and_filter_blocks_with_high_priority = true;
+
+  // If true, the index block and filter of level-0 tables stored in
+  // block_cache by cache_index_and_filter_blocks are pinned there for as
+  // long as the table is open.  Every lookup probes all level-0 tables,
+  // so they are the last ones worth evicting.
+  bool pin_l0_filter_and_index_blocks_in_cache = false;
+
+  // If non-null, defines the prefix of a key for iterators created with
+  // ReadOptions::prefix_same_as_start.  With a filter_policy, the filters
+  // of new tables also hold the prefix of every key in the domain of this
+  // transform, which lets such iterators skip the tables and blocks that
+  // hold no key with the prefix they are looking for.  Tables written with
+  // another (or no) prefix extractor are read without their filters.
+  //
+  // REQUIRES: the keys that share a prefix are adjacent in the order of
+  // the comparator, as they are for prefixes under the default comparator.
+  const SliceTransform* prefix_extractor = nullptr;
+
+  // Maximum number of compactions that may run concurrently.  Concurrent
+  // compactions never share input files.  Compactions are scheduled on
+  // env's Env::kLowPriority pool, which is grown to at least this many
+  // threads when the DB is opened; memtable flushes use the separate
+  // Env::kHighPriority pool so that they are never queued behind a
+  // compaction.
+  int max_background_compactions = 1;
+
+  // Maximum number of threads that work on a single compaction.  A large
+  // compaction is split into key ranges that are merged in parallel; the
+  // files produced for all ranges are installed together.  1 disables
+  // the splitting.
+  int max_subcompactions = 1;
+
+  // If true, a group of writes is inserted into the memtable while the
+  // next group is already being appended to the log, instead of each
+  // group doing both before the next one starts.  Writes still become
+  // visible in sequence order.  This raises throughput for workloads of
+  // many small concurrent writes.
+  bool enable_pipelined_write = false;
+
+  // If true, when several writes are committed together, each writer
+  // inserts its own batch into the memtable in parallel with the others
+  // once the group has been logged, instead of the group's leader
+  // inserting all of them alone.
+  // Ignored unless memtable_factory supports concurrent inserts.
+  bool allow_concurrent_memtable_write = false;
+
+  // If non-null, use the specified factory to create the data structure
+  // that holds each memtable's entries (see leveldb/memtablerep.h).
+  // If null, leveldb uses a skiplist.
+  MemTableRepFactory* memtable_factory = nullptr;
 };
 
 // Options that control read operations
@@ -157,6 +315,21 @@ struct LEVELDB_EXPORT ReadOptions {
   // not have been released).  If "snapshot" is null, use an implicit
   // snapshot of the state at the beginning of this read operation.
   const Snapshot* snapshot = nullptr;
+
+  // If true, an iterator only yields keys that share the prefix (as given
+  // by Options::prefix_extractor) of the target of its last Seek(), and
+  // becomes invalid once it moves past them.  Tables whose filters say
+  // that they hold no such key are then skipped without reading their
+  // data.  Has no effect after SeekToFirst() or SeekToLast(), or without
+  // a prefix extractor.
+  bool prefix_same_as_start = false;
+
+  // If non-zero, an iterator that reads the data blocks of a table one
+  // after the other asks the file to fetch the bytes that follow in the
+  // background.  The readahead starts small once sequential reads are
+  // detected and doubles with every further one, up to readahead_size
+  // bytes.  Helps long range scans over files that are not cached.
+  size_t readahead_size = 0;
 };
 
 // Options that control write operations
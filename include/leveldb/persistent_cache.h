@@ -0,0 +1,61 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A PersistentCache keeps blocks in files, typically on a device faster
+// than the one holding the database (e.g. a local SSD in front of a
+// spinning disk), and finds them again after a restart.  It has internal
+// synchronization and may be safely accessed concurrently from multiple
+// threads.
+//
+// Most people will want to use the builtin file based implementation
+// (see NewPersistentCache() below).
+
+#ifndef STORAGE_LEVELDB_INCLUDE_PERSISTENT_CACHE_H_
+#define STORAGE_LEVELDB_INCLUDE_PERSISTENT_CACHE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class Env;
+
+class LEVELDB_EXPORT PersistentCache {
+ public:
+  PersistentCache() = default;
+
+  PersistentCache(const PersistentCache&) = delete;
+  PersistentCache& operator=(const PersistentCache&) = delete;
+
+  // Keeps what was stored in a way that survives reopening the cache.
+  virtual ~PersistentCache();
+
+  // Store a copy of "data" under "key", unless the key is already
+  // present.  The cache may drop the data, e.g. when it fails to write it.
+  virtual void Insert(const Slice& key, const Slice& data) = 0;
+
+  // If the cache holds "key", store its data in *data and return true.
+  virtual bool Lookup(const Slice& key, std::string* data) = 0;
+};
+
+// Create a persistent cache of at most "capacity" bytes, stored in the
+// directory "path" through "env".  The data a previous cache left in the
+// directory is kept.  Only one cache may use a directory at a time.
+//
+// The cache appends entries to a sequence of segment files and keeps an
+// index of them in memory.  Once over capacity, it deletes the segments
+// that were least recently read from.  Entries added since the last
+// segment was written out are lost if the process does not delete the
+// cache before exiting.
+LEVELDB_EXPORT Status NewPersistentCache(Env* env, const std::string& path,
+                                         uint64_t capacity,
+                                         PersistentCache** cache);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_PERSISTENT_CACHE_H_
@@ -0,0 +1,73 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A PinnableSlice is a Slice that may keep the storage it refers to alive:
+// DB::Get() points it straight at the value in a memtable or a cached
+// block, and pins that memory instead of copying the value.  The pin is
+// released when the slice is reset or destroyed.
+//
+// A pinned slice holds on to database resources and must be released
+// before the database it was read from is deleted.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_PINNABLE_SLICE_H_
+#define STORAGE_LEVELDB_INCLUDE_PINNABLE_SLICE_H_
+
+#include <string>
+
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class LEVELDB_EXPORT PinnableSlice : public Slice {
+ public:
+  using CleanupFunction = void (*)(void* arg1, void* arg2);
+
+  PinnableSlice() : cleanup_(nullptr), arg1_(nullptr), arg2_(nullptr) {}
+
+  PinnableSlice(const PinnableSlice&) = delete;
+  PinnableSlice& operator=(const PinnableSlice&) = delete;
+
+  ~PinnableSlice() { Reset(); }
+
+  // Refer to "s", whose storage stays valid until (*cleanup)(arg1, arg2)
+  // is called when the slice is reset or destroyed.
+  void PinSlice(const Slice& s, CleanupFunction cleanup, void* arg1,
+                void* arg2) {
+    Reset();
+    Slice::operator=(s);
+    cleanup_ = cleanup;
+    arg1_ = arg1;
+    arg2_ = arg2;
+  }
+
+  // Refer to a copy of "s" owned by this slice.
+  void PinSelf(const Slice& s) {
+    Reset();
+    self_.assign(s.data(), s.size());
+    Slice::operator=(self_);
+  }
+
+  // Release the pinned storage, if any, and become empty.
+  void Reset() {
+    if (cleanup_ != nullptr) {
+      (*cleanup_)(arg1_, arg2_);
+      cleanup_ = nullptr;
+    }
+    Slice::clear();
+  }
+
+  // Return true iff the slice refers to storage it does not own.
+  bool IsPinned() const { return cleanup_ != nullptr; }
+
+ private:
+  std::string self_;
+  CleanupFunction cleanup_;
+  void* arg1_;
+  void* arg2_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_PINNABLE_SLICE_H_
@@ -0,0 +1,46 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A SliceTransform maps a key to a shorter slice of it, typically a prefix.
+// Keys that share a transformed value can be grouped together, e.g. in the
+// buckets of a hash-based memtable representation (see memtablerep.h).
+//
+// Most people will want to use the builtin fixed-length prefix transform
+// (see NewFixedPrefixTransform() below).
+
+#ifndef STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+#define STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+
+#include <cstddef>
+
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class LEVELDB_EXPORT SliceTransform {
+ public:
+  virtual ~SliceTransform();
+
+  // Return the name of this transform.  Note that if the transform
+  // changes in an incompatible way, the name returned by this method
+  // must be changed.
+  virtual const char* Name() const = 0;
+
+  // Return the transformed value of "key", which must point into "key".
+  // REQUIRES: InDomain(key)
+  virtual Slice Transform(const Slice& key) const = 0;
+
+  // Return true iff Transform() may be applied to "key".
+  virtual bool InDomain(const Slice& key) const = 0;
+};
+
+// Return a new transform that maps every key of at least "prefix_len"
+// bytes to its first "prefix_len" bytes.  Shorter keys are not in its
+// domain.  The caller must delete the result when it is no longer needed.
+LEVELDB_EXPORT const SliceTransform* NewFixedPrefixTransform(size_t prefix_len);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
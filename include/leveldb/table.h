@@ -7,12 +7,14 @@
 
 #include <cstdint>
 
+#include "leveldb/cache.h"
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
 
 namespace leveldb {
 
 class Block;
+struct BlockContents;
 class BlockHandle;
 class Footer;
 struct Options;
@@ -60,9 +62,24 @@ class LEVELDB_EXPORT Table {
 
  private:
   friend class TableCache;
+  struct Filter;
   struct Rep;
 
+  // Same as the public Open(), and if "pin_index_and_filter", the index
+  // block and filter stored in the block cache by
+  // Options::cache_index_and_filter_blocks stay there until the table is
+  // deleted.
+  static Status Open(const Options& options, RandomAccessFile* file,
+                     uint64_t file_size, bool pin_index_and_filter,
+                     Table** table);
+
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
+  static Iterator* IndexPartitionReader(void*, const ReadOptions&,
+                                        const Slice&);
+  static bool BlockMayMatchPrefix(void*, const Slice& target,
+                                  const Slice& index_key,
+                                  const Slice& index_value);
+  static void Prefetch(void*, uint64_t offset, size_t n);
 
   explicit Table(Rep* rep) : rep_(rep) {}
 
@@ -73,8 +90,86 @@ class LEVELDB_EXPORT Table {
                      void (*handle_result)(void* arg, const Slice& k,
                                            const Slice& v));
 
-  void ReadMeta(const Footer& footer);
-  void ReadFilter(const Slice& filter_handle_value);
+  // Same as above, and if an entry is found, stores in *pin an iterator
+  // that keeps the found key and value valid until it is deleted, or else
+  // nullptr.
+  Status InternalGet(const ReadOptions&, const Slice& key, void* arg,
+                     void (*handle_result)(void* arg, const Slice& k,
+                                           const Slice& v),
+                     Iterator** pin);
+
+  // Same as calling InternalGet(options, keys[i], args[i], handle_result)
+  // for every i in [0, n), except that keys falling in the same data
+  // block share one read of that block, and the reads of all the blocks
+  // are in flight at the same time.  REQUIRES: keys are sorted.
+  Status InternalMultiGet(const ReadOptions&, const Slice* keys,
+                          void* const* args, int n,
+                          void (*handle_result)(void* arg, const Slice& k,
+                                                const Slice& v));
+
+  // Store in iters[i] a point lookup iterator over the data block at
+  // handles[i] for every i in [0, n).  Blocks missing from the block cache,
+  // the compressed block cache and the persistent cache are fetched with a
+  // single RandomAccessFile::MultiRead() call.
+  void ReadBlocks(const ReadOptions&, const BlockHandle* handles, int n,
+                  Iterator** iters) const;
+
+  // Returns an iterator over the block at "index_value", read through the
+  // block cache.  "data_block" tells whether the block may be compressed
+  // against the table's dictionary, and "lookup" whether the iterator is
+  // only for a point lookup (see Block::NewLookupIterator()).
+  Iterator* ReadBlockIterator(const ReadOptions&, const Slice& index_value,
+                              bool data_block, bool lookup) const;
+
+  // Reads the block at "handle" like ReadBlock(), looking it up in the
+  // compressed block cache and the persistent cache first.  "data_block"
+  // is as for ReadBlockIterator().
+  Status ReadBlockContents(const ReadOptions&, const BlockHandle& handle,
+                           bool data_block, BlockContents* contents) const;
+
+  // Like DecodeBlock(), and if the block could be decoded, adds it to the
+  // compressed block cache (when compressed) and to the persistent cache.
+  Status DecodeBlockContents(const ReadOptions&, const BlockHandle& handle,
+                             const Slice& raw, char* buf, bool data_block,
+                             BlockContents* contents) const;
+
+  // If the compressed block cache or else the persistent cache holds the
+  // block at "handle", returns a new[] copy of its on-disk form (with the
+  // trailer), else nullptr.  A compressed block found in the persistent
+  // cache is added to the compressed block cache.
+  char* LookupRawBlock(const ReadOptions&, const BlockHandle& handle) const;
+
+  // Returns an iterator over the index entries of all data blocks, which
+  // reads the index partitions on demand if the index is partitioned.
+  Iterator* NewIndexIterator(const ReadOptions&) const;
+
+  // Returns false if the table's full filter says that it holds no key
+  // with the prefix of "target".  True if it has no full filter or no
+  // prefix entries in its filter.
+  bool PrefixMayMatch(const Slice& target) const;
+
+  // Probes the filter partition that covers "partition_key" for "key",
+  // looking it up in "filter_index".
+  bool PartitionedFilterMayMatch(const ReadOptions&, Block* filter_index,
+                                 const Slice& partition_key,
+                                 const Slice& key) const;
+
+  // Returns the filter of the table, or nullptr if it has none or it
+  // cannot be read.  Sets "*cache_handle" to the handle to pass to
+  // ReleaseCacheHandle() when done with the filter.
+  const Filter* GetFilter(Cache::Handle** cache_handle) const;
+  void ReleaseCacheHandle(Cache::Handle* cache_handle) const;
+
+  // Read the index block and filter through the block cache, inserting
+  // them if missing.
+  Status ReadCachedIndexBlock(const ReadOptions&,
+                              Cache::Handle** cache_handle) const;
+  Cache::Handle* ReadCachedFilter() const;
+
+  Status ReadIndexBlock(bool pin);
+  Status ReadMeta(const Footer& footer, bool pin);
+  Filter* LoadFilter() const;
+  Status ReadCompressionDict(const Slice& dict_handle_value);
 
   Rep* const rep_;
 };
@@ -84,6 +84,9 @@ class LEVELDB_EXPORT TableBuilder {
 
  private:
   bool ok() const { return status().ok(); }
+  void AddToBlocks(const Slice& key, const Slice& value);
+  void TrainDictionary();
+  void CutIndexPartition();
   void WriteBlock(BlockBuilder* block, BlockHandle* handle);
   void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
 
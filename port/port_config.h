@@ -30,4 +30,14 @@
 //#cmakedefine01 HAVE_SNAPPY
 #endif  // !defined(HAVE_SNAPPY)
 
+// Define to 1 if you have Zstd.
+#if !defined(HAVE_ZSTD)
+//#cmakedefine01 HAVE_ZSTD
+#endif  // !defined(HAVE_ZSTD)
+
+// Define to 1 if you have LZ4.
+#if !defined(HAVE_LZ4)
+//#cmakedefine01 HAVE_LZ4
+#endif  // !defined(HAVE_LZ4)
+
 #endif  // STORAGE_LEVELDB_PORT_PORT_CONFIG_H_
\ No newline at end of file
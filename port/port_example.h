@@ -81,6 +81,72 @@ bool Snappy_GetUncompressedLength(const char* input, size_t length,
 bool Snappy_Uncompress(const char* input_data, size_t input_length,
                        char* output);
 
+// Store the zstd compression of "input[0,input_length-1]" at compression
+// level "level" in *output.  Returns false if zstd is not supported by
+// this port.
+bool Zstd_Compress(int level, const char* input, size_t input_length,
+                   std::string* output);
+
+// If input[0,input_length-1] looks like a valid zstd compressed
+// buffer, store the size of the uncompressed data in *result and
+// return true.  Else return false.
+bool Zstd_GetUncompressedLength(const char* input, size_t length,
+                                size_t* result);
+
+// Attempt to zstd uncompress input[0,input_length-1] into *output.
+// Returns true if successful, false if the input is invalid zstd
+// compressed data.
+//
+// REQUIRES: at least the first "n" bytes of output[] must be writable
+// where "n" is the result of a successful call to
+// Zstd_GetUncompressedLength.
+bool Zstd_Uncompress(const char* input_data, size_t input_length,
+                     char* output);
+
+// Train a zstd dictionary of at most "max_dict_bytes" bytes from the
+// samples stored back to back in "samples", "sample_sizes[i]" bytes each,
+// and store it in *dict.  Returns false if training fails or zstd is not
+// supported by this port.
+bool Zstd_TrainDictionary(const std::string& samples,
+                          const std::vector<size_t>& sample_sizes,
+                          size_t max_dict_bytes, std::string* dict);
+
+// A zstd dictionary digested for compression at one compression level.
+// Not thread safe.
+class ZstdCompressionDict {
+ public:
+  ZstdCompressionDict(const char* dict, size_t length, int level);
+  ~ZstdCompressionDict();
+
+  // Same as Zstd_Compress(), but compresses against the dictionary.
+  bool Compress(const char* input, size_t input_length, std::string* output);
+};
+
+// A zstd dictionary digested for decompression.  Thread safe.
+class ZstdUncompressionDict {
+ public:
+  ZstdUncompressionDict(const char* dict, size_t length);
+  ~ZstdUncompressionDict();
+
+  // Same as Zstd_Uncompress(), for input compressed against the
+  // dictionary.
+  bool Uncompress(const char* input_data, size_t input_length,
+                  char* output) const;
+};
+
+// Store the LZ4 block compression of "input[0,input_length-1]" in *output.
+// The result does not record the uncompressed length; callers must keep
+// it themselves.  Returns false if LZ4 is not supported by this port.
+bool Lz4_Compress(const char* input, size_t input_length,
+                  std::string* output);
+
+// Attempt to LZ4 uncompress input[0,input_length-1] into
+// output[0,output_length-1], where "output_length" is the exact length of
+// the uncompressed data.  Returns true if successful, false if the input
+// is invalid LZ4 compressed data.
+bool Lz4_Uncompress(const char* input_data, size_t input_length,
+                    char* output, size_t output_length);
+
 // ------------------ Miscellaneous -------------------
 
 // If heap profiling is not supported, returns false.
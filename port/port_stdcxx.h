@@ -28,13 +28,22 @@
 #if HAVE_SNAPPY
 #include <snappy.h>
 #endif  // HAVE_SNAPPY
+#if HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif  // HAVE_ZSTD
+#if HAVE_LZ4
+#include <lz4.h>
+#endif  // HAVE_LZ4
 
 #include <cassert>
 #include <condition_variable>  // NOLINT
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
+#include <vector>
 
 #include "port/thread_annotations.h"
 
@@ -126,6 +135,246 @@ inline bool Snappy_Uncompress(const char* input, size_t length, char* output) {
 #endif  // HAVE_SNAPPY
 }
 
+inline bool Zstd_Compress(int level, const char* input, size_t length,
+                          std::string* output) {
+#if HAVE_ZSTD
+  output->resize(ZSTD_compressBound(length));
+  size_t outlen =
+      ZSTD_compress(&(*output)[0], output->size(), input, length, level);
+  if (ZSTD_isError(outlen)) {
+    return false;
+  }
+  output->resize(outlen);
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)level;
+  (void)input;
+  (void)length;
+  (void)output;
+  return false;
+#endif  // HAVE_ZSTD
+}
+
+inline bool Zstd_GetUncompressedLength(const char* input, size_t length,
+                                       size_t* result) {
+#if HAVE_ZSTD
+  unsigned long long size = ZSTD_getFrameContentSize(input, length);
+  if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) {
+    return false;
+  }
+  *result = size;
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)result;
+  return false;
+#endif  // HAVE_ZSTD
+}
+
+inline bool Zstd_Uncompress(const char* input, size_t length, char* output) {
+#if HAVE_ZSTD
+  size_t outlen;
+  if (!Zstd_GetUncompressedLength(input, length, &outlen)) {
+    return false;
+  }
+  size_t result = ZSTD_decompress(output, outlen, input, length);
+  return !ZSTD_isError(result) && result == outlen;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)output;
+  return false;
+#endif  // HAVE_ZSTD
+}
+
+// Train a zstd dictionary of at most "max_dict_bytes" from the samples
+// stored back to back in "samples", "sample_sizes[i]" bytes each.
+inline bool Zstd_TrainDictionary(const std::string& samples,
+                                 const std::vector<size_t>& sample_sizes,
+                                 size_t max_dict_bytes, std::string* dict) {
+#if HAVE_ZSTD
+  if (sample_sizes.empty()) {
+    return false;
+  }
+  dict->resize(max_dict_bytes);
+  size_t dict_size = ZDICT_trainFromBuffer(
+      &(*dict)[0], dict->size(), samples.data(), sample_sizes.data(),
+      static_cast<unsigned>(sample_sizes.size()));
+  if (ZDICT_isError(dict_size)) {
+    dict->clear();
+    return false;
+  }
+  dict->resize(dict_size);
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)samples;
+  (void)sample_sizes;
+  (void)max_dict_bytes;
+  (void)dict;
+  return false;
+#endif  // HAVE_ZSTD
+}
+
+// A zstd dictionary prepared for compressing at one compression level.
+// Not thread safe.
+class ZstdCompressionDict {
+ public:
+  ZstdCompressionDict(const char* dict, size_t length, int level) {
+#if HAVE_ZSTD
+    ctx_ = ZSTD_createCCtx();
+    cdict_ = ZSTD_createCDict(dict, length, level);
+#else
+    // Silence compiler warnings about unused arguments.
+    (void)dict;
+    (void)length;
+    (void)level;
+#endif  // HAVE_ZSTD
+  }
+
+  ZstdCompressionDict(const ZstdCompressionDict&) = delete;
+  ZstdCompressionDict& operator=(const ZstdCompressionDict&) = delete;
+
+  ~ZstdCompressionDict() {
+#if HAVE_ZSTD
+    ZSTD_freeCDict(cdict_);
+    ZSTD_freeCCtx(ctx_);
+#endif  // HAVE_ZSTD
+  }
+
+  // Same as Zstd_Compress(), using the dictionary.
+  bool Compress(const char* input, size_t length, std::string* output) {
+#if HAVE_ZSTD
+    if (ctx_ == nullptr || cdict_ == nullptr) {
+      return false;
+    }
+    output->resize(ZSTD_compressBound(length));
+    size_t outlen = ZSTD_compress_usingCDict(ctx_, &(*output)[0],
+                                             output->size(), input, length,
+                                             cdict_);
+    if (ZSTD_isError(outlen)) {
+      return false;
+    }
+    output->resize(outlen);
+    return true;
+#else
+    // Silence compiler warnings about unused arguments.
+    (void)input;
+    (void)length;
+    (void)output;
+    return false;
+#endif  // HAVE_ZSTD
+  }
+
+ private:
+#if HAVE_ZSTD
+  ZSTD_CCtx* ctx_;
+  ZSTD_CDict* cdict_;
+#endif  // HAVE_ZSTD
+};
+
+// A zstd dictionary prepared for decompression.  Thread safe.
+class ZstdUncompressionDict {
+ public:
+  ZstdUncompressionDict(const char* dict, size_t length) {
+#if HAVE_ZSTD
+    ddict_ = ZSTD_createDDict(dict, length);
+#else
+    // Silence compiler warnings about unused arguments.
+    (void)dict;
+    (void)length;
+#endif  // HAVE_ZSTD
+  }
+
+  ZstdUncompressionDict(const ZstdUncompressionDict&) = delete;
+  ZstdUncompressionDict& operator=(const ZstdUncompressionDict&) = delete;
+
+  ~ZstdUncompressionDict() {
+#if HAVE_ZSTD
+    ZSTD_freeDDict(ddict_);
+#endif  // HAVE_ZSTD
+  }
+
+  // Same as Zstd_Uncompress(), using the dictionary.
+  bool Uncompress(const char* input, size_t length, char* output) const {
+#if HAVE_ZSTD
+    size_t outlen;
+    if (ddict_ == nullptr ||
+        !Zstd_GetUncompressedLength(input, length, &outlen)) {
+      return false;
+    }
+    // Decompression contexts are expensive to create, so each thread keeps
+    // one for good.
+    static thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)>
+        ctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    if (ctx == nullptr) {
+      return false;
+    }
+    size_t result = ZSTD_decompress_usingDDict(ctx.get(), output, outlen,
+                                               input, length, ddict_);
+    return !ZSTD_isError(result) && result == outlen;
+#else
+    // Silence compiler warnings about unused arguments.
+    (void)input;
+    (void)length;
+    (void)output;
+    return false;
+#endif  // HAVE_ZSTD
+  }
+
+ private:
+#if HAVE_ZSTD
+  ZSTD_DDict* ddict_;
+#endif  // HAVE_ZSTD
+};
+
+inline bool Lz4_Compress(const char* input, size_t length,
+                         std::string* output) {
+#if HAVE_LZ4
+  if (length > LZ4_MAX_INPUT_SIZE) {
+    return false;
+  }
+  output->resize(LZ4_compressBound(static_cast<int>(length)));
+  int outlen = LZ4_compress_default(input, &(*output)[0],
+                                    static_cast<int>(length),
+                                    static_cast<int>(output->size()));
+  if (outlen <= 0) {
+    return false;
+  }
+  output->resize(outlen);
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)output;
+  return false;
+#endif  // HAVE_LZ4
+}
+
+inline bool Lz4_Uncompress(const char* input, size_t length, char* output,
+                           size_t output_length) {
+#if HAVE_LZ4
+  if (length > LZ4_MAX_INPUT_SIZE || output_length > LZ4_MAX_INPUT_SIZE) {
+    return false;
+  }
+  int outlen = LZ4_decompress_safe(input, output, static_cast<int>(length),
+                                   static_cast<int>(output_length));
+  return outlen >= 0 && static_cast<size_t>(outlen) == output_length;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)output;
+  (void)output_length;
+  return false;
+#endif  // HAVE_LZ4
+}
+
 inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
   // Silence compiler warnings about unused arguments.
   (void)func;
@@ -11,31 +11,49 @@
 #include <vector>
 
 #include "leveldb/comparator.h"
+#include "table/block_builder.h"
 #include "table/format.h"
 #include "util/coding.h"
+#include "util/hash.h"
 #include "util/logging.h"
 
 namespace leveldb {
 
-inline uint32_t Block::NumRestarts() const {
-  assert(size_ >= sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
-}
-
 Block::Block(const BlockContents& contents)
     : data_(contents.data.data()),
       size_(contents.data.size()),
+      num_restarts_(0),
+      hash_index_(nullptr),
+      num_buckets_(0),
       owned_(contents.heap_allocated) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
-  } else {
-    size_t max_restarts_allowed = (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
-    if (NumRestarts() > max_restarts_allowed) {
-      // The size is too small for NumRestarts()
+    return;
+  }
+  num_restarts_ = DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  // End of the restart array
+  size_t restarts_end = size_ - sizeof(uint32_t);
+  if ((num_restarts_ & kHashIndexFlag) != 0) {
+    num_restarts_ &= ~kHashIndexFlag;
+    if (restarts_end < sizeof(uint32_t)) {
       size_ = 0;
-    } else {
-      restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+      return;
+    }
+    num_buckets_ = DecodeFixed32(data_ + restarts_end - sizeof(uint32_t));
+    restarts_end -= sizeof(uint32_t);
+    if (num_buckets_ == 0 || num_buckets_ > restarts_end) {
+      size_ = 0;
+      return;
     }
+    restarts_end -= num_buckets_;
+    hash_index_ = data_ + restarts_end;
+  }
+  size_t max_restarts_allowed = restarts_end / sizeof(uint32_t);
+  if (num_restarts_ > max_restarts_allowed) {
+    // The size is too small for num_restarts_
+    size_ = 0;
+  } else {
+    restart_offset_ = restarts_end - num_restarts_ * sizeof(uint32_t);
   }
 }
 
@@ -92,6 +110,9 @@ class Block::Iter : public Iterator {
   const char* const data_;       // underlying block contents
   uint32_t const restarts_;      // Offset of restart array (list of fixed32)
   uint32_t const num_restarts_;  // Number of uint32_t entries in restart array
+  // Hash index buckets, if Seek() is to use them
+  const char* const hash_index_;
+  uint32_t const num_buckets_;
 
   // current_ is offset in data_ of current entry.  >= restarts_ if !Valid
   // 遍历时，记录当前entity
@@ -131,11 +152,13 @@ class Block::Iter : public Iterator {
 
  public:
   Iter(const Comparator* comparator, const char* data, uint32_t restarts,
-       uint32_t num_restarts)
+       uint32_t num_restarts, const char* hash_index, uint32_t num_buckets)
       : comparator_(comparator),
         data_(data),
         restarts_(restarts),
         num_restarts_(num_restarts),
+        hash_index_(hash_index),
+        num_buckets_(num_buckets),
         current_(restarts_),
         restart_index_(num_restarts_) {
     assert(num_restarts_ > 0);
@@ -185,6 +208,10 @@ class Block::Iter : public Iterator {
    * Seek应该是Block::Iter最重要的一个接口，用于查找第一个 >= target的 entry。
    */
   void Seek(const Slice& target) override {
+    if (hash_index_ != nullptr && SeekWithHashIndex(target)) {
+      return;
+    }
+
     // Binary search in restart array to find the last restart point
     // with a key < target
     uint32_t left = 0;
@@ -268,6 +295,37 @@ class Block::Iter : public Iterator {
   }
 
  private:
+  // Positions the iterator like Seek() if the hash index has an entry for
+  // the hash key of "target", or past the end if it knows there is none.
+  // Returns false if a binary search is needed.
+  bool SeekWithHashIndex(const Slice& target) {
+    Slice hash_key;
+    if (!comparator_->ExtractHashKey(target, &hash_key)) {
+      return false;
+    }
+    const uint32_t h = Hash(hash_key.data(), hash_key.size(), kHashIndexSeed);
+    const uint8_t entry =
+        static_cast<uint8_t>(hash_index_[h % num_buckets_]);
+    if (entry == kHashIndexCollision) {
+      return false;
+    }
+    if (entry == kHashIndexNoEntry || entry >= num_restarts_) {
+      // No key with that hash key
+      current_ = restarts_;
+      restart_index_ = num_restarts_;
+      return true;
+    }
+    // Linear search from the restart point before the first key with
+    // that hash key.
+    SeekToRestartPoint(entry);
+    while (ParseNextKey()) {
+      if (Compare(key_, target) >= 0) {
+        break;
+      }
+    }
+    return true;
+  }
+
   void CorruptionError() {
     current_ = restarts_;
     restart_index_ = num_restarts_;
@@ -317,11 +375,23 @@ Iterator* Block::NewIterator(const Comparator* comparator) {
     return NewErrorIterator(Status::Corruption("bad block contents"));
   }
   //读取block中最后的32个字节，获取restart_offset数组的个数。
-  const uint32_t num_restarts = NumRestarts();
-  if (num_restarts == 0) {
+  if (num_restarts_ == 0) {
+    return NewEmptyIterator();
+  } else {
+    return new Iter(comparator, data_, restart_offset_, num_restarts_, nullptr,
+                    0);
+  }
+}
+
+Iterator* Block::NewLookupIterator(const Comparator* comparator) {
+  if (size_ < sizeof(uint32_t)) {
+    return NewErrorIterator(Status::Corruption("bad block contents"));
+  }
+  if (num_restarts_ == 0) {
     return NewEmptyIterator();
   } else {
-    return new Iter(comparator, data_, restart_offset_, num_restarts);
+    return new Iter(comparator, data_, restart_offset_, num_restarts_,
+                    hash_index_, num_buckets_);
   }
 }
 
@@ -28,17 +28,25 @@ class Block {
   size_t size() const { return size_; }
   Iterator* NewIterator(const Comparator* comparator);
 
+  // Same as NewIterator(), for point lookups: if the block has a hash
+  // index, Seek(target) uses it to find the keys with the hash key of
+  // "target", and may leave the iterator invalid, or at a key with
+  // another hash key, if there are none.
+  Iterator* NewLookupIterator(const Comparator* comparator);
+
  private:
   class Iter;
 
-  uint32_t NumRestarts() const;
-
   //block的起始地址
   const char* data_;
   size_t size_;
   //restart_offset_的数组的起始地址
   uint32_t restart_offset_;  // Offset in data_ of restart array
-  bool owned_;               // Block owns data_[]
+  uint32_t num_restarts_;
+  // Buckets of the hash index, or nullptr if the block has none.
+  const char* hash_index_;
+  uint32_t num_buckets_;
+  bool owned_;  // Block owns data_[]
 };
 
 }  // namespace leveldb
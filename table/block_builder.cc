@@ -23,8 +23,16 @@
 //
 // The trailer of the block has the form:
 //     restarts: uint32[num_restarts]
+//     hash_index: uint8[num_buckets]    (optional)
+//     num_buckets: uint32               (optional)
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+//
+// The top bit of num_restarts tells whether the block has a hash index.
+// Bucket h % num_buckets of the hash index holds the index of the restart
+// point before the first key whose hash key hashes to h, or
+// kHashIndexNoEntry if there is no such key, or kHashIndexCollision if
+// such keys follow different restart points.
 
 #include "table/block_builder.h"
 
@@ -34,11 +42,16 @@
 #include "leveldb/comparator.h"
 #include "leveldb/options.h"
 #include "util/coding.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
 BlockBuilder::BlockBuilder(const Options* options)
-    : options_(options), restarts_(), counter_(0), finished_(false) {
+    : options_(options),
+      restarts_(),
+      counter_(0),
+      finished_(false),
+      hash_index_(false) {
   //不成立就报错
   assert(options->block_restart_interval >= 1);
   restarts_.push_back(0);  // First restart point is at offset 0
@@ -51,12 +64,35 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  hash_index_ = false;
+  hash_entries_.clear();
+}
+
+// Range that Options::data_block_hash_table_util_ratio is clipped to.
+static const double kMinHashTableUtilRatio = 0.1;
+static const double kMaxHashTableUtilRatio = 1.0;
+
+size_t BlockBuilder::NumHashBuckets() const {
+  // Keep the ratio in the documented range; the negated comparison also
+  // catches NaN.
+  double ratio = options_->data_block_hash_table_util_ratio;
+  if (!(ratio >= kMinHashTableUtilRatio)) {
+    ratio = kMinHashTableUtilRatio;
+  } else if (ratio > kMaxHashTableUtilRatio) {
+    ratio = kMaxHashTableUtilRatio;
+  }
+  const size_t n = static_cast<size_t>(hash_entries_.size() / ratio);
+  return std::max<size_t>(n, 1);
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
-  return (buffer_.size() +                       // Raw data buffer
-          restarts_.size() * sizeof(uint32_t) +  // Restart array
-          sizeof(uint32_t));                     // Restart array length
+  size_t estimate = (buffer_.size() +                       // Raw data buffer
+                     restarts_.size() * sizeof(uint32_t) +  // Restart array
+                     sizeof(uint32_t));  // Restart array length
+  if (hash_index_) {
+    estimate += NumHashBuckets() + sizeof(uint32_t);
+  }
+  return estimate;
 }
 
 /**
@@ -68,7 +104,24 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, restarts_.size());
+  uint32_t num_restarts = restarts_.size();
+  if (hash_index_ && restarts_.size() <= kHashIndexMaxRestarts) {
+    // Append hash index
+    const size_t num_buckets = NumHashBuckets();
+    std::string buckets(num_buckets, static_cast<char>(kHashIndexNoEntry));
+    for (const auto& entry : hash_entries_) {
+      char& bucket = buckets[entry.first % num_buckets];
+      if (bucket == static_cast<char>(kHashIndexNoEntry)) {
+        bucket = static_cast<char>(entry.second);
+      } else if (bucket != static_cast<char>(entry.second)) {
+        bucket = static_cast<char>(kHashIndexCollision);
+      }
+    }
+    buffer_.append(buckets);
+    PutFixed32(&buffer_, num_buckets);
+    num_restarts |= kHashIndexFlag;
+  }
+  PutFixed32(&buffer_, num_restarts);
   finished_ = true;
   return Slice(buffer_);
 }
@@ -85,6 +138,12 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   //options_->comparator->Compare(key, last_key_piece) > 0 保证后面的key大于前面的key
   assert(buffer_.empty()  // No values yet?
          || options_->comparator->Compare(key, last_key_piece) > 0);
+  if (buffer_.empty()) {
+    // The hash index is all or nothing for a block.
+    Slice hash_key;
+    hash_index_ = options_->data_block_hash_index &&
+                  options_->comparator->ExtractHashKey(key, &hash_key);
+  }
   size_t shared = 0;
   if (counter_ < options_->block_restart_interval) {
     // See how much sharing to do with previous string
@@ -100,6 +159,20 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
+  if (hash_index_) {
+    // Only the first of the keys sharing a hash key is indexed, since
+    // lookups scan forward from the restart point found.
+    Slice hash_key, last_hash_key;
+    options_->comparator->ExtractHashKey(key, &hash_key);
+    if (buffer_.empty() ||
+        !options_->comparator->ExtractHashKey(last_key_piece, &last_hash_key) ||
+        hash_key != last_hash_key) {
+      hash_entries_.emplace_back(
+          Hash(hash_key.data(), hash_key.size(), kHashIndexSeed),
+          restarts_.size() - 1);
+    }
+  }
+
   // Add "<shared><non_shared><value_size>" to buffer_
   PutVarint32(&buffer_, shared);
   PutVarint32(&buffer_, non_shared);
@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_TABLE_BLOCK_BUILDER_H_
 
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "leveldb/slice.h"
@@ -14,6 +15,13 @@ namespace leveldb {
 
 struct Options;
 
+// Hash index of data blocks: see block_builder.cc for the format.
+static const uint32_t kHashIndexFlag = 1u << 31;  // In num_restarts
+static const uint32_t kHashIndexSeed = 0x5bd1e995;
+static const uint8_t kHashIndexNoEntry = 255;
+static const uint8_t kHashIndexCollision = 254;
+static const size_t kHashIndexMaxRestarts = 253;
+
 class BlockBuilder {
  public:
   explicit BlockBuilder(const Options* options);
@@ -48,6 +56,12 @@ class BlockBuilder {
   //表示这个块完成写入到sstable中
   bool finished_;                   // Has Finish() been called?
   std::string last_key_;
+  // Whether this block gets a hash index, and its (hash, restart index)
+  // entries.
+  bool hash_index_;
+  std::vector<std::pair<uint32_t, uint32_t>> hash_entries_;
+
+  size_t NumHashBuckets() const;
 };
 
 }  // namespace leveldb
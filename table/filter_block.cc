@@ -5,6 +5,7 @@
 #include "table/filter_block.h"
 
 #include "leveldb/filter_policy.h"
+#include "leveldb/slice_transform.h"
 #include "util/coding.h"
 
 namespace leveldb {
@@ -15,8 +16,54 @@ namespace leveldb {
 static const size_t kFilterBaseLg = 11;
 static const size_t kFilterBase = 1 << kFilterBaseLg;
 
-FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy)
-    : policy_(policy) {}
+std::string FilterBlockName(const FilterPolicy* policy,
+                            const SliceTransform* prefix_extractor,
+                            FilterBlockType type) {
+  std::string name;
+  switch (type) {
+    case kPerBlockFilter:
+      name = "filter.";
+      break;
+    case kFullFilter:
+      name = "fullfilter.";
+      break;
+    case kPartitionedFilter:
+      name = "partitionedfilter.";
+      break;
+  }
+  name.append(policy->Name());
+  if (prefix_extractor != nullptr) {
+    name.push_back('+');
+    name.append(prefix_extractor->Name());
+  }
+  return name;
+}
+
+void PrefixCollector::Add(const Slice& prefix) {
+  if (!start_.empty() &&
+      Slice(prefixes_.data() + start_.back(),
+            prefixes_.size() - start_.back()) == prefix) {
+    return;  // Keys are sorted, so only the last prefix can repeat
+  }
+  start_.push_back(prefixes_.size());
+  prefixes_.append(prefix.data(), prefix.size());
+}
+
+void PrefixCollector::AppendTo(std::vector<Slice>* keys) const {
+  for (size_t i = 0; i < start_.size(); i++) {
+    size_t limit = (i + 1 < start_.size()) ? start_[i + 1] : prefixes_.size();
+    keys->push_back(Slice(prefixes_.data() + start_[i], limit - start_[i]));
+  }
+}
+
+void PrefixCollector::Clear() {
+  prefixes_.clear();
+  start_.clear();
+}
+
+FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy,
+                                       const SliceTransform* prefix_extractor)
+    : policy_(policy), prefix_extractor_(prefix_extractor) {}
 
 void FilterBlockBuilder::StartBlock(uint64_t block_offset) {
   uint64_t filter_index = (block_offset / kFilterBase);
@@ -30,6 +77,9 @@ void FilterBlockBuilder::AddKey(const Slice& key) {
   Slice k = key;
   start_.push_back(keys_.size());
   keys_.append(k.data(), k.size());
+  if (prefix_extractor_ != nullptr && prefix_extractor_->InDomain(k)) {
+    prefixes_.Add(prefix_extractor_->Transform(k));
+  }
 }
 
 Slice FilterBlockBuilder::Finish() {
@@ -64,14 +114,17 @@ void FilterBlockBuilder::GenerateFilter() {
     size_t length = start_[i + 1] - start_[i];
     tmp_keys_[i] = Slice(base, length);
   }
+  prefixes_.AppendTo(&tmp_keys_);
 
   // Generate filter for current set of keys and append to result_.
   filter_offsets_.push_back(result_.size());
-  policy_->CreateFilter(&tmp_keys_[0], static_cast<int>(num_keys), &result_);
+  policy_->CreateFilter(&tmp_keys_[0], static_cast<int>(tmp_keys_.size()),
+                        &result_);
 
   tmp_keys_.clear();
   keys_.clear();
   start_.clear();
+  prefixes_.Clear();
 }
 
 FilterBlockReader::FilterBlockReader(const FilterPolicy* policy,
@@ -103,4 +156,46 @@ bool FilterBlockReader::KeyMayMatch(uint64_t block_offset, const Slice& key) {
   return true;  // Errors are treated as potential matches
 }
 
+FullFilterBlockBuilder::FullFilterBlockBuilder(
+    const FilterPolicy* policy, const SliceTransform* prefix_extractor)
+    : policy_(policy), prefix_extractor_(prefix_extractor) {}
+
+void FullFilterBlockBuilder::AddKey(const Slice& key) {
+  start_.push_back(keys_.size());
+  keys_.append(key.data(), key.size());
+  if (prefix_extractor_ != nullptr && prefix_extractor_->InDomain(key)) {
+    prefixes_.Add(prefix_extractor_->Transform(key));
+  }
+}
+
+Slice FullFilterBlockBuilder::Finish() {
+  const size_t num_keys = start_.size();
+  if (num_keys > 0) {
+    start_.push_back(keys_.size());  // Simplify length computation
+    std::vector<Slice> tmp_keys(num_keys);
+    for (size_t i = 0; i < num_keys; i++) {
+      tmp_keys[i] = Slice(keys_.data() + start_[i], start_[i + 1] - start_[i]);
+    }
+    prefixes_.AppendTo(&tmp_keys);
+    policy_->CreateFilter(&tmp_keys[0], static_cast<int>(tmp_keys.size()),
+                          &result_);
+  }
+  keys_.clear();
+  start_.clear();
+  prefixes_.Clear();
+  return Slice(result_);
+}
+
+FullFilterBlockReader::FullFilterBlockReader(const FilterPolicy* policy,
+                                             const Slice& contents)
+    : policy_(policy), filter_(contents) {}
+
+bool FullFilterBlockReader::KeyMayMatch(const Slice& key) {
+  if (filter_.empty()) {
+    // Empty filters do not match any keys
+    return false;
+  }
+  return policy_->KeyMayMatch(key, filter_);
+}
+
 }  // namespace leveldb
@@ -5,6 +5,14 @@
 // A filter block is stored near the end of a Table file.  It contains
 // filters (e.g., bloom filters) for all data blocks in the table combined
 // into a single filter block.
+//
+// A full filter block instead holds one filter built from every key in
+// the table, so that it can be probed without knowing which data block
+// the key would be in.
+//
+// If the table is built with a prefix extractor, the filters also hold the
+// prefix of every key in its domain, so that a seek can skip the blocks
+// and tables that hold no key with the prefix it is looking for.
 
 #ifndef STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
 #define STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
@@ -20,6 +28,41 @@
 namespace leveldb {
 
 class FilterPolicy;
+class SliceTransform;
+
+// The kinds of filter a table may have.
+enum FilterBlockType {
+  kPerBlockFilter,     // One filter per 2KB of data blocks
+  kFullFilter,         // One filter over the whole table
+  kPartitionedFilter,  // One filter per index partition
+};
+
+// Returns the metaindex key of the filter block written by "policy":
+// "filter.<policy>" for per-block filters, "fullfilter.<policy>" for a
+// full filter or "partitionedfilter.<policy>" for the top-level index of
+// partitioned filters, followed by "+<transform>" if the filters also hold
+// the prefixes produced by "prefix_extractor".  Readers configured
+// differently do not find the block and go without the filter.
+std::string FilterBlockName(const FilterPolicy* policy,
+                            const SliceTransform* prefix_extractor,
+                            FilterBlockType type);
+
+// Collects the distinct prefixes of a sorted sequence of keys.  They are
+// handed to the filter policy after all of the keys, so that the keys and
+// the prefixes each stay sorted and any duplicates the policy is given
+// are adjacent.
+class PrefixCollector {
+ public:
+  void Add(const Slice& prefix);
+  // Appends the collected prefixes to *keys, which must not outlive the
+  // next call to Clear().
+  void AppendTo(std::vector<Slice>* keys) const;
+  void Clear();
+
+ private:
+  std::string prefixes_;       // Flattened prefix contents
+  std::vector<size_t> start_;  // Starting index in prefixes_ of each prefix
+};
 
 // A FilterBlockBuilder is used to construct all of the filters for a
 // particular Table.  It generates a single string which is stored as
@@ -29,7 +72,10 @@ class FilterPolicy;
 //      (StartBlock AddKey*)* Finish
 class FilterBlockBuilder {
  public:
-  explicit FilterBlockBuilder(const FilterPolicy*);
+  // If "prefix_extractor" is non-null, AddKey() also adds the prefix of
+  // each key in its domain.
+  explicit FilterBlockBuilder(const FilterPolicy*,
+                              const SliceTransform* prefix_extractor = nullptr);
 
   FilterBlockBuilder(const FilterBlockBuilder&) = delete;
   FilterBlockBuilder& operator=(const FilterBlockBuilder&) = delete;
@@ -42,8 +88,10 @@ class FilterBlockBuilder {
   void GenerateFilter();
 
   const FilterPolicy* policy_;
+  const SliceTransform* prefix_extractor_;
   std::string keys_;             // Flattened key contents
   std::vector<size_t> start_;    // Starting index in keys_ of each key
+  PrefixCollector prefixes_;     // Prefixes of the keys in keys_
   std::string result_;           // Filter data computed so far
   std::vector<Slice> tmp_keys_;  // policy_->CreateFilter() argument
   std::vector<uint32_t> filter_offsets_;
@@ -63,6 +111,42 @@ class FilterBlockReader {
   size_t base_lg_;      // Encoding parameter (see kFilterBaseLg in .cc file)
 };
 
+// A FullFilterBlockBuilder builds a single filter over all of the keys of
+// a Table.
+//
+// The sequence of calls to FullFilterBlockBuilder must match the regexp:
+//      AddKey* Finish
+class FullFilterBlockBuilder {
+ public:
+  explicit FullFilterBlockBuilder(
+      const FilterPolicy*, const SliceTransform* prefix_extractor = nullptr);
+
+  FullFilterBlockBuilder(const FullFilterBlockBuilder&) = delete;
+  FullFilterBlockBuilder& operator=(const FullFilterBlockBuilder&) = delete;
+
+  void AddKey(const Slice& key);
+  Slice Finish();
+
+ private:
+  const FilterPolicy* policy_;
+  const SliceTransform* prefix_extractor_;
+  std::string keys_;           // Flattened key contents
+  std::vector<size_t> start_;  // Starting index in keys_ of each key
+  PrefixCollector prefixes_;   // Prefixes of the keys in keys_
+  std::string result_;         // Filter data
+};
+
+class FullFilterBlockReader {
+ public:
+  // REQUIRES: "contents" and *policy must stay live while *this is live.
+  FullFilterBlockReader(const FilterPolicy* policy, const Slice& contents);
+  bool KeyMayMatch(const Slice& key);
+
+ private:
+  const FilterPolicy* policy_;
+  Slice filter_;
+};
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
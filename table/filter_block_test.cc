@@ -6,6 +6,7 @@
 
 #include "gtest/gtest.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/slice_transform.h"
 #include "util/coding.h"
 #include "util/hash.h"
 #include "util/logging.h"
@@ -119,4 +120,62 @@ TEST_F(FilterBlockTest, MultiChunk) {
   ASSERT_TRUE(!reader.KeyMayMatch(9000, "bar"));
 }
 
+TEST_F(FilterBlockTest, FullFilterEmptyBuilder) {
+  FullFilterBlockBuilder builder(&policy_);
+  Slice block = builder.Finish();
+  ASSERT_EQ("", EscapeString(block));
+  FullFilterBlockReader reader(&policy_, block);
+  ASSERT_TRUE(!reader.KeyMayMatch("foo"));
+}
+
+TEST_F(FilterBlockTest, FullFilter) {
+  FullFilterBlockBuilder builder(&policy_);
+  builder.AddKey("foo");
+  builder.AddKey("bar");
+  builder.AddKey("box");
+  builder.AddKey("hello");
+  Slice block = builder.Finish();
+  FullFilterBlockReader reader(&policy_, block);
+  ASSERT_TRUE(reader.KeyMayMatch("foo"));
+  ASSERT_TRUE(reader.KeyMayMatch("bar"));
+  ASSERT_TRUE(reader.KeyMayMatch("box"));
+  ASSERT_TRUE(reader.KeyMayMatch("hello"));
+  ASSERT_TRUE(!reader.KeyMayMatch("missing"));
+  ASSERT_TRUE(!reader.KeyMayMatch("other"));
+}
+
+TEST_F(FilterBlockTest, Prefixes) {
+  const SliceTransform* prefix_extractor = NewFixedPrefixTransform(3);
+  FilterBlockBuilder builder(&policy_, prefix_extractor);
+  builder.StartBlock(0);
+  builder.AddKey("foo1");
+  builder.AddKey("foo2");
+  builder.AddKey("go");  // Not in the domain
+  builder.StartBlock(3100);
+  builder.AddKey("hello");
+  Slice block = builder.Finish();
+  FilterBlockReader reader(&policy_, block);
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo1"));
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
+  ASSERT_TRUE(reader.KeyMayMatch(0, "go"));
+  ASSERT_TRUE(!reader.KeyMayMatch(0, "hel"));
+  ASSERT_TRUE(reader.KeyMayMatch(3100, "hel"));
+  ASSERT_TRUE(!reader.KeyMayMatch(3100, "foo"));
+
+  FullFilterBlockBuilder full_builder(&policy_, prefix_extractor);
+  full_builder.AddKey("foo1");
+  full_builder.AddKey("foo2");
+  full_builder.AddKey("hello");
+  Slice full_block = full_builder.Finish();
+  FullFilterBlockReader full_reader(&policy_, full_block);
+  ASSERT_TRUE(full_reader.KeyMayMatch("foo"));
+  ASSERT_TRUE(full_reader.KeyMayMatch("hel"));
+  ASSERT_TRUE(full_reader.KeyMayMatch("foo2"));
+  ASSERT_TRUE(!full_reader.KeyMayMatch("fo"));
+  ASSERT_TRUE(!full_reader.KeyMayMatch("bar"));
+  // Five entries: the three keys, then "foo" (only once) and "hel".
+  ASSERT_EQ(5 * 4, full_block.size());
+  delete prefix_extractor;
+}
+
 }  // namespace leveldb
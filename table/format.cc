@@ -72,7 +72,8 @@ Status Footer::DecodeFrom(Slice* input) {
 }
 
 Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
-                 const BlockHandle& handle, BlockContents* result) {
+                 const BlockHandle& handle, BlockContents* result,
+                 const port::ZstdUncompressionDict* dict) {
   result->data = Slice();
   result->cachable = false;
   result->heap_allocated = false;
@@ -87,6 +88,17 @@ Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
     delete[] buf;
     return s;
   }
+  return DecodeBlock(options, handle, contents, buf, result, dict);
+}
+
+Status DecodeBlock(const ReadOptions& options, const BlockHandle& handle,
+                   const Slice& contents, char* buf, BlockContents* result,
+                   const port::ZstdUncompressionDict* dict) {
+  result->data = Slice();
+  result->cachable = false;
+  result->heap_allocated = false;
+
+  size_t n = static_cast<size_t>(handle.size());
   if (contents.size() != n + kBlockTrailerSize) {
     delete[] buf;
     return Status::Corruption("truncated block read");
@@ -99,8 +111,7 @@ Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
     const uint32_t actual = crc32c::Value(data, n + 1);
     if (actual != crc) {
       delete[] buf;
-      s = Status::Corruption("block checksum mismatch");
-      return s;
+      return Status::Corruption("block checksum mismatch");
     }
   }
 
@@ -140,6 +151,46 @@ Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
       result->cachable = true;
       break;
     }
+    case kZstdCompression: {
+      size_t ulength = 0;
+      if (!port::Zstd_GetUncompressedLength(data, n, &ulength)) {
+        delete[] buf;
+        return Status::Corruption("corrupted zstd compressed block length");
+      }
+      char* ubuf = new char[ulength];
+      bool ok = (dict != nullptr) ? dict->Uncompress(data, n, ubuf)
+                                  : port::Zstd_Uncompress(data, n, ubuf);
+      if (!ok) {
+        delete[] buf;
+        delete[] ubuf;
+        return Status::Corruption("corrupted zstd compressed block contents");
+      }
+      delete[] buf;
+      result->data = Slice(ubuf, ulength);
+      result->heap_allocated = true;
+      result->cachable = true;
+      break;
+    }
+    case kLZ4Compression: {
+      // The uncompressed length precedes the LZ4 block.
+      uint32_t ulength;
+      const char* lz4 = GetVarint32Ptr(data, data + n, &ulength);
+      if (lz4 == nullptr) {
+        delete[] buf;
+        return Status::Corruption("corrupted lz4 compressed block length");
+      }
+      char* ubuf = new char[ulength];
+      if (!port::Lz4_Uncompress(lz4, data + n - lz4, ubuf, ulength)) {
+        delete[] buf;
+        delete[] ubuf;
+        return Status::Corruption("corrupted lz4 compressed block contents");
+      }
+      delete[] buf;
+      result->data = Slice(ubuf, ulength);
+      result->heap_allocated = true;
+      result->cachable = true;
+      break;
+    }
     default:
       delete[] buf;
       return Status::Corruption("bad block type");
@@ -14,6 +14,10 @@
 
 namespace leveldb {
 
+namespace port {
+class ZstdUncompressionDict;
+}  // namespace port
+
 class Block;
 class RandomAccessFile;
 struct ReadOptions;
@@ -92,6 +96,21 @@ static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
 // 1-byte type + 32-bit crc
 static const size_t kBlockTrailerSize = 5;
 
+// Name of the metaindex entry whose value is a random id that no other
+// table shares.  It keys the blocks of the table in a persistent cache.
+static const char kUniqueIdName[] = "uniqueid";
+
+// Length of the id of kUniqueIdName.
+static const size_t kUniqueIdLength = 16;
+
+// Name of the meta block holding the zstd dictionary the data blocks of
+// a table are compressed against, if any.
+static const char kZstdDictionaryBlockName[] = "zstd.dictionary";
+
+// Name of the (empty) meta block whose presence says that the entries of
+// the index block point to index partitions rather than to data blocks.
+static const char kPartitionedIndexBlockName[] = "partitionedindex";
+
 struct BlockContents {
   Slice data;           // Actual contents of data
   bool cachable;        // True iff data can be cached
@@ -99,9 +118,21 @@ struct BlockContents {
 };
 
 // Read the block identified by "handle" from "file".  On failure
-// return non-OK.  On success fill *result and return OK.
+// return non-OK.  On success fill *result and return OK.  "dict" is the
+// table's zstd dictionary, used if the block is zstd compressed; it may
+// be nullptr for blocks written without one.
 Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
-                 const BlockHandle& handle, BlockContents* result);
+                 const BlockHandle& handle, BlockContents* result,
+                 const port::ZstdUncompressionDict* dict = nullptr);
+
+// Check and uncompress the block identified by "handle", given the
+// "contents" produced by reading handle.size() + kBlockTrailerSize bytes
+// at handle.offset() into "buf".  Takes ownership of "buf", which must
+// have been allocated with new[].  On failure return non-OK.  On success
+// fill *result and return OK.  "dict" is as for ReadBlock().
+Status DecodeBlock(const ReadOptions& options, const BlockHandle& handle,
+                   const Slice& contents, char* buf, BlockContents* result,
+                   const port::ZstdUncompressionDict* dict = nullptr);
 
 // Implementation details follow.  Clients should ignore,
 
@@ -17,6 +17,8 @@ class MergingIterator : public Iterator {
       : comparator_(comparator),
         children_(new IteratorWrapper[n]),
         n_(n),
+        heap_(new IteratorWrapper*[n]),
+        heap_size_(0),
         current_(nullptr),
         direction_(kForward) {
     for (int i = 0; i < n; i++) {
@@ -24,7 +26,10 @@ class MergingIterator : public Iterator {
     }
   }
 
-  ~MergingIterator() override { delete[] children_; }
+  ~MergingIterator() override {
+    delete[] heap_;
+    delete[] children_;
+  }
 
   bool Valid() const override { return (current_ != nullptr); }
 
@@ -32,24 +37,24 @@ class MergingIterator : public Iterator {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToFirst();
     }
-    FindSmallest();
     direction_ = kForward;
+    BuildHeap();
   }
 
   void SeekToLast() override {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToLast();
     }
-    FindLargest();
     direction_ = kReverse;
+    BuildHeap();
   }
 
   void Seek(const Slice& target) override {
     for (int i = 0; i < n_; i++) {
       children_[i].Seek(target);
     }
-    FindSmallest();
     direction_ = kForward;
+    BuildHeap();
   }
 
   void Next() override {
@@ -72,10 +77,11 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kForward;
+      BuildHeap();
     }
 
     current_->Next();
-    FindSmallest();
+    UpdateTop();
   }
 
   void Prev() override {
@@ -101,10 +107,11 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kReverse;
+      BuildHeap();
     }
 
     current_->Prev();
-    FindLargest();
+    UpdateTop();
   }
 
   Slice key() const override {
@@ -132,48 +139,86 @@ class MergingIterator : public Iterator {
   // Which direction is the iterator moving?
   enum Direction { kForward, kReverse };
 
-  void FindSmallest();
-  void FindLargest();
+  // Returns true if "a" must be returned before "b" when moving in
+  // direction_.  Equal keys are returned in the order of children_ when
+  // moving forward and in the opposite order when moving backward.
+  bool Precedes(const IteratorWrapper* a, const IteratorWrapper* b) const {
+    const int r = comparator_->Compare(a->key(), b->key());
+    if (direction_ == kForward) {
+      return r < 0 || (r == 0 && a < b);
+    } else {
+      return r > 0 || (r == 0 && a > b);
+    }
+  }
+
+  // Rebuild the heap from all valid children and point current_ at the
+  // child that comes first in direction_.
+  void BuildHeap();
+
+  // Restore the heap after heap_[0] (== current_) has been moved.
+  void UpdateTop();
+
+  void SiftDown(int pos);
 
-  // We might want to use a heap in case there are lots of children.
-  // For now we use a simple array since we expect a very small number
-  // of children in leveldb.
   const Comparator* comparator_;
   IteratorWrapper* children_;
   int n_;
+
+  // The valid children, kept as a binary heap ordered by Precedes(), so
+  // that each step costs O(log n) comparisons instead of O(n).  Rebuilt
+  // whenever the direction changes.
+  IteratorWrapper** heap_;
+  int heap_size_;
+
   IteratorWrapper* current_;
   Direction direction_;
 };
 
-void MergingIterator::FindSmallest() {
-  IteratorWrapper* smallest = nullptr;
+void MergingIterator::BuildHeap() {
+  heap_size_ = 0;
   for (int i = 0; i < n_; i++) {
-    IteratorWrapper* child = &children_[i];
-    if (child->Valid()) {
-      if (smallest == nullptr) {
-        smallest = child;
-      } else if (comparator_->Compare(child->key(), smallest->key()) < 0) {
-        smallest = child;
-      }
+    if (children_[i].Valid()) {
+      heap_[heap_size_++] = &children_[i];
     }
   }
-  current_ = smallest;
+  for (int pos = heap_size_ / 2 - 1; pos >= 0; pos--) {
+    SiftDown(pos);
+  }
+  current_ = (heap_size_ > 0) ? heap_[0] : nullptr;
 }
 
-void MergingIterator::FindLargest() {
-  IteratorWrapper* largest = nullptr;
-  for (int i = n_ - 1; i >= 0; i--) {
-    IteratorWrapper* child = &children_[i];
-    if (child->Valid()) {
-      if (largest == nullptr) {
-        largest = child;
-      } else if (comparator_->Compare(child->key(), largest->key()) > 0) {
-        largest = child;
-      }
+void MergingIterator::UpdateTop() {
+  assert(heap_size_ > 0 && heap_[0] == current_);
+  if (!current_->Valid()) {
+    heap_[0] = heap_[--heap_size_];
+  }
+  if (heap_size_ > 0) {
+    SiftDown(0);
+    current_ = heap_[0];
+  } else {
+    current_ = nullptr;
+  }
+}
+
+void MergingIterator::SiftDown(int pos) {
+  IteratorWrapper* item = heap_[pos];
+  while (true) {
+    int child = 2 * pos + 1;
+    if (child >= heap_size_) {
+      break;
+    }
+    if (child + 1 < heap_size_ && Precedes(heap_[child + 1], heap_[child])) {
+      child++;
     }
+    if (!Precedes(heap_[child], item)) {
+      break;
+    }
+    heap_[pos] = heap_[child];
+    pos = child;
   }
-  current_ = largest;
+  heap_[pos] = item;
 }
+
 }  // namespace
 
 Iterator* NewMergingIterator(const Comparator* comparator, Iterator** children,
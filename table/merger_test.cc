@@ -0,0 +1,171 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "table/merger.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+namespace {
+
+// Iterates over a sorted vector of keys; every value is "v" + key.
+class VectorIterator : public Iterator {
+ public:
+  explicit VectorIterator(const std::vector<std::string>& keys)
+      : keys_(keys), pos_(keys.size()) {}
+
+  bool Valid() const override { return pos_ < keys_.size(); }
+  void SeekToFirst() override { pos_ = 0; }
+  void SeekToLast() override { pos_ = keys_.empty() ? 0 : keys_.size() - 1; }
+  void Seek(const Slice& target) override {
+    pos_ = std::lower_bound(keys_.begin(), keys_.end(), target.ToString()) -
+           keys_.begin();
+  }
+  void Next() override {
+    assert(Valid());
+    pos_++;
+  }
+  void Prev() override {
+    assert(Valid());
+    pos_ = (pos_ == 0) ? keys_.size() : pos_ - 1;
+  }
+  Slice key() const override {
+    assert(Valid());
+    return keys_[pos_];
+  }
+  Slice value() const override {
+    assert(Valid());
+    value_ = "v" + keys_[pos_];
+    return value_;
+  }
+  Status status() const override { return Status::OK(); }
+
+ private:
+  const std::vector<std::string> keys_;
+  size_t pos_;
+  mutable std::string value_;
+};
+
+}  // namespace
+
+class MergerTest : public testing::Test {
+ public:
+  // Distribute "n" distinct random keys over "num_children" children.
+  // Returns the merging iterator and stores all keys, sorted, in *model.
+  Iterator* NewMerger(Random* rnd, int num_children, int n,
+                      std::vector<std::string>* model) {
+    std::vector<std::vector<std::string>> keys(num_children);
+    model->clear();
+    while (model->size() < static_cast<size_t>(n)) {
+      std::string k;
+      test::RandomString(rnd, 1 + rnd->Uniform(8), &k);
+      if (std::find(model->begin(), model->end(), k) == model->end()) {
+        model->push_back(k);
+        keys[rnd->Uniform(num_children)].push_back(k);
+      }
+    }
+    std::sort(model->begin(), model->end());
+    std::vector<Iterator*> children;
+    for (int i = 0; i < num_children; i++) {
+      std::sort(keys[i].begin(), keys[i].end());
+      children.push_back(new VectorIterator(keys[i]));
+    }
+    return NewMergingIterator(BytewiseComparator(), children.data(),
+                              num_children);
+  }
+};
+
+TEST_F(MergerTest, Empty) {
+  Iterator* children[] = {NewEmptyIterator(), NewEmptyIterator(),
+                          NewEmptyIterator()};
+  Iterator* iter = NewMergingIterator(BytewiseComparator(), children, 3);
+  iter->SeekToFirst();
+  ASSERT_TRUE(!iter->Valid());
+  iter->SeekToLast();
+  ASSERT_TRUE(!iter->Valid());
+  iter->Seek("foo");
+  ASSERT_TRUE(!iter->Valid());
+  delete iter;
+}
+
+TEST_F(MergerTest, ForwardAndBackward) {
+  Random rnd(301);
+  for (int num_children : {2, 3, 8, 33}) {
+    std::vector<std::string> model;
+    Iterator* iter = NewMerger(&rnd, num_children, 500, &model);
+
+    size_t i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_EQ(model[i], iter->key().ToString());
+      ASSERT_EQ("v" + model[i], iter->value().ToString());
+    }
+    ASSERT_EQ(model.size(), i);
+
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      i--;
+      ASSERT_EQ(model[i], iter->key().ToString());
+    }
+    ASSERT_EQ(0, i);
+    delete iter;
+  }
+}
+
+TEST_F(MergerTest, RandomizedDirectionChanges) {
+  Random rnd(test::RandomSeed());
+  for (int num_children : {2, 5, 16, 40}) {
+    std::vector<std::string> model;
+    Iterator* iter = NewMerger(&rnd, num_children, 200, &model);
+
+    // "pos" mirrors the merging iterator; model.size() means invalid.
+    size_t pos = model.size();
+    for (int step = 0; step < 2000; step++) {
+      switch (rnd.Uniform(5)) {
+        case 0:
+          iter->SeekToFirst();
+          pos = 0;
+          break;
+        case 1:
+          iter->SeekToLast();
+          pos = model.size() - 1;
+          break;
+        case 2: {
+          std::string target;
+          test::RandomString(&rnd, 1 + rnd.Uniform(8), &target);
+          iter->Seek(target);
+          pos = std::lower_bound(model.begin(), model.end(), target) -
+                model.begin();
+          break;
+        }
+        case 3:
+          if (pos < model.size()) {
+            iter->Next();
+            pos++;
+          }
+          break;
+        case 4:
+          if (pos < model.size()) {
+            iter->Prev();
+            pos = (pos == 0) ? model.size() : pos - 1;
+          }
+          break;
+      }
+      ASSERT_EQ(pos < model.size(), iter->Valid());
+      if (iter->Valid()) {
+        ASSERT_EQ(model[pos], iter->key().ToString());
+      }
+    }
+    delete iter;
+  }
+}
+
+}  // namespace leveldb
@@ -4,42 +4,136 @@
 
 #include "leveldb/table.h"
 
+#include <cstring>
+#include <vector>
+
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/persistent_cache.h"
+#include "leveldb/slice_transform.h"
+#include "port/port.h"
 #include "table/block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
+#include "util/crc32c.h"
 
 namespace leveldb {
 
+// The filter of a table, of whichever kind it has.
+struct Table::Filter {
+  Filter()
+      : filter(nullptr),
+        full_filter(nullptr),
+        filter_index(nullptr),
+        data(nullptr),
+        size(0) {}
+  ~Filter() {
+    delete filter;
+    delete full_filter;
+    delete filter_index;
+    delete[] data;
+  }
+
+  FilterBlockReader* filter;
+  FullFilterBlockReader* full_filter;  // At most one of the three is set
+  // Top-level index of the filter partitions, if the filters are
+  // partitioned.  Maps the last key of each index partition to the filter
+  // over the keys of that partition.
+  Block* filter_index;
+  const char* data;  // Owned data of filter or full_filter, if any
+  size_t size;       // Bytes read from the file
+};
+
 struct Table::Rep {
   ~Rep() {
-    delete filter;
-    delete[] filter_data;
-    delete index_block;
+    if (filter_cache_handle != nullptr) {
+      options.block_cache->Release(filter_cache_handle);
+    } else {
+      delete filter;
+    }
+    if (index_cache_handle != nullptr) {
+      options.block_cache->Release(index_cache_handle);
+    } else {
+      delete index_block;
+    }
+    delete compression_dict;
   }
 
   Options options;
   Status status;
   RandomAccessFile* file;
   uint64_t cache_id;
-  FilterBlockReader* filter;
-  const char* filter_data;
+  uint64_t compressed_cache_id;  // Id of the table in compressed_block_cache
+  // Keys the table's blocks in persistent_cache: the id written by the
+  // TableBuilder, or empty to keep them out of it.
+  std::string persistent_cache_id;
+
+  // Whether the index block and filter live in options.block_cache, in
+  // which case index_block and filter are only set while pinned there by
+  // index_cache_handle and filter_cache_handle.
+  bool cache_meta_blocks;
+  // Priority of the index and filter blocks in options.block_cache.
+  Cache::Priority meta_block_priority;
+
+  bool has_filter;  // Whether the table has a filter we can read
+  FilterBlockType filter_type;
+  BlockHandle filter_handle;
+  Filter* filter;
+  Cache::Handle* filter_cache_handle;
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
+  BlockHandle index_handle;
+  // The index block, or the top-level index of the index partitions if
+  // "partitioned_index".
   Block* index_block;
+  Cache::Handle* index_cache_handle;
+  bool partitioned_index;
+  // Dictionary the data blocks are zstd compressed against, or nullptr.
+  port::ZstdUncompressionDict* compression_dict;
 };
 
+// Returns the key of the block at "offset" of the table with "cache_id"
+// in the block cache, stored in "buf".
+static Slice BlockCacheKey(uint64_t cache_id, uint64_t offset, char* buf) {
+  EncodeFixed64(buf, cache_id);
+  EncodeFixed64(buf + 8, offset);
+  return Slice(buf, 16);
+}
+
+// Returns the key of the block at "offset" of the table with unique id
+// "table_id" in the persistent cache.
+static std::string PersistentCacheKey(const std::string& table_id,
+                                      uint64_t offset) {
+  std::string key = table_id;
+  PutFixed64(&key, offset);
+  return key;
+}
+
+static void DeleteCachedBlock(const Slice& key, void* value) {
+  Block* block = reinterpret_cast<Block*>(value);
+  delete block;
+}
+
+static void DeleteCachedCompressedBlock(const Slice& key, void* value) {
+  delete[] reinterpret_cast<char*>(value);
+}
+
+Status Table::Open(const Options& options, RandomAccessFile* file,
+                   uint64_t size, Table** table) {
+  return Open(options, file, size, false, table);
+}
+
 /**
  * 解析sstable文件。
  */
 Status Table::Open(const Options& options, RandomAccessFile* file,
-                   uint64_t size, Table** table) {
+                   uint64_t size, bool pin_index_and_filter,
+                   Table** table) {
   *table = nullptr;
   if (size < Footer::kEncodedLength) {
     return Status::Corruption("file is too short to be an sstable");
@@ -57,45 +151,107 @@ Status Table::Open(const Options& options, RandomAccessFile* file,
   s = footer.DecodeFrom(&footer_input);
   if (!s.ok()) return s;
 
+  // 将sstable解析到Rep
+  Rep* rep = new Table::Rep;
+  rep->options = options;
+  rep->file = file;
+  //读取sstable的时候回分配一个唯一的cache_id
+  rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
+  rep->compressed_cache_id = (options.compressed_block_cache
+                                  ? options.compressed_block_cache->NewId()
+                                  : 0);
+  rep->cache_meta_blocks =
+      options.cache_index_and_filter_blocks && options.block_cache != nullptr;
+  rep->meta_block_priority =
+      options.cache_index_and_filter_blocks_with_high_priority
+          ? Cache::kHighPriority
+          : Cache::kLowPriority;
+  rep->has_filter = false;
+  rep->filter_type = kPerBlockFilter;
+  rep->filter = nullptr;
+  rep->filter_cache_handle = nullptr;
+  rep->metaindex_handle = footer.metaindex_handle();
+  rep->index_handle = footer.index_handle();
+  rep->index_block = nullptr;
+  rep->index_cache_handle = nullptr;
+  rep->partitioned_index = false;
+  rep->compression_dict = nullptr;
+  //根据rep构建table
+  Table* t = new Table(rep);
   // Read the index block
-  //  BlockContents知识保存了一个block的二进制数据
-  BlockContents index_block_contents;
-  ReadOptions opt;
-  if (options.paranoid_checks) {
-    opt.verify_checksums = true;
-  }
-  //传入文件，以及block的起始和偏移地址，就能取出这个index block了
-  s = ReadBlock(file, opt, footer.index_handle(), &index_block_contents);
-
+  s = t->ReadIndexBlock(pin_index_and_filter);
   if (s.ok()) {
     // We've successfully read the footer and the index block: we're
     // ready to serve requests.
-    // 将block的二进制数据解析出来，给对应的变量赋值。
-    Block* index_block = new Block(index_block_contents);
-    // 将sstable解析到Rep
-    Rep* rep = new Table::Rep;
-    rep->options = options;
-    rep->file = file;
-    rep->metaindex_handle = footer.metaindex_handle();
-    rep->index_block = index_block;
-    //读取sstable的时候回分配一个唯一的cache_id
-    rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
-    rep->filter_data = nullptr;
-    rep->filter = nullptr;
-    //根据rep构建table
-    *table = new Table(rep);
     //读取 filter block，记录到rep_->filter
-    (*table)->ReadMeta(footer);
+    s = t->ReadMeta(footer, pin_index_and_filter);
   }
+  if (s.ok()) {
+    *table = t;
+  } else {
+    delete t;
+  }
+  return s;
+}
 
+Status Table::ReadIndexBlock(bool pin) {
+  ReadOptions opt;
+  if (rep_->options.paranoid_checks) {
+    opt.verify_checksums = true;
+  }
+  if (!rep_->cache_meta_blocks) {
+    //  BlockContents知识保存了一个block的二进制数据
+    BlockContents contents;
+    //传入文件，以及block的起始和偏移地址，就能取出这个index block了
+    Status s = ReadBlock(rep_->file, opt, rep_->index_handle, &contents);
+    if (s.ok()) {
+      // 将block的二进制数据解析出来，给对应的变量赋值。
+      rep_->index_block = new Block(contents);
+    }
+    return s;
+  }
+
+  // Warm the block cache up with the index block, and keep it there if
+  // it is to be pinned.
+  Cache::Handle* cache_handle;
+  Status s = ReadCachedIndexBlock(opt, &cache_handle);
+  if (s.ok()) {
+    if (pin) {
+      rep_->index_block =
+          reinterpret_cast<Block*>(rep_->options.block_cache->Value(
+              cache_handle));
+      rep_->index_cache_handle = cache_handle;
+    } else {
+      rep_->options.block_cache->Release(cache_handle);
+    }
+  }
   return s;
 }
 
-void Table::ReadMeta(const Footer& footer) {
-  if (rep_->options.filter_policy == nullptr) {
-    return;  // Do not need any metadata
+Status Table::ReadCachedIndexBlock(const ReadOptions& options,
+                                   Cache::Handle** cache_handle) const {
+  Cache* block_cache = rep_->options.block_cache;
+  char cache_key_buffer[16];
+  Slice key = BlockCacheKey(rep_->cache_id, rep_->index_handle.offset(),
+                            cache_key_buffer);
+  *cache_handle = block_cache->Lookup(key);
+  if (*cache_handle != nullptr) {
+    return Status::OK();
   }
+  BlockContents contents;
+  Status s = ReadBlock(rep_->file, options, rep_->index_handle, &contents);
+  if (s.ok()) {
+    Block* block = new Block(contents);
+    *cache_handle = block_cache->Insert(key, block, block->size(),
+                                        &DeleteCachedBlock,
+                                        rep_->meta_block_priority);
+  }
+  return s;
+}
 
+Status Table::ReadMeta(const Footer& footer, bool pin) {
+  // The metaindex block is read even without a filter policy, since it
+  // tells whether the data blocks need a compression dictionary.
   // TODO(sanjay): Skip this if footer.metaindex_handle() size indicates
   // it is an empty block.
   ReadOptions opt;
@@ -104,31 +260,94 @@ void Table::ReadMeta(const Footer& footer) {
   }
   //读取mate_index_block
   BlockContents contents;
-  if (!ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents).ok()) {
-    // Do not propagate errors since meta info is not needed for operation
-    return;
+  Status s = ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents);
+  if (!s.ok()) {
+    // The metaindex tells how to read the index and the data blocks, so
+    // the table cannot be used without it.
+    return s;
   }
   //解析出mate_index_block
   Block* meta = new Block(contents);
 
   Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
-  key.append(rep_->options.filter_policy->Name());
-  iter->Seek(key);
-  if (iter->Valid() && iter->key() == Slice(key)) {
-    ReadFilter(iter->value());
+  if (rep_->options.filter_policy != nullptr) {
+    // The table's options decide which kind of filter it has, not ours.
+    for (FilterBlockType type :
+         {kFullFilter, kPartitionedFilter, kPerBlockFilter}) {
+      std::string key = FilterBlockName(rep_->options.filter_policy,
+                                        rep_->options.prefix_extractor, type);
+      iter->Seek(key);
+      if (iter->Valid() && iter->key() == Slice(key)) {
+        Slice v = iter->value();
+        rep_->has_filter = rep_->filter_handle.DecodeFrom(&v).ok();
+        rep_->filter_type = type;
+        break;
+      }
+    }
+  }
+  iter->Seek(kPartitionedIndexBlockName);
+  rep_->partitioned_index =
+      iter->Valid() && iter->key() == Slice(kPartitionedIndexBlockName);
+  if (rep_->options.persistent_cache != nullptr) {
+    // File numbers may be reused after a crash, so the cache is keyed by
+    // an id that only this table has.  Tables without one stay out of it.
+    iter->Seek(kUniqueIdName);
+    if (iter->Valid() && iter->key() == Slice(kUniqueIdName) &&
+        iter->value().size() == kUniqueIdLength) {
+      rep_->persistent_cache_id = iter->value().ToString();
+    }
+  }
+  iter->Seek(kZstdDictionaryBlockName);
+  if (iter->Valid() && iter->key() == Slice(kZstdDictionaryBlockName)) {
+    // Unlike the filter, the dictionary is needed to read the data.
+    s = ReadCompressionDict(iter->value());
   }
   delete iter;
   delete meta;
+
+  if (rep_->has_filter) {
+    if (!rep_->cache_meta_blocks) {
+      rep_->filter = LoadFilter();
+    } else {
+      // Like the index block, warm the block cache up with the filter.
+      Cache::Handle* cache_handle = ReadCachedFilter();
+      if (cache_handle != nullptr && pin) {
+        rep_->filter = reinterpret_cast<Filter*>(
+            rep_->options.block_cache->Value(cache_handle));
+        rep_->filter_cache_handle = cache_handle;
+      } else if (cache_handle != nullptr) {
+        rep_->options.block_cache->Release(cache_handle);
+      }
+    }
+  }
+  return s;
 }
 
-void Table::ReadFilter(const Slice& filter_handle_value) {
-  Slice v = filter_handle_value;
-  BlockHandle filter_handle;
-  if (!filter_handle.DecodeFrom(&v).ok()) {
-    return;
+Status Table::ReadCompressionDict(const Slice& dict_handle_value) {
+  Slice v = dict_handle_value;
+  BlockHandle dict_handle;
+  Status s = dict_handle.DecodeFrom(&v);
+  if (!s.ok()) {
+    return s;
   }
 
+  ReadOptions opt;
+  opt.verify_checksums = true;
+  BlockContents block;
+  s = ReadBlock(rep_->file, opt, dict_handle, &block);
+  if (!s.ok()) {
+    return s;
+  }
+  // The dictionary is digested once here and shared by all block reads.
+  rep_->compression_dict =
+      new port::ZstdUncompressionDict(block.data.data(), block.data.size());
+  if (block.heap_allocated) {
+    delete[] block.data.data();
+  }
+  return Status::OK();
+}
+
+Table::Filter* Table::LoadFilter() const {
   // We might want to unify with ReadBlock() if we start
   // requiring checksum verification in Table::Open.
   ReadOptions opt;
@@ -136,13 +355,68 @@ void Table::ReadFilter(const Slice& filter_handle_value) {
     opt.verify_checksums = true;
   }
   BlockContents block;
-  if (!ReadBlock(rep_->file, opt, filter_handle, &block).ok()) {
-    return;
+  if (!ReadBlock(rep_->file, opt, rep_->filter_handle, &block).ok()) {
+    return nullptr;
+  }
+  Filter* filter = new Filter;
+  filter->size = block.data.size();
+  const FilterPolicy* policy = rep_->options.filter_policy;
+  switch (rep_->filter_type) {
+    case kPerBlockFilter:
+      filter->filter = new FilterBlockReader(policy, block.data);
+      break;
+    case kFullFilter:
+      filter->full_filter = new FullFilterBlockReader(policy, block.data);
+      break;
+    case kPartitionedFilter:
+      // The filter index is a block, which owns its data itself.
+      filter->filter_index = new Block(block);
+      return filter;
   }
   if (block.heap_allocated) {
-    rep_->filter_data = block.data.data();  // Will need to delete later
+    filter->data = block.data.data();  // Will need to delete later
+  }
+  return filter;
+}
+
+Cache::Handle* Table::ReadCachedFilter() const {
+  Cache* block_cache = rep_->options.block_cache;
+  char cache_key_buffer[16];
+  Slice key = BlockCacheKey(rep_->cache_id, rep_->filter_handle.offset(),
+                            cache_key_buffer);
+  Cache::Handle* cache_handle = block_cache->Lookup(key);
+  if (cache_handle == nullptr) {
+    Filter* filter = LoadFilter();
+    if (filter != nullptr) {
+      cache_handle = block_cache->Insert(
+          key, filter, filter->size,
+          [](const Slice& key, void* value) {
+            delete reinterpret_cast<Filter*>(value);
+          },
+          rep_->meta_block_priority);
+    }
+  }
+  return cache_handle;
+}
+
+const Table::Filter* Table::GetFilter(Cache::Handle** cache_handle) const {
+  *cache_handle = nullptr;
+  if (!rep_->cache_meta_blocks || rep_->filter != nullptr ||
+      !rep_->has_filter) {
+    return rep_->filter;
+  }
+  *cache_handle = ReadCachedFilter();
+  if (*cache_handle == nullptr) {
+    return nullptr;  // Errors are treated as potential matches
+  }
+  return reinterpret_cast<Filter*>(
+      rep_->options.block_cache->Value(*cache_handle));
+}
+
+void Table::ReleaseCacheHandle(Cache::Handle* cache_handle) const {
+  if (cache_handle != nullptr) {
+    rep_->options.block_cache->Release(cache_handle);
   }
-  rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
 }
 
 Table::~Table() { delete rep_; }
@@ -151,17 +425,29 @@ static void DeleteBlock(void* arg, void* ignored) {
   delete reinterpret_cast<Block*>(arg);
 }
 
-static void DeleteCachedBlock(const Slice& key, void* value) {
-  Block* block = reinterpret_cast<Block*>(value);
-  delete block;
-}
-
 static void ReleaseBlock(void* arg, void* h) {
   Cache* cache = reinterpret_cast<Cache*>(arg);
   Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
   cache->Release(handle);
 }
 
+// Returns an iterator over "block", for point lookups if "lookup".  The
+// iterator owns "block" if "cache_handle" is null; otherwise it releases
+// "cache_handle" when done.
+static Iterator* NewBlockIterator(const Comparator* comparator, Block* block,
+                                  Cache* block_cache,
+                                  Cache::Handle* cache_handle,
+                                  bool lookup = false) {
+  Iterator* iter = lookup ? block->NewLookupIterator(comparator)
+                          : block->NewIterator(comparator);
+  if (cache_handle == nullptr) {
+    iter->RegisterCleanup(&DeleteBlock, block, nullptr);
+  } else {
+    iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
+  }
+  return iter;
+}
+
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
 /**
@@ -169,8 +455,136 @@ static void ReleaseBlock(void* arg, void* h) {
  */
 Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
                              const Slice& index_value) {
-  Table* table = reinterpret_cast<Table*>(arg);
-  Cache* block_cache = table->rep_->options.block_cache;
+  return reinterpret_cast<Table*>(arg)->ReadBlockIterator(options, index_value,
+                                                          true, false);
+}
+
+// Index partitions are read through the block cache just like data blocks.
+Iterator* Table::IndexPartitionReader(void* arg, const ReadOptions& options,
+                                      const Slice& index_value) {
+  return reinterpret_cast<Table*>(arg)->ReadBlockIterator(options, index_value,
+                                                          false, false);
+}
+
+// Readahead of the data blocks that a sequential scan reads next.
+void Table::Prefetch(void* arg, uint64_t offset, size_t n) {
+  reinterpret_cast<Table*>(arg)->rep_->file->Prefetch(offset, n);
+}
+
+char* Table::LookupRawBlock(const ReadOptions& options,
+                            const BlockHandle& handle) const {
+  Cache* compressed_cache = rep_->options.compressed_block_cache;
+  PersistentCache* persistent_cache = rep_->options.persistent_cache;
+  const size_t n = static_cast<size_t>(handle.size()) + kBlockTrailerSize;
+  char cache_key_buffer[16];
+  if (compressed_cache != nullptr) {
+    Slice key = BlockCacheKey(rep_->compressed_cache_id, handle.offset(),
+                              cache_key_buffer);
+    Cache::Handle* cache_handle = compressed_cache->Lookup(key);
+    if (cache_handle != nullptr) {
+      // DecodeBlock() takes ownership of the buffer it decodes.
+      char* buf = new char[n];
+      std::memcpy(buf, compressed_cache->Value(cache_handle), n);
+      compressed_cache->Release(cache_handle);
+      return buf;
+    }
+  }
+
+  std::string data;
+  if (rep_->persistent_cache_id.empty() ||
+      !persistent_cache->Lookup(
+          PersistentCacheKey(rep_->persistent_cache_id, handle.offset()),
+          &data) ||
+      data.size() != n) {
+    return nullptr;
+  }
+  // The cache outlives the process and lives on another device, so its
+  // blocks are always checked, as a miss costs no more than a read.
+  const uint32_t crc = crc32c::Unmask(DecodeFixed32(data.data() + n - 4));
+  if (crc32c::Value(data.data(), n - 4) != crc) {
+    return nullptr;
+  }
+  char* buf = new char[n];
+  std::memcpy(buf, data.data(), n);
+  if (compressed_cache != nullptr && options.fill_cache &&
+      buf[n - kBlockTrailerSize] != kNoCompression) {
+    char* compressed = new char[n];
+    std::memcpy(compressed, buf, n);
+    Slice key = BlockCacheKey(rep_->compressed_cache_id, handle.offset(),
+                              cache_key_buffer);
+    compressed_cache->Release(compressed_cache->Insert(
+        key, compressed, n, &DeleteCachedCompressedBlock));
+  }
+  return buf;
+}
+
+Status Table::DecodeBlockContents(const ReadOptions& options,
+                                  const BlockHandle& handle, const Slice& raw,
+                                  char* buf, bool data_block,
+                                  BlockContents* contents) const {
+  const port::ZstdUncompressionDict* dict =
+      data_block ? rep_->compression_dict : nullptr;
+  Cache* compressed_cache = rep_->options.compressed_block_cache;
+  const size_t n = static_cast<size_t>(handle.size());
+  const bool whole = options.fill_cache && raw.size() == n + kBlockTrailerSize;
+  const bool fill_compressed =
+      whole && compressed_cache != nullptr && raw[n] != kNoCompression;
+  const bool fill_persistent = whole && !rep_->persistent_cache_id.empty();
+  if (!fill_compressed && !fill_persistent) {
+    return DecodeBlock(options, handle, raw, buf, contents, dict);
+  }
+
+  // 解压会释放buf，先保留一份磁盘上形式的拷贝
+  char* copy = new char[raw.size()];
+  std::memcpy(copy, raw.data(), raw.size());
+  Status s = DecodeBlock(options, handle, raw, buf, contents, dict);
+  if (s.ok()) {
+    if (fill_persistent) {
+      rep_->options.persistent_cache->Insert(
+          PersistentCacheKey(rep_->persistent_cache_id, handle.offset()),
+          Slice(copy, n + kBlockTrailerSize));
+    }
+    if (fill_compressed) {
+      char cache_key_buffer[16];
+      Slice key = BlockCacheKey(rep_->compressed_cache_id, handle.offset(),
+                                cache_key_buffer);
+      compressed_cache->Release(compressed_cache->Insert(
+          key, copy, n + kBlockTrailerSize, &DeleteCachedCompressedBlock));
+      copy = nullptr;
+    }
+  }
+  delete[] copy;
+  return s;
+}
+
+Status Table::ReadBlockContents(const ReadOptions& options,
+                                const BlockHandle& handle, bool data_block,
+                                BlockContents* contents) const {
+  if (rep_->options.compressed_block_cache == nullptr &&
+      rep_->persistent_cache_id.empty()) {
+    return ReadBlock(rep_->file, options, handle, contents,
+                     data_block ? rep_->compression_dict : nullptr);
+  }
+  const size_t n = static_cast<size_t>(handle.size()) + kBlockTrailerSize;
+  char* buf = LookupRawBlock(options, handle);
+  if (buf != nullptr) {
+    return DecodeBlock(options, handle, Slice(buf, n), buf, contents,
+                       data_block ? rep_->compression_dict : nullptr);
+  }
+  buf = new char[n];
+  Slice raw;
+  Status s = rep_->file->Read(handle.offset(), n, &raw, buf);
+  if (!s.ok()) {
+    delete[] buf;
+    return s;
+  }
+  return DecodeBlockContents(options, handle, raw, buf, data_block, contents);
+}
+
+Iterator* Table::ReadBlockIterator(const ReadOptions& options,
+                                   const Slice& index_value,
+                                   bool data_block, bool lookup) const {
+  Cache* block_cache = rep_->options.block_cache;
   Block* block = nullptr;
   Cache::Handle* cache_handle = nullptr;
 
@@ -191,7 +605,7 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
       // 同一Table的不同data block有唯一的offset
       // 因此可以作为cache key.
       char cache_key_buffer[16];
-      EncodeFixed64(cache_key_buffer, table->rep_->cache_id);
+      EncodeFixed64(cache_key_buffer, rep_->cache_id);
       EncodeFixed64(cache_key_buffer + 8, handle.offset());
       Slice key(cache_key_buffer, sizeof(cache_key_buffer));
       // 查找缓存是否存在
@@ -200,21 +614,24 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
       if (cache_handle != nullptr) {
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
       } else {
-        // 否则从文件里读取Data Block
+        // 否则从压缩块缓存或文件里读取Data Block
         //缓存 value 则是整个 Block 对象
-        s = ReadBlock(table->rep_->file, options, handle, &contents);
+        s = ReadBlockContents(options, handle, data_block, &contents);
         if (s.ok()) {
           block = new Block(contents);
           if (contents.cachable && options.fill_cache) {
             // 插入缓存
-            cache_handle = block_cache->Insert(key, block, block->size(),
-                                               &DeleteCachedBlock);
+            // Index partitions are metadata, whose priority is that of the
+            // index and filter blocks.
+            cache_handle = block_cache->Insert(
+                key, block, block->size(), &DeleteCachedBlock,
+                data_block ? Cache::kLowPriority : rep_->meta_block_priority);
           }
         }
       }
     } else {
       // 不使用缓存，直接读取数据
-      s = ReadBlock(table->rep_->file, options, handle, &contents);
+      s = ReadBlockContents(options, handle, data_block, &contents);
       if (s.ok()) {
         block = new Block(contents);
       }
@@ -223,18 +640,105 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
 
   Iterator* iter;
   if (block != nullptr) {
-    iter = block->NewIterator(table->rep_->options.comparator);
-    if (cache_handle == nullptr) {
-      iter->RegisterCleanup(&DeleteBlock, block, nullptr);
-    } else {
-      iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
-    }
+    iter = NewBlockIterator(rep_->options.comparator, block, block_cache,
+                            cache_handle, lookup);
   } else {
     iter = NewErrorIterator(s);
   }
   return iter;
 }
 
+void Table::ReadBlocks(const ReadOptions& options, const BlockHandle* handles,
+                       int n, Iterator** iters) const {
+  const Comparator* comparator = rep_->options.comparator;
+  Cache* block_cache = rep_->options.block_cache;
+
+  // Serve what we can from the block cache and collect the other reads.
+  std::vector<RandomAccessFile::ReadRequest> reqs;
+  std::vector<int> req_blocks;  // Index into handles of each request
+  // Blocks found in the compressed block cache or the persistent cache, as
+  // if read already.
+  std::vector<RandomAccessFile::ReadRequest> cached;
+  std::vector<int> cached_blocks;
+  for (int i = 0; i < n; i++) {
+    if (block_cache != nullptr) {
+      char cache_key_buffer[16];
+      EncodeFixed64(cache_key_buffer, rep_->cache_id);
+      EncodeFixed64(cache_key_buffer + 8, handles[i].offset());
+      Slice key(cache_key_buffer, sizeof(cache_key_buffer));
+      Cache::Handle* cache_handle = block_cache->Lookup(key);
+      if (cache_handle != nullptr) {
+        Block* block =
+            reinterpret_cast<Block*>(block_cache->Value(cache_handle));
+        iters[i] =
+            NewBlockIterator(comparator, block, block_cache, cache_handle,
+                             true);
+        continue;
+      }
+    }
+    if (rep_->options.compressed_block_cache != nullptr ||
+        !rep_->persistent_cache_id.empty()) {
+      char* buf = LookupRawBlock(options, handles[i]);
+      if (buf != nullptr) {
+        RandomAccessFile::ReadRequest req;
+        req.offset = handles[i].offset();
+        req.n = static_cast<size_t>(handles[i].size()) + kBlockTrailerSize;
+        req.scratch = buf;
+        req.result = Slice(buf, req.n);
+        cached.push_back(req);
+        cached_blocks.push_back(i);
+        continue;
+      }
+    }
+    RandomAccessFile::ReadRequest req;
+    req.offset = handles[i].offset();
+    req.n = static_cast<size_t>(handles[i].size()) + kBlockTrailerSize;
+    req.scratch = new char[req.n];
+    reqs.push_back(req);
+    req_blocks.push_back(i);
+  }
+  if (!reqs.empty()) {
+    rep_->file->MultiRead(reqs.data(), reqs.size());
+  }
+
+  // The blocks found in the caches follow those read.
+  const size_t num_read = reqs.size();
+  reqs.insert(reqs.end(), cached.begin(), cached.end());
+  req_blocks.insert(req_blocks.end(), cached_blocks.begin(),
+                    cached_blocks.end());
+  for (size_t r = 0; r < reqs.size(); r++) {
+    const int i = req_blocks[r];
+    Status s = reqs[r].status;
+    BlockContents contents;
+    if (s.ok() && r < num_read) {
+      s = DecodeBlockContents(options, handles[i], reqs[r].result,
+                              reqs[r].scratch, true, &contents);
+    } else if (s.ok()) {
+      s = DecodeBlock(options, handles[i], reqs[r].result, reqs[r].scratch,
+                      &contents, rep_->compression_dict);
+    } else {
+      delete[] reqs[r].scratch;
+    }
+    if (!s.ok()) {
+      iters[i] = NewErrorIterator(s);
+      continue;
+    }
+
+    Block* block = new Block(contents);
+    Cache::Handle* cache_handle = nullptr;
+    if (block_cache != nullptr && contents.cachable && options.fill_cache) {
+      char cache_key_buffer[16];
+      EncodeFixed64(cache_key_buffer, rep_->cache_id);
+      EncodeFixed64(cache_key_buffer + 8, handles[i].offset());
+      Slice key(cache_key_buffer, sizeof(cache_key_buffer));
+      cache_handle =
+          block_cache->Insert(key, block, block->size(), &DeleteCachedBlock);
+    }
+    iters[i] =
+        NewBlockIterator(comparator, block, block_cache, cache_handle, true);
+  }
+}
+
 
 /**
  * new TwoLevelIterator(index_iter, block_function, arg, options);
@@ -243,45 +747,301 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
  * 第三、四个参数都在函数调用时使用。
  */
 Iterator* Table::NewIterator(const ReadOptions& options) const {
+  // Only filters written with our prefix extractor are ever read, so a
+  // table with a filter has the prefix entries the seeks rely on.
+  const bool has_prefix_filter =
+      rep_->options.prefix_extractor != nullptr &&
+      rep_->has_filter;
   return NewTwoLevelIterator(
       //传入index_block的iterator
-      rep_->index_block->NewIterator(rep_->options.comparator),
-      &Table::BlockReader, const_cast<Table*>(this),  options);
+      NewIndexIterator(options), &Table::BlockReader,
+      const_cast<Table*>(this), options,
+      has_prefix_filter ? &Table::BlockMayMatchPrefix : nullptr,
+      &Table::Prefetch);
+}
+
+Iterator* Table::NewIndexIterator(const ReadOptions& options) const {
+  Iterator* iter;
+  if (rep_->index_block != nullptr) {
+    iter = rep_->index_block->NewIterator(rep_->options.comparator);
+  } else {
+    // The index block lives in the block cache.
+    Cache::Handle* cache_handle;
+    Status s = ReadCachedIndexBlock(options, &cache_handle);
+    if (!s.ok()) {
+      return NewErrorIterator(s);
+    }
+    Block* block =
+        reinterpret_cast<Block*>(rep_->options.block_cache->Value(cache_handle));
+    iter = NewBlockIterator(rep_->options.comparator, block,
+                            rep_->options.block_cache, cache_handle);
+  }
+  if (rep_->partitioned_index) {
+    iter = NewTwoLevelIterator(iter, &Table::IndexPartitionReader,
+                               const_cast<Table*>(this), options);
+  }
+  return iter;
+}
+
+bool Table::BlockMayMatchPrefix(void* arg, const Slice& target,
+                                const Slice& index_key,
+                                const Slice& index_value) {
+  Table* table = reinterpret_cast<Table*>(arg);
+  Rep* rep = table->rep_;
+  const SliceTransform* prefix_extractor = rep->options.prefix_extractor;
+  if (!prefix_extractor->InDomain(target)) {
+    return true;
+  }
+  Slice prefix = prefix_extractor->Transform(target);
+  Cache::Handle* cache_handle;
+  const Filter* filter = table->GetFilter(&cache_handle);
+  bool result = true;
+  BlockHandle handle;
+  Slice input = index_value;
+  if (filter == nullptr) {
+    // Cannot read the filter
+  } else if (filter->full_filter != nullptr) {
+    result = filter->full_filter->KeyMayMatch(prefix);
+  } else if (filter->filter_index != nullptr) {
+    // The index key of a data block falls in the partition holding it.
+    result = table->PartitionedFilterMayMatch(
+        ReadOptions(), filter->filter_index, index_key, prefix);
+  } else if (handle.DecodeFrom(&input).ok()) {
+    result = filter->filter->KeyMayMatch(handle.offset(), prefix);
+  }
+  table->ReleaseCacheHandle(cache_handle);
+  return result;
+}
+
+bool Table::PrefixMayMatch(const Slice& target) const {
+  const SliceTransform* prefix_extractor = rep_->options.prefix_extractor;
+  if (rep_->filter_type != kFullFilter || prefix_extractor == nullptr ||
+      !prefix_extractor->InDomain(target)) {
+    return true;
+  }
+  Cache::Handle* cache_handle;
+  const Filter* filter = GetFilter(&cache_handle);
+  bool result =
+      filter == nullptr ||
+      filter->full_filter->KeyMayMatch(prefix_extractor->Transform(target));
+  ReleaseCacheHandle(cache_handle);
+  return result;
+}
+
+namespace {
+
+// A filter partition as held by the block cache.
+struct FilterPartition {
+  FilterPartition(const FilterPolicy* policy, const BlockContents& contents)
+      : reader(policy, contents.data),
+        owned_data(contents.heap_allocated ? contents.data.data() : nullptr) {}
+  ~FilterPartition() { delete[] owned_data; }
+
+  FullFilterBlockReader reader;
+  const char* owned_data;
+};
+
+void DeleteCachedFilterPartition(const Slice& key, void* value) {
+  delete reinterpret_cast<FilterPartition*>(value);
+}
+
+}  // namespace
+
+bool Table::PartitionedFilterMayMatch(const ReadOptions& options,
+                                      Block* filter_index,
+                                      const Slice& partition_key,
+                                      const Slice& key) const {
+  Iterator* iter = filter_index->NewIterator(rep_->options.comparator);
+  iter->Seek(partition_key);
+  BlockHandle handle;
+  Slice input;
+  bool found_handle = false;
+  bool result = true;  // Errors are treated as potential matches
+  if (iter->Valid()) {
+    input = iter->value();
+    found_handle = handle.DecodeFrom(&input).ok();
+  } else if (iter->status().ok()) {
+    result = false;  // Past the last key of the table
+  }
+  delete iter;
+  if (!found_handle) {
+    return result;
+  }
+
+  Cache* block_cache = rep_->options.block_cache;
+  char cache_key_buffer[16];
+  EncodeFixed64(cache_key_buffer, rep_->cache_id);
+  EncodeFixed64(cache_key_buffer + 8, handle.offset());
+  Slice cache_key(cache_key_buffer, sizeof(cache_key_buffer));
+  Cache::Handle* cache_handle =
+      (block_cache != nullptr) ? block_cache->Lookup(cache_key) : nullptr;
+  FilterPartition* partition;
+  if (cache_handle != nullptr) {
+    partition =
+        reinterpret_cast<FilterPartition*>(block_cache->Value(cache_handle));
+  } else {
+    BlockContents contents;
+    if (!ReadBlock(rep_->file, options, handle, &contents).ok()) {
+      return true;
+    }
+    partition = new FilterPartition(rep_->options.filter_policy, contents);
+    if (block_cache != nullptr && contents.cachable && options.fill_cache) {
+      cache_handle = block_cache->Insert(
+          cache_key, partition, contents.data.size(),
+          &DeleteCachedFilterPartition, rep_->meta_block_priority);
+    }
+  }
+  result = partition->reader.KeyMayMatch(key);
+  if (cache_handle != nullptr) {
+    block_cache->Release(cache_handle);
+  } else {
+    delete partition;
+  }
+  return result;
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
                           void (*handle_result)(void*, const Slice&,
                                                 const Slice&)) {
+  return InternalGet(options, k, arg, handle_result, nullptr);
+}
+
+Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
+                          void (*handle_result)(void*, const Slice&,
+                                                const Slice&),
+                          Iterator** pin) {
+  if (pin != nullptr) {
+    *pin = nullptr;
+  }
   Status s;
-  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  Cache::Handle* filter_cache_handle;
+  const Filter* filter = GetFilter(&filter_cache_handle);
+  if (filter != nullptr &&
+      ((filter->full_filter != nullptr &&
+        !filter->full_filter->KeyMayMatch(k)) ||
+       (filter->filter_index != nullptr &&
+        !PartitionedFilterMayMatch(options, filter->filter_index, k, k)))) {
+    ReleaseCacheHandle(filter_cache_handle);
+    return s;  // Not found, without touching the index
+  }
+  Iterator* iiter = NewIndexIterator(options);
   iiter->Seek(k);
   if (iiter->Valid()) {
     Slice handle_value = iiter->value();
-    FilterBlockReader* filter = rep_->filter;
     BlockHandle handle;
-    if (filter != nullptr && handle.DecodeFrom(&handle_value).ok() &&
-        !filter->KeyMayMatch(handle.offset(), k)) {
+    if (filter != nullptr && filter->filter != nullptr &&
+        handle.DecodeFrom(&handle_value).ok() &&
+        !filter->filter->KeyMayMatch(handle.offset(), k)) {
       // Not found
     } else {
-      Iterator* block_iter = BlockReader(this, options, iiter->value());
+      Iterator* block_iter =
+          ReadBlockIterator(options, iiter->value(), true, true);
       block_iter->Seek(k);
+      bool found = false;
       if (block_iter->Valid()) {
         (*handle_result)(arg, block_iter->key(), block_iter->value());
+        found = true;
       }
       s = block_iter->status();
-      delete block_iter;
+      if (found && pin != nullptr) {
+        // The iterator holds the block the entry lives in.
+        *pin = block_iter;
+      } else {
+        delete block_iter;
+      }
     }
   }
   if (s.ok()) {
     s = iiter->status();
   }
   delete iiter;
+  ReleaseCacheHandle(filter_cache_handle);
+  return s;
+}
+
+Status Table::InternalMultiGet(const ReadOptions& options, const Slice* keys,
+                               void* const* args, int n,
+                               void (*handle_result)(void*, const Slice&,
+                                                     const Slice&)) {
+  // Find the data block of every key that may be present.  Keys are
+  // sorted, so keys sharing a block are adjacent.
+  Status s;
+  const Comparator* comparator = rep_->options.comparator;
+  std::vector<BlockHandle> handles;
+  std::vector<int> key_blocks(n, -1);  // Index into handles, or -1 if absent
+  Cache::Handle* filter_cache_handle;
+  const Filter* filter = GetFilter(&filter_cache_handle);
+  Iterator* iiter = NewIndexIterator(options);
+  bool positioned = false;
+  for (int i = 0; i < n; i++) {
+    if (filter != nullptr && filter->full_filter != nullptr &&
+        !filter->full_filter->KeyMayMatch(keys[i])) {
+      continue;  // Not found
+    }
+    if (filter != nullptr && filter->filter_index != nullptr &&
+        !PartitionedFilterMayMatch(options, filter->filter_index, keys[i],
+                                   keys[i])) {
+      continue;  // Not found
+    }
+    // The index entry found for the previous key is the first one >= that
+    // key; it also covers this key unless this key is past its limit.
+    if (!positioned || comparator->Compare(keys[i], iiter->key()) > 0) {
+      positioned = true;
+      iiter->Seek(keys[i]);
+      if (!iiter->Valid()) {
+        break;  // This key and all later ones are past the end of the table
+      }
+    }
+
+    BlockHandle handle;
+    Slice input = iiter->value();
+    s = handle.DecodeFrom(&input);
+    if (!s.ok()) {
+      break;
+    }
+    if (filter != nullptr && filter->filter != nullptr &&
+        !filter->filter->KeyMayMatch(handle.offset(), keys[i])) {
+      continue;  // Not found
+    }
+    if (handles.empty() || handles.back().offset() != handle.offset()) {
+      handles.push_back(handle);
+    }
+    key_blocks[i] = static_cast<int>(handles.size()) - 1;
+  }
+  if (s.ok()) {
+    s = iiter->status();
+  }
+  delete iiter;
+  ReleaseCacheHandle(filter_cache_handle);
+  if (!s.ok() || handles.empty()) {
+    return s;
+  }
+
+  // Fetch all of the blocks at once, then look the keys up in them.
+  std::vector<Iterator*> block_iters(handles.size());
+  ReadBlocks(options, handles.data(), static_cast<int>(handles.size()),
+             block_iters.data());
+  for (int i = 0; i < n; i++) {
+    if (key_blocks[i] < 0) {
+      continue;
+    }
+    Iterator* block_iter = block_iters[key_blocks[i]];
+    block_iter->Seek(keys[i]);
+    if (block_iter->Valid()) {
+      (*handle_result)(args[i], block_iter->key(), block_iter->value());
+    }
+  }
+  for (Iterator* block_iter : block_iters) {
+    if (s.ok()) {
+      s = block_iter->status();
+    }
+    delete block_iter;
+  }
   return s;
 }
 
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
-  Iterator* index_iter =
-      rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* index_iter = NewIndexIterator(ReadOptions());
   index_iter->Seek(key);
   uint64_t result;
   if (index_iter->Valid()) {
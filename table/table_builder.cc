@@ -5,6 +5,9 @@
 #include "leveldb/table_builder.h"
 
 #include <cassert>
+#include <random>
+#include <string>
+#include <vector>
 
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
@@ -30,15 +33,32 @@ struct TableBuilder::Rep {
         //todo：会用&options作为参数构造一个临时对象赋值给data_block？
         data_block(&options),
         index_block(&index_block_options),
+        partitioned(opt.partition_index_and_filters),
+        top_level_index(&index_block_options),
+        filter_index(&index_block_options),
         num_entries(0),
         closed(false),
-        filter_block(opt.filter_policy == nullptr
+        filter_block(opt.filter_policy == nullptr || opt.full_filter ||
+                             opt.partition_index_and_filters
                          ? nullptr
-                         : new FilterBlockBuilder(opt.filter_policy)),
-        pending_index_entry(false) {
+                         : new FilterBlockBuilder(opt.filter_policy,
+                                                  opt.prefix_extractor)),
+        full_filter_block(opt.filter_policy == nullptr ||
+                                  !(opt.full_filter ||
+                                    opt.partition_index_and_filters)
+                              ? nullptr
+                              : new FullFilterBlockBuilder(
+                                    opt.filter_policy, opt.prefix_extractor)),
+        pending_index_entry(false),
+        buffering(opt.compression == kZstdCompression &&
+                  opt.zstd_max_dict_bytes > 0),
+        compression_dict(nullptr) {
     index_block_options.block_restart_interval = 1;
+    index_block_options.data_block_hash_index = false;
   }
 
+  ~Rep() { delete compression_dict; }
+
   Options options;
   Options index_block_options;
   //文件信息
@@ -57,12 +77,21 @@ struct TableBuilder::Rep {
   BlockBuilder data_block;
   //sstable中data_block的index_block
   BlockBuilder index_block;
+  // With partitioned index and filters, index_block is the index partition
+  // being built and full_filter_block its filter.  Finished partitions are
+  // written out right away and indexed by "top_level_index" (and their
+  // filters by "filter_index"), under the last key of the partition.
+  bool partitioned;
+  BlockBuilder top_level_index;
+  BlockBuilder filter_index;
   std::string last_key;
   //一个kv一个entry，entry的个数。
   int64_t num_entries;
   bool closed;  // Either Finish() or Abandon() has been called.
   //sstable中的过滤器
   FilterBlockBuilder* filter_block;
+  //整个sstable（或一个index分区）共用一个过滤器时使用，和filter_block至多一个非空。
+  FullFilterBlockBuilder* full_filter_block;
 
   // We do not emit the index entry for a block until we have seen the
   // first key for the next data block.  This allows us to use shorter
@@ -77,6 +106,19 @@ struct TableBuilder::Rep {
   BlockHandle pending_handle;  // Handle to add to index block
 
   std::string compressed_output;
+
+  // While a zstd dictionary is being collected, entries are not turned
+  // into blocks yet: they are appended to "buffered_data" as length
+  // prefixed key/value pairs until there is enough data to train on.
+  // "buffered_flushes" holds the sizes of buffered_data at which Flush()
+  // was called meanwhile.
+  bool buffering;
+  std::string buffered_data;
+  std::vector<size_t> buffered_flushes;
+
+  // Dictionary the data blocks are compressed against, or nullptr.
+  std::string compression_dict_data;
+  port::ZstdCompressionDict* compression_dict;
 };
 
 TableBuilder::TableBuilder(const Options& options, WritableFile* file)
@@ -89,6 +131,7 @@ TableBuilder::TableBuilder(const Options& options, WritableFile* file)
 TableBuilder::~TableBuilder() {
   assert(rep_->closed);  // Catch errors where caller forgot to call Finish()
   delete rep_->filter_block;
+  delete rep_->full_filter_block;
   delete rep_;
 }
 
@@ -99,12 +142,17 @@ Status TableBuilder::ChangeOptions(const Options& options) {
   if (options.comparator != rep_->options.comparator) {
     return Status::InvalidArgument("changing comparator while building table");
   }
+  if (options.prefix_extractor != rep_->options.prefix_extractor) {
+    return Status::InvalidArgument(
+        "changing prefix extractor while building table");
+  }
 
   // Note that any live BlockBuilders point to rep_->options and therefore
   // will automatically pick up the updated options.
   rep_->options = options;
   rep_->index_block_options = options;
   rep_->index_block_options.block_restart_interval = 1;
+  rep_->index_block_options.data_block_hash_index = false;
   return Status::OK();
 }
 
@@ -119,6 +167,28 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
     assert(r->options.comparator->Compare(key, Slice(r->last_key)) > 0);
   }
 
+  if (r->buffering) {
+    PutLengthPrefixedSlice(&r->buffered_data, key);
+    PutLengthPrefixedSlice(&r->buffered_data, value);
+    r->last_key.assign(key.data(), key.size());
+    r->num_entries++;
+    size_t train_bytes = r->options.zstd_max_train_bytes;
+    if (train_bytes == 0) {
+      train_bytes = 100 * r->options.zstd_max_dict_bytes;
+    }
+    if (r->buffered_data.size() >= train_bytes) {
+      TrainDictionary();
+    }
+    return;
+  }
+
+  r->num_entries++;
+  AddToBlocks(key, value);
+}
+
+void TableBuilder::AddToBlocks(const Slice& key, const Slice& value) {
+  Rep* r = rep_;
+
   //每次向data_block插入kv，当block达到了上限，将这个block写入到文件后，就将pending_index_entry置为true。
   //同时，代表需要向index_block块新增一个entity。这个entity指向这个块
   if (r->pending_index_entry) {
@@ -132,15 +202,21 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
     //index_block中entity的key为所指向的data_block中最大的key，value为这个data_block的位置和大小。
     r->index_block.Add(r->last_key, Slice(handle_encoding));
     r->pending_index_entry = false;
+    if (r->partitioned &&
+        r->index_block.CurrentSizeEstimate() >= r->options.metadata_block_size) {
+      CutIndexPartition();
+    }
   }
 
   //将当前key加入到过滤器块中。
   if (r->filter_block != nullptr) {
     r->filter_block->AddKey(key);
   }
+  if (r->full_filter_block != nullptr) {
+    r->full_filter_block->AddKey(key);
+  }
 
   r->last_key.assign(key.data(), key.size());
-  r->num_entries++;
   r->data_block.Add(key, value);
 
   //当data_bloc到达了上限的时候，就Flush，将当前data_block写到文件中。
@@ -158,6 +234,10 @@ void TableBuilder::Flush() {
   Rep* r = rep_;
   assert(!r->closed);
   if (!ok()) return;
+  if (r->buffering) {
+    r->buffered_flushes.push_back(r->buffered_data.size());
+    return;
+  }
   if (r->data_block.empty()) return;
   assert(!r->pending_index_entry);
   //写入r->data_block到文件中。
@@ -176,6 +256,89 @@ void TableBuilder::Flush() {
   }
 }
 
+/**
+ * 写出当前的index分区及其过滤器，并在顶层索引中记录它们的位置。
+ * 分区在最后一个data block的index entry之后切分，r->last_key此时是该entry的key。
+ */
+void TableBuilder::CutIndexPartition() {
+  Rep* r = rep_;
+  assert(r->partitioned && !r->index_block.empty());
+  if (!ok()) return;
+  std::string handle_encoding;
+  BlockHandle handle;
+  WriteBlock(&r->index_block, &handle);
+  handle.EncodeTo(&handle_encoding);
+  r->top_level_index.Add(r->last_key, handle_encoding);
+
+  if (ok() && r->full_filter_block != nullptr) {
+    WriteRawBlock(r->full_filter_block->Finish(), kNoCompression, &handle);
+    handle_encoding.clear();
+    handle.EncodeTo(&handle_encoding);
+    r->filter_index.Add(r->last_key, handle_encoding);
+    delete r->full_filter_block;
+    r->full_filter_block = new FullFilterBlockBuilder(
+        r->options.filter_policy, r->options.prefix_extractor);
+  }
+}
+
+/**
+ * 用缓存的数据训练zstd字典，然后把缓存的kv按正常流程写成data block。
+ */
+void TableBuilder::TrainDictionary() {
+  Rep* r = rep_;
+  assert(r->buffering);
+  r->buffering = false;
+
+  // Train on the buffered entries cut into blocks the way they will be
+  // written, so the dictionary sees the same restart points and shared
+  // key prefixes.
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  {
+    BlockBuilder sample_block(&r->options);
+    Slice input(r->buffered_data);
+    Slice key, value;
+    while (GetLengthPrefixedSlice(&input, &key) &&
+           GetLengthPrefixedSlice(&input, &value)) {
+      sample_block.Add(key, value);
+      if (sample_block.CurrentSizeEstimate() >= r->options.block_size ||
+          input.empty()) {
+        Slice raw = sample_block.Finish();
+        samples.append(raw.data(), raw.size());
+        sample_sizes.push_back(raw.size());
+        sample_block.Reset();
+      }
+    }
+  }
+  // Training fails when there is too little data to learn from, in which
+  // case the blocks are compressed without a dictionary.
+  if (port::Zstd_TrainDictionary(samples, sample_sizes,
+                                 r->options.zstd_max_dict_bytes,
+                                 &r->compression_dict_data)) {
+    r->compression_dict = new port::ZstdCompressionDict(
+        r->compression_dict_data.data(), r->compression_dict_data.size(),
+        r->options.zstd_compression_level);
+  }
+
+  std::string buffered_data;
+  std::vector<size_t> buffered_flushes;
+  buffered_data.swap(r->buffered_data);
+  buffered_flushes.swap(r->buffered_flushes);
+  Slice input(buffered_data);
+  Slice key, value;
+  size_t next_flush = 0;
+  while (GetLengthPrefixedSlice(&input, &key) &&
+         GetLengthPrefixedSlice(&input, &value)) {
+    AddToBlocks(key, value);
+    const size_t consumed = buffered_data.size() - input.size();
+    while (next_flush < buffered_flushes.size() &&
+           buffered_flushes[next_flush] <= consumed) {
+      Flush();
+      next_flush++;
+    }
+  }
+}
+
 /**
  * 其实就是从 block 取出数据，判断是否需要压缩，将最终结果调用WriteRawBlock。
  *
@@ -187,6 +350,16 @@ void TableBuilder::Flush() {
  * N个 data blocks, 1个 index block，1个 meta_index block，都使用这种方式写入，
  * 也就是都采用BlockBuilder构造的数据组织格式，filter block的数据格式由FilterBlockBuilder构造。
  */
+// Returns kUniqueIdLength random bytes.
+static std::string NewUniqueId() {
+  std::random_device rd;
+  std::string id;
+  while (id.size() < kUniqueIdLength) {
+    PutFixed32(&id, rd());
+  }
+  return id;
+}
+
 void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   // File format contains a sequence of blocks where each block has:
   //    block_data: uint8[n]
@@ -199,7 +372,6 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
 
   Slice block_contents;
   CompressionType type = r->options.compression;
-  // TODO(postrelease): Support more compression options: zlib?
   switch (type) {
     case kNoCompression:
       block_contents = raw;
@@ -218,6 +390,49 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
       }
       break;
     }
+
+    case kZstdCompression: {
+      std::string* compressed = &r->compressed_output;
+      // Only data blocks use the dictionary: the index and meta blocks
+      // must be readable before the dictionary is loaded.
+      port::ZstdCompressionDict* dict =
+          (block == &r->data_block) ? r->compression_dict : nullptr;
+      bool compressed_ok =
+          (dict != nullptr)
+              ? dict->Compress(raw.data(), raw.size(), compressed)
+              : port::Zstd_Compress(r->options.zstd_compression_level,
+                                    raw.data(), raw.size(), compressed);
+      if (compressed_ok &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        block_contents = *compressed;
+      } else {
+        // Zstd not supported, or compressed less than 12.5%, so just
+        // store uncompressed form
+        block_contents = raw;
+        type = kNoCompression;
+      }
+      break;
+    }
+
+    case kLZ4Compression: {
+      // An LZ4 block does not record its uncompressed length, so prefix
+      // it with one.
+      std::string* compressed = &r->compressed_output;
+      PutVarint32(compressed, static_cast<uint32_t>(raw.size()));
+      const size_t header_size = compressed->size();
+      std::string lz4;
+      if (port::Lz4_Compress(raw.data(), raw.size(), &lz4) &&
+          header_size + lz4.size() < raw.size() - (raw.size() / 8u)) {
+        compressed->append(lz4);
+        block_contents = *compressed;
+      } else {
+        // LZ4 not supported, or compressed less than 12.5%, so just
+        // store uncompressed form
+        block_contents = raw;
+        type = kNoCompression;
+      }
+      break;
+    }
   }
   WriteRawBlock(block_contents, type, handle);
   r->compressed_output.clear();
@@ -267,19 +482,52 @@ Status TableBuilder::status() const { return rep_->status; }
  */
 Status TableBuilder::Finish() {
   Rep* r = rep_;
+  if (r->buffering && ok()) {
+    TrainDictionary();
+  }
   //将最后一个data_block写入到sstable
   Flush();
   assert(!r->closed);
   r->closed = true;
 
-  BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
+  BlockHandle filter_block_handle, dictionary_block_handle,
+      metaindex_block_handle, index_block_handle;
+
+  // Add the index entry of the last data block
+  if (ok() && r->pending_index_entry) {
+    r->options.comparator->FindShortSuccessor(&r->last_key);
+    std::string handle_encoding;
+    r->pending_handle.EncodeTo(&handle_encoding);
+    r->index_block.Add(r->last_key, Slice(handle_encoding));
+    r->pending_index_entry = false;
+  }
+  if (r->partitioned && !r->index_block.empty()) {
+    CutIndexPartition();
+  }
 
   // Write filter block
   // filter block写入sstable
+  FilterBlockType filter_type = kPerBlockFilter;
   if (ok() && r->filter_block != nullptr) {
     WriteRawBlock(r->filter_block->Finish(), kNoCompression,
                   &filter_block_handle);
   }
+  if (ok() && r->full_filter_block != nullptr) {
+    if (r->partitioned) {
+      filter_type = kPartitionedFilter;
+      WriteBlock(&r->filter_index, &filter_block_handle);
+    } else {
+      filter_type = kFullFilter;
+      WriteRawBlock(r->full_filter_block->Finish(), kNoCompression,
+                    &filter_block_handle);
+    }
+  }
+
+  // Write compression dictionary block
+  if (ok() && r->compression_dict != nullptr) {
+    WriteRawBlock(r->compression_dict_data, kNoCompression,
+                  &dictionary_block_handle);
+  }
 
   // Write metaindex block
   // 写入index of filter block，这里称为meta_index_block
@@ -287,15 +535,37 @@ Status TableBuilder::Finish() {
     //meta_index_block只写入一条数据
     //key: filter.$filter_name
     //value: filter_block的起始位置和大小
-    BlockBuilder meta_index_block(&r->options);
-    if (r->filter_block != nullptr) {
-      // Add mapping from "filter.Name" to location of filter data
-      std::string key = "filter.";
-      key.append(r->options.filter_policy->Name());
+    // Meta block names are ordered bytewise, as Table::ReadMeta() expects,
+    // whatever the comparator of the table's keys.
+    Options meta_index_options = r->options;
+    meta_index_options.comparator = BytewiseComparator();
+    meta_index_options.data_block_hash_index = false;
+    BlockBuilder meta_index_block(&meta_index_options);
+    if (r->filter_block != nullptr || r->full_filter_block != nullptr) {
+      // Add mapping from "filter.Name" (or "fullfilter.Name", or
+      // "partitionedfilter.Name") to location of filter data
+      std::string key = FilterBlockName(r->options.filter_policy,
+                                        r->options.prefix_extractor,
+                                        filter_type);
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
       meta_index_block.Add(key, handle_encoding);
     }
+    if (r->partitioned) {
+      // Sorts after "partitionedfilter.*".
+      meta_index_block.Add(kPartitionedIndexBlockName, Slice());
+    }
+    if (r->options.persistent_cache != nullptr) {
+      // Sorts after "partitionedindex" and before "zstd.dictionary".  Keys
+      // the table's blocks in the cache, which a reused file number cannot.
+      meta_index_block.Add(kUniqueIdName, NewUniqueId());
+    }
+    if (r->compression_dict != nullptr) {
+      // Sorts after all of the above.
+      std::string handle_encoding;
+      dictionary_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add(kZstdDictionaryBlockName, handle_encoding);
+    }
 
     // TODO(postrelease): Add stats and other meta blocks
     WriteBlock(&meta_index_block, &metaindex_block_handle);
@@ -303,14 +573,8 @@ Status TableBuilder::Finish() {
 
   // Write index block
   if (ok()) {
-    if (r->pending_index_entry) {
-      r->options.comparator->FindShortSuccessor(&r->last_key);
-      std::string handle_encoding;
-      r->pending_handle.EncodeTo(&handle_encoding);
-      r->index_block.Add(r->last_key, Slice(handle_encoding));
-      r->pending_index_entry = false;
-    }
-    WriteBlock(&r->index_block, &index_block_handle);
+    WriteBlock(r->partitioned ? &r->top_level_index : &r->index_block,
+               &index_block_handle);
   }
 
   // Write footer
@@ -336,6 +600,10 @@ void TableBuilder::Abandon() {
 
 uint64_t TableBuilder::NumEntries() const { return rep_->num_entries; }
 
-uint64_t TableBuilder::FileSize() const { return rep_->offset; }
+uint64_t TableBuilder::FileSize() const {
+  // Count the entries still buffered for dictionary training so that
+  // callers cutting files by size see them.
+  return rep_->offset + rep_->buffered_data.size();
+}
 
 }  // namespace leveldb
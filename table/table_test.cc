@@ -4,20 +4,26 @@
 
 #include "leveldb/table.h"
 
+#include <limits>
 #include <map>
 #include <string>
 
 #include "gtest/gtest.h"
 #include "db/dbformat.h"
+#include "db/filename.h"
 #include "db/memtable.h"
+#include "db/table_cache.h"
 #include "db/write_batch_internal.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
 #include "leveldb/iterator.h"
+#include "leveldb/persistent_cache.h"
 #include "leveldb/table_builder.h"
 #include "table/block.h"
 #include "table/block_builder.h"
 #include "table/format.h"
+#include "util/coding.h"
 #include "util/random.h"
 #include "util/testutil.h"
 
@@ -376,6 +382,7 @@ struct TestArgs {
   TestType type;
   bool reverse_compare;
   int restart_interval;
+  bool partition_index;  // Only for TABLE_TEST
 };
 
 static const TestArgs kTestArgList[] = {
@@ -385,6 +392,8 @@ static const TestArgs kTestArgList[] = {
     {TABLE_TEST, true, 16},
     {TABLE_TEST, true, 1},
     {TABLE_TEST, true, 1024},
+    {TABLE_TEST, false, 16, true},
+    {TABLE_TEST, true, 1, true},
 
     {BLOCK_TEST, false, 16},
     {BLOCK_TEST, false, 1},
@@ -416,6 +425,10 @@ class Harness : public testing::Test {
     // Use shorter block size for tests to exercise block boundary
     // conditions more.
     options_.block_size = 256;
+    if (args.partition_index) {
+      options_.partition_index_and_filters = true;
+      options_.metadata_block_size = 64;  // A few data blocks per partition
+    }
     if (args.reverse_compare) {
       options_.comparator = &reverse_key_comparator;
     }
@@ -721,6 +734,86 @@ TEST_F(Harness, RandomizedLongDB) {
   ASSERT_GT(files, 0);
 }
 
+TEST(BlockTest, HashIndex) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  Options options;
+  options.comparator = &cmp;
+  options.data_block_hash_index = true;
+  BlockBuilder builder(&options);
+  // Two versions of every even key
+  const int N = 200;
+  char buf[16];
+  for (int i = 0; i < N; i += 2) {
+    std::snprintf(buf, sizeof(buf), "key%05d", i);
+    builder.Add(InternalKey(buf, 20, kTypeValue).Encode(), "new");
+    builder.Add(InternalKey(buf, 10, kTypeValue).Encode(), "old");
+  }
+  std::string data = builder.Finish().ToString();
+  ASSERT_NE(0, DecodeFixed32(data.data() + data.size() - 4) & kHashIndexFlag);
+
+  BlockContents contents;
+  contents.data = data;
+  contents.cachable = false;
+  contents.heap_allocated = false;
+  Block block(contents);
+  Iterator* iter = block.NewLookupIterator(&cmp);
+  for (int i = 0; i < N; i++) {
+    std::snprintf(buf, sizeof(buf), "key%05d", i);
+    iter->Seek(InternalKey(buf, 15, kValueTypeForSeek).Encode());
+    if (i % 2 == 0) {
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(buf, ExtractUserKey(iter->key()).ToString());
+      ASSERT_EQ("old", iter->value().ToString());
+      iter->Seek(InternalKey(buf, 30, kValueTypeForSeek).Encode());
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ("new", iter->value().ToString());
+    } else {
+      ASSERT_TRUE(!iter->Valid() ||
+                  ExtractUserKey(iter->key()) != Slice(buf));
+    }
+  }
+  delete iter;
+
+  // Other iterators ignore the index.
+  iter = block.NewIterator(&cmp);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  ASSERT_EQ(N, count);
+  iter->Seek(InternalKey("key00001", 15, kValueTypeForSeek).Encode());
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("key00002", ExtractUserKey(iter->key()).ToString());
+  delete iter;
+}
+
+TEST(BlockTest, HashIndexUtilRatioIsClipped) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  const int N = 100;
+  char buf[16];
+  size_t min_size = 0;
+  for (double ratio : {0.1, 0.0, -1.0, 1e-300,
+                       std::numeric_limits<double>::quiet_NaN(), 1e300}) {
+    Options options;
+    options.comparator = &cmp;
+    options.data_block_hash_index = true;
+    options.data_block_hash_table_util_ratio = ratio;
+    BlockBuilder builder(&options);
+    for (int i = 0; i < N; i++) {
+      std::snprintf(buf, sizeof(buf), "key%05d", i);
+      builder.Add(InternalKey(buf, 10, kTypeValue).Encode(), "value");
+    }
+    const size_t size = builder.Finish().size();
+    if (ratio == 0.1) {
+      min_size = size;  // The largest index allowed
+    } else if (ratio == 1e300) {
+      ASSERT_LT(size, min_size);
+    } else {
+      ASSERT_EQ(min_size, size) << ratio;
+    }
+  }
+}
+
 TEST(MemTableTest, Simple) {
   InternalKeyComparator cmp(BytewiseComparator());
   MemTable* memtable = new MemTable(cmp);
@@ -784,44 +877,441 @@ TEST(TableTest, ApproximateOffsetOfPlain) {
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 610000, 612000));
 }
 
-static bool SnappyCompressionSupported() {
+static bool CompressionSupported(CompressionType type) {
   std::string out;
   Slice in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
-  return port::Snappy_Compress(in.data(), in.size(), &out);
+  switch (type) {
+    case kSnappyCompression:
+      return port::Snappy_Compress(in.data(), in.size(), &out);
+    case kZstdCompression:
+      return port::Zstd_Compress(/*level=*/1, in.data(), in.size(), &out);
+    case kLZ4Compression:
+      return port::Lz4_Compress(in.data(), in.size(), &out);
+    default:
+      return false;
+  }
 }
 
 TEST(TableTest, ApproximateOffsetOfCompressed) {
-  if (!SnappyCompressionSupported())
+  int tested = 0;
+  for (CompressionType type :
+       {kSnappyCompression, kZstdCompression, kLZ4Compression}) {
+    if (!CompressionSupported(type)) {
+      continue;
+    }
+    tested++;
+
+    Random rnd(301);
+    TableConstructor c(BytewiseComparator());
+    std::string tmp;
+    c.Add("k01", "hello");
+    c.Add("k02", test::CompressibleString(&rnd, 0.25, 10000, &tmp));
+    c.Add("k03", "hello3");
+    c.Add("k04", test::CompressibleString(&rnd, 0.25, 10000, &tmp));
+    std::vector<std::string> keys;
+    KVMap kvmap;
+    Options options;
+    options.block_size = 1024;
+    options.compression = type;
+    c.Finish(options, &keys, &kvmap);
+
+    // Expected upper and lower bounds of space used by compressible strings.
+    static const int kSlop = 1000;  // Compressor effectiveness varies.
+    const int expected = 2500;      // 10000 * compression ratio (0.25)
+    const int min_z = expected - kSlop;
+    const int max_z = expected + kSlop;
+
+    ASSERT_TRUE(Between(c.ApproximateOffsetOf("abc"), 0, kSlop));
+    ASSERT_TRUE(Between(c.ApproximateOffsetOf("k01"), 0, kSlop));
+    ASSERT_TRUE(Between(c.ApproximateOffsetOf("k02"), 0, kSlop));
+    // Have now emitted a large compressible string, so adjust expected
+    // offset.
+    ASSERT_TRUE(Between(c.ApproximateOffsetOf("k03"), min_z, max_z));
+    ASSERT_TRUE(Between(c.ApproximateOffsetOf("k04"), min_z, max_z));
+    // Have now emitted two large compressible strings, so adjust expected
+    // offset.
+    ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 2 * min_z, 2 * max_z));
+
+    // The compressed blocks must read back intact.
+    Iterator* iter = c.NewIterator();
+    auto model = kvmap.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++model) {
+      ASSERT_TRUE(model != kvmap.end());
+      ASSERT_EQ(model->first, iter->key().ToString());
+      ASSERT_EQ(model->second, iter->value().ToString());
+    }
+    ASSERT_TRUE(model == kvmap.end());
+    delete iter;
+  }
+  if (tested == 0) {
     GTEST_SKIP() << "skipping compression tests";
+  }
+}
+
+// A StringSource that counts its reads.
+class CountingStringSource : public StringSource {
+ public:
+  CountingStringSource(const Slice& contents)
+      : StringSource(contents), reads_(0) {}
+
+  Status Read(uint64_t offset, size_t n, Slice* result,
+              char* scratch) const override {
+    reads_++;
+    return StringSource::Read(offset, n, result, scratch);
+  }
+
+  int reads() const { return reads_; }
+
+ private:
+  mutable int reads_;
+};
+
+TEST(TableTest, CompressedBlockCache) {
+  int tested = 0;
+  for (CompressionType type :
+       {kSnappyCompression, kZstdCompression, kLZ4Compression}) {
+    if (!CompressionSupported(type)) {
+      continue;
+    }
+    tested++;
+
+    Random rnd(301);
+    std::string tmp;
+    Options options;
+    options.block_size = 1024;
+    options.compression = type;
+    StringSink sink;
+    TableBuilder builder(options, &sink);
+    for (int i = 0; i < 100; i++) {
+      char key[20];
+      std::snprintf(key, sizeof(key), "key%06d", i);
+      builder.Add(key, test::CompressibleString(&rnd, 0.25, 500, &tmp));
+    }
+    ASSERT_LEVELDB_OK(builder.Finish());
+    const int kNumBlocks = 100 / 2;  // Two entries fill a block
+
+    // Nothing stays in the block cache, so every block read after the
+    // first scan comes from the compressed block cache.
+    Options table_options;
+    table_options.block_cache = NewLRUCache(0);
+    table_options.compressed_block_cache = NewLRUCache(1 << 20);
+    CountingStringSource source(sink.contents());
+    Table* table;
+    ASSERT_LEVELDB_OK(Table::Open(table_options, &source,
+                                  sink.contents().size(), &table));
+    std::string first_scan;
+    for (int scan = 0; scan < 2; scan++) {
+      const int reads_before = source.reads();
+      Iterator* iter = table->NewIterator(ReadOptions());
+      std::string contents;
+      for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        contents += iter->key().ToString() + iter->value().ToString();
+      }
+      ASSERT_LEVELDB_OK(iter->status());
+      delete iter;
+      if (scan == 0) {
+        ASSERT_GE(source.reads() - reads_before, kNumBlocks);
+        first_scan = contents;
+      } else {
+        ASSERT_EQ(reads_before, source.reads());
+        ASSERT_EQ(first_scan, contents);
+      }
+    }
+    ASSERT_GT(table_options.compressed_block_cache->TotalCharge(), 0);
+    ASSERT_LT(table_options.compressed_block_cache->TotalCharge(),
+              sink.contents().size());
+
+    delete table;
+    delete table_options.block_cache;
+    delete table_options.compressed_block_cache;
+  }
+  if (tested == 0) {
+    GTEST_SKIP() << "skipping compression tests";
+  }
+}
+
+// A StringSource that records the prefetches asked of it.
+class PrefetchRecordingSource : public StringSource {
+ public:
+  PrefetchRecordingSource(const Slice& contents) : StringSource(contents) {}
+
+  void Prefetch(uint64_t offset, size_t n) const override {
+    prefetches_.emplace_back(offset, n);
+  }
+
+  const std::vector<std::pair<uint64_t, size_t>>& prefetches() const {
+    return prefetches_;
+  }
+  void Clear() { prefetches_.clear(); }
 
+ private:
+  mutable std::vector<std::pair<uint64_t, size_t>> prefetches_;
+};
+
+TEST(TableTest, Readahead) {
   Random rnd(301);
-  TableConstructor c(BytewiseComparator());
   std::string tmp;
-  c.Add("k01", "hello");
-  c.Add("k02", test::CompressibleString(&rnd, 0.25, 10000, &tmp));
-  c.Add("k03", "hello3");
-  c.Add("k04", test::CompressibleString(&rnd, 0.25, 10000, &tmp));
-  std::vector<std::string> keys;
-  KVMap kvmap;
   Options options;
   options.block_size = 1024;
-  options.compression = kSnappyCompression;
-  c.Finish(options, &keys, &kvmap);
+  options.compression = kNoCompression;
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  for (int i = 0; i < 1000; i++) {
+    char key[20];
+    std::snprintf(key, sizeof(key), "key%06d", i);
+    builder.Add(key, test::RandomString(&rnd, 500, &tmp));
+  }
+  ASSERT_LEVELDB_OK(builder.Finish());
+
+  Options table_options;
+  table_options.block_cache = NewLRUCache(0);
+  PrefetchRecordingSource source(sink.contents());
+  Table* table;
+  ASSERT_LEVELDB_OK(
+      Table::Open(table_options, &source, sink.contents().size(), &table));
+
+  const size_t kMaxReadahead = 64 * 1024;
+  ReadOptions read_options;
+  read_options.readahead_size = kMaxReadahead;
+  Iterator* iter = table->NewIterator(read_options);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  ASSERT_LEVELDB_OK(iter->status());
+  ASSERT_EQ(1000, count);
+
+  // The readahead starts small, grows up to the maximum, and never asks
+  // for the same bytes twice.
+  const auto& prefetches = source.prefetches();
+  ASSERT_GT(prefetches.size(), 2);
+  ASSERT_EQ(8 * 1024, prefetches[0].second);
+  ASSERT_EQ(kMaxReadahead, prefetches.back().second);
+  for (size_t i = 1; i < prefetches.size(); i++) {
+    ASSERT_EQ(prefetches[i - 1].first + prefetches[i - 1].second,
+              prefetches[i].first);
+    ASSERT_GE(prefetches[i].second, prefetches[i - 1].second);
+  }
+
+  // Seeks that skip blocks do not read ahead.
+  source.Clear();
+  for (int i = 990; i >= 0; i -= 10) {
+    char key[20];
+    std::snprintf(key, sizeof(key), "key%06d", i);
+    iter->Seek(key);
+    ASSERT_TRUE(iter->Valid());
+  }
+  ASSERT_TRUE(source.prefetches().empty());
+  delete iter;
+
+  // Nor does an iterator without readahead.
+  iter = table->NewIterator(ReadOptions());
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+  }
+  ASSERT_LEVELDB_OK(iter->status());
+  ASSERT_TRUE(source.prefetches().empty());
+  delete iter;
+
+  delete table;
+  delete table_options.block_cache;
+}
+
+// A StringSource whose reads at one offset fail.
+class FailingStringSource : public StringSource {
+ public:
+  FailingStringSource(const Slice& contents, uint64_t failing_offset)
+      : StringSource(contents), failing_offset_(failing_offset) {}
+
+  Status Read(uint64_t offset, size_t n, Slice* result,
+              char* scratch) const override {
+    if (offset == failing_offset_) {
+      return Status::IOError("injected read error");
+    }
+    return StringSource::Read(offset, n, result, scratch);
+  }
+
+ private:
+  const uint64_t failing_offset_;
+};
+
+TEST(TableTest, OpenFailsWithoutMetaindex) {
+  Options options;
+  options.block_size = 256;
+  options.partition_index_and_filters = true;
+  options.filter_policy = NewBloomFilterPolicy(10);
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  for (int i = 0; i < 100; i++) {
+    char key[20];
+    std::snprintf(key, sizeof(key), "key%06d", i);
+    builder.Add(key, "value");
+  }
+  ASSERT_LEVELDB_OK(builder.Finish());
+
+  const std::string& contents = sink.contents();
+  Footer footer;
+  Slice footer_input(contents.data() + contents.size() - Footer::kEncodedLength,
+                     Footer::kEncodedLength);
+  ASSERT_LEVELDB_OK(footer.DecodeFrom(&footer_input));
+
+  // Without the metaindex, the partitioned index would be taken for a
+  // plain one.
+  FailingStringSource source(contents, footer.metaindex_handle().offset());
+  Table* table = nullptr;
+  Status s = Table::Open(options, &source, contents.size(), &table);
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  ASSERT_EQ(nullptr, table);
+
+  delete options.filter_policy;
+}
 
-  // Expected upper and lower bounds of space used by compressible strings.
-  static const int kSlop = 1000;  // Compressor effectiveness varies.
-  const int expected = 2500;      // 10000 * compression ratio (0.25)
-  const int min_z = expected - kSlop;
-  const int max_z = expected + kSlop;
-
-  ASSERT_TRUE(Between(c.ApproximateOffsetOf("abc"), 0, kSlop));
-  ASSERT_TRUE(Between(c.ApproximateOffsetOf("k01"), 0, kSlop));
-  ASSERT_TRUE(Between(c.ApproximateOffsetOf("k02"), 0, kSlop));
-  // Have now emitted a large compressible string, so adjust expected offset.
-  ASSERT_TRUE(Between(c.ApproximateOffsetOf("k03"), min_z, max_z));
-  ASSERT_TRUE(Between(c.ApproximateOffsetOf("k04"), min_z, max_z));
-  // Have now emitted two large compressible strings, so adjust expected offset.
-  ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 2 * min_z, 2 * max_z));
+// A PersistentCache in memory that counts its hits.
+class MemPersistentCache : public PersistentCache {
+ public:
+  void Insert(const Slice& key, const Slice& data) override {
+    blocks_.emplace(key.ToString(), data.ToString());
+  }
+
+  bool Lookup(const Slice& key, std::string* data) override {
+    auto it = blocks_.find(key.ToString());
+    if (it == blocks_.end()) {
+      return false;
+    }
+    hits_++;
+    *data = it->second;
+    return true;
+  }
+
+  int hits() const { return hits_; }
+
+ private:
+  std::map<std::string, std::string> blocks_;
+  int hits_ = 0;
+};
+
+// Writes table file "number" of "dbname", mapping each key to "value".
+static void WriteTableFile(const Options& options, const std::string& dbname,
+                           uint64_t number, const std::string& value) {
+  WritableFile* file;
+  ASSERT_LEVELDB_OK(
+      options.env->NewWritableFile(TableFileName(dbname, number), &file));
+  TableBuilder builder(options, file);
+  for (int i = 0; i < 100; i++) {
+    char key[20];
+    std::snprintf(key, sizeof(key), "key%06d", i);
+    builder.Add(key, value);
+  }
+  ASSERT_LEVELDB_OK(builder.Finish());
+  ASSERT_LEVELDB_OK(file->Close());
+  delete file;
+}
+
+// Returns the values of table file "number", separated by commas.
+static std::string ReadTableFile(TableCache* table_cache, uint64_t number,
+                                 uint64_t file_size) {
+  std::string result;
+  Iterator* iter = table_cache->NewIterator(ReadOptions(), number, file_size);
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    if (!result.empty()) {
+      result += ",";
+    }
+    result += iter->value().ToString();
+  }
+  EXPECT_LEVELDB_OK(iter->status());
+  delete iter;
+  return result;
+}
+
+TEST(TableTest, PersistentCacheFileNumberReuse) {
+  MemPersistentCache persistent_cache;
+  Options options;
+  options.env = Env::Default();
+  options.block_size = 256;
+  options.compression = kNoCompression;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.persistent_cache = &persistent_cache;
+  std::string dbname = testing::TempDir() + "table_test_file_number_reuse";
+  options.env->CreateDir(dbname);
+
+  // Fill the cache with the blocks of a table file.
+  const uint64_t kNumber = 7;
+  uint64_t file_size;
+  WriteTableFile(options, dbname, kNumber, "first");
+  ASSERT_LEVELDB_OK(
+      options.env->GetFileSize(TableFileName(dbname, kNumber), &file_size));
+  TableCache table_cache(dbname, options, 10);
+  std::string first = ReadTableFile(&table_cache, kNumber, file_size);
+  table_cache.Evict(kNumber);
+  ASSERT_EQ(first, ReadTableFile(&table_cache, kNumber, file_size));
+  ASSERT_GT(persistent_cache.hits(), 0);
+  table_cache.Evict(kNumber);
+
+  // A crash before the file reaches the MANIFEST lets the database give
+  // its number to another table of the same size, which must not be
+  // served the blocks of the first.
+  WriteTableFile(options, dbname, kNumber, "other");
+  uint64_t new_size;
+  ASSERT_LEVELDB_OK(
+      options.env->GetFileSize(TableFileName(dbname, kNumber), &new_size));
+  ASSERT_EQ(file_size, new_size);
+  std::string other = ReadTableFile(&table_cache, kNumber, file_size);
+  ASSERT_EQ(std::string::npos, other.find("first"));
+  ASSERT_NE(std::string::npos, other.find("other"));
+
+  table_cache.Evict(kNumber);
+  options.env->RemoveFile(TableFileName(dbname, kNumber));
+  options.env->RemoveDir(dbname);
+  delete options.block_cache;
+}
+
+TEST(TableTest, ZstdDictionary) {
+  if (!CompressionSupported(kZstdCompression)) {
+    GTEST_SKIP() << "skipping zstd dictionary test";
+  }
+
+  // Small records that share most of their bytes with other blocks but
+  // little within a block: the case dictionaries are for.
+  Random rnd(301);
+  std::vector<std::string> phrases(20);
+  for (std::string& phrase : phrases) {
+    test::RandomString(&rnd, 40, &phrase);
+  }
+  uint64_t sizes[2];
+  for (int use_dict = 0; use_dict < 2; use_dict++) {
+    TableConstructor c(BytewiseComparator());
+    Random value_rnd(301);
+    for (int i = 0; i < 2000; i++) {
+      char key[20];
+      std::snprintf(key, sizeof(key), "key%06d", i);
+      c.Add(key, phrases[value_rnd.Uniform(phrases.size())] +
+                     phrases[value_rnd.Uniform(phrases.size())]);
+    }
+    std::vector<std::string> keys;
+    KVMap kvmap;
+    Options options;
+    options.block_size = 256;
+    options.compression = kZstdCompression;
+    if (use_dict) {
+      options.zstd_max_dict_bytes = 4096;
+      // Train part way through the table, so that entries are both
+      // replayed from the training buffer and added directly.
+      options.zstd_max_train_bytes = 64 * 1024;
+    }
+    c.Finish(options, &keys, &kvmap);
+    sizes[use_dict] = c.ApproximateOffsetOf("xyz");
+
+    Iterator* iter = c.NewIterator();
+    auto model = kvmap.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++model) {
+      ASSERT_TRUE(model != kvmap.end());
+      ASSERT_EQ(model->first, iter->key().ToString());
+      ASSERT_EQ(model->second, iter->value().ToString());
+    }
+    ASSERT_TRUE(iter->status().ok()) << iter->status().ToString();
+    ASSERT_TRUE(model == kvmap.end());
+    delete iter;
+  }
+  ASSERT_LT(sizes[1], sizes[0] / 2);
 }
 
 }  // namespace leveldb
@@ -4,6 +4,9 @@
 
 #include "table/two_level_iterator.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "leveldb/table.h"
 #include "table/block.h"
 #include "table/format.h"
@@ -14,6 +17,12 @@ namespace leveldb {
 namespace {
 
 typedef Iterator* (*BlockFunction)(void*, const ReadOptions&, const Slice&);
+typedef bool (*PrefixMayMatchFunction)(void*, const Slice&, const Slice&,
+                                       const Slice&);
+typedef void (*PrefetchFunction)(void*, uint64_t, size_t);
+
+// Readahead size once the second block in a row is read sequentially.
+static const size_t kInitialReadaheadSize = 8 * 1024;
 
 /**
  * sstable的迭代器。
@@ -23,7 +32,9 @@ typedef Iterator* (*BlockFunction)(void*, const ReadOptions&, const Slice&);
 class TwoLevelIterator : public Iterator {
  public:
   TwoLevelIterator(Iterator* index_iter, BlockFunction block_function,
-                   void* arg, const ReadOptions& options);
+                   void* arg, const ReadOptions& options,
+                   PrefixMayMatchFunction prefix_may_match,
+                   PrefetchFunction prefetch);
 
   ~TwoLevelIterator() override;
 
@@ -61,8 +72,20 @@ class TwoLevelIterator : public Iterator {
   void SkipEmptyDataBlocksBackward();
   void SetDataIterator(Iterator* data_iter);
   void InitDataBlock();
+  // Prefetch the bytes that follow the block at "index_value" if it follows
+  // the previous block read and they have not been prefetched yet.
+  void MaybeReadahead(const Slice& index_value);
+  // False if the block at index_iter_ holds no key with the prefix of the
+  // last seek target.  Always true outside of prefix mode.
+  bool BlockMayMatchPrefix() {
+    return !prefix_mode_ ||
+           (*prefix_may_match_)(arg_, prefix_target_, index_iter_.key(),
+                                index_iter_.value());
+  }
 
   BlockFunction block_function_;
+  PrefixMayMatchFunction prefix_may_match_;
+  PrefetchFunction prefetch_;
   void* arg_;
   const ReadOptions options_;
   Status status_;
@@ -71,16 +94,34 @@ class TwoLevelIterator : public Iterator {
   // If data_iter_ is non-null, then "data_block_handle_" holds the
   // "index_value" passed to block_function_ to create the data_iter_.
   std::string data_block_handle_;
+  // Set by a Seek() with options_.prefix_same_as_start, until the next
+  // SeekToFirst(), SeekToLast() or Prev().
+  bool prefix_mode_;
+  std::string prefix_target_;
+  // File offset right after the last block read, the end of the bytes
+  // prefetched so far, and the size of the next readahead (0 until two
+  // blocks in a row are read).
+  uint64_t next_block_offset_;
+  uint64_t readahead_limit_;
+  size_t readahead_size_;
 };
 
 TwoLevelIterator::TwoLevelIterator(Iterator* index_iter,
                                    BlockFunction block_function, void* arg,
-                                   const ReadOptions& options)
+                                   const ReadOptions& options,
+                                   PrefixMayMatchFunction prefix_may_match,
+                                   PrefetchFunction prefetch)
     : block_function_(block_function),
+      prefix_may_match_(prefix_may_match),
+      prefetch_(options.readahead_size > 0 ? prefetch : nullptr),
       arg_(arg),
       options_(options),
       index_iter_(index_iter),
-      data_iter_(nullptr) {}
+      data_iter_(nullptr),
+      prefix_mode_(false),
+      next_block_offset_(std::numeric_limits<uint64_t>::max()),
+      readahead_limit_(0),
+      readahead_size_(0) {}
 
 TwoLevelIterator::~TwoLevelIterator() = default;
 
@@ -94,7 +135,20 @@ void TwoLevelIterator::Seek(const Slice& target) {
   // index_iter_就是class Block::Iter类。
   // 先在 index block 找到第一个>= target 的k:v, v是某个data_block的size&offset。
   // 查找第一个 >= target的 entry。
+  prefix_mode_ = prefix_may_match_ != nullptr && options_.prefix_same_as_start;
+  if (prefix_mode_) {
+    prefix_target_.assign(target.data(), target.size());
+  }
   index_iter_.Seek(target);
+  if (index_iter_.Valid() && !BlockMayMatchPrefix()) {
+    // The block found may end before target, in which case the keys with
+    // its prefix can still start in the next block.
+    index_iter_.Next();
+    if (index_iter_.Valid() && !BlockMayMatchPrefix()) {
+      SetDataIterator(nullptr);
+      return;
+    }
+  }
   // 根据v读取data_block，data_iter_是向该data_block的迭代器。
   InitDataBlock();
   // 根据data_block的迭代器找到target。
@@ -106,6 +160,7 @@ void TwoLevelIterator::Seek(const Slice& target) {
  * 指向index_block和对应data_block的第一条数据。
  */
 void TwoLevelIterator::SeekToFirst() {
+  prefix_mode_ = false;
   index_iter_.SeekToFirst();
   InitDataBlock();
   if (data_iter_.iter() != nullptr) data_iter_.SeekToFirst();
@@ -113,6 +168,7 @@ void TwoLevelIterator::SeekToFirst() {
 }
 
 void TwoLevelIterator::SeekToLast() {
+  prefix_mode_ = false;
   index_iter_.SeekToLast();
   InitDataBlock();
   if (data_iter_.iter() != nullptr) data_iter_.SeekToLast();
@@ -133,6 +189,7 @@ void TwoLevelIterator::Next() {
 
 void TwoLevelIterator::Prev() {
   assert(Valid());
+  prefix_mode_ = false;
   data_iter_.Prev();
   SkipEmptyDataBlocksBackward();
 }
@@ -145,6 +202,12 @@ void TwoLevelIterator::SkipEmptyDataBlocksForward() {
       return;
     }
     index_iter_.Next();
+    if (index_iter_.Valid() && !BlockMayMatchPrefix()) {
+      // All of the keys of this block come after the seek target, and none
+      // of them has its prefix: the keys with the prefix are behind us.
+      SetDataIterator(nullptr);
+      return;
+    }
     InitDataBlock();
     if (data_iter_.iter() != nullptr) data_iter_.SeekToFirst();
   }
@@ -185,6 +248,9 @@ void TwoLevelIterator::InitDataBlock() {
       // block_function_ == BlockReader(const_cast<Table*>(this),options_,handle)
       // handle：index_block中entity的value值，即：data_block的偏移位置。
       // 词句含义：根据handle所定位的块构建一个data_block的迭代器。
+      if (prefetch_ != nullptr) {
+        MaybeReadahead(handle);
+      }
       Iterator* iter = (*block_function_)(arg_, options_, handle);
       data_block_handle_.assign(handle.data(), handle.size());
       // 根据index_block的迭代器构建出data_block的迭代器，给Rep中的迭代器赋值。
@@ -193,12 +259,40 @@ void TwoLevelIterator::InitDataBlock() {
   }
 }
 
+void TwoLevelIterator::MaybeReadahead(const Slice& index_value) {
+  BlockHandle handle;
+  Slice input = index_value;
+  if (!handle.DecodeFrom(&input).ok()) {
+    return;
+  }
+  const uint64_t offset = handle.offset();
+  const uint64_t end = offset + handle.size() + kBlockTrailerSize;
+  if (offset != next_block_offset_) {
+    // A seek or a backward step: wait for sequential reads again.
+    readahead_size_ = 0;
+  } else if (readahead_size_ == 0) {
+    readahead_size_ = std::min(kInitialReadaheadSize, options_.readahead_size);
+    readahead_limit_ = end;
+  }
+  // Stay at least half a readahead ahead of the reads.
+  if (readahead_size_ > 0 && readahead_limit_ < end + readahead_size_ / 2) {
+    const uint64_t start = std::max(readahead_limit_, end);
+    (*prefetch_)(arg_, start, readahead_size_);
+    readahead_limit_ = start + readahead_size_;
+    readahead_size_ = std::min(readahead_size_ * 2, options_.readahead_size);
+  }
+  next_block_offset_ = end;
+}
+
 }  // namespace
 
 Iterator* NewTwoLevelIterator(Iterator* index_iter,
                               BlockFunction block_function, void* arg,
-                              const ReadOptions& options) {
-  return new TwoLevelIterator(index_iter, block_function, arg, options);
+                              const ReadOptions& options,
+                              PrefixMayMatchFunction prefix_may_match,
+                              PrefetchFunction prefetch) {
+  return new TwoLevelIterator(index_iter, block_function, arg, options,
+                              prefix_may_match, prefetch);
 }
 
 }  // namespace leveldb
@@ -5,6 +5,9 @@
 #ifndef STORAGE_LEVELDB_TABLE_TWO_LEVEL_ITERATOR_H_
 #define STORAGE_LEVELDB_TABLE_TWO_LEVEL_ITERATOR_H_
 
+#include <cstddef>
+#include <cstdint>
+
 #include "leveldb/iterator.h"
 
 namespace leveldb {
@@ -20,11 +23,28 @@ struct ReadOptions;
 //
 // Uses a supplied function to convert an index_iter value into
 // an iterator over the contents of the corresponding block.
+//
+// If "prefix_may_match" is non-null and options.prefix_same_as_start is
+// set, Seek(target) skips the blocks for which
+// (*prefix_may_match)(arg, target, index_key, index_value) returns false,
+// i.e. that hold no key sharing target's prefix, and the iterator becomes
+// invalid at the first such block past the keys with that prefix.  The
+// caller is responsible for stopping at the first key with another prefix.
+//
+// If "prefetch" is non-null, the index values must be encoded BlockHandles
+// of blocks in one file.  When options.readahead_size is non-zero and
+// blocks are read one after the other, the iterator calls
+// (*prefetch)(arg, offset, n) to ask for the "n" bytes of the file that
+// follow the block just read to be fetched ahead of time.
 Iterator* NewTwoLevelIterator(
     Iterator* index_iter,
     Iterator* (*block_function)(void* arg, const ReadOptions& options,
                                 const Slice& index_value),
-    void* arg, const ReadOptions& options);
+    void* arg, const ReadOptions& options,
+    bool (*prefix_may_match)(void* arg, const Slice& target,
+                             const Slice& index_key,
+                             const Slice& index_value) = nullptr,
+    void (*prefetch)(void* arg, uint64_t offset, size_t n) = nullptr);
 
 }  // namespace leveldb
 
@@ -11,6 +11,9 @@
 #include <cstdint>
 #include <vector>
 
+#include "port/port.h"
+#include "port/thread_annotations.h"
+
 namespace leveldb {
 
 class Arena {
@@ -28,6 +31,12 @@ class Arena {
   // Allocate memory with the normal alignment guarantees provided by malloc.
   char* AllocateAligned(size_t bytes);
 
+  // Same as Allocate() and AllocateAligned(), except that these may be
+  // called from several threads at once.  REQUIRES: no concurrent call to
+  // the unsynchronized versions.
+  char* AllocateConcurrently(size_t bytes) LOCKS_EXCLUDED(mu_);
+  char* AllocateAlignedConcurrently(size_t bytes) LOCKS_EXCLUDED(mu_);
+
   // Returns an estimate of the total memory usage of data allocated
   // by the arena.
   size_t MemoryUsage() const {
@@ -45,6 +54,9 @@ class Arena {
   // Array of new[] allocated memory blocks
   std::vector<char*> blocks_;
 
+  // Serializes AllocateConcurrently() and AllocateAlignedConcurrently().
+  port::Mutex mu_;
+
   // Total memory usage of the arena.
   //
   // TODO(costan): This member is accessed via atomics, but the others are
@@ -23,6 +23,13 @@ class BloomTest : public testing::Test {
 
   ~BloomTest() { delete policy_; }
 
+  // Switches to "policy", which is deleted with *this.
+  void UsePolicy(const FilterPolicy* policy) {
+    delete policy_;
+    policy_ = policy;
+    Reset();
+  }
+
   void Reset() {
     keys_.clear();
     filter_.clear();
@@ -73,6 +80,11 @@ class BloomTest : public testing::Test {
     return result / 10000.0;
   }
 
+  // Checks the size, the absence of false negatives, and the false
+  // positive rate of filters over many key counts at 10 bits per key.
+  // Filters may be up to "extra_bytes" larger than 10 bits per key.
+  void CheckVaryingLengths(size_t extra_bytes);
+
  private:
   const FilterPolicy* policy_;
   std::string filter_;
@@ -106,7 +118,7 @@ static int NextLength(int length) {
   return length;
 }
 
-TEST_F(BloomTest, VaryingLengths) {
+void BloomTest::CheckVaryingLengths(size_t extra_bytes) {
   char buffer[sizeof(int)];
 
   // Count number of filters that significantly exceed the false positive rate
@@ -120,7 +132,8 @@ TEST_F(BloomTest, VaryingLengths) {
     }
     Build();
 
-    ASSERT_LE(FilterSize(), static_cast<size_t>((length * 10 / 8) + 40))
+    ASSERT_LE(FilterSize(),
+              static_cast<size_t>(length * 10 / 8) + extra_bytes)
         << length;
 
     // All added keys must match
@@ -149,6 +162,67 @@ TEST_F(BloomTest, VaryingLengths) {
   ASSERT_LE(mediocre_filters, good_filters / 5);
 }
 
+TEST_F(BloomTest, VaryingLengths) {
+  CheckVaryingLengths(/*extra_bytes=*/40);
+}
+
+TEST_F(BloomTest, BlockedEmptyFilter) {
+  UsePolicy(NewBlockedBloomFilterPolicy(10));
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+}
+
+TEST_F(BloomTest, BlockedSmall) {
+  UsePolicy(NewBlockedBloomFilterPolicy(10));
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(BloomTest, BlockedVaryingLengths) {
+  UsePolicy(NewBlockedBloomFilterPolicy(10));
+  // Filters are rounded up to whole 64-byte lines.
+  CheckVaryingLengths(/*extra_bytes=*/65);
+}
+
+TEST_F(BloomTest, RibbonEmptyFilter) {
+  UsePolicy(NewRibbonFilterPolicy(10));
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+}
+
+TEST_F(BloomTest, RibbonSmall) {
+  UsePolicy(NewRibbonFilterPolicy(10));
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(BloomTest, RibbonVaryingLengths) {
+  UsePolicy(NewRibbonFilterPolicy(10));
+  // Filters span at least 128 slots of 7 bits.
+  CheckVaryingLengths(/*extra_bytes=*/114);
+}
+
+TEST_F(BloomTest, RibbonSize) {
+  UsePolicy(NewRibbonFilterPolicy(10));
+  char buffer[sizeof(int)];
+  const int kKeys = 100000;
+  for (int i = 0; i < kKeys; i++) {
+    Add(Key(i, buffer));
+  }
+  Build();
+  // Bloom filters take 10 bits per key for the same false positive rate.
+  ASSERT_LE(FilterSize() * 8, kKeys * 7.6);
+  ASSERT_LE(FalsePositiveRate(), 0.0125);
+}
+
 // Different bits-per-byte
 
 }  // namespace leveldb
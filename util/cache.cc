@@ -18,6 +18,12 @@ namespace leveldb {
 
 Cache::~Cache() {}
 
+Cache::Handle* Cache::Insert(const Slice& key, void* value, size_t charge,
+                             void (*deleter)(const Slice& key, void* value),
+                             Priority priority) {
+  return Insert(key, value, charge, deleter);
+}
+
 namespace {
 
 // LRU cache implementation
@@ -35,6 +41,9 @@ namespace {
 //   removed the check, elements that would otherwise be on this list could be
 //   left as disconnected singleton lists.)
 // - LRU:  contains the items not currently referenced by clients, in LRU order
+// - high-pri LRU:  like LRU, for the high priority items that fit in the
+//   high priority pool.  Items overflowing the pool move to the LRU list,
+//   which is evicted first.
 // Elements are moved between these lists by the Ref() and Unref() methods,
 // when they detect an element in the cache acquiring or losing its only
 // external reference.
@@ -64,6 +73,9 @@ struct LRUHandle {
   size_t key_length;
   // 当前项是否在缓存中
   bool in_cache;     // Whether entry is in the cache.
+  // 是否以高优先级插入
+  bool is_high_pri;       // Whether entry was inserted with kHighPriority.
+  bool in_high_pri_pool;  // Whether entry is on the high-pri LRU list.
   // 引用计数，用于删除数据
   // refs==0：节点将被销毁，refs==1：节点在lru_中，refs==2：节点在in_use_中
   uint32_t refs;     // References, including cache reference, if present.
@@ -211,12 +223,20 @@ class LRUCache {
 
   // Separate from constructor so caller can easily make an array of LRUCache
   // 缓存容量默认15
-  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+  void SetCapacity(size_t capacity, double high_pri_pool_ratio) {
+    capacity_ = capacity;
+    high_pri_pool_capacity_ =
+        static_cast<size_t>(capacity * high_pri_pool_ratio);
+  }
+  void SetStrictCapacityLimit(bool strict_capacity_limit) {
+    strict_capacity_limit_ = strict_capacity_limit;
+  }
 
   // Like Cache methods, but with an extra "hash" parameter.
   Cache::Handle* Insert(const Slice& key, uint32_t hash, void* value,
                         size_t charge,
-                        void (*deleter)(const Slice& key, void* value));
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Priority priority);
   Cache::Handle* Lookup(const Slice& key, uint32_t hash);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
@@ -225,10 +245,14 @@ class LRUCache {
     MutexLock l(&mutex_);
     return usage_;
   }
+  // Appends a row of statistics for this shard to *stats.
+  void AppendStats(int shard, std::string* stats) const;
 
  private:
   void LRU_Remove(LRUHandle* e);
   void LRU_Append(LRUHandle* list, LRUHandle* e);
+  // Appends an unreferenced entry to the LRU list of its priority.
+  void LRU_Insert(LRUHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void Ref(LRUHandle* e);
   void Unref(LRUHandle* e);
   bool FinishErase(LRUHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
@@ -236,12 +260,21 @@ class LRUCache {
   // Initialized before use.
   // 缓存容量默认15
   size_t capacity_;
+  // Part of capacity_ reserved for high priority entries.
+  size_t high_pri_pool_capacity_;
+  // If true, entries that do not fit in capacity_ are not cached.
+  bool strict_capacity_limit_;
 
   // mutex_ protects the following state.
   // 包含缓存的锁
   mutable port::Mutex mutex_;
   // 当前使用了多少容量
   size_t usage_ GUARDED_BY(mutex_);
+  // Combined charge of the entries on high_pri_lru_.
+  size_t high_pri_pool_usage_ GUARDED_BY(mutex_);
+  // 查找命中和未命中的次数
+  uint64_t hits_ GUARDED_BY(mutex_);
+  uint64_t misses_ GUARDED_BY(mutex_);
 
   // Dummy head of LRU list.
   // lru.prev is newest entry, lru.next is oldest entry.
@@ -249,6 +282,10 @@ class LRUCache {
   // 缓存项链表
   LRUHandle lru_ GUARDED_BY(mutex_);
 
+  // Dummy head of the LRU list of the high priority pool.  Same invariants
+  // as lru_, which is evicted first.
+  LRUHandle high_pri_lru_ GUARDED_BY(mutex_);
+
   // Dummy head of in-use list.
   // Entries are in use by clients, and have refs >= 2 and in_cache==true.
   // 当前正在被使用的缓存项链表。头节点（不保存数据），方便增删
@@ -258,23 +295,34 @@ class LRUCache {
   HandleTable table_ GUARDED_BY(mutex_);
 };
 
-LRUCache::LRUCache() : capacity_(0), usage_(0) {
+LRUCache::LRUCache()
+    : capacity_(0),
+      high_pri_pool_capacity_(0),
+      strict_capacity_limit_(false),
+      usage_(0),
+      high_pri_pool_usage_(0),
+      hits_(0),
+      misses_(0) {
   // Make empty circular linked lists.
   lru_.next = &lru_;
   lru_.prev = &lru_;
+  high_pri_lru_.next = &high_pri_lru_;
+  high_pri_lru_.prev = &high_pri_lru_;
   in_use_.next = &in_use_;
   in_use_.prev = &in_use_;
 }
 
 LRUCache::~LRUCache() {
   assert(in_use_.next == &in_use_);  // Error if caller has an unreleased handle
-  for (LRUHandle* e = lru_.next; e != &lru_;) {
-    LRUHandle* next = e->next;
-    assert(e->in_cache);
-    e->in_cache = false;
-    assert(e->refs == 1);  // Invariant of lru_ list.
-    Unref(e);
-    e = next;
+  for (LRUHandle* list : {&lru_, &high_pri_lru_}) {
+    for (LRUHandle* e = list->next; e != list;) {
+      LRUHandle* next = e->next;
+      assert(e->in_cache);
+      e->in_cache = false;
+      assert(e->refs == 1);  // Invariant of lru_ list.
+      Unref(e);
+      e = next;
+    }
   }
 }
 
@@ -304,13 +352,33 @@ void LRUCache::Unref(LRUHandle* e) {
     // No longer in use; move to lru_ list.
     // 重新移动到lru_里
     LRU_Remove(e);
-    LRU_Append(&lru_, e);
+    LRU_Insert(e);
   }
 }
 
 void LRUCache::LRU_Remove(LRUHandle* e) {
   e->next->prev = e->prev;
   e->prev->next = e->next;
+  if (e->in_high_pri_pool) {
+    e->in_high_pri_pool = false;
+    high_pri_pool_usage_ -= e->charge;
+  }
+}
+
+void LRUCache::LRU_Insert(LRUHandle* e) {
+  if (!e->is_high_pri || high_pri_pool_capacity_ == 0) {
+    LRU_Append(&lru_, e);
+    return;
+  }
+  LRU_Append(&high_pri_lru_, e);
+  e->in_high_pri_pool = true;
+  high_pri_pool_usage_ += e->charge;
+  // 高优先级池溢出时，最旧的项降级为普通优先级（成为lru_中最新的项）
+  while (high_pri_pool_usage_ > high_pri_pool_capacity_) {
+    LRUHandle* old = high_pri_lru_.next;
+    LRU_Remove(old);
+    LRU_Append(&lru_, old);
+  }
 }
 
 void LRUCache::LRU_Append(LRUHandle* list, LRUHandle* e) {
@@ -327,6 +395,9 @@ Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash) {
   LRUHandle* e = table_.Lookup(key, hash);
   if (e != nullptr) {
     Ref(e);
+    ++hits_;
+  } else {
+    ++misses_;
   }
   return reinterpret_cast<Cache::Handle*>(e);
 }
@@ -340,7 +411,8 @@ void LRUCache::Release(Cache::Handle* handle) {
 Cache::Handle* LRUCache::Insert(const Slice& key, uint32_t hash, void* value,
                                 size_t charge,
                                 void (*deleter)(const Slice& key,
-                                                void* value)) {
+                                                void* value),
+                                Cache::Priority priority) {
   //加锁了，所以同一时间，读写不能同时存在。
   MutexLock l(&mutex_);
 
@@ -357,11 +429,33 @@ Cache::Handle* LRUCache::Insert(const Slice& key, uint32_t hash, void* value,
   e->key_length = key.size();
   e->hash = hash;
   e->in_cache = false;
+  e->is_high_pri = (priority == Cache::kHighPriority);
+  e->in_high_pri_pool = false;
   // refs==0：节点将被销毁，refs==1：节点在lru_中，refs==2：节点在in_use_中
   e->refs = 1;  // for the returned handle.
   std::memcpy(e->key_data, key.data(), key.size());
 
+  // The entry being replaced neither needs room made for it nor counts
+  // against the strict limit.
+  FinishErase(table_.Remove(key, hash));
+
   if (capacity_ > 0) {
+    // 如果放不下新项，根据lru_按照lru策略淘汰，lru_为空时才淘汰高优先级的项
+    while (usage_ + charge > capacity_ &&
+           (lru_.next != &lru_ || high_pri_lru_.next != &high_pri_lru_)) {
+      // lru_.next是最老的节点，首先淘汰
+      LRUHandle* old = (lru_.next != &lru_) ? lru_.next : high_pri_lru_.next;
+      assert(old->refs == 1);
+      bool erased = FinishErase(table_.Remove(old->key(), old->hash));
+      if (!erased) {  // to avoid unused variable when compiled NDEBUG
+        assert(erased);
+      }
+    }
+  }
+
+  // 严格容量限制下，其余的项都在使用中时，新项不进入缓存
+  if (capacity_ > 0 &&
+      (!strict_capacity_limit_ || usage_ + charge <= capacity_)) {
     //e被使用
     e->refs++;  // for the cache's reference.
     e->in_cache = true;
@@ -377,16 +471,6 @@ Cache::Handle* LRUCache::Insert(const Slice& key, uint32_t hash, void* value,
     // next is read by key() in an assert, so it must be initialized
     e->next = nullptr;
   }
-  // 如果超过了容量限制，根据lru_按照lru策略淘汰
-  while (usage_ > capacity_ && lru_.next != &lru_) {
-    // lru_.next是最老的节点，首先淘汰
-    LRUHandle* old = lru_.next;
-    assert(old->refs == 1);
-    bool erased = FinishErase(table_.Remove(old->key(), old->hash));
-    if (!erased) {  // to avoid unused variable when compiled NDEBUG
-      assert(erased);
-    }
-  }
 
   return reinterpret_cast<Cache::Handle*>(e);
 }
@@ -414,25 +498,49 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
 
 void LRUCache::Prune() {
   MutexLock l(&mutex_);
-  while (lru_.next != &lru_) {
-    LRUHandle* e = lru_.next;
-    assert(e->refs == 1);
-    bool erased = FinishErase(table_.Remove(e->key(), e->hash));
-    if (!erased) {  // to avoid unused variable when compiled NDEBUG
-      assert(erased);
+  for (LRUHandle* list : {&lru_, &high_pri_lru_}) {
+    while (list->next != list) {
+      LRUHandle* e = list->next;
+      assert(e->refs == 1);
+      bool erased = FinishErase(table_.Remove(e->key(), e->hash));
+      if (!erased) {  // to avoid unused variable when compiled NDEBUG
+        assert(erased);
+      }
     }
   }
 }
 
+void LRUCache::AppendStats(int shard, std::string* stats) const {
+  MutexLock l(&mutex_);
+  size_t pinned_usage = 0;
+  for (const LRUHandle* e = in_use_.next; e != &in_use_; e = e->next) {
+    pinned_usage += e->charge;
+  }
+  char buf[200];
+  std::snprintf(buf, sizeof(buf), "%5d %12llu %12llu %12llu %12llu %12llu\n",
+                shard, static_cast<unsigned long long>(capacity_),
+                static_cast<unsigned long long>(usage_),
+                static_cast<unsigned long long>(pinned_usage),
+                static_cast<unsigned long long>(hits_),
+                static_cast<unsigned long long>(misses_));
+  stats->append(buf);
+}
+
 static const int kNumShardBits = 4;
-static const int kNumShards = 1 << kNumShardBits;
+
+// Shards of at least this capacity when the number of shards is picked
+// from the capacity.
+static const size_t kMinShardCapacity = 512 << 10;
+static const int kMaxNumShardBits = 6;
 
 /**
  * 定义多个LRUCache，实现分段式锁。
  */
 class ShardedLRUCache : public Cache {
  private:
-  LRUCache shard_[kNumShards];
+  const int num_shard_bits_;
+  const int num_shards_;
+  LRUCache* const shard_;
   port::Mutex id_mutex_;
   uint64_t last_id_;
 
@@ -440,23 +548,37 @@ class ShardedLRUCache : public Cache {
     return Hash(s.data(), s.size(), 0);
   }
 
-  static uint32_t Shard(uint32_t hash) { return hash >> (32 - kNumShardBits); }
+  uint32_t Shard(uint32_t hash) const {
+    return num_shard_bits_ > 0 ? hash >> (32 - num_shard_bits_) : 0;
+  }
 
  public:
-  explicit ShardedLRUCache(size_t capacity) : last_id_(0) {
-    // capacity=16 kNumShards=16
-    // per_shard=15
-    const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
-    for (int s = 0; s < kNumShards; s++) {
-      shard_[s].SetCapacity(per_shard);
+  ShardedLRUCache(size_t capacity, int num_shard_bits,
+                  bool strict_capacity_limit, double high_pri_pool_ratio)
+      : num_shard_bits_(num_shard_bits),
+        num_shards_(1 << num_shard_bits),
+        shard_(new LRUCache[num_shards_]),
+        last_id_(0) {
+    // capacity=16 num_shards_=16
+    // per_shard=1
+    const size_t per_shard = (capacity + (num_shards_ - 1)) / num_shards_;
+    for (int s = 0; s < num_shards_; s++) {
+      shard_[s].SetCapacity(per_shard, high_pri_pool_ratio);
+      shard_[s].SetStrictCapacityLimit(strict_capacity_limit);
     }
   }
-  ~ShardedLRUCache() override {}
+  ~ShardedLRUCache() override { delete[] shard_; }
   Handle* Insert(const Slice& key, void* value, size_t charge,
                  void (*deleter)(const Slice& key, void* value)) override {
+    return Insert(key, value, charge, deleter, kLowPriority);
+  }
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value),
+                 Priority priority) override {
     const uint32_t hash = HashSlice(key);
-    //一共有16个LRUCache，取hash的高4个字节，确定进入哪一个LRUCache。
-    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
+    //一共有num_shards_个LRUCache，取hash的高位，确定进入哪一个LRUCache。
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      priority);
   }
   Handle* Lookup(const Slice& key) override {
     const uint32_t hash = HashSlice(key);
@@ -478,21 +600,55 @@ class ShardedLRUCache : public Cache {
     return ++(last_id_);
   }
   void Prune() override {
-    for (int s = 0; s < kNumShards; s++) {
+    for (int s = 0; s < num_shards_; s++) {
       shard_[s].Prune();
     }
   }
   size_t TotalCharge() const override {
     size_t total = 0;
-    for (int s = 0; s < kNumShards; s++) {
+    for (int s = 0; s < num_shards_; s++) {
       total += shard_[s].TotalCharge();
     }
     return total;
   }
+  bool GetStats(std::string* stats) const override {
+    stats->append(
+        "Shard     Capacity        Usage       Pinned         Hits       "
+        "Misses\n"
+        "--------------------------------------------------------------------"
+        "--\n");
+    for (int s = 0; s < num_shards_; s++) {
+      shard_[s].AppendStats(s, stats);
+    }
+    return true;
+  }
 };
 
 }  // end anonymous namespace
 
-Cache* NewLRUCache(size_t capacity) { return new ShardedLRUCache(capacity); }
+Cache* NewLRUCache(size_t capacity) {
+  return new ShardedLRUCache(capacity, kNumShardBits, false, 0);
+}
+
+Cache* NewLRUCache(size_t capacity, double high_pri_pool_ratio) {
+  assert(high_pri_pool_ratio >= 0 && high_pri_pool_ratio <= 1);
+  return new ShardedLRUCache(capacity, kNumShardBits, false,
+                             high_pri_pool_ratio);
+}
+
+Cache* NewLRUCache(size_t capacity, int num_shard_bits,
+                   bool strict_capacity_limit, double high_pri_pool_ratio) {
+  assert(num_shard_bits <= 20);
+  assert(high_pri_pool_ratio >= 0 && high_pri_pool_ratio <= 1);
+  if (num_shard_bits < 0) {
+    num_shard_bits = 0;
+    while (num_shard_bits < kMaxNumShardBits &&
+           (capacity >> (num_shard_bits + 1)) >= kMinShardCapacity) {
+      num_shard_bits++;
+    }
+  }
+  return new ShardedLRUCache(capacity, num_shard_bits, strict_capacity_limit,
+                             high_pri_pool_ratio);
+}
 
 }  // namespace leveldb
@@ -4,6 +4,10 @@
 
 #include "leveldb/cache.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -54,6 +58,11 @@ class CacheTest : public testing::Test {
                                    &CacheTest::Deleter));
   }
 
+  void InsertHighPriority(int key, int value, int charge = 1) {
+    cache_->Release(cache_->Insert(EncodeKey(key), EncodeValue(value), charge,
+                                   &CacheTest::Deleter, Cache::kHighPriority));
+  }
+
   Cache::Handle* InsertAndReturnHandle(int key, int value, int charge = 1) {
     return cache_->Insert(EncodeKey(key), EncodeValue(value), charge,
                           &CacheTest::Deleter);
@@ -150,6 +159,28 @@ TEST_F(CacheTest, EvictionPolicy) {
   cache_->Release(h);
 }
 
+TEST_F(CacheTest, HighPriorityPool) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0.5);
+
+  // Low priority entries are evicted first, however recently used.
+  InsertHighPriority(100, 101);
+  Insert(200, 201);
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    Insert(1000 + i, 2000 + i);
+    ASSERT_EQ(2000 + i, Lookup(1000 + i));
+  }
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+
+  // High priority entries overflowing the pool lose their protection.
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    InsertHighPriority(3000 + i, 4000 + i);
+  }
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(4000 + kCacheSize + 99, Lookup(3000 + kCacheSize + 99));
+}
+
 TEST_F(CacheTest, UseExceedsCacheSize) {
   // Overfill the cache, keeping handles on all inserted entries.
   std::vector<Cache::Handle*> h;
@@ -158,15 +189,38 @@ TEST_F(CacheTest, UseExceedsCacheSize) {
   }
 
   // Check that all the entries can be found in the cache.
-  for (int i = 0; i < h.size(); i++) {
+  for (size_t i = 0; i < h.size(); i++) {
     ASSERT_EQ(2000 + i, Lookup(1000 + i));
   }
 
-  for (int i = 0; i < h.size(); i++) {
+  for (size_t i = 0; i < h.size(); i++) {
     cache_->Release(h[i]);
   }
 }
 
+TEST_F(CacheTest, ReinsertIntoFullCache) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0, false);
+
+  for (int i = 0; i < kCacheSize; i++) {
+    Insert(1000 + i, 2000 + i);
+  }
+  ASSERT_EQ(static_cast<size_t>(kCacheSize), cache_->TotalCharge());
+
+  // Replacing an entry makes room for the new one by itself, without
+  // evicting another entry.
+  Insert(1000 + kCacheSize / 2, 3000);
+  ASSERT_EQ(3000, Lookup(1000 + kCacheSize / 2));
+  for (int i = 0; i < kCacheSize; i++) {
+    if (i != kCacheSize / 2) {
+      ASSERT_EQ(2000 + i, Lookup(1000 + i));
+    }
+  }
+  ASSERT_EQ(1u, deleted_keys_.size());
+  ASSERT_EQ(1000 + kCacheSize / 2, deleted_keys_[0]);
+  ASSERT_EQ(2000 + kCacheSize / 2, deleted_values_[0]);
+}
+
 TEST_F(CacheTest, HeavyEntries) {
   // Add a bunch of light and heavy entries and then count the combined
   // size of items still in the cache, which must be approximately the
@@ -221,4 +275,274 @@ TEST_F(CacheTest, ZeroSizeCache) {
   ASSERT_EQ(-1, Lookup(1));
 }
 
+TEST_F(CacheTest, StrictCapacityLimit) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0, true);
+
+  // Entries that do not fit next to the pinned ones are handed out
+  // without being cached.
+  std::vector<Cache::Handle*> h;
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    h.push_back(InsertAndReturnHandle(1000 + i, 2000 + i));
+    ASSERT_EQ(2000 + i, DecodeValue(cache_->Value(h[i])));
+  }
+  ASSERT_EQ(static_cast<size_t>(kCacheSize), cache_->TotalCharge());
+  ASSERT_EQ(2000, Lookup(1000));
+  ASSERT_EQ(-1, Lookup(1000 + kCacheSize));
+  ASSERT_EQ(0u, deleted_keys_.size());
+
+  for (size_t i = 0; i < h.size(); i++) {
+    cache_->Release(h[i]);
+  }
+  ASSERT_EQ(100u, deleted_keys_.size());
+  ASSERT_EQ(1000 + kCacheSize, deleted_keys_[0]);
+
+  // Unused entries are evicted as usual.
+  Insert(1, 101);
+  ASSERT_EQ(101, Lookup(1));
+  ASSERT_EQ(static_cast<size_t>(kCacheSize), cache_->TotalCharge());
+
+  // The entry being replaced does not count against the limit, but an
+  // entry that is not cached still replaces the cached one.
+  h.clear();
+  for (int i = 0; i < kCacheSize; i++) {
+    h.push_back(InsertAndReturnHandle(3000 + i, 4000 + i));
+  }
+  h.push_back(InsertAndReturnHandle(3000, 5000));
+  ASSERT_EQ(5000, Lookup(3000));
+  ASSERT_EQ(static_cast<size_t>(kCacheSize), cache_->TotalCharge());
+  Cache::Handle* replacement = InsertAndReturnHandle(3001, 5001, 2);
+  ASSERT_EQ(-1, Lookup(3001));
+  ASSERT_EQ(5001, DecodeValue(cache_->Value(replacement)));
+  ASSERT_EQ(static_cast<size_t>(kCacheSize - 1), cache_->TotalCharge());
+  cache_->Release(replacement);
+  for (size_t i = 0; i < h.size(); i++) {
+    cache_->Release(h[i]);
+  }
+}
+
+TEST_F(CacheTest, Stats) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 2, false);
+
+  Insert(100, 101);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+
+  std::string stats;
+  ASSERT_TRUE(cache_->GetStats(&stats));
+  unsigned long long capacity = 0, usage = 0, hits = 0, misses = 0;
+  int shards = 0;
+  size_t start = stats.find('\n', stats.find('\n') + 1) + 1;
+  while (start < stats.size()) {
+    int shard;
+    unsigned long long c, u, p, h, m;
+    ASSERT_EQ(6, std::sscanf(stats.c_str() + start,
+                             "%d %llu %llu %llu %llu %llu", &shard, &c, &u,
+                             &p, &h, &m));
+    ASSERT_EQ(shards, shard);
+    capacity += c;
+    usage += u;
+    hits += h;
+    misses += m;
+    shards++;
+    start = stats.find('\n', start) + 1;
+  }
+  ASSERT_EQ(4, shards);
+  ASSERT_EQ(static_cast<unsigned long long>(kCacheSize), capacity);
+  ASSERT_EQ(1, usage);
+  ASSERT_EQ(1, hits);
+  ASSERT_EQ(1, misses);
+}
+
+TEST_F(CacheTest, DefaultNumShardBits) {
+  delete cache_;
+  cache_ = NewLRUCache(1 << 20, -1, false);
+  std::string stats;
+  ASSERT_TRUE(cache_->GetStats(&stats));
+  // Two shards of 512KB; a header and a separator.
+  ASSERT_EQ(2 + 2, std::count(stats.begin(), stats.end(), '\n'));
+}
+
+// Sizes the tables of the clock cache for the unit charges used here.
+class ClockCacheTest : public CacheTest {
+ public:
+  ClockCacheTest() {
+    delete cache_;
+    cache_ = NewClockCache(kCacheSize, 4, 1);
+  }
+};
+
+TEST_F(ClockCacheTest, HitAndMiss) {
+  ASSERT_EQ(-1, Lookup(100));
+
+  Insert(100, 101);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+
+  Insert(200, 201);
+  Insert(100, 102);
+  ASSERT_EQ(102, Lookup(100));
+  ASSERT_EQ(201, Lookup(200));
+  ASSERT_EQ(1u, deleted_keys_.size());
+  ASSERT_EQ(100, deleted_keys_[0]);
+  ASSERT_EQ(101, deleted_values_[0]);
+
+  Erase(100);
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(201, Lookup(200));
+  ASSERT_EQ(2u, deleted_keys_.size());
+}
+
+TEST_F(ClockCacheTest, EntriesArePinned) {
+  Insert(100, 101);
+  Cache::Handle* h1 = cache_->Lookup(EncodeKey(100));
+  ASSERT_EQ(101, DecodeValue(cache_->Value(h1)));
+
+  Insert(100, 102);
+  Cache::Handle* h2 = cache_->Lookup(EncodeKey(100));
+  ASSERT_EQ(102, DecodeValue(cache_->Value(h2)));
+  ASSERT_EQ(0u, deleted_keys_.size());
+
+  cache_->Release(h1);
+  ASSERT_EQ(1u, deleted_keys_.size());
+  ASSERT_EQ(101, deleted_values_[0]);
+
+  Erase(100);
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(1u, deleted_keys_.size());
+
+  cache_->Release(h2);
+  ASSERT_EQ(2u, deleted_keys_.size());
+  ASSERT_EQ(102, deleted_values_[1]);
+}
+
+TEST_F(ClockCacheTest, EvictionPolicy) {
+  Insert(100, 101);
+  Insert(200, 201);
+  Insert(300, 301);
+  Cache::Handle* h = cache_->Lookup(EncodeKey(300));
+
+  // Entries used between turns of the clock hand must be kept around,
+  // as must things that are still in use.
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    Insert(1000 + i, 2000 + i);
+    ASSERT_EQ(2000 + i, Lookup(1000 + i));
+    ASSERT_EQ(101, Lookup(100));
+  }
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+  ASSERT_EQ(301, Lookup(300));
+  cache_->Release(h);
+}
+
+TEST_F(ClockCacheTest, HeavyEntries) {
+  const int kLight = 1;
+  const int kHeavy = 10;
+  int added = 0;
+  int index = 0;
+  while (added < 2 * kCacheSize) {
+    const int weight = (index & 1) ? kLight : kHeavy;
+    Insert(index, 1000 + index, weight);
+    added += weight;
+    index++;
+  }
+
+  int cached_weight = 0;
+  for (int i = 0; i < index; i++) {
+    const int weight = (i & 1 ? kLight : kHeavy);
+    int r = Lookup(i);
+    if (r >= 0) {
+      cached_weight += weight;
+      ASSERT_EQ(1000 + i, r);
+    }
+  }
+  ASSERT_LE(cached_weight, kCacheSize + kCacheSize / 10);
+  ASSERT_EQ(static_cast<size_t>(cached_weight), cache_->TotalCharge());
+}
+
+TEST_F(ClockCacheTest, FullTable) {
+  // Tables sized for a single entry of the estimated charge.
+  delete cache_;
+  cache_ = NewClockCache(kCacheSize, 0, kCacheSize);
+
+  // Pinned entries that do not fit in the table are still returned.
+  std::vector<Cache::Handle*> h;
+  for (int i = 0; i < 100; i++) {
+    h.push_back(InsertAndReturnHandle(1000 + i, 2000 + i));
+    ASSERT_EQ(2000 + i, DecodeValue(cache_->Value(h[i])));
+  }
+  ASSERT_LT(cache_->TotalCharge(), 100);
+  for (size_t i = 0; i < h.size(); i++) {
+    cache_->Release(h[i]);
+  }
+
+  // Once released, older entries make room for new ones.
+  Insert(1, 101);
+  ASSERT_EQ(101, Lookup(1));
+  delete cache_;
+  cache_ = nullptr;
+  ASSERT_EQ(101u, deleted_keys_.size());
+}
+
+TEST_F(ClockCacheTest, Prune) {
+  Insert(1, 100);
+  Insert(2, 200);
+
+  Cache::Handle* handle = cache_->Lookup(EncodeKey(1));
+  ASSERT_TRUE(handle);
+  cache_->Prune();
+  cache_->Release(handle);
+
+  ASSERT_EQ(100, Lookup(1));
+  ASSERT_EQ(-1, Lookup(2));
+}
+
+TEST_F(ClockCacheTest, ZeroSizeCache) {
+  delete cache_;
+  cache_ = NewClockCache(0, 4);
+
+  Insert(1, 100);
+  ASSERT_EQ(-1, Lookup(1));
+  ASSERT_EQ(1u, deleted_keys_.size());
+}
+
+TEST_F(ClockCacheTest, ConcurrentAccess) {
+  static std::atomic<int> deleted(0);
+  struct Helper {
+    static void Deleter(const Slice& key, void* v) {
+      ASSERT_EQ(DecodeKey(key), DecodeValue(v));
+      deleted.fetch_add(1);
+    }
+  };
+
+  // Threads look keys up and insert those they miss, over twice as many
+  // keys as fit in the cache.
+  const int kNumThreads = 8;
+  std::atomic<int> inserted(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([this, t, &inserted]() {
+      for (int i = 0; i < 20000; i++) {
+        const int key = (i * 7919 + t * 104729) % (2 * kCacheSize);
+        Cache::Handle* h = cache_->Lookup(EncodeKey(key));
+        if (h == nullptr) {
+          h = cache_->Insert(EncodeKey(key), EncodeValue(key), 1,
+                             &Helper::Deleter);
+          inserted.fetch_add(1);
+        }
+        ASSERT_EQ(key, DecodeValue(cache_->Value(h)));
+        cache_->Release(h);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  ASSERT_LE(cache_->TotalCharge(), kCacheSize + kCacheSize / 10);
+  delete cache_;
+  cache_ = nullptr;
+  ASSERT_EQ(inserted.load(), deleted.load());
+}
+
 }  // namespace leveldb
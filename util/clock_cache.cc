@@ -0,0 +1,469 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "leveldb/cache.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+namespace {
+
+// CLOCK cache implementation
+//
+// Each shard keeps its entries in a fixed size open addressing hash table.
+// The slots are never freed while the cache exists, so Lookup() and
+// Release() only need atomic operations on the slot they touch.  Insert(),
+// Erase() and Prune() serialize on the shard mutex; they are the only ones
+// that make an entry visible or evict a visible entry.
+//
+// The state of a slot, the number of handles on its entry and the clock
+// countdown of the entry are packed into the "meta" word of the slot:
+// - Empty:  free slot.
+// - Construction:  owned by the thread filling or freeing the slot.
+// - Visible:  an entry that Lookup() may return.
+// - Invisible:  an entry that was erased or replaced while it still had
+//   handles.  It is freed when the last handle is released.
+// Lookup() takes its reference with a single fetch_add.  If the slot turned
+// out not to be shareable, the stray increment is simply overwritten by the
+// owner of the slot when it stores the next state.
+//
+// On insertion the clock hand walks the table: an unreferenced visible
+// entry is evicted once its countdown is zero, and has its countdown
+// decremented otherwise.  Lookup() gives the entry the maximum countdown
+// again, so entries that are used survive several turns of the hand.
+//
+// Entries whose probe sequence passes over a slot are counted in the
+// "displacements" of that slot, so that lookups can stop at the first slot
+// that is not part of any such sequence.
+
+constexpr uint64_t kRefsMask = (uint64_t{1} << 30) - 1;
+constexpr int kCountdownShift = 30;
+constexpr uint64_t kCountdownMask = uint64_t{3} << kCountdownShift;
+constexpr uint64_t kMaxCountdown = 3;
+constexpr int kStateShift = 32;
+constexpr uint64_t kStateOccupiedBit = uint64_t{1} << kStateShift;
+constexpr uint64_t kStateShareableBit = uint64_t{2} << kStateShift;
+constexpr uint64_t kStateVisibleBit = uint64_t{4} << kStateShift;
+constexpr uint64_t kStateMask = uint64_t{7} << kStateShift;
+
+constexpr uint64_t kStateConstruction = kStateOccupiedBit;
+constexpr uint64_t kStateInvisible = kStateOccupiedBit | kStateShareableBit;
+constexpr uint64_t kStateVisible = kStateInvisible | kStateVisibleBit;
+
+struct ClockHandle {
+  // 状态 | 时钟计数 | 引用计数
+  std::atomic<uint64_t> meta;
+  // 探测序列经过该槽位的项的个数，为0时查找可以在此停止
+  std::atomic<uint32_t> displacements;
+  uint32_t hash;
+  // Not in the table: the table was full, or caching is disabled.
+  bool detached;
+  void* value;
+  void (*deleter)(const Slice&, void* value);
+  size_t charge;
+  char* key_data;
+  size_t key_length;
+
+  Slice key() const { return Slice(key_data, key_length); }
+};
+
+// A single shard of sharded cache.
+class ClockCacheShard {
+ public:
+  ClockCacheShard();
+  ~ClockCacheShard();
+
+  // Separate from constructor so caller can easily make an array of shards.
+  // The table is sized for capacity / estimated_entry_charge entries.
+  void Init(size_t capacity, size_t estimated_entry_charge);
+
+  // Like Cache methods, but with an extra "hash" parameter.
+  Cache::Handle* Insert(const Slice& key, uint32_t hash, void* value,
+                        size_t charge,
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Priority priority);
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash);
+  void Release(Cache::Handle* handle);
+  void Erase(const Slice& key, uint32_t hash);
+  void Prune();
+  size_t TotalCharge() const { return usage_.load(std::memory_order_relaxed); }
+
+ private:
+  static uint32_t Increment(uint32_t hash) { return (hash >> 16) | 1; }
+
+  // Drops a reference, freeing an invisible entry with the last one.
+  void Unref(ClockHandle* h);
+  // Frees the entry of *h if its meta word still is "expected".
+  void TryFree(ClockHandle* h, uint64_t expected);
+  // REQUIRES: the caller moved *h to the Construction state.
+  void Free(ClockHandle* h);
+
+  ClockHandle* FindVisible(const Slice& key, uint32_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void EraseLocked(const Slice& key, uint32_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Runs the clock hand until "charge" more fits in the shard.
+  void Evict(size_t charge) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Returns an empty slot along the probe sequence of "hash", now in the
+  // Construction state, or nullptr if the table is full.
+  ClockHandle* Claim(uint32_t hash) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Initialized before use.
+  size_t capacity_;
+  ClockHandle* table_;
+  uint32_t mask_;
+  // Entries beyond this are not inserted, to keep probe sequences short.
+  size_t max_occupancy_;
+
+  std::atomic<size_t> usage_;
+  std::atomic<size_t> occupancy_;
+
+  port::Mutex mutex_;
+  uint32_t clock_hand_ GUARDED_BY(mutex_);
+};
+
+ClockCacheShard::ClockCacheShard()
+    : capacity_(0),
+      table_(nullptr),
+      mask_(0),
+      max_occupancy_(0),
+      usage_(0),
+      occupancy_(0),
+      clock_hand_(0) {}
+
+ClockCacheShard::~ClockCacheShard() {
+  for (uint32_t i = 0; table_ != nullptr && i <= mask_; i++) {
+    ClockHandle* h = &table_[i];
+    const uint64_t meta = h->meta.load(std::memory_order_acquire);
+    if (meta & kStateShareableBit) {
+      // Error if caller has an unreleased handle
+      assert((meta & kStateMask) == kStateVisible && (meta & kRefsMask) == 0);
+      (*h->deleter)(h->key(), h->value);
+      std::free(h->key_data);
+    }
+  }
+  delete[] table_;
+}
+
+void ClockCacheShard::Init(size_t capacity, size_t estimated_entry_charge) {
+  capacity_ = capacity;
+  const size_t entries =
+      (capacity + estimated_entry_charge - 1) / estimated_entry_charge;
+  // Aim for a load factor of 3/4 at capacity.
+  uint32_t length = 16;
+  while (length < entries + entries / 3) {
+    length *= 2;
+  }
+  table_ = new ClockHandle[length];
+  for (uint32_t i = 0; i < length; i++) {
+    table_[i].meta.store(0, std::memory_order_relaxed);
+    table_[i].displacements.store(0, std::memory_order_relaxed);
+  }
+  mask_ = length - 1;
+  max_occupancy_ = length - length / 8;
+}
+
+Cache::Handle* ClockCacheShard::Lookup(const Slice& key, uint32_t hash) {
+  const uint32_t increment = Increment(hash);
+  uint32_t index = hash & mask_;
+  for (uint32_t i = 0; i <= mask_; i++) {
+    ClockHandle* h = &table_[index];
+    const uint64_t meta = h->meta.load(std::memory_order_acquire);
+    if ((meta & kStateMask) == kStateVisible) {
+      const uint64_t old = h->meta.fetch_add(1, std::memory_order_acquire);
+      if ((old & kStateMask) == kStateVisible && h->hash == hash &&
+          h->key() == key) {
+        if ((old & kCountdownMask) != kCountdownMask) {
+          h->meta.fetch_or(kCountdownMask, std::memory_order_relaxed);
+        }
+        return reinterpret_cast<Cache::Handle*>(h);
+      }
+      if (old & kStateShareableBit) {
+        Unref(h);
+      }
+    }
+    if (h->displacements.load(std::memory_order_acquire) == 0) {
+      break;
+    }
+    index = (index + increment) & mask_;
+  }
+  return nullptr;
+}
+
+void ClockCacheShard::Release(Cache::Handle* handle) {
+  ClockHandle* h = reinterpret_cast<ClockHandle*>(handle);
+  if (h->detached) {
+    (*h->deleter)(h->key(), h->value);
+    std::free(h->key_data);
+    delete h;
+    return;
+  }
+  Unref(h);
+}
+
+void ClockCacheShard::Unref(ClockHandle* h) {
+  const uint64_t old = h->meta.fetch_sub(1, std::memory_order_acq_rel);
+  assert((old & kStateShareableBit) && (old & kRefsMask) > 0);
+  if ((old & kStateMask) == kStateInvisible && (old & kRefsMask) == 1) {
+    TryFree(h, old - 1);
+  }
+}
+
+void ClockCacheShard::TryFree(ClockHandle* h, uint64_t expected) {
+  // Racing lookups may hold a reference for a moment: the last of them to
+  // drop it frees the entry instead.
+  if (h->meta.compare_exchange_strong(expected, kStateConstruction,
+                                      std::memory_order_acq_rel)) {
+    Free(h);
+  }
+}
+
+void ClockCacheShard::Free(ClockHandle* h) {
+  (*h->deleter)(h->key(), h->value);
+  std::free(h->key_data);
+  usage_.fetch_sub(h->charge, std::memory_order_relaxed);
+  // 撤销该项在探测序列上留下的位移计数
+  const uint32_t increment = Increment(h->hash);
+  for (uint32_t index = h->hash & mask_; &table_[index] != h;
+       index = (index + increment) & mask_) {
+    table_[index].displacements.fetch_sub(1, std::memory_order_release);
+  }
+  h->meta.store(0, std::memory_order_release);
+  occupancy_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+ClockHandle* ClockCacheShard::FindVisible(const Slice& key, uint32_t hash) {
+  // Visible entries only change under mutex_, so their fields can be read
+  // without a reference.
+  const uint32_t increment = Increment(hash);
+  uint32_t index = hash & mask_;
+  for (uint32_t i = 0; i <= mask_; i++) {
+    ClockHandle* h = &table_[index];
+    const uint64_t meta = h->meta.load(std::memory_order_acquire);
+    if ((meta & kStateMask) == kStateVisible && h->hash == hash &&
+        h->key() == key) {
+      return h;
+    }
+    if (h->displacements.load(std::memory_order_acquire) == 0) {
+      break;
+    }
+    index = (index + increment) & mask_;
+  }
+  return nullptr;
+}
+
+void ClockCacheShard::EraseLocked(const Slice& key, uint32_t hash) {
+  ClockHandle* h = FindVisible(key, hash);
+  if (h != nullptr) {
+    const uint64_t old =
+        h->meta.fetch_and(~kStateVisibleBit, std::memory_order_acq_rel);
+    if ((old & kRefsMask) == 0) {
+      TryFree(h, old & ~kStateVisibleBit);
+    }
+  }
+}
+
+void ClockCacheShard::Evict(size_t charge) {
+  // Every turn of the hand decrements the countdowns, so kMaxCountdown + 1
+  // turns reach every unreferenced entry.  Stop there if all are in use.
+  const size_t max_steps = (kMaxCountdown + 1) * (size_t{mask_} + 1);
+  for (size_t step = 0;
+       step < max_steps &&
+       (usage_.load(std::memory_order_relaxed) + charge > capacity_ ||
+        occupancy_.load(std::memory_order_relaxed) >= max_occupancy_);
+       step++) {
+    ClockHandle* h = &table_[clock_hand_];
+    clock_hand_ = (clock_hand_ + 1) & mask_;
+    uint64_t meta = h->meta.load(std::memory_order_relaxed);
+    if ((meta & kStateMask) != kStateVisible || (meta & kRefsMask) != 0) {
+      continue;
+    }
+    if ((meta & kCountdownMask) != 0) {
+      h->meta.compare_exchange_strong(
+          meta, meta - (uint64_t{1} << kCountdownShift),
+          std::memory_order_relaxed);
+    } else if (h->meta.compare_exchange_strong(meta, kStateConstruction,
+                                               std::memory_order_acquire)) {
+      Free(h);
+    }
+  }
+}
+
+ClockHandle* ClockCacheShard::Claim(uint32_t hash) {
+  const uint32_t increment = Increment(hash);
+  uint32_t index = hash & mask_;
+  for (uint32_t i = 0; i <= mask_; i++) {
+    ClockHandle* h = &table_[index];
+    const uint64_t old =
+        h->meta.fetch_or(kStateOccupiedBit, std::memory_order_acq_rel);
+    if ((old & kStateOccupiedBit) == 0) {
+      occupancy_.fetch_add(1, std::memory_order_relaxed);
+      return h;
+    }
+    h->displacements.fetch_add(1, std::memory_order_release);
+    index = (index + increment) & mask_;
+  }
+  // Every slot is taken: undo the displacements.
+  index = hash & mask_;
+  for (uint32_t i = 0; i <= mask_; i++) {
+    table_[index].displacements.fetch_sub(1, std::memory_order_release);
+    index = (index + increment) & mask_;
+  }
+  return nullptr;
+}
+
+Cache::Handle* ClockCacheShard::Insert(const Slice& key, uint32_t hash,
+                                       void* value, size_t charge,
+                                       void (*deleter)(const Slice& key,
+                                                       void* value),
+                                       Cache::Priority priority) {
+  MutexLock l(&mutex_);
+  EraseLocked(key, hash);
+
+  ClockHandle* h = nullptr;
+  if (capacity_ > 0) {
+    Evict(charge);
+    if (occupancy_.load(std::memory_order_relaxed) < max_occupancy_) {
+      h = Claim(hash);
+    }
+  }
+  // (capacity_==0 is supported and turns off caching.)
+  const bool detached = (h == nullptr);
+  if (detached) {
+    h = new ClockHandle;
+    h->displacements.store(0, std::memory_order_relaxed);
+  }
+  h->hash = hash;
+  h->detached = detached;
+  h->value = value;
+  h->deleter = deleter;
+  h->charge = charge;
+  h->key_length = key.size();
+  h->key_data = static_cast<char*>(std::malloc(key.size()));
+  std::memcpy(h->key_data, key.data(), key.size());
+
+  if (detached) {
+    h->meta.store(kStateInvisible | 1, std::memory_order_relaxed);
+  } else {
+    usage_.fetch_add(charge, std::memory_order_relaxed);
+    // 高优先级的项可以多经历几轮时钟指针
+    const uint64_t countdown =
+        (priority == Cache::kHighPriority) ? kMaxCountdown : 1;
+    h->meta.store(kStateVisible | (countdown << kCountdownShift) | 1,
+                  std::memory_order_release);
+  }
+  return reinterpret_cast<Cache::Handle*>(h);
+}
+
+void ClockCacheShard::Erase(const Slice& key, uint32_t hash) {
+  MutexLock l(&mutex_);
+  EraseLocked(key, hash);
+}
+
+void ClockCacheShard::Prune() {
+  MutexLock l(&mutex_);
+  for (uint32_t i = 0; i <= mask_; i++) {
+    ClockHandle* h = &table_[i];
+    uint64_t meta = h->meta.load(std::memory_order_relaxed);
+    if ((meta & kStateMask) == kStateVisible && (meta & kRefsMask) == 0 &&
+        h->meta.compare_exchange_strong(meta, kStateConstruction,
+                                        std::memory_order_acquire)) {
+      Free(h);
+    }
+  }
+}
+
+class ShardedClockCache : public Cache {
+ private:
+  ClockCacheShard* const shards_;
+  const int num_shard_bits_;
+  std::atomic<uint64_t> last_id_;
+
+  static inline uint32_t HashSlice(const Slice& s) {
+    return Hash(s.data(), s.size(), 0);
+  }
+
+  uint32_t Shard(uint32_t hash) const {
+    return num_shard_bits_ > 0 ? hash >> (32 - num_shard_bits_) : 0;
+  }
+
+ public:
+  ShardedClockCache(size_t capacity, int num_shard_bits,
+                    size_t estimated_entry_charge)
+      : shards_(new ClockCacheShard[1 << num_shard_bits]),
+        num_shard_bits_(num_shard_bits),
+        last_id_(0) {
+    const int num_shards = 1 << num_shard_bits;
+    const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
+    for (int s = 0; s < num_shards; s++) {
+      shards_[s].Init(per_shard, estimated_entry_charge);
+    }
+  }
+  ~ShardedClockCache() override { delete[] shards_; }
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value)) override {
+    return Insert(key, value, charge, deleter, kLowPriority);
+  }
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value),
+                 Priority priority) override {
+    const uint32_t hash = HashSlice(key);
+    return shards_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                       priority);
+  }
+  Handle* Lookup(const Slice& key) override {
+    const uint32_t hash = HashSlice(key);
+    return shards_[Shard(hash)].Lookup(key, hash);
+  }
+  void Release(Handle* handle) override {
+    ClockHandle* h = reinterpret_cast<ClockHandle*>(handle);
+    shards_[Shard(h->hash)].Release(handle);
+  }
+  void Erase(const Slice& key) override {
+    const uint32_t hash = HashSlice(key);
+    shards_[Shard(hash)].Erase(key, hash);
+  }
+  void* Value(Handle* handle) override {
+    return reinterpret_cast<ClockHandle*>(handle)->value;
+  }
+  uint64_t NewId() override {
+    return last_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  void Prune() override {
+    for (int s = 0; s < (1 << num_shard_bits_); s++) {
+      shards_[s].Prune();
+    }
+  }
+  size_t TotalCharge() const override {
+    size_t total = 0;
+    for (int s = 0; s < (1 << num_shard_bits_); s++) {
+      total += shards_[s].TotalCharge();
+    }
+    return total;
+  }
+};
+
+}  // end anonymous namespace
+
+Cache* NewClockCache(size_t capacity, int num_shard_bits) {
+  return NewClockCache(capacity, num_shard_bits, 4096);
+}
+
+Cache* NewClockCache(size_t capacity, int num_shard_bits,
+                     size_t estimated_entry_charge) {
+  assert(num_shard_bits >= 0 && num_shard_bits <= 20);
+  assert(estimated_entry_charge > 0);
+  return new ShardedClockCache(capacity, num_shard_bits,
+                               estimated_entry_charge);
+}
+
+}  // namespace leveldb
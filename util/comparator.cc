@@ -17,6 +17,10 @@ namespace leveldb {
 
 Comparator::~Comparator() = default;
 
+bool Comparator::ExtractHashKey(const Slice& key, Slice* hash_key) const {
+  return false;
+}
+
 namespace {
 class BytewiseComparatorImpl : public Comparator {
  public:
@@ -64,6 +68,11 @@ class BytewiseComparatorImpl : public Comparator {
     }
     // *key is a run of 0xffs.  Leave it alone.
   }
+
+  bool ExtractHashKey(const Slice& key, Slice* hash_key) const override {
+    *hash_key = key;
+    return true;
+  }
 };
 }  // namespace
 
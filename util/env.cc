@@ -28,10 +28,25 @@ Status Env::DeleteDir(const std::string& dirname) { return RemoveDir(dirname); }
 Status Env::RemoveFile(const std::string& fname) { return DeleteFile(fname); }
 Status Env::DeleteFile(const std::string& fname) { return RemoveFile(fname); }
 
+void Env::Schedule(void (*function)(void* arg), void* arg, Priority pri) {
+  Schedule(function, arg);
+}
+
+void Env::SetBackgroundThreads(int number, Priority pri) {}
+
 SequentialFile::~SequentialFile() = default;
 
 RandomAccessFile::~RandomAccessFile() = default;
 
+void RandomAccessFile::MultiRead(ReadRequest* reqs, size_t num) const {
+  for (size_t i = 0; i < num; i++) {
+    ReadRequest* req = &reqs[i];
+    req->status = Read(req->offset, req->n, &req->result, req->scratch);
+  }
+}
+
+void RandomAccessFile::Prefetch(uint64_t offset, size_t n) const {}
+
 WritableFile::~WritableFile() = default;
 
 Logger::~Logger() = default;
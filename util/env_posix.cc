@@ -13,6 +13,20 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+// io_uring is driven through the raw system calls, so only the kernel
+// header is needed (not liburing).
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define LEVELDB_HAVE_IO_URING 1
+#endif
+#endif  // __has_include(<linux/io_uring.h>)
+#endif  // defined(__linux__) && defined(__has_include)
+
+#include <algorithm>
 #include <atomic>
 #include <cerrno>
 #include <cstddef>
@@ -20,6 +34,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <limits>
 #include <queue>
 #include <set>
@@ -27,6 +42,7 @@
 #include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "leveldb/env.h"
 #include "leveldb/slice.h"
@@ -34,6 +50,8 @@
 #include "port/port.h"
 #include "port/thread_annotations.h"
 #include "util/env_posix_test_helper.h"
+#include "util/mutexlock.h"
+#include "util/no_destructor.h"
 #include "util/posix_logger.h"
 
 namespace leveldb {
@@ -58,6 +76,15 @@ constexpr const int kOpenBaseFlags = 0;
 
 constexpr const size_t kWritableFileBufferSize = 65536;
 
+// Can be set using EnvPosixTestHelper::SetIoUringEnabled().
+std::atomic<bool> g_io_uring_enabled{true};
+
+// Maximum number of reads each thread's io_uring keeps in flight.
+constexpr const unsigned kIoUringQueueDepth = 64;
+
+// Number of threads that serve MultiRead() when io_uring is not available.
+constexpr const int kNumMultiReadThreads = 8;
+
 Status PosixError(const std::string& context, int error_number) {
   if (error_number == ENOENT) {
     return Status::NotFound(context, std::strerror(error_number));
@@ -129,6 +156,341 @@ class Limiter {
   std::atomic<int> acquires_allowed_;
 };
 
+// Performs |req| with a single pread() on |fd|, exactly like
+// PosixRandomAccessFile::Read().
+void PosixPread(int fd, const std::string& filename,
+                RandomAccessFile::ReadRequest* req) {
+  ::ssize_t read_size =
+      ::pread(fd, req->scratch, req->n, static_cast<off_t>(req->offset));
+  req->result = Slice(req->scratch, (read_size < 0) ? 0 : read_size);
+  req->status =
+      (read_size < 0) ? PosixError(filename, errno) : Status::OK();
+}
+
+#if defined(LEVELDB_HAVE_IO_URING)
+
+// A minimal io_uring instance used to keep the reads of a MultiRead() batch
+// in flight together.
+//
+// Instances are not thread-safe. Every thread that issues MultiRead() calls
+// gets its own instance through ForCurrentThread().
+class PosixIoUring {
+ public:
+  // Returns the calling thread's instance, or nullptr if the kernel does not
+  // support io_uring or does not allow this process to use it.
+  static PosixIoUring* ForCurrentThread() {
+    static thread_local PosixIoUring ring;
+    return ring.ring_fd_ >= 0 ? &ring : nullptr;
+  }
+
+  PosixIoUring(const PosixIoUring&) = delete;
+  PosixIoUring& operator=(const PosixIoUring&) = delete;
+
+  ~PosixIoUring() { Close(); }
+
+  // Reads all of |reqs[0..num-1]| from |fd|. Keeps up to the queue depth of
+  // them in flight and returns once every request has completed.
+  void Read(int fd, const std::string& filename,
+            RandomAccessFile::ReadRequest* reqs, size_t num) {
+    std::vector<::iovec> iovecs(num);
+    std::vector<bool> completed(num, false);
+    size_t num_queued = 0;
+    size_t num_completed = 0;
+    unsigned num_unsubmitted = 0;  // Queued, but not yet taken by the kernel.
+    while (num_completed < num) {
+      // Queue as many of the remaining requests as there is room for.
+      unsigned sq_tail = *sq_tail_;
+      while (num_queued < num && num_queued - num_completed < sq_entries_) {
+        RandomAccessFile::ReadRequest* req = &reqs[num_queued];
+        iovecs[num_queued].iov_base = req->scratch;
+        iovecs[num_queued].iov_len = req->n;
+
+        const unsigned index = sq_tail & *sq_mask_;
+        ::io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&iovecs[num_queued]);
+        sqe->len = 1;
+        sqe->off = req->offset;
+        sqe->user_data = num_queued;
+        sq_array_[index] = index;
+
+        ++sq_tail;
+        ++num_queued;
+        ++num_unsubmitted;
+      }
+      __atomic_store_n(sq_tail_, sq_tail, __ATOMIC_RELEASE);
+
+      // Submit the new requests and wait for at least one completion.
+      const size_t num_in_flight = num_queued - num_unsubmitted - num_completed;
+      int submitted = Enter(num_unsubmitted, 1);
+      if (submitted < 0 && errno == EAGAIN && num_in_flight > 0) {
+        // The kernel is short of resources: wait for the reads in flight
+        // instead of submitting more.
+        submitted = Enter(0, 1);
+      }
+      if (submitted < 0) {
+        if (errno == EINTR) {
+          continue;  // Retry
+        }
+        // The ring is unusable. The reads the kernel already took may still
+        // write to their scratch buffers, so wait for them before finishing
+        // the remaining requests synchronously, and let this thread fall
+        // back to the thread pool from now on.
+        while (num_queued - num_unsubmitted - num_completed > 0) {
+          num_completed += Reap(filename, reqs, &completed);
+          if (num_queued - num_unsubmitted - num_completed > 0 &&
+              Enter(0, 1) < 0 && errno != EINTR) {
+            // Completions are still posted to the ring; poll it.
+            std::this_thread::yield();
+          }
+        }
+        Close();
+        for (size_t i = 0; i < num; i++) {
+          if (!completed[i]) {
+            PosixPread(fd, filename, &reqs[i]);
+          }
+        }
+        return;
+      }
+      num_unsubmitted -= submitted;
+      num_completed += Reap(filename, reqs, &completed);
+    }
+  }
+
+ private:
+  PosixIoUring()
+      : ring_fd_(-1),
+        sq_ring_(MAP_FAILED),
+        sq_ring_size_(0),
+        cq_ring_(MAP_FAILED),
+        cq_ring_size_(0),
+        sqes_(static_cast<::io_uring_sqe*>(MAP_FAILED)),
+        sqes_size_(0) {
+    ::io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = static_cast<int>(
+        ::syscall(__NR_io_uring_setup, kIoUringQueueDepth, &params));
+    if (ring_fd_ < 0) {
+      return;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      Close();
+      return;
+    }
+    if (single_mmap) {
+      cq_ring_ = sq_ring_;
+    } else {
+      cq_ring_ =
+          ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+      if (cq_ring_ == MAP_FAILED) {
+        Close();
+        return;
+      }
+    }
+    sqes_size_ = params.sq_entries * sizeof(::io_uring_sqe);
+    sqes_ = static_cast<::io_uring_sqe*>(
+        ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+      Close();
+      return;
+    }
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_entries_ = params.sq_entries;
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<::io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  // Submits |to_submit| queued requests and waits for |min_complete|
+  // completions. Returns the number of requests submitted, or -1 with errno
+  // set.
+  int Enter(unsigned to_submit, unsigned min_complete) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit,
+                                      min_complete, IORING_ENTER_GETEVENTS,
+                                      nullptr, 0));
+  }
+
+  // Stores the results of the completed reads of |reqs| and marks them in
+  // |completed|. Returns the number of reads completed.
+  size_t Reap(const std::string& filename, RandomAccessFile::ReadRequest* reqs,
+              std::vector<bool>* completed) {
+    size_t num_reaped = 0;
+    unsigned cq_head = *cq_head_;
+    const unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while (cq_head != cq_tail) {
+      const ::io_uring_cqe& cqe = cqes_[cq_head & *cq_mask_];
+      RandomAccessFile::ReadRequest* req = &reqs[cqe.user_data];
+      if (cqe.res < 0) {
+        req->result = Slice(req->scratch, 0);
+        req->status = PosixError(filename, -cqe.res);
+      } else {
+        req->result = Slice(req->scratch, cqe.res);
+        req->status = Status::OK();
+      }
+      (*completed)[cqe.user_data] = true;
+      ++num_reaped;
+      ++cq_head;
+    }
+    __atomic_store_n(cq_head_, cq_head, __ATOMIC_RELEASE);
+    return num_reaped;
+  }
+
+  void Close() {
+    if (sqes_ != MAP_FAILED) {
+      ::munmap(sqes_, sqes_size_);
+      sqes_ = static_cast<::io_uring_sqe*>(MAP_FAILED);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      ::munmap(cq_ring_, cq_ring_size_);
+    }
+    cq_ring_ = MAP_FAILED;
+    if (sq_ring_ != MAP_FAILED) {
+      ::munmap(sq_ring_, sq_ring_size_);
+      sq_ring_ = MAP_FAILED;
+    }
+    if (ring_fd_ >= 0) {
+      ::close(ring_fd_);
+      ring_fd_ = -1;
+    }
+  }
+
+  int ring_fd_;  // -1 if io_uring is unavailable.
+
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;  // Same as sq_ring_ if the kernel maps both rings at once.
+  size_t cq_ring_size_;
+  ::io_uring_sqe* sqes_;
+  size_t sqes_size_;
+
+  // Fields of the mapped rings.
+  unsigned sq_entries_;
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  ::io_uring_cqe* cqes_;
+};
+
+#endif  // defined(LEVELDB_HAVE_IO_URING)
+
+// Serves MultiRead() batches by issuing their pread()s from a fixed set of
+// threads, so the reads of one batch proceed in parallel. Used where
+// io_uring is not available.
+//
+// Thread-safe.
+class PosixMultiReadPool {
+ public:
+  static PosixMultiReadPool* Get() {
+    static NoDestructor<PosixMultiReadPool> pool;
+    return pool.get();
+  }
+
+  PosixMultiReadPool() : work_cv_(&mu_) {
+    for (int i = 0; i < kNumMultiReadThreads; i++) {
+      std::thread read_thread(&PosixMultiReadPool::ThreadMain, this);
+      read_thread.detach();
+    }
+  }
+
+  PosixMultiReadPool(const PosixMultiReadPool&) = delete;
+  PosixMultiReadPool& operator=(const PosixMultiReadPool&) = delete;
+
+  // Reads all of |reqs[0..num-1]| from |fd|. The calling thread also
+  // performs reads until none are left to hand out.
+  void Read(int fd, const std::string& filename,
+            RandomAccessFile::ReadRequest* reqs, size_t num) {
+    assert(num > 0);
+    Batch batch(&mu_, fd, &filename, reqs, num);
+    MutexLock lock(&mu_);
+    queue_.push_back(&batch);
+    work_cv_.SignalAll();
+    while (batch.next < batch.num) {
+      ReadOne(&batch);
+    }
+    while (batch.done < batch.num) {
+      batch.finished.Wait();
+    }
+  }
+
+ private:
+  // A MultiRead() call in progress. All fields but the constant ones are
+  // protected by mu_.
+  struct Batch {
+    Batch(port::Mutex* mu, int fd, const std::string* filename,
+          RandomAccessFile::ReadRequest* reqs, size_t num)
+        : fd(fd),
+          filename(filename),
+          reqs(reqs),
+          num(num),
+          next(0),
+          done(0),
+          finished(mu) {}
+
+    const int fd;
+    const std::string* const filename;
+    RandomAccessFile::ReadRequest* const reqs;
+    const size_t num;
+    size_t next;  // Index of the next request to hand out.
+    size_t done;  // Number of completed requests.
+    port::CondVar finished;
+  };
+
+  // Performs the next unclaimed request of |batch|. Drops the lock while
+  // reading.
+  void ReadOne(Batch* batch) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    assert(batch->next < batch->num);
+    const size_t index = batch->next++;
+    if (batch->next == batch->num) {
+      queue_.erase(std::find(queue_.begin(), queue_.end(), batch));
+    }
+    mu_.Unlock();
+    PosixPread(batch->fd, *batch->filename, &batch->reqs[index]);
+    mu_.Lock();
+    if (++batch->done == batch->num) {
+      batch->finished.Signal();
+    }
+  }
+
+  void ThreadMain() {
+    MutexLock lock(&mu_);
+    while (true) {
+      while (queue_.empty()) {
+        work_cv_.Wait();
+      }
+      ReadOne(queue_.front());
+    }
+  }
+
+  port::Mutex mu_;
+  port::CondVar work_cv_ GUARDED_BY(mu_);
+
+  // Batches that still have requests to hand out.
+  std::deque<Batch*> queue_ GUARDED_BY(mu_);
+};
+
 // Implements sequential read access in a file using read().
 //
 // Instances of this class are thread-friendly but not thread-safe, as required
@@ -226,6 +588,63 @@ class PosixRandomAccessFile final : public RandomAccessFile {
     return status;
   }
 
+  void MultiRead(ReadRequest* reqs, size_t num) const override {
+    if (num == 0) {
+      return;
+    }
+
+    int fd = fd_;
+    if (!has_permanent_fd_) {
+      fd = ::open(filename_.c_str(), O_RDONLY | kOpenBaseFlags);
+      if (fd < 0) {
+        Status status = PosixError(filename_, errno);
+        for (size_t i = 0; i < num; i++) {
+          reqs[i].result = Slice(reqs[i].scratch, 0);
+          reqs[i].status = status;
+        }
+        return;
+      }
+    }
+
+    assert(fd != -1);
+
+    if (num == 1) {
+      PosixPread(fd, filename_, &reqs[0]);
+    } else {
+#if defined(LEVELDB_HAVE_IO_URING)
+      PosixIoUring* ring = g_io_uring_enabled.load(std::memory_order_relaxed)
+                               ? PosixIoUring::ForCurrentThread()
+                               : nullptr;
+      if (ring != nullptr) {
+        ring->Read(fd, filename_, reqs, num);
+      } else {
+        PosixMultiReadPool::Get()->Read(fd, filename_, reqs, num);
+      }
+#else
+      PosixMultiReadPool::Get()->Read(fd, filename_, reqs, num);
+#endif  // defined(LEVELDB_HAVE_IO_URING)
+    }
+
+    if (!has_permanent_fd_) {
+      // Close the temporary file descriptor opened earlier.
+      assert(fd != fd_);
+      ::close(fd);
+    }
+  }
+
+  void Prefetch(uint64_t offset, size_t n) const override {
+#if defined(POSIX_FADV_WILLNEED)
+    // The hint is not worth opening a file that has no permanent fd.
+    if (has_permanent_fd_) {
+      ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(n),
+                      POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)offset;
+    (void)n;
+#endif  // defined(POSIX_FADV_WILLNEED)
+  }
+
  private:
   const bool has_permanent_fd_;  // If false, the file is opened on every read.
   const int fd_;                 // -1 if has_permanent_fd_ is false.
@@ -273,6 +692,20 @@ class PosixMmapReadableFile final : public RandomAccessFile {
     return Status::OK();
   }
 
+  void Prefetch(uint64_t offset, size_t n) const override {
+    if (offset >= length_) {
+      return;
+    }
+    n = std::min<uint64_t>(n, length_ - offset);
+    // madvise() wants a page-aligned address.
+    static const uintptr_t kPageMask =
+        static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE)) - 1;
+    uintptr_t start = reinterpret_cast<uintptr_t>(mmap_base_ + offset);
+    uintptr_t aligned_start = start & ~kPageMask;
+    ::madvise(reinterpret_cast<void*>(aligned_start),
+              n + (start - aligned_start), MADV_WILLNEED);
+  }
+
  private:
   char* const mmap_base_;
   const size_t length_;
@@ -703,7 +1136,14 @@ class PosixEnv : public Env {
   }
 
   void Schedule(void (*background_work_function)(void* background_work_arg),
-                void* background_work_arg) override;
+                void* background_work_arg) override {
+    Schedule(background_work_function, background_work_arg, kLowPriority);
+  }
+
+  void Schedule(void (*background_work_function)(void* background_work_arg),
+                void* background_work_arg, Priority pri) override;
+
+  void SetBackgroundThreads(int number, Priority pri) override;
 
   void StartThread(void (*thread_main)(void* thread_main_arg),
                    void* thread_main_arg) override {
@@ -759,12 +1199,18 @@ class PosixEnv : public Env {
   }
 
  private:
-  void BackgroundThreadMain();
+  struct BackgroundPool;
 
-  static void BackgroundThreadEntryPoint(PosixEnv* env) {
-    env->BackgroundThreadMain();
+  void BackgroundThreadMain(BackgroundPool* pool);
+
+  static void BackgroundThreadEntryPoint(PosixEnv* env, BackgroundPool* pool) {
+    env->BackgroundThreadMain(pool);
   }
 
+  // Start threads until "pool" has as many as it was asked for.
+  void MaybeStartBackgroundThreads(BackgroundPool* pool)
+      EXCLUSIVE_LOCKS_REQUIRED(pool->mutex);
+
   // Stores the work item data in a Schedule() call.
   //
   // Instances are constructed on the thread calling Schedule() and used on the
@@ -779,12 +1225,19 @@ class PosixEnv : public Env {
     void* const arg;
   };
 
-  port::Mutex background_work_mutex_;
-  port::CondVar background_work_cv_ GUARDED_BY(background_work_mutex_);
-  bool started_background_thread_ GUARDED_BY(background_work_mutex_);
+  // The work queue and threads serving one Priority.  Threads are started
+  // lazily, when the first work item is scheduled on the pool.
+  struct BackgroundPool {
+    BackgroundPool() : cv(&mutex), started_threads(0), wanted_threads(1) {}
 
-  std::queue<BackgroundWorkItem> background_work_queue_
-      GUARDED_BY(background_work_mutex_);
+    port::Mutex mutex;
+    port::CondVar cv GUARDED_BY(mutex);
+    int started_threads GUARDED_BY(mutex);
+    int wanted_threads GUARDED_BY(mutex);
+    std::queue<BackgroundWorkItem> queue GUARDED_BY(mutex);
+  };
+
+  BackgroundPool background_pools_[2];  // Indexed by Priority
 
   PosixLockTable locks_;  // Thread-safe.
   Limiter mmap_limiter_;  // Thread-safe.
@@ -820,47 +1273,58 @@ int MaxOpenFiles() {
 }  // namespace
 
 PosixEnv::PosixEnv()
-    : background_work_cv_(&background_work_mutex_),
-      started_background_thread_(false),
-      mmap_limiter_(MaxMmaps()),
+    : mmap_limiter_(MaxMmaps()),
       fd_limiter_(MaxOpenFiles()) {}
 
 void PosixEnv::Schedule(
     void (*background_work_function)(void* background_work_arg),
-    void* background_work_arg) {
-  background_work_mutex_.Lock();
+    void* background_work_arg, Priority pri) {
+  BackgroundPool* pool = &background_pools_[pri];
+  MutexLock lock(&pool->mutex);
 
-  // Start the background thread, if we haven't done so already.
-  if (!started_background_thread_) {
-    started_background_thread_ = true;
-    std::thread background_thread(PosixEnv::BackgroundThreadEntryPoint, this);
-    background_thread.detach();
-  }
+  MaybeStartBackgroundThreads(pool);
 
-  // If the queue is empty, the background thread may be waiting for work.
-  if (background_work_queue_.empty()) {
-    background_work_cv_.Signal();
+  pool->queue.emplace(background_work_function, background_work_arg);
+  pool->cv.Signal();
+}
+
+void PosixEnv::SetBackgroundThreads(int number, Priority pri) {
+  BackgroundPool* pool = &background_pools_[pri];
+  MutexLock lock(&pool->mutex);
+  if (number > pool->wanted_threads) {
+    pool->wanted_threads = number;
   }
+  // Pools that have not seen any work yet keep starting lazily.
+  if (pool->started_threads > 0) {
+    MaybeStartBackgroundThreads(pool);
+  }
+}
 
-  background_work_queue_.emplace(background_work_function, background_work_arg);
-  background_work_mutex_.Unlock();
+void PosixEnv::MaybeStartBackgroundThreads(BackgroundPool* pool) {
+  pool->mutex.AssertHeld();
+  while (pool->started_threads < pool->wanted_threads) {
+    pool->started_threads++;
+    std::thread background_thread(PosixEnv::BackgroundThreadEntryPoint, this,
+                                  pool);
+    background_thread.detach();
+  }
 }
 
-void PosixEnv::BackgroundThreadMain() {
+void PosixEnv::BackgroundThreadMain(BackgroundPool* pool) {
   while (true) {
-    background_work_mutex_.Lock();
+    pool->mutex.Lock();
 
     // Wait until there is work to be done.
-    while (background_work_queue_.empty()) {
-      background_work_cv_.Wait();
+    while (pool->queue.empty()) {
+      pool->cv.Wait();
     }
 
-    assert(!background_work_queue_.empty());
-    auto background_work_function = background_work_queue_.front().function;
-    void* background_work_arg = background_work_queue_.front().arg;
-    background_work_queue_.pop();
+    assert(!pool->queue.empty());
+    auto background_work_function = pool->queue.front().function;
+    void* background_work_arg = pool->queue.front().arg;
+    pool->queue.pop();
 
-    background_work_mutex_.Unlock();
+    pool->mutex.Unlock();
     background_work_function(background_work_arg);
   }
 }
@@ -932,6 +1396,10 @@ void EnvPosixTestHelper::SetReadOnlyMMapLimit(int limit) {
   g_mmap_limit = limit;
 }
 
+void EnvPosixTestHelper::SetIoUringEnabled(bool enabled) {
+  g_io_uring_enabled.store(enabled, std::memory_order_relaxed);
+}
+
 Env* Env::Default() {
   static PosixDefaultEnv env_container;
   return env_container.env();
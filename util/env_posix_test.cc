@@ -17,6 +17,8 @@
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "util/env_posix_test_helper.h"
+#include "util/mutexlock.h"
+#include "util/random.h"
 #include "util/testutil.h"
 
 #if HAVE_O_CLOEXEC
@@ -176,6 +178,10 @@ class EnvPosixTest : public testing::Test {
     EnvPosixTestHelper::SetReadOnlyMMapLimit(mmap_limit);
   }
 
+  static void SetIoUringEnabled(bool enabled) {
+    EnvPosixTestHelper::SetIoUringEnabled(enabled);
+  }
+
   EnvPosixTest() : env_(Env::Default()) {}
 
   Env* env_;
@@ -212,6 +218,108 @@ TEST_F(EnvPosixTest, TestOpenOnRead) {
   ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
 }
 
+TEST_F(EnvPosixTest, TestMultiRead) {
+  std::string test_dir;
+  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/multi_read.txt";
+
+  Random rnd(test::RandomSeed());
+  std::string data;
+  test::RandomString(&rnd, 100000, &data);
+  ASSERT_LEVELDB_OK(WriteStringToFile(env_, data, test_file));
+
+  // Enough files to get mmap-backed, pread-backed and open-on-read files.
+  const int kNumFiles = kReadOnlyFileLimit + kMMapLimit + 2;
+  leveldb::RandomAccessFile* files[kNumFiles] = {0};
+  for (int i = 0; i < kNumFiles; i++) {
+    ASSERT_LEVELDB_OK(env_->NewRandomAccessFile(test_file, &files[i]));
+  }
+
+  for (bool io_uring : {true, false}) {
+    SetIoUringEnabled(io_uring);
+    for (int i = 0; i < kNumFiles; i++) {
+      // More requests than the io_uring queue depth.
+      const int kNumRequests = 200;
+      std::vector<std::string> scratch(kNumRequests);
+      std::vector<RandomAccessFile::ReadRequest> reqs(kNumRequests);
+      for (int r = 0; r < kNumRequests; r++) {
+        reqs[r].offset = rnd.Uniform(data.size() - 5000);
+        reqs[r].n = 1 + rnd.Uniform(5000);
+        scratch[r].resize(reqs[r].n);
+        reqs[r].scratch = &scratch[r][0];
+      }
+      files[i]->MultiRead(reqs.data(), reqs.size());
+      for (int r = 0; r < kNumRequests; r++) {
+        ASSERT_LEVELDB_OK(reqs[r].status);
+        ASSERT_EQ(data.substr(reqs[r].offset, reqs[r].n),
+                  reqs[r].result.ToString());
+      }
+    }
+  }
+  SetIoUringEnabled(true);
+
+  for (int i = 0; i < kNumFiles; i++) {
+    delete files[i];
+  }
+  ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
+}
+
+TEST_F(EnvPosixTest, RunOnSeparatePools) {
+  struct RunState {
+    port::Mutex mu;
+    port::CondVar cvar{&mu};
+    bool release = false;
+    int blocked = 0;
+    int finished = 0;
+
+    // Occupies a background thread until "release" is set.
+    static void Block(void* arg) {
+      RunState* state = reinterpret_cast<RunState*>(arg);
+      MutexLock l(&state->mu);
+      state->blocked++;
+      state->cvar.SignalAll();
+      while (!state->release) {
+        state->cvar.Wait();
+      }
+      state->finished++;
+      state->cvar.SignalAll();
+    }
+
+    static void Run(void* arg) {
+      RunState* state = reinterpret_cast<RunState*>(arg);
+      MutexLock l(&state->mu);
+      state->finished++;
+      state->cvar.SignalAll();
+    }
+  };
+
+  RunState state;
+  env_->SetBackgroundThreads(2, Env::kLowPriority);
+  env_->Schedule(&RunState::Block, &state, Env::kLowPriority);
+  env_->Schedule(&RunState::Block, &state, Env::kLowPriority);
+  {
+    // Both low priority threads are busy.
+    MutexLock l(&state.mu);
+    while (state.blocked < 2) {
+      state.cvar.Wait();
+    }
+  }
+
+  // High priority work does not queue up behind them.
+  env_->Schedule(&RunState::Run, &state, Env::kHighPriority);
+  MutexLock l(&state.mu);
+  while (state.finished < 1) {
+    state.cvar.Wait();
+  }
+  ASSERT_EQ(state.finished, 1);
+
+  state.release = true;
+  state.cvar.SignalAll();
+  while (state.finished < 3) {
+    state.cvar.Wait();
+  }
+}
+
 #if HAVE_O_CLOEXEC
 
 TEST_F(EnvPosixTest, TestCloseOnExecSequentialFile) {
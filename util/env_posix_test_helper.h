@@ -21,6 +21,11 @@ class EnvPosixTestHelper {
   // Set the maximum number of read-only files that will be mapped via mmap.
   // Must be called before creating an Env.
   static void SetReadOnlyMMapLimit(int limit);
+
+  // Enable or disable io_uring for RandomAccessFile::MultiRead(). When
+  // disabled (or unsupported), reads are served by a thread pool instead.
+  // May be called at any time.
+  static void SetIoUringEnabled(bool enabled);
 };
 
 }  // namespace leveldb
@@ -0,0 +1,365 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/persistent_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/logging.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+PersistentCache::~PersistentCache() = default;
+
+namespace {
+
+// Each segment file is a sequence of records:
+//    checksum: fixed32     // masked crc32c of the rest of the record
+//    key_length: fixed32
+//    data_length: fixed32
+//    key: char[key_length]
+//    data: char[data_length]
+// Recovery stops at the first record of a segment that does not check out.
+static const size_t kRecordHeaderSize = 12;
+
+struct Segment;
+typedef std::list<std::shared_ptr<Segment>> SegmentList;
+
+// 一个段文件。正在写入的段只在内存中（buffer），写满后整体写入文件。
+struct Segment {
+  explicit Segment(uint64_t n) : number(n), file(nullptr) {}
+  ~Segment() { delete file; }
+
+  const uint64_t number;
+  // Set once the segment is written out.  Until then the segment is read
+  // from "buffer".
+  RandomAccessFile* file;
+  std::string buffer;
+  uint64_t size;
+  // Keys of the records, some of which may have been stored again since.
+  std::vector<std::string> keys;
+  SegmentList::iterator lru_position;  // If written out
+};
+
+// Where a record is: the segment keeps the file open while it is read.
+struct Location {
+  std::shared_ptr<Segment> segment;
+  uint64_t offset;
+  size_t size;
+};
+
+// Decodes the record "input" and checks that it holds "key".
+bool DecodeRecord(const Slice& input, const Slice& key, Slice* data) {
+  if (input.size() < kRecordHeaderSize) {
+    return false;
+  }
+  const uint32_t crc = crc32c::Unmask(DecodeFixed32(input.data()));
+  const uint32_t key_length = DecodeFixed32(input.data() + 4);
+  const uint32_t data_length = DecodeFixed32(input.data() + 8);
+  if (input.size() != kRecordHeaderSize + key_length + data_length ||
+      crc32c::Value(input.data() + 4, input.size() - 4) != crc ||
+      Slice(input.data() + kRecordHeaderSize, key_length) != key) {
+    return false;
+  }
+  *data = Slice(input.data() + kRecordHeaderSize + key_length, data_length);
+  return true;
+}
+
+class SegmentedFileCache : public PersistentCache {
+ public:
+  SegmentedFileCache(Env* env, const std::string& path, uint64_t capacity)
+      : env_(env),
+        path_(path),
+        capacity_(capacity),
+        // Evicting a segment drops a sixteenth of the cache.
+        segment_size_(std::min<uint64_t>(
+            64 << 20, std::max<uint64_t>(capacity / 16, 64 << 10))),
+        lock_(nullptr),
+        next_number_(1),
+        usage_(0) {}
+
+  ~SegmentedFileCache() override {
+    mutex_.Lock();
+    if (active_ != nullptr && !active_->buffer.empty()) {
+      WriteOut(active_);
+    }
+    active_.reset();
+    index_.clear();
+    lru_.clear();
+    mutex_.Unlock();
+    if (lock_ != nullptr) {
+      env_->UnlockFile(lock_);
+    }
+  }
+
+  Status Open();
+
+  void Insert(const Slice& key, const Slice& data) override;
+  bool Lookup(const Slice& key, std::string* data) override;
+
+ private:
+  std::string SegmentFileName(uint64_t number) const {
+    char buf[100];
+    std::snprintf(buf, sizeof(buf), "/%06llu.cache",
+                  static_cast<unsigned long long>(number));
+    return path_ + buf;
+  }
+
+  // Adds the records of the segment file "number" to the index.
+  Status RecoverSegment(uint64_t number) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Writes the buffer of "segment" to its file, then reads it from there.
+  // Drops the segment if it cannot be written.  Temporarily releases
+  // mutex_ while writing.
+  void WriteOut(const std::shared_ptr<Segment>& segment)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Makes a segment read from its file the most recently used one.
+  void AddToLRU(const std::shared_ptr<Segment>& segment)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Removes "segment" and the records it still holds.  Takes "segment" by
+  // value, as it may be the element of lru_ it erases.
+  void Drop(std::shared_ptr<Segment> segment)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  Env* const env_;
+  const std::string path_;
+  const uint64_t capacity_;
+  const uint64_t segment_size_;
+  FileLock* lock_;
+
+  port::Mutex mutex_;
+  std::unordered_map<std::string, Location> index_ GUARDED_BY(mutex_);
+  // Segments read from their files, least recently used first.
+  SegmentList lru_ GUARDED_BY(mutex_);
+  std::shared_ptr<Segment> active_ GUARDED_BY(mutex_);
+  uint64_t next_number_ GUARDED_BY(mutex_);
+  uint64_t usage_ GUARDED_BY(mutex_);  // Bytes in lru_
+};
+
+Status SegmentedFileCache::Open() {
+  env_->CreateDir(path_);  // Ignore error; the directory may exist
+  Status s = env_->LockFile(path_ + "/LOCK", &lock_);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<std::string> filenames;
+  s = env_->GetChildren(path_, &filenames);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<uint64_t> numbers;
+  for (const std::string& filename : filenames) {
+    Slice name(filename);
+    uint64_t number;
+    if (ConsumeDecimalNumber(&name, &number) && name == Slice(".cache")) {
+      numbers.push_back(number);
+    }
+  }
+  // 按写入顺序恢复，后写入的记录覆盖先写入的
+  std::sort(numbers.begin(), numbers.end());
+  MutexLock l(&mutex_);
+  for (uint64_t number : numbers) {
+    if (!RecoverSegment(number).ok()) {
+      env_->RemoveFile(SegmentFileName(number));
+    }
+    next_number_ = number + 1;
+  }
+  while (usage_ > capacity_ && !lru_.empty()) {
+    Drop(lru_.front());
+  }
+  active_ = std::make_shared<Segment>(next_number_++);
+  active_->size = 0;
+  return Status::OK();
+}
+
+Status SegmentedFileCache::RecoverSegment(uint64_t number) {
+  std::shared_ptr<Segment> segment = std::make_shared<Segment>(number);
+  std::string contents;
+  Status s = ReadFileToString(env_, SegmentFileName(number), &contents);
+  if (!s.ok()) {
+    return s;
+  }
+  size_t offset = 0;
+  while (offset + kRecordHeaderSize <= contents.size()) {
+    const uint32_t key_length = DecodeFixed32(&contents[offset + 4]);
+    const uint32_t data_length = DecodeFixed32(&contents[offset + 8]);
+    const uint64_t size =
+        uint64_t{kRecordHeaderSize} + key_length + data_length;
+    if (size > contents.size() - offset) {
+      break;
+    }
+    Slice key(&contents[offset + kRecordHeaderSize], key_length);
+    Slice data;
+    if (!DecodeRecord(Slice(&contents[offset], size), key, &data)) {
+      break;
+    }
+    Location& location = index_[key.ToString()];
+    location.segment = segment;
+    location.offset = offset;
+    location.size = size;
+    segment->keys.push_back(key.ToString());
+    offset += size;
+  }
+  if (offset == 0) {
+    return Status::Corruption("empty cache segment");
+  }
+  segment->size = offset;
+  s = env_->NewRandomAccessFile(SegmentFileName(number), &segment->file);
+  if (!s.ok()) {
+    Drop(segment);
+    return s;
+  }
+  AddToLRU(segment);
+  return Status::OK();
+}
+
+void SegmentedFileCache::AddToLRU(const std::shared_ptr<Segment>& segment) {
+  lru_.push_back(segment);
+  segment->lru_position = std::prev(lru_.end());
+  usage_ += segment->size;
+}
+
+void SegmentedFileCache::Drop(std::shared_ptr<Segment> segment) {
+  for (const std::string& key : segment->keys) {
+    auto iter = index_.find(key);
+    if (iter != index_.end() && iter->second.segment == segment) {
+      index_.erase(iter);
+    }
+  }
+  if (segment->file != nullptr) {
+    usage_ -= segment->size;
+    lru_.erase(segment->lru_position);
+  }
+  // Readers holding the segment keep the deleted file open.
+  env_->RemoveFile(SegmentFileName(segment->number));
+}
+
+void SegmentedFileCache::WriteOut(const std::shared_ptr<Segment>& segment) {
+  const std::string fname = SegmentFileName(segment->number);
+  // Lookups keep reading the buffer, which does not change any more.
+  mutex_.Unlock();
+  WritableFile* file;
+  Status s = env_->NewWritableFile(fname, &file);
+  if (s.ok()) {
+    s = file->Append(segment->buffer);
+    if (s.ok()) {
+      s = file->Close();
+    }
+    delete file;
+  }
+  RandomAccessFile* readable = nullptr;
+  if (s.ok()) {
+    s = env_->NewRandomAccessFile(fname, &readable);
+  }
+  mutex_.Lock();
+
+  if (!s.ok()) {
+    Drop(segment);
+    return;
+  }
+  segment->file = readable;
+  std::string().swap(segment->buffer);
+  AddToLRU(segment);
+  while (usage_ > capacity_ && lru_.size() > 1) {
+    Drop(lru_.front());
+  }
+}
+
+void SegmentedFileCache::Insert(const Slice& key, const Slice& data) {
+  std::string record;
+  record.resize(kRecordHeaderSize);
+  EncodeFixed32(&record[4], static_cast<uint32_t>(key.size()));
+  EncodeFixed32(&record[8], static_cast<uint32_t>(data.size()));
+  record.append(key.data(), key.size());
+  record.append(data.data(), data.size());
+  EncodeFixed32(&record[0], crc32c::Mask(crc32c::Value(record.data() + 4,
+                                                       record.size() - 4)));
+
+  MutexLock l(&mutex_);
+  std::string key_string = key.ToString();
+  if (index_.count(key_string) > 0) {
+    return;
+  }
+  std::shared_ptr<Segment> segment = active_;
+  Location& location = index_[key_string];
+  location.segment = segment;
+  location.offset = segment->buffer.size();
+  location.size = record.size();
+  segment->buffer.append(record);
+  segment->size = segment->buffer.size();
+  segment->keys.push_back(std::move(key_string));
+  if (segment->size >= segment_size_) {
+    active_ = std::make_shared<Segment>(next_number_++);
+    active_->size = 0;
+    WriteOut(segment);
+  }
+}
+
+bool SegmentedFileCache::Lookup(const Slice& key, std::string* data) {
+  Location location;
+  RandomAccessFile* file;
+  std::string record;
+  {
+    MutexLock l(&mutex_);
+    auto iter = index_.find(key.ToString());
+    if (iter == index_.end()) {
+      return false;
+    }
+    // "location" keeps the segment, and so its file, alive.
+    location = iter->second;
+    file = location.segment->file;
+    if (file == nullptr) {
+      record = location.segment->buffer.substr(location.offset,
+                                               location.size);
+    } else {
+      lru_.splice(lru_.end(), lru_, location.segment->lru_position);
+    }
+  }
+
+  Slice input(record);
+  std::unique_ptr<char[]> scratch;
+  if (file != nullptr) {
+    scratch.reset(new char[location.size]);
+    if (!file->Read(location.offset, location.size, &input, scratch.get())
+             .ok()) {
+      return false;
+    }
+  }
+  Slice result;
+  if (!DecodeRecord(input, key, &result)) {
+    return false;
+  }
+  data->assign(result.data(), result.size());
+  return true;
+}
+
+}  // namespace
+
+Status NewPersistentCache(Env* env, const std::string& path, uint64_t capacity,
+                          PersistentCache** cache) {
+  *cache = nullptr;
+  SegmentedFileCache* result = new SegmentedFileCache(env, path, capacity);
+  Status s = result->Open();
+  if (!s.ok()) {
+    delete result;
+    return s;
+  }
+  *cache = result;
+  return s;
+}
+
+}  // namespace leveldb
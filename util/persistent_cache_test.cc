@@ -0,0 +1,192 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/persistent_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/env.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+static std::string Key(int i) {
+  char buf[100];
+  std::snprintf(buf, sizeof(buf), "key%06d", i);
+  return buf;
+}
+
+// Large enough for a few records to fill a segment.
+static std::string Value(int i) { return std::string(20000, 'a' + (i % 26)); }
+
+class PersistentCacheTest : public testing::Test {
+ public:
+  // Holds all the entries the tests insert, unless they test eviction.
+  static constexpr uint64_t kCapacity = 8 << 20;
+
+  PersistentCacheTest() : env_(Env::Default()), cache_(nullptr) {
+    EXPECT_LEVELDB_OK(env_->GetTestDirectory(&path_));
+    path_ += "/persistent_cache_test";
+    DestroyFiles();
+  }
+
+  ~PersistentCacheTest() {
+    delete cache_;
+    DestroyFiles();
+  }
+
+  void DestroyFiles() {
+    std::vector<std::string> filenames;
+    if (env_->GetChildren(path_, &filenames).ok()) {
+      for (const std::string& filename : filenames) {
+        env_->RemoveFile(path_ + "/" + filename);
+      }
+      env_->RemoveDir(path_);
+    }
+  }
+
+  Status Open(uint64_t capacity) {
+    delete cache_;
+    cache_ = nullptr;
+    return NewPersistentCache(env_, path_, capacity, &cache_);
+  }
+
+  std::string Lookup(int i) {
+    std::string data;
+    if (!cache_->Lookup(Key(i), &data)) {
+      return "NOT_FOUND";
+    }
+    return data;
+  }
+
+  // Returns the names of the segment files.
+  std::vector<std::string> Segments() {
+    std::vector<std::string> filenames, result;
+    EXPECT_LEVELDB_OK(env_->GetChildren(path_, &filenames));
+    for (const std::string& filename : filenames) {
+      if (filename.size() > 6 &&
+          filename.compare(filename.size() - 6, 6, ".cache") == 0) {
+        result.push_back(path_ + "/" + filename);
+      }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  Env* env_;
+  std::string path_;
+  PersistentCache* cache_;
+};
+
+TEST_F(PersistentCacheTest, InsertAndLookup) {
+  ASSERT_LEVELDB_OK(Open(kCapacity));
+  ASSERT_EQ("NOT_FOUND", Lookup(100));
+  cache_->Insert(Key(1), "one");
+  cache_->Insert(Key(2), "two");
+  ASSERT_EQ("one", Lookup(1));
+  ASSERT_EQ("two", Lookup(2));
+  ASSERT_EQ("NOT_FOUND", Lookup(3));
+
+  // The first copy stays.
+  cache_->Insert(Key(1), "uno");
+  ASSERT_EQ("one", Lookup(1));
+
+  // Also read back from segments written out.
+  for (int i = 10; i < 200; i++) {
+    cache_->Insert(Key(i), Value(i));
+  }
+  ASSERT_GT(Segments().size(), 0);
+  for (int i = 10; i < 200; i++) {
+    ASSERT_EQ(Value(i), Lookup(i));
+  }
+}
+
+TEST_F(PersistentCacheTest, Recovery) {
+  ASSERT_LEVELDB_OK(Open(kCapacity));
+  for (int i = 0; i < 100; i++) {
+    cache_->Insert(Key(i), Value(i));
+  }
+  ASSERT_LEVELDB_OK(Open(kCapacity));
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(Value(i), Lookup(i));
+  }
+
+  // Segments written after reopening do not replace the earlier ones.
+  for (int i = 100; i < 150; i++) {
+    cache_->Insert(Key(i), Value(i));
+  }
+  ASSERT_LEVELDB_OK(Open(kCapacity));
+  for (int i = 0; i < 150; i++) {
+    ASSERT_EQ(Value(i), Lookup(i));
+  }
+}
+
+TEST_F(PersistentCacheTest, DirectoryIsLocked) {
+  ASSERT_LEVELDB_OK(Open(kCapacity));
+  PersistentCache* other;
+  ASSERT_TRUE(!NewPersistentCache(env_, path_, kCapacity, &other).ok());
+  ASSERT_TRUE(other == nullptr);
+}
+
+TEST_F(PersistentCacheTest, Eviction) {
+  const uint64_t kSmallCapacity = 1 << 20;
+  ASSERT_LEVELDB_OK(Open(kSmallCapacity));
+  const int kNumEntries = 500;  // About ten times the capacity
+  for (int i = 0; i < kNumEntries; i++) {
+    cache_->Insert(Key(i), Value(i));
+    // Keep reading the first entry.
+    Lookup(0);
+  }
+  ASSERT_EQ(Value(0), Lookup(0));
+  ASSERT_EQ("NOT_FOUND", Lookup(100));
+  ASSERT_EQ(Value(kNumEntries - 1), Lookup(kNumEntries - 1));
+
+  uint64_t total = 0;
+  for (const std::string& fname : Segments()) {
+    uint64_t size;
+    ASSERT_LEVELDB_OK(env_->GetFileSize(fname, &size));
+    total += size;
+  }
+  ASSERT_LE(total, kSmallCapacity);
+
+  // A smaller capacity evicts more on reopening.
+  ASSERT_LEVELDB_OK(Open(kSmallCapacity / 4));
+  ASSERT_EQ(Value(kNumEntries - 1), Lookup(kNumEntries - 1));
+  int found = 0;
+  for (int i = 0; i < kNumEntries; i++) {
+    if (Lookup(i) != "NOT_FOUND") {
+      found++;
+    }
+  }
+  ASSERT_LT(found, kNumEntries / 16);
+}
+
+TEST_F(PersistentCacheTest, CorruptSegment) {
+  ASSERT_LEVELDB_OK(Open(kCapacity));
+  for (int i = 0; i < 100; i++) {
+    cache_->Insert(Key(i), Value(i));
+  }
+  delete cache_;
+  cache_ = nullptr;
+
+  // Damage the last record of the last segment.
+  std::vector<std::string> segments = Segments();
+  ASSERT_GT(segments.size(), 1);
+  std::string contents;
+  ASSERT_LEVELDB_OK(ReadFileToString(env_, segments.back(), &contents));
+  contents[contents.size() - 1] ^= 1;
+  ASSERT_LEVELDB_OK(WriteStringToFile(env_, contents, segments.back()));
+
+  ASSERT_LEVELDB_OK(Open(kCapacity));
+  for (int i = 0; i < 99; i++) {
+    ASSERT_EQ(Value(i), Lookup(i));
+  }
+  ASSERT_EQ("NOT_FOUND", Lookup(99));
+}
+
+}  // namespace leveldb
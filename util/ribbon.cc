@@ -0,0 +1,287 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A Ribbon filter ("Ribbon filter: practically smaller than Bloom and Xor",
+// Dillinger & Walzer 2021) answers "may key be present?" by storing the
+// solution S of a system of linear equations over GF(2).  Every key maps
+// to one equation: a start slot s, a 128-bit coefficient row c, and an
+// r-bit result x, and the filter is built so that
+//
+//     XOR of S[s + j] for every bit j set in c  ==  x
+//
+// holds for every key.  A key that was not added satisfies its equation
+// with probability 2^-r.  Since the rows are confined to a 128-slot band,
+// the system is solved by incremental Gaussian elimination in near-linear
+// time, and it takes only a few percent more than r bits per key to make
+// a solution exist.
+
+#include <cstdint>
+#include <vector>
+
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+
+// Filter layout:
+//    [solution: num_blocks * result_bits * 8 bytes]
+//    seed: uint8
+//    result_bits: uint8
+// Slots are grouped in blocks of 64.  For each block, the solution holds
+// one little-endian 64-bit word per result bit, whose bit i is that result
+// bit of the block's slot i.
+constexpr int kTrailerSize = 2;
+constexpr int kBandWidth = 128;
+constexpr int kBlockSlots = 64;
+constexpr int kMaxResultBits = 16;
+
+// Coefficient row: bit j stands for slot start + j.
+struct Row {
+  uint64_t lo;
+  uint64_t hi;
+
+  bool empty() const { return lo == 0 && hi == 0; }
+};
+
+inline uint64_t Mix64(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+inline int Parity64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_parityll(x);
+#else
+  x ^= x >> 32;
+  x ^= x >> 16;
+  x ^= x >> 8;
+  x ^= x >> 4;
+  x ^= x >> 2;
+  x ^= x >> 1;
+  return static_cast<int>(x & 1);
+#endif
+}
+
+inline int CountTrailingZeros64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(x);
+#else
+  int n = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+// The equation of a key, derived from its 32-bit hash and the seed the
+// filter was built with.
+struct Equation {
+  uint32_t start;
+  Row row;
+  uint32_t result;
+};
+
+inline Equation MakeEquation(uint32_t hash, uint32_t seed, uint32_t num_starts,
+                             int result_bits) {
+  const uint64_t a = Mix64(hash ^ (seed * 0x9e3779b97f4a7c15ULL));
+  const uint64_t b = Mix64(a);
+  Equation eq;
+  eq.start = static_cast<uint32_t>(((a >> 32) * num_starts) >> 32);
+  eq.row.lo = b | 1;  // The first coefficient is always set
+  eq.row.hi = Mix64(b);
+  eq.result = static_cast<uint32_t>(a) & ((1u << result_bits) - 1);
+  return eq;
+}
+
+inline uint32_t RibbonHash(const Slice& key) {
+  return Hash(key.data(), key.size(), 0x7c8a5d3e);
+}
+
+// Gaussian elimination restricted to the band: rows[i] is either empty or
+// has its lowest set bit at slot i.  Returns false if some equation
+// contradicts the others, in which case the caller retries with another
+// seed or more slots.
+bool Solve(const std::vector<uint32_t>& hashes, uint32_t seed,
+           size_t num_slots, int result_bits, std::vector<Row>* rows,
+           std::vector<uint16_t>* results) {
+  rows->assign(num_slots, Row{0, 0});
+  results->assign(num_slots, 0);
+  const uint32_t num_starts = static_cast<uint32_t>(num_slots - kBandWidth + 1);
+  for (uint32_t hash : hashes) {
+    Equation eq = MakeEquation(hash, seed, num_starts, result_bits);
+    size_t i = eq.start;
+    Row row = eq.row;
+    uint32_t result = eq.result;
+    while (true) {
+      Row& existing = (*rows)[i];
+      if (existing.empty()) {
+        existing = row;
+        (*results)[i] = static_cast<uint16_t>(result);
+        break;
+      }
+      row.lo ^= existing.lo;
+      row.hi ^= existing.hi;
+      result ^= (*results)[i];
+      if (row.empty()) {
+        if (result != 0) {
+          return false;
+        }
+        break;  // Implied by the equations added so far
+      }
+      int shift = (row.lo != 0) ? CountTrailingZeros64(row.lo)
+                                : 64 + CountTrailingZeros64(row.hi);
+      i += shift;
+      if (shift >= 64) {
+        row.lo = row.hi >> (shift - 64);
+        row.hi = 0;
+      } else if (shift > 0) {
+        row.lo = (row.lo >> shift) | (row.hi << (64 - shift));
+        row.hi >>= shift;
+      }
+    }
+  }
+  return true;
+}
+
+class RibbonFilterPolicy : public FilterPolicy {
+ public:
+  explicit RibbonFilterPolicy(int bloom_equivalent_bits_per_key) {
+    // A bloom filter with b bits per key has a false positive rate of
+    // about 0.6185^b = 2^(-0.69 * b).
+    result_bits_ = static_cast<int>(bloom_equivalent_bits_per_key * 0.69 + 0.5);
+    if (result_bits_ < 1) result_bits_ = 1;
+    if (result_bits_ > kMaxResultBits) result_bits_ = kMaxResultBits;
+  }
+
+  const char* Name() const override { return "leveldb.RibbonFilter"; }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    if (n == 0) {
+      // Zero result bits marks a filter that matches nothing.
+      dst->push_back(0);
+      dst->push_back(0);
+      return;
+    }
+
+    std::vector<uint32_t> hashes(n);
+    for (int i = 0; i < n; i++) {
+      hashes[i] = RibbonHash(keys[i]);
+    }
+
+    // Larger systems need a little more slack to be solvable.
+    const double overhead = (n < 100000) ? 1.03 : 1.05;
+    size_t num_slots = static_cast<size_t>(n * overhead);
+    std::vector<Row> rows;
+    std::vector<uint16_t> results;
+    uint32_t seed = 0;
+    for (int attempt = 0;; attempt++) {
+      if (attempt > 0 && attempt % 4 == 0) {
+        num_slots += num_slots / 16;  // Unlucky; make room
+      }
+      num_slots = RoundUpSlots(num_slots);
+      seed = attempt & 0xff;
+      if (Solve(hashes, seed, num_slots, result_bits_, &rows, &results)) {
+        break;
+      }
+    }
+
+    // Back substitution, from the last slot down: "state[k]" holds result
+    // bit k of the solution for the 128 slots from i on.
+    const size_t num_blocks = num_slots / kBlockSlots;
+    std::vector<uint64_t> solution(num_blocks * result_bits_, 0);
+    Row state[kMaxResultBits] = {};
+    for (size_t i = num_slots; i-- > 0;) {
+      const Row& row = rows[i];
+      uint64_t* words = &solution[(i / kBlockSlots) * result_bits_];
+      for (int k = 0; k < result_bits_; k++) {
+        Row& s = state[k];
+        s.hi = (s.hi << 1) | (s.lo >> 63);
+        s.lo <<= 1;
+        // Slots without an equation of their own are free; leave them 0.
+        uint64_t bit = 0;
+        if (!row.empty()) {
+          bit = ((results[i] >> k) & 1) ^
+                Parity64((row.lo & s.lo) ^ (row.hi & s.hi));
+        }
+        s.lo |= bit;
+        words[k] |= bit << (i % kBlockSlots);
+      }
+    }
+
+    for (uint64_t word : solution) {
+      PutFixed64(dst, word);
+    }
+    dst->push_back(static_cast<char>(seed));
+    dst->push_back(static_cast<char>(result_bits_));
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& filter) const override {
+    const size_t len = filter.size();
+    if (len < kTrailerSize) return false;
+    const int result_bits = static_cast<uint8_t>(filter[len - 1]);
+    if (result_bits == 0) return false;  // Empty filter
+    if (result_bits > kMaxResultBits) {
+      // Reserved for potentially new encodings.  Consider it a match.
+      return true;
+    }
+    const uint32_t seed = static_cast<uint8_t>(filter[len - 2]);
+    const size_t block_bytes = 8 * result_bits;
+    const size_t num_blocks = (len - kTrailerSize) / block_bytes;
+    if (num_blocks * kBlockSlots < kBandWidth) {
+      return true;  // Corrupt; errors are treated as potential matches
+    }
+    const size_t num_slots = num_blocks * kBlockSlots;
+
+    const Equation eq =
+        MakeEquation(RibbonHash(key), seed,
+                     static_cast<uint32_t>(num_slots - kBandWidth + 1),
+                     result_bits);
+    const char* block = filter.data() + (eq.start / kBlockSlots) * block_bytes;
+    const int offset = eq.start % kBlockSlots;
+    for (int k = 0; k < result_bits; k++) {
+      // Gather the solution bits of slots [start, start + 128).  The band
+      // spans a third block only if it does not start on a block boundary.
+      const uint64_t w0 = DecodeFixed64(block + 8 * k);
+      const uint64_t w1 = DecodeFixed64(block + block_bytes + 8 * k);
+      uint64_t lo = w0, hi = w1;
+      if (offset != 0) {
+        const uint64_t w2 = DecodeFixed64(block + 2 * block_bytes + 8 * k);
+        lo = (w0 >> offset) | (w1 << (64 - offset));
+        hi = (w1 >> offset) | (w2 << (64 - offset));
+      }
+      if (Parity64((lo & eq.row.lo) ^ (hi & eq.row.hi)) !=
+          static_cast<int>((eq.result >> k) & 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  // At least one band's worth of slots, in whole blocks.
+  static size_t RoundUpSlots(size_t num_slots) {
+    if (num_slots < kBandWidth) num_slots = kBandWidth;
+    return (num_slots + kBlockSlots - 1) / kBlockSlots * kBlockSlots;
+  }
+
+  int result_bits_;
+};
+
+}  // namespace
+
+const FilterPolicy* NewRibbonFilterPolicy(int bloom_equivalent_bits_per_key) {
+  return new RibbonFilterPolicy(bloom_equivalent_bits_per_key);
+}
+
+}  // namespace leveldb
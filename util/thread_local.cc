@@ -0,0 +1,213 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/thread_local.h"
+
+#include <atomic>
+#include <cassert>
+#include <utility>
+
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/mutexlock.h"
+#include "util/no_destructor.h"
+
+namespace leveldb {
+
+// Per-thread state: one slot per ThreadLocalPtr id.  All ThreadData
+// objects are kept on a circular list so Scrape() and id reclamation can
+// reach every thread.
+struct ThreadLocalPtr::ThreadData {
+  struct Entry {
+    Entry() : ptr(nullptr) {}
+    Entry(const Entry& e) : ptr(e.ptr.load(std::memory_order_relaxed)) {}
+
+    std::atomic<void*> ptr;
+  };
+
+  ThreadData() : next(this), prev(this) {}
+
+  ThreadData* next;
+  ThreadData* prev;
+
+  // Only the owning thread grows "entries", and only while holding the
+  // StaticMeta mutex, so other threads may walk it under that mutex.
+  std::vector<Entry> entries;
+};
+
+class ThreadLocalPtr::StaticMeta {
+ public:
+  StaticMeta() : exit_handler_done_(&mutex_), next_id_(0) {}
+
+  uint32_t AcquireId(UnrefHandler handler) {
+    MutexLock l(&mutex_);
+    uint32_t id;
+    if (!free_ids_.empty()) {
+      id = free_ids_.back();
+      free_ids_.pop_back();
+      handlers_[id] = handler;
+    } else {
+      id = next_id_++;
+      handlers_.push_back(handler);
+      exit_handlers_running_.push_back(0);
+    }
+    return id;
+  }
+
+  // Clear the slot for "id" in every thread and make "id" available for
+  // reuse.  Leftover values are passed to the handler for "id".  Also
+  // waits for the handlers that exiting threads are running for "id", so
+  // that none of them runs once the owner is gone.
+  void ReclaimId(uint32_t id) {
+    std::vector<void*> leftovers;
+    UnrefHandler handler;
+    {
+      MutexLock l(&mutex_);
+      while (exit_handlers_running_[id] > 0) {
+        exit_handler_done_.Wait();
+      }
+      for (ThreadData* t = head_.next; t != &head_; t = t->next) {
+        if (id < t->entries.size()) {
+          void* ptr =
+              t->entries[id].ptr.exchange(nullptr, std::memory_order_acq_rel);
+          if (ptr != nullptr) leftovers.push_back(ptr);
+        }
+      }
+      handler = handlers_[id];
+      handlers_[id] = nullptr;
+      free_ids_.push_back(id);
+    }
+    if (handler != nullptr) {
+      for (void* ptr : leftovers) (*handler)(ptr);
+    }
+  }
+
+  void Scrape(uint32_t id, std::vector<void*>* ptrs, void* replacement) {
+    MutexLock l(&mutex_);
+    for (ThreadData* t = head_.next; t != &head_; t = t->next) {
+      if (id < t->entries.size()) {
+        void* ptr =
+            t->entries[id].ptr.exchange(replacement, std::memory_order_acq_rel);
+        if (ptr != nullptr) ptrs->push_back(ptr);
+      }
+    }
+  }
+
+  // Return the slot for "id" in the calling thread, creating it if needed.
+  std::atomic<void*>* Slot(uint32_t id) {
+    ThreadData* t = GetThreadData();
+    if (id >= t->entries.size()) {
+      MutexLock l(&mutex_);
+      t->entries.resize(id + 1);
+    }
+    return &t->entries[id].ptr;
+  }
+
+  // Like Slot() but returns nullptr instead of creating the slot.
+  std::atomic<void*>* ExistingSlot(uint32_t id) {
+    ThreadData* t = GetThreadData();
+    return (id < t->entries.size()) ? &t->entries[id].ptr : nullptr;
+  }
+
+ private:
+  // Unregisters the calling thread's ThreadData when the thread exits.
+  struct Holder {
+    Holder() : data(nullptr) {}
+    ~Holder() {
+      if (data != nullptr) Instance()->OnThreadExit(data);
+    }
+
+    ThreadData* data;
+  };
+
+  ThreadData* GetThreadData() {
+    static thread_local Holder holder;
+    if (holder.data == nullptr) {
+      ThreadData* t = new ThreadData;
+      MutexLock l(&mutex_);
+      t->next = &head_;
+      t->prev = head_.prev;
+      head_.prev->next = t;
+      head_.prev = t;
+      holder.data = t;
+    }
+    return holder.data;
+  }
+
+  // The handlers run without mutex_ held, since they may acquire locks
+  // that are held by callers of Scrape().  exit_handlers_running_ keeps
+  // ReclaimId() from returning while they run.
+  void OnThreadExit(ThreadData* t) {
+    std::vector<std::pair<uint32_t, void*>> leftovers;
+    std::vector<UnrefHandler> handlers;
+    {
+      MutexLock l(&mutex_);
+      t->prev->next = t->next;
+      t->next->prev = t->prev;
+      for (uint32_t id = 0; id < t->entries.size(); id++) {
+        void* ptr =
+            t->entries[id].ptr.exchange(nullptr, std::memory_order_acq_rel);
+        if (ptr != nullptr && handlers_[id] != nullptr) {
+          leftovers.emplace_back(id, ptr);
+          handlers.push_back(handlers_[id]);
+          exit_handlers_running_[id]++;
+        }
+      }
+    }
+    delete t;
+    for (size_t i = 0; i < leftovers.size(); i++) {
+      (*handlers[i])(leftovers[i].second);
+    }
+    if (!leftovers.empty()) {
+      MutexLock l(&mutex_);
+      for (const auto& leftover : leftovers) {
+        exit_handlers_running_[leftover.first]--;
+      }
+      exit_handler_done_.SignalAll();
+    }
+  }
+
+  port::Mutex mutex_;
+  port::CondVar exit_handler_done_;
+  uint32_t next_id_ GUARDED_BY(mutex_);
+  std::vector<uint32_t> free_ids_ GUARDED_BY(mutex_);
+  std::vector<UnrefHandler> handlers_ GUARDED_BY(mutex_);
+  // Number of exiting threads running the handler of each id.
+  std::vector<int> exit_handlers_running_ GUARDED_BY(mutex_);
+  ThreadData head_;  // Dummy head of the list of live threads
+};
+
+ThreadLocalPtr::StaticMeta* ThreadLocalPtr::Instance() {
+  static NoDestructor<StaticMeta> meta;
+  return meta.get();
+}
+
+ThreadLocalPtr::ThreadLocalPtr(UnrefHandler handler)
+    : id_(Instance()->AcquireId(handler)) {}
+
+ThreadLocalPtr::~ThreadLocalPtr() { Instance()->ReclaimId(id_); }
+
+void* ThreadLocalPtr::Get() const {
+  std::atomic<void*>* slot = Instance()->ExistingSlot(id_);
+  return (slot == nullptr) ? nullptr : slot->load(std::memory_order_acquire);
+}
+
+void ThreadLocalPtr::Reset(void* ptr) {
+  Instance()->Slot(id_)->store(ptr, std::memory_order_release);
+}
+
+void* ThreadLocalPtr::Swap(void* ptr) {
+  return Instance()->Slot(id_)->exchange(ptr, std::memory_order_acq_rel);
+}
+
+bool ThreadLocalPtr::CompareAndSwap(void* ptr, void** expected) {
+  return Instance()->Slot(id_)->compare_exchange_strong(
+      *expected, ptr, std::memory_order_acq_rel, std::memory_order_acquire);
+}
+
+void ThreadLocalPtr::Scrape(std::vector<void*>* ptrs, void* replacement) {
+  Instance()->Scrape(id_, ptrs, replacement);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,67 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// ThreadLocalPtr holds one void* per (instance, thread) pair.  Unlike a
+// plain thread_local variable, every ThreadLocalPtr instance has its own
+// set of per-thread slots, so an object such as a DB can cache state in
+// each thread that uses it.  The owner may also visit and replace the
+// values held by all threads (see Scrape()), which is what makes it
+// possible to invalidate such caches.
+//
+// Thread-safe.  Get/Reset/Swap/CompareAndSwap only touch the calling
+// thread's slot and do not acquire any lock in the common case.
+
+#ifndef STORAGE_LEVELDB_UTIL_THREAD_LOCAL_H_
+#define STORAGE_LEVELDB_UTIL_THREAD_LOCAL_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace leveldb {
+
+class ThreadLocalPtr {
+ public:
+  // Invoked with a non-null slot value when the thread owning the slot
+  // exits, or when the ThreadLocalPtr itself is destroyed.  Never called
+  // while any internal lock is held.  The destructor does not return
+  // before the calls made by exiting threads have returned.
+  typedef void (*UnrefHandler)(void* ptr);
+
+  explicit ThreadLocalPtr(UnrefHandler handler = nullptr);
+
+  ThreadLocalPtr(const ThreadLocalPtr&) = delete;
+  ThreadLocalPtr& operator=(const ThreadLocalPtr&) = delete;
+
+  ~ThreadLocalPtr();
+
+  // Return the value stored for the calling thread (nullptr if none).
+  void* Get() const;
+
+  // Store ptr for the calling thread.
+  void Reset(void* ptr);
+
+  // Store ptr for the calling thread and return the previous value.
+  void* Swap(void* ptr);
+
+  // If the calling thread's value equals *expected, replace it with ptr
+  // and return true.  Otherwise store the current value in *expected and
+  // return false.
+  bool CompareAndSwap(void* ptr, void** expected);
+
+  // Atomically replace the value of every thread with "replacement" and
+  // append the non-null previous values to *ptrs.
+  void Scrape(std::vector<void*>* ptrs, void* replacement);
+
+ private:
+  class StaticMeta;
+  struct ThreadData;
+
+  static StaticMeta* Instance();
+
+  const uint32_t id_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_THREAD_LOCAL_H_
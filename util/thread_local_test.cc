@@ -0,0 +1,143 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/thread_local.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace leveldb {
+
+namespace {
+
+std::atomic<int> unref_count(0);
+
+void CountUnref(void* ptr) { unref_count.fetch_add(1); }
+
+}  // namespace
+
+TEST(ThreadLocalTest, Basic) {
+  ThreadLocalPtr tls;
+  int a = 1, b = 2;
+  ASSERT_EQ(nullptr, tls.Get());
+  tls.Reset(&a);
+  ASSERT_EQ(&a, tls.Get());
+  ASSERT_EQ(&a, tls.Swap(&b));
+  ASSERT_EQ(&b, tls.Get());
+
+  void* expected = &a;
+  ASSERT_TRUE(!tls.CompareAndSwap(nullptr, &expected));
+  ASSERT_EQ(&b, expected);
+  ASSERT_TRUE(tls.CompareAndSwap(nullptr, &expected));
+  ASSERT_EQ(nullptr, tls.Get());
+}
+
+TEST(ThreadLocalTest, IndependentInstances) {
+  ThreadLocalPtr tls1, tls2;
+  int a = 1, b = 2;
+  tls1.Reset(&a);
+  tls2.Reset(&b);
+  ASSERT_EQ(&a, tls1.Get());
+  ASSERT_EQ(&b, tls2.Get());
+}
+
+TEST(ThreadLocalTest, PerThreadValues) {
+  ThreadLocalPtr tls;
+  int main_value = 0;
+  tls.Reset(&main_value);
+
+  std::thread t([&tls]() {
+    int thread_value = 1;
+    ASSERT_EQ(nullptr, tls.Get());
+    tls.Reset(&thread_value);
+    ASSERT_EQ(&thread_value, tls.Get());
+    tls.Reset(nullptr);
+  });
+  t.join();
+  ASSERT_EQ(&main_value, tls.Get());
+}
+
+TEST(ThreadLocalTest, Scrape) {
+  ThreadLocalPtr tls;
+  const int kNumThreads = 4;
+  int values[kNumThreads];
+  int replacement = 0;
+  std::atomic<int> ready(0);
+  std::atomic<bool> scraped(false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&, i]() {
+      tls.Reset(&values[i]);
+      ready.fetch_add(1);
+      while (!scraped.load()) std::this_thread::yield();
+      ASSERT_EQ(&replacement, tls.Get());
+      tls.Reset(nullptr);
+    });
+  }
+  while (ready.load() < kNumThreads) std::this_thread::yield();
+
+  std::vector<void*> ptrs;
+  tls.Scrape(&ptrs, &replacement);
+  scraped.store(true);
+  for (auto& t : threads) t.join();
+
+  ASSERT_EQ(kNumThreads, ptrs.size());
+  for (int i = 0; i < kNumThreads; i++) {
+    ASSERT_TRUE(std::find(ptrs.begin(), ptrs.end(), &values[i]) != ptrs.end());
+  }
+}
+
+TEST(ThreadLocalTest, HandlerOnThreadExit) {
+  ThreadLocalPtr tls(&CountUnref);
+  unref_count.store(0);
+  int value = 0;
+  std::thread t([&]() { tls.Reset(&value); });
+  t.join();
+  ASSERT_EQ(1, unref_count.load());
+
+  std::thread t2([&]() { tls.Reset(nullptr); });
+  t2.join();
+  ASSERT_EQ(1, unref_count.load());
+}
+
+TEST(ThreadLocalTest, DestructionWaitsForExitHandlers) {
+  static std::atomic<bool> handler_started;
+  static std::atomic<bool> handler_done;
+  handler_started.store(false);
+  handler_done.store(false);
+  ThreadLocalPtr* tls = new ThreadLocalPtr([](void* ptr) {
+    handler_started.store(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    handler_done.store(true);
+  });
+  int value = 0;
+  std::thread t([&]() { tls->Reset(&value); });
+  while (!handler_started.load()) {
+    std::this_thread::yield();
+  }
+  delete tls;
+  ASSERT_TRUE(handler_done.load());
+  t.join();
+}
+
+TEST(ThreadLocalTest, HandlerOnDestruction) {
+  unref_count.store(0);
+  int value = 0;
+  {
+    ThreadLocalPtr tls(&CountUnref);
+    tls.Reset(&value);
+  }
+  ASSERT_EQ(1, unref_count.load());
+
+  // The id of the destroyed instance may be reused; it must start empty.
+  ThreadLocalPtr tls(&CountUnref);
+  ASSERT_EQ(nullptr, tls.Get());
+}
+
+}  // namespace leveldb